@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./bench.h"
+
+
+#define ROUNDS          100000
+
+
+/*
+ * Build an alist of string keys and integer values, in the shape of a parsed
+ * form. Alists shorter than the index threshold are scanned linearly, so the
+ * two sizes used below time both lookup paths.
+ */
+
+
+static ag_alist *
+sample_alist(size_t len)
+{
+        ag_alist *a = ag_alist_new_empty();
+
+        for (size_t i = 0; i < len; i++) {
+                AG_AUTO(ag_string) *s = ag_string_new_fmt("field_%zu", i);
+                AG_AUTO(ag_value) *k = ag_value_new_string(s);
+                AG_AUTO(ag_value) *v = ag_value_new_int(i);
+                AG_AUTO(ag_field) *f = ag_field_new(k, v);
+
+                ag_alist_push(&a, f);
+        }
+
+        return a;
+}
+
+
+static void
+bench_alist_val(size_t len)
+{
+        AG_AUTO(ag_alist) *a = sample_alist(len);
+        ag_value **k = ag_memblock_new(len * sizeof *k);
+        ag_int sum = 0, chk = 0;
+
+        for (size_t i = 0; i < len; i++) {
+                AG_AUTO(ag_string) *s = ag_string_new_fmt("field_%zu", i);
+                k[i] = ag_value_new_string(s);
+        }
+
+        double t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_value) *v = ag_alist_val(a, k[i % len]);
+                sum += ag_value_int(v);
+        }
+
+        AG_AUTO(ag_string) *n = ag_string_new_fmt(
+            "ag_alist_val() on %zu fields", len);
+        bench_report(n, ROUNDS, 0, bench_now() - t);
+
+        for (size_t i = 0; i < ROUNDS; i++)
+                chk += i % len;
+
+        bench_check(n, sum == chk);
+
+        for (size_t i = 0; i < len; i++)
+                ag_value_release(&k[i]);
+
+        void *ptr = k;
+        ag_memblock_release(&ptr);
+}
+
+
+extern void
+bench_alist(void)
+{
+        bench_alist_val(8);
+        bench_alist_val(64);
+        bench_alist_val(500);
+}
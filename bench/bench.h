@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#ifndef __ARGENT_BENCH_BENCH_H__
+#define __ARGENT_BENCH_BENCH_H__
+
+#include "../src/argent.h"
+
+#include <time.h>
+
+
+/*
+ * The benchmarks are plain functions run in sequence by the benchmark runner;
+ * each of them times its own workloads with bench_now() and prints the results
+ * through bench_report(). Unlike the test suites, the benchmarks are not meant
+ * to pass or fail, although they do check that the work they time is correct.
+ */
+
+
+static inline double
+bench_now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+extern void     bench_report(const char *, size_t, size_t, double);
+extern void     bench_check(const char *, bool);
+
+extern void     bench_pack(void);
+extern void     bench_list(void);
+extern void     bench_alist(void);
+extern void     bench_form(void);
+extern void     bench_map(void);
+extern void     bench_omap(void);
+extern void     bench_vec(void);
+extern void     bench_seq(void);
+extern void     bench_hash(void);
+extern void     bench_uuid(void);
+extern void     bench_http(void);
+
+
+#endif /* !__ARGENT_BENCH_BENCH_H__ */
+
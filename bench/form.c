@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * Build a form-encoded body of roughly a given size out of fields that look
+ * like typical form input, with a few escaped characters in each value.
+ */
+
+
+static ag_string *
+sample_body(size_t sz, size_t *len)
+{
+        char *bfr = ag_memblock_new(sz + 64);
+        size_t n = 0, i = 0;
+
+        while (n < sz) {
+                n += snprintf(bfr + n, 64, "%sfield_%zu=some+value%%2C+no.+%zu",
+                    n ? "&" : "", i, i);
+                i++;
+        }
+
+        *len = i;
+        ag_string *s = ag_string_new(bfr);
+
+        ag_memblock *m = bfr;
+        ag_memblock_release(&m);
+
+        return s;
+}
+
+
+/*
+ * Parse a body the way the server used to: url-decode the whole body, then
+ * split it with ag_alist_parse().
+ */
+
+
+static ag_alist *
+parse_legacy(const ag_string *body)
+{
+        AG_AUTO(ag_string) *s = ag_string_url_decode(body);
+        return ag_alist_parse(s, "=", "&");
+}
+
+
+static void
+bench_form_sz(const char *label, size_t sz, size_t rounds)
+{
+        size_t len;
+        AG_AUTO(ag_string) *body = sample_body(sz, &len);
+        size_t bytes = ag_string_sz(body) - 1;
+        char name[64];
+        double t;
+
+        t = bench_now();
+        for (size_t i = 0; i < rounds; i++) {
+                AG_AUTO(ag_alist) *a = parse_legacy(body);
+                bench_check("ag_alist_parse()", ag_alist_len(a) == len);
+        }
+        snprintf(name, sizeof name, "ag_alist_parse() of a %s form", label);
+        bench_report(name, rounds, bytes * rounds, bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < rounds; i++) {
+                AG_AUTO(ag_alist) *a = ag_alist_parse_form(body);
+                bench_check("ag_alist_parse_form()", ag_alist_len(a) == len);
+        }
+        snprintf(name, sizeof name, "ag_alist_parse_form() of a %s form",
+            label);
+        bench_report(name, rounds, bytes * rounds, bench_now() - t);
+}
+
+
+extern void
+bench_form(void)
+{
+        bench_form_sz("1 KB", 1024, 1000);
+        bench_form_sz("64 KB", 64 * 1024, 10);
+        bench_form_sz("1 MB", 1024 * 1024, 1);
+}
@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./bench.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+
+#define ROUNDS  20000
+#define DEPTH   16
+#define ROUTES  64
+
+
+/*
+ * Time requests to a server with the HTTP backend, forked and listening on a
+ * UNIX socket so that the numbers do not depend on the network setup, with a
+ * single worker thread. The client sends a minimal GET request, first waiting
+ * for each response over a kept-alive connection, and then pipelining DEPTH
+ * requests at a time. The route is served by bench_http_hello(). The server
+ * masks out debug messages, which a debug build of the library would otherwise
+ * log for every CGI variable of every request. Beforehand, router_run() times
+ * the route lookups on their own.
+ */
+
+extern void      bench_http_hello(const ag_http_request *);
+static void      router_run(void);
+static int       client_connect(const char *);
+static bool      client_run(int, const char *, size_t, size_t, size_t);
+
+
+extern void
+bench_http(void)
+{
+        char sock[64], bfr[4096];
+        const char *req = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        size_t rlen = strlen(req);
+
+        router_run();
+
+        snprintf(sock, sizeof sock, "/tmp/argent-bench-%d.sock", getpid());
+
+        pid_t pid = fork();
+
+        if (!pid) {
+                setlogmask(LOG_UPTO(LOG_INFO));
+
+                struct ag_http_server_opt opt = {.threads = 1, .listen = sock,
+                    .backend = AG_HTTP_SERVER_HTTP};
+                ag_http_server_init(&opt);
+
+                AG_AUTO(ag_plugin) *p = ag_plugin_new_local("bench_http_hello");
+                ag_http_server_register("/hello", p);
+
+                ag_http_server_run();
+                _exit(EXIT_SUCCESS);
+        }
+
+        int fd = client_connect(sock);
+        ssize_t n = fd < 0 ? -1 : write(fd, req, rlen);
+        ssize_t len = n == (ssize_t)rlen ? read(fd, bfr, sizeof bfr) : -1;
+
+        bench_check("HTTP backend", len > 0
+            && !strncmp(bfr, "HTTP/1.1 200 OK\r\n", 17));
+
+        for (size_t i = 0; i < DEPTH; i++)
+                memcpy(bfr + i * rlen, req, rlen);
+
+        double t = bench_now();
+        bool ok = client_run(fd, bfr, rlen, len, 1);
+        bench_report("HTTP backend, keep-alive", ROUNDS, 0, bench_now() - t);
+
+        t = bench_now();
+        ok &= client_run(fd, bfr, rlen, len, DEPTH);
+        bench_report("HTTP backend, pipelined", ROUNDS, 0, bench_now() - t);
+
+        bench_check("HTTP backend", ok);
+
+        close(fd);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        unlink(sock);
+}
+
+
+extern void
+bench_http_hello(const ag_http_request *req)
+{
+        (void)req;
+
+        AG_AUTO(ag_http_response) *r = ag_http_response_new(
+            AG_HTTP_MIME_TEXT_PLAIN, AG_HTTP_STATUS_200_OK, "Hello, world!");
+        ag_http_server_respond(r);
+}
+
+
+/*
+ * Time route lookups in a router holding ROUTES resources, each with a static
+ * route and a route capturing an id, for a path that needs a capture and for
+ * one that only has static segments.
+ */
+static void
+router_run(void)
+{
+        struct ag_http_router *r = __ag_http_router_new__();
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("bench_http_hello");
+        const char *path[] = {"/api/v1/res37/1234", "/api/v1/res37"};
+        const char *name[] = {"router lookup, with capture",
+            "router lookup, static"};
+        struct ag_http_route rt;
+        char pat[64];
+        bool ok = true;
+
+        for (size_t i = 0; i < ROUTES; i++) {
+                snprintf(pat, sizeof pat, "/api/v1/res%zu", i);
+                __ag_http_router_add__(r, NULL, pat, p);
+
+                snprintf(pat, sizeof pat, "/api/v1/res%zu/:id", i);
+                __ag_http_router_add__(r, NULL, pat, p);
+        }
+
+        for (size_t i = 0; i < 2; i++) {
+                double t = bench_now();
+
+                for (size_t j = 0; j < ROUNDS * 50; j++) {
+                        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, path[i],
+                            &rt);
+                        ok &= rt.ncap == 1 - i;
+                        ag_plugin_release(&rt.hnd);
+                }
+
+                bench_report(name[i], ROUNDS * 50, 0, bench_now() - t);
+        }
+
+        bench_check("router lookup", ok);
+        __ag_http_router_release__(&r);
+}
+
+
+static int
+client_connect(const char *sock)
+{
+        struct sockaddr_un sa = {.sun_family = AF_UNIX};
+        strcpy(sa.sun_path, sock);
+
+        for (register int i = 0; i < 200; i++) {
+                int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+                if (fd < 0 || !connect(fd, (struct sockaddr *)&sa, sizeof sa))
+                        return fd;
+
+                close(fd);
+                usleep(10000);
+        }
+
+        return -1;
+}
+
+
+/*
+ * Send ROUNDS requests, depth at a time from a buffer holding depth copies of
+ * the request, and read back the responses, which are all of the given length.
+ */
+static bool
+client_run(int fd, const char *req, size_t rlen, size_t resp, size_t depth)
+{
+        char bfr[65536];
+
+        for (size_t i = 0; i < ROUNDS; i += depth) {
+                size_t want = resp * depth;
+
+                if (write(fd, req, rlen * depth) != (ssize_t)(rlen * depth))
+                        return false;
+
+                while (want) {
+                        ssize_t n = read(fd, bfr, want < sizeof bfr ? want
+                            : sizeof bfr);
+
+                        if (n <= 0)
+                                return false;
+
+                        want -= n;
+                }
+        }
+
+        return true;
+}
@@ -0,0 +1,205 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./bench.h"
+
+
+#define LIST_LEN        10000
+#define ROUNDS          1000
+
+
+/*
+ * Build a list of integers. Integers are boxed values, so copying them is cheap
+ * and the timings below are dominated by the work done on the list itself.
+ */
+
+
+static ag_list *
+sample_list(void)
+{
+        ag_list *l = ag_list_new();
+
+        for (size_t i = 0; i < LIST_LEN; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i);
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
+/*
+ * Time the sorting functions on a scrambled list of integers and of strings,
+ * both through the radix sort fast path and through a comparator, which takes
+ * the comparison sort path, and binary search on the sorted result.
+ */
+
+
+static enum ag_cmp
+sort_cmp(const ag_value *lhs, const ag_value *rhs, void *in)
+{
+        (void)in;
+        return ag_value_cmp(lhs, rhs);
+}
+
+
+static void
+bench_list_sort(void)
+{
+        AG_AUTO(ag_list) *l = ag_list_new();
+        AG_AUTO(ag_list) *ls = ag_list_new();
+        double t;
+
+        for (size_t i = 0; i < LIST_LEN; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i * 7919 % LIST_LEN);
+                AG_AUTO(ag_string) *s = ag_string_new_fmt("key/%zu",
+                    i * 7919 % LIST_LEN);
+                AG_AUTO(ag_value) *v2 = ag_value_new_string(s);
+
+                ag_list_push(&l, v);
+                ag_list_push(&ls, v2);
+        }
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / 10; i++) {
+                AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+                ag_list_sort(&l2, NULL, NULL);
+        }
+        bench_report("ag_list_sort() of 10000 integers", ROUNDS / 10, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / 10; i++) {
+                AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+                ag_list_sort(&l2, sort_cmp, NULL);
+        }
+        bench_report("ag_list_sort() of 10000 integers, cmp",
+            ROUNDS / 10, 0, bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / 10; i++) {
+                AG_AUTO(ag_list) *l2 = ag_list_copy(ls);
+                ag_list_sort(&l2, NULL, NULL);
+        }
+        bench_report("ag_list_sort() of 10000 strings", ROUNDS / 10, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / 10; i++) {
+                AG_AUTO(ag_list) *l2 = ag_list_copy(ls);
+                ag_list_sort_stable(&l2, sort_cmp, NULL);
+        }
+        bench_report("ag_list_sort_stable() of 10000 strings, cmp",
+            ROUNDS / 10, 0, bench_now() - t);
+
+        ag_list_sort(&l, NULL, NULL);
+        size_t hit = 0;
+
+        t = bench_now();
+        for (size_t i = 0; i < LIST_LEN; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i);
+                hit += ag_list_search(l, v, NULL, NULL) == i + 1;
+        }
+        bench_report("ag_list_search() on every value", LIST_LEN, 0,
+            bench_now() - t);
+
+        bench_check("ag_list_search()", hit == LIST_LEN);
+}
+
+
+extern void
+bench_list(void)
+{
+        AG_AUTO(ag_list) *l = sample_list();
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+        double t;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+                ag_list_set_at(&l2, v, 1 + i * 7 % LIST_LEN);
+        }
+        bench_report("ag_list_set_at() on a shared list", ROUNDS, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+                ag_list_start(&l2);
+                ag_list_next(&l2);
+        }
+        bench_report("ag_list_next() on a shared list", ROUNDS, 0,
+            bench_now() - t);
+
+        ag_int sum = 0;
+
+        t = bench_now();
+        for (size_t i = 1; i <= LIST_LEN; i++) {
+                AG_AUTO(ag_value) *v2 = ag_list_get_at(l, i);
+                sum += ag_value_int(v2);
+        }
+        bench_report("ag_list_get_at() on every index", LIST_LEN, 0,
+            bench_now() - t);
+
+        bench_check("ag_list_get_at()",
+            sum == (ag_int)LIST_LEN * (LIST_LEN - 1) / 2);
+
+        sum = 0;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+                ag_list_cursor c;
+
+                ag_list_cursor_init(&c, l2);
+                while (ag_list_cursor_next(&c))
+                        sum += ag_value_int(ag_list_cursor_get(&c));
+        }
+        bench_report("ag_list_cursor_next() on a shared list", ROUNDS * LIST_LEN,
+            0, bench_now() - t);
+
+        bench_check("ag_list_cursor_next()",
+            sum == (ag_int)ROUNDS * LIST_LEN * (LIST_LEN - 1) / 2);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / 10; i++) {
+                AG_AUTO(ag_list) *l2 = sample_list();
+        }
+        bench_report("ag_list_push() of 10000 values", ROUNDS / 10, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / 10; i++) {
+                AG_AUTO(ag_list) *l2 = ag_list_new();
+                ag_list_reserve(&l2, LIST_LEN);
+
+                for (size_t j = 0; j < LIST_LEN; j++) {
+                        AG_AUTO(ag_value) *v2 = ag_value_new_int(j);
+                        ag_list_push(&l2, v2);
+                }
+        }
+        bench_report("ag_list_push() of 10000 values, reserved", ROUNDS / 10,
+            0, bench_now() - t);
+
+        bench_list_sort();
+}
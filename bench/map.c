@@ -0,0 +1,97 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./bench.h"
+
+
+#define MAP_LEN         10000
+#define ROUNDS          100000
+
+
+/*
+ * Build a map of integers to integers. Integer keys hash cheaply, so the
+ * timings below are dominated by the work done on the trie itself.
+ */
+
+
+static ag_map *
+sample_map(void)
+{
+        ag_map *m = ag_map_new();
+
+        for (size_t i = 0; i < MAP_LEN; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                ag_map_set(&m, k, k);
+        }
+
+        return m;
+}
+
+
+extern void
+bench_map(void)
+{
+        double t;
+
+        t = bench_now();
+        for (size_t i = 0; i < 10; i++) {
+                AG_AUTO(ag_map) *m = sample_map();
+        }
+        bench_report("ag_map_set() of 10000 keys", 10, 0, bench_now() - t);
+
+        AG_AUTO(ag_map) *m = sample_map();
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+        ag_int sum = 0, chk = 0;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i % MAP_LEN);
+                AG_AUTO(ag_value) *v2 = ag_map_get(m, k);
+
+                sum += ag_value_int(v2);
+                chk += i % MAP_LEN;
+        }
+        bench_report("ag_map_get() on 10000 keys", ROUNDS, 0, bench_now() - t);
+        bench_check("ag_map_get()", sum == chk);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i % MAP_LEN);
+                AG_AUTO(ag_map) *m2 = ag_map_copy(m);
+
+                ag_map_set(&m2, k, v);
+        }
+        bench_report("ag_map_set() on a fork of 10000 keys", ROUNDS, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i % MAP_LEN);
+                AG_AUTO(ag_map) *m2 = ag_map_copy(m);
+
+                ag_map_remove(&m2, k);
+        }
+        bench_report("ag_map_remove() on a fork of 10000 keys", ROUNDS, 0,
+            bench_now() - t);
+
+        bench_check("ag_map_len()", ag_map_len(m) == MAP_LEN);
+}
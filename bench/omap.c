@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./bench.h"
+
+
+#define OMAP_LEN        10000
+#define ROUNDS          100000
+#define RANGE_LEN       100
+
+
+/*
+ * Build a list of fields of integers to integers in ascending order of keys,
+ * ready to be bulk loaded into an ordered map.
+ */
+
+
+static ag_list *
+sample_list(void)
+{
+        ag_list *l = ag_list_new();
+
+        for (size_t i = 0; i < OMAP_LEN; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_field) *f = ag_field_new(k, k);
+                AG_AUTO(ag_value) *v = ag_value_new_object(f);
+
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
+static bool
+iterator(const ag_value *key, const ag_value *val, void *in, void *out)
+{
+        (void)key;
+        (void)in;
+        ag_int *sum = out;
+
+        *sum += ag_value_int(val);
+        return true;
+}
+
+
+extern void
+bench_omap(void)
+{
+        AG_AUTO(ag_list) *l = sample_list();
+        double t;
+
+        t = bench_now();
+        for (size_t i = 0; i < 10; i++) {
+                AG_AUTO(ag_omap) *m = ag_omap_new();
+
+                for (size_t j = 0; j < OMAP_LEN; j++) {
+                        AG_AUTO(ag_value) *k = ag_value_new_int(j);
+                        ag_omap_set(&m, k, k);
+                }
+        }
+        bench_report("ag_omap_set() of 10000 keys", 10, 0, bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < 10; i++) {
+                AG_AUTO(ag_omap) *m = ag_omap_new_list(l);
+        }
+        bench_report("ag_omap_new_list() of 10000 keys", 10, 0,
+            bench_now() - t);
+
+        AG_AUTO(ag_omap) *m = ag_omap_new_list(l);
+        ag_int sum = 0, chk = 0;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i % OMAP_LEN);
+                AG_AUTO(ag_value) *v = ag_omap_get(m, k);
+
+                sum += ag_value_int(v);
+                chk += i % OMAP_LEN;
+        }
+        bench_report("ag_omap_get() on 10000 keys", ROUNDS, 0,
+            bench_now() - t);
+        bench_check("ag_omap_get()", sum == chk);
+
+        sum = chk = 0;
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / RANGE_LEN; i++) {
+                register size_t lo = (i * RANGE_LEN) % (OMAP_LEN - RANGE_LEN);
+                AG_AUTO(ag_value) *k = ag_value_new_int(lo);
+                AG_AUTO(ag_value) *k2 = ag_value_new_int(lo + RANGE_LEN);
+
+                ag_omap_range(m, k, k2, iterator, NULL, &sum);
+
+                for (size_t j = lo; j < lo + RANGE_LEN; j++)
+                        chk += j;
+        }
+        bench_report("ag_omap_range() of 100 keys", ROUNDS / RANGE_LEN, 0,
+            bench_now() - t);
+        bench_check("ag_omap_range()", sum == chk);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i % OMAP_LEN);
+                AG_AUTO(ag_omap) *m2 = ag_omap_copy(m);
+
+                ag_omap_remove(&m2, k);
+        }
+        bench_report("ag_omap_remove() on a fork of 10000 keys", ROUNDS, 0,
+            bench_now() - t);
+
+        bench_check("ag_omap_len()", ag_omap_len(m) == OMAP_LEN);
+}
@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./bench.h"
+
+
+#define LIST_LEN        10000
+#define ALIST_LEN       16
+#define ROUNDS          20
+
+
+/*
+ * Build a list of mixed values, with every tenth value being an association
+ * list of string pairs, so that the workload exercises scalars, strings, and
+ * nested objects.
+ */
+
+
+static ag_list *
+sample_list(void)
+{
+        ag_list *l = ag_list_new();
+        AG_AUTO(ag_alist) *a = ag_alist_new_empty();
+
+        for (size_t i = 0; i < ALIST_LEN; i++) {
+                AG_AUTO(ag_string) *ks = ag_string_new_fmt("key-%lu", i);
+                AG_AUTO(ag_string) *vs = ag_string_new_fmt("value-%lu", i);
+                AG_AUTO(ag_value) *k = ag_value_new_string(ks);
+                AG_AUTO(ag_value) *v = ag_value_new_string(vs);
+                AG_AUTO(ag_field) *f = ag_field_new(k, v);
+
+                ag_alist_push(&a, f);
+        }
+
+        for (size_t i = 0; i < LIST_LEN; i++) {
+                AG_AUTO(ag_value) *v = NULL;
+                AG_AUTO(ag_string) *s = NULL;
+
+                switch (i % 5) {
+                case 0:
+                        v = ag_value_new_int(-(ag_int)i * 1000);
+                        break;
+                case 1:
+                        v = ag_value_new_uint(i);
+                        break;
+                case 2:
+                        v = ag_value_new_float(i / 7.0);
+                        break;
+                case 3:
+                        s = ag_string_new_fmt("string value number %lu", i);
+                        v = ag_value_new_string(s);
+                        break;
+                default:
+                        v = i % 10 == 4 ? ag_value_new_object(a)
+                            : ag_value_new_int(i);
+                }
+
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
+extern void
+bench_pack(void)
+{
+        AG_AUTO(ag_list) *l = sample_list();
+        AG_AUTO(ag_pack) *pk = NULL;
+        double t;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                ag_pack_release(&pk);
+                pk = ag_pack_new();
+                ag_object_pack(l, pk);
+        }
+        bench_report("ag_object_pack() mixed list", ROUNDS,
+            ROUNDS * ag_pack_len(pk), bench_now() - t);
+
+        struct ag_unpack rd;
+        ag_list *l2 = NULL;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                ag_list_release(&l2);
+                ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+                l2 = ag_object_unpack(&rd);
+        }
+        bench_report("ag_object_unpack() mixed list", ROUNDS,
+            ROUNDS * ag_pack_len(pk), bench_now() - t);
+
+        bench_check("ag_object_unpack()", ag_list_eq(l, l2));
+        ag_list_release(&l2);
+
+        size_t len, n = 0, chars = 0;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+                (void)ag_unpack_ext(&rd, &len);
+                (void)ag_unpack_int(&rd);
+                n = ag_unpack_array(&rd);
+
+                for (size_t j = 0; j < n; j++) {
+                        if (ag_unpack_type(&rd) == AG_PACK_TYPE_STR)
+                                chars += ag_unpack_str(&rd, &len) ? len : 0;
+                        else
+                                ag_unpack_skip(&rd);
+                }
+        }
+        bench_report("ag_unpack_str() zero-copy scan of mixed list", ROUNDS,
+            ROUNDS * ag_pack_len(pk), bench_now() - t);
+
+        bench_check("ag_unpack_str()", n == LIST_LEN && chars);
+}
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+extern void
+bench_report(const char *name, size_t ops, size_t bytes, double secs)
+{
+        printf("%-48s %10.0f ops/s", name, ops / secs);
+
+        if (bytes)
+                printf(" %10.1f MB/s", bytes / secs / 1e6);
+
+        printf("\n");
+}
+
+
+extern void
+bench_check(const char *name, bool pass)
+{
+        if (!pass) {
+                printf("[!] %s produced an incorrect result\n", name);
+                ag_exit(EXIT_FAILURE);
+        }
+}
+
+
+int main(int argc, char **argv)
+{
+        ag_init(argc, argv);
+
+        bench_pack();
+        bench_list();
+        bench_alist();
+        bench_form();
+        bench_map();
+        bench_omap();
+        bench_vec();
+        bench_seq();
+        bench_hash();
+        bench_uuid();
+        bench_http();
+
+        ag_exit(EXIT_SUCCESS);
+        return 0;
+}
+
@@ -0,0 +1,103 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./bench.h"
+
+
+#define LIST_LEN        10000
+#define ROUNDS          100
+
+
+/*
+ * The callbacks for the pipeline; both the eager and the lazy versions keep
+ * the even integers, scale them by ten, and keep the first few results.
+ */
+
+
+static bool
+even(const ag_value *val, void *in)
+{
+        (void)in;
+
+        return !(ag_value_int(val) % 2);
+}
+
+
+static ag_value *
+tenfold(const ag_value *val, void *in)
+{
+        (void)in;
+
+        return ag_value_new_int(ag_value_int(val) * 10);
+}
+
+
+extern void
+bench_seq(void)
+{
+        AG_AUTO(ag_list) *l = ag_list_new();
+        size_t n = 0;
+        double t;
+
+        for (ag_int i = 1; i <= LIST_LEN; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i);
+                ag_list_push(&l, v);
+        }
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_list) *f = ag_list_pfilter(l, even, NULL, 0);
+                AG_AUTO(ag_list) *m = ag_list_pmap(f, tenfold, NULL, 0);
+                n += ag_list_len(m);
+        }
+        bench_report("filter then map, eager lists", ROUNDS * LIST_LEN, 0,
+            bench_now() - t);
+
+        bench_check("eager pipeline", n == ROUNDS * LIST_LEN / 2);
+        n = 0;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_seq) *s = ag_seq_map(ag_seq_filter(
+                    ag_seq_from_list(l), even, NULL), tenfold, NULL);
+                AG_AUTO(ag_list) *m = ag_seq_collect(s);
+                n += ag_list_len(m);
+        }
+        bench_report("filter then map, ag_seq", ROUNDS * LIST_LEN, 0,
+            bench_now() - t);
+
+        bench_check("ag_seq pipeline", n == ROUNDS * LIST_LEN / 2);
+        n = 0;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS * 100; i++) {
+                AG_AUTO(ag_seq) *s = ag_seq_take(ag_seq_map(ag_seq_filter(
+                    ag_seq_from_list(l), even, NULL), tenfold, NULL), 10);
+                AG_AUTO(ag_list) *m = ag_seq_collect(s);
+                n += ag_list_len(m);
+        }
+        bench_report("filter, map and take 10, ag_seq", ROUNDS * 100, 0,
+            bench_now() - t);
+
+        bench_check("ag_seq take", n == ROUNDS * 100 * 10);
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./bench.h"
+
+#include <uuid/uuid.h>
+
+
+#define ROUNDS  1000000
+
+
+/*
+ * Time UUID generation on a single thread, so the rates are per core: libuuid's
+ * uuid_generate_random(), which ag_uuid_new() used to call, against the
+ * buffered version 4 and the version 7 generators, both generating in place and
+ * allocating through ag_uuid_new_version().
+ */
+
+extern void
+bench_uuid(void)
+{
+        ag_uuid u;
+        uuid_t lu;
+        double t;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++)
+                uuid_generate_random(lu);
+        bench_report("uuid_generate_random() per core", ROUNDS, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++)
+                ag_uuid_generate(&u, AG_UUID_V4);
+        bench_report("ag_uuid_generate(), v4, per core", ROUNDS, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++)
+                ag_uuid_generate(&u, AG_UUID_V7);
+        bench_report("ag_uuid_generate(), v7, per core", ROUNDS, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                AG_AUTO(ag_uuid) *u2 = ag_uuid_new_version(AG_UUID_V7);
+        }
+        bench_report("ag_uuid_new_version(), v7, per core", ROUNDS, 0,
+            bench_now() - t);
+
+        bench_check("ag_uuid_generate()", (u.uuid[6] >> 4) == 7);
+}
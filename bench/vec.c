@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./bench.h"
+
+
+#define VEC_LEN         10000
+#define ROUNDS          1000
+
+
+/*
+ * Build an integer vector and a list holding the same integers, so that the
+ * reductions over the unboxed vector can be compared against the same work done
+ * through a list cursor.
+ */
+
+
+static ag_vec_int *
+sample_vec(void)
+{
+        ag_vec_int *v = ag_vec_int_new();
+        ag_vec_int_reserve(&v, VEC_LEN);
+
+        for (ag_int i = 0; i < VEC_LEN; i++)
+                ag_vec_int_push(&v, (i * 7919) % VEC_LEN);
+
+        return v;
+}
+
+
+extern void
+bench_vec(void)
+{
+        AG_AUTO(ag_vec_int) *v = sample_vec();
+        AG_AUTO(ag_list) *l = ag_vec_int_list(v);
+        ag_int sum = 0;
+        double t;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++) {
+                ag_list_cursor c;
+
+                ag_list_cursor_init(&c, l);
+                while (ag_list_cursor_next(&c))
+                        sum += ag_value_int(ag_list_cursor_get(&c));
+        }
+        bench_report("sum of a list of integers", ROUNDS * VEC_LEN, 0,
+            bench_now() - t);
+
+        bench_check("list sum",
+            sum == (ag_int)ROUNDS * VEC_LEN * (VEC_LEN - 1) / 2);
+
+        sum = 0;
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++)
+                sum += ag_vec_int_sum(v);
+        bench_report("ag_vec_int_sum()", ROUNDS * VEC_LEN, 0,
+            bench_now() - t);
+
+        bench_check("ag_vec_int_sum()",
+            sum == (ag_int)ROUNDS * VEC_LEN * (VEC_LEN - 1) / 2);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS; i++)
+                sum = ag_vec_int_max(v) - ag_vec_int_min(v);
+        bench_report("ag_vec_int_min() and ag_vec_int_max()", ROUNDS * VEC_LEN,
+            0, bench_now() - t);
+
+        bench_check("ag_vec_int_max()", sum == VEC_LEN - 1);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / 10; i++) {
+                AG_AUTO(ag_vec_int) *v2 = ag_vec_int_copy(v);
+                ag_vec_int_sort(&v2);
+        }
+        bench_report("ag_vec_int_sort() of 10000 integers", ROUNDS / 10, 0,
+            bench_now() - t);
+
+        t = bench_now();
+        for (size_t i = 0; i < ROUNDS / 10; i++) {
+                AG_AUTO(ag_vec_int) *v2 = ag_vec_int_new_list(l);
+        }
+        bench_report("ag_vec_int_new_list() of 10000 integers", ROUNDS / 10,
+            0, bench_now() - t);
+}
@@ -28,6 +28,10 @@
 #include "ds/alist.h"
 #include "ds/field.h"
 #include "ds/list.h"
+#include "ds/map.h"
+#include "ds/omap.h"
+#include "ds/seq.h"
+#include "ds/vec.h"
 #include "ex/erno.h"
 #include "ex/exception.h"
 #include "http/http.h"
@@ -35,12 +39,14 @@
 #include "type/primitives.h"
 #include "type/string.h"
 #include "type/typeid.h"
+#include "type/pack.h"
 #include "type/object.h"
 #include "type/value.h"
 #include "util/registry.h"
 #include "util/hash.h"
 #include "util/uuid.h"
 #include "util/plugin.h"
+#include "util/pool.h"
 #include "util/manager.h"
 
 #endif /* !__ARGENT_INCLUDE_ARGENT_H__ */
@@ -142,6 +142,7 @@ extern AG_NONULL ag_memblock    *ag_memblock_clone(const ag_memblock *);
 extern AG_NONULL ag_memblock    *ag_memblock_clone_align(const ag_memblock *, 
                                     size_t);
 extern void                      ag_memblock_release(ag_memblock **);
+extern bool                      ag_memblock_release_last(ag_memblock **);
 extern AG_NONULL enum ag_cmp     ag_memblock_cmp(const ag_memblock *, 
                                     const ag_memblock *cmp); // 1.
 extern AG_NONULL size_t          ag_memblock_sz(const ag_memblock *);
@@ -153,6 +154,8 @@ extern AG_NONULL void            ag_memblock_resize(ag_memblock **, size_t);
 extern AG_NONULL void            ag_memblock_resize_align(ag_memblock **,
                                     size_t, size_t);
 extern AG_NONULL ag_string      *ag_memblock_str(const ag_memblock *);
+extern AG_NONULL void            ag_memblock_freeze(ag_memblock *);
+extern AG_NONULL bool            ag_memblock_frozen(const ag_memblock *);
 
 AG_NONULL inline bool
 ag_memblock_lt(const ag_memblock *ctx, const ag_memblock *cmp)
@@ -28,12 +28,14 @@
 
 /*******************************************************************************
  * The global variable `g_init` is used to track whether or not the logging unit
- * has been initialised, and is required only for release builds. As is the norm
- * for Argent, we specify every static global variable to be thread-local.
+ * has been initialised, and is required only for debug builds. Although it is
+ * the norm for Argent to specify every static global variable to be
+ * thread-local, `g_init` is shared by all threads since the syslog connection
+ * it tracks is opened once per process, and worker threads log too.
  */
 
 #ifndef NDEBUG
-        static AG_THREADLOCAL bool      g_init = false;
+        static bool     g_init = false;
 #endif
 
 
@@ -60,6 +60,19 @@ extern inline bool      ag_memblock_gt(const ag_memblock *,
 #define ASSERT_HND(H)   AG_ASSERT (*H && "memory handle valid")
 
 
+/*******************************************************************************
+ * A frozen memory block is marked by a sentinel reference count that is never
+ * modified again, so copying and releasing a frozen block don't write to it.
+ * Reference counts are otherwise updated atomically, and owners that have to
+ * release the contents of a block decide to do so on the result of dropping
+ * their reference through ag_memblock_release_last(), never on a prior read of
+ * the count, since two threads dropping the last two references at once would
+ * both see a count of 2 and leak the contents.
+ */
+
+#define REFC_FROZEN     SIZE_MAX
+
+
 /*******************************************************************************
  *
  */
@@ -116,7 +129,9 @@ ag_memblock *
 ag_memblock_copy(const ag_memblock *ctx)
 {
         ag_memblock *cp = (ag_memblock *)ctx;
-        ((size_t *)cp)[-2]++;
+
+        if (AG_LIKELY (meta_refc(cp) != REFC_FROZEN))
+                __atomic_add_fetch(&((size_t *)cp)[-2], 1, __ATOMIC_RELAXED);
 
         return cp;
 }
@@ -164,7 +179,8 @@ ag_memblock_release(ag_memblock **ctx)
         size_t *hnd;
 
         if (AG_LIKELY (ctx && (hnd = (size_t *)*ctx))) {
-                if (!(--hnd[-2]))
+                if (AG_LIKELY (meta_refc(hnd) != REFC_FROZEN)
+                    && !__atomic_sub_fetch(&hnd[-2], 1, __ATOMIC_ACQ_REL))
                         free(&hnd[-2]);
                         
                 *ctx = NULL;
@@ -172,6 +188,37 @@ ag_memblock_release(ag_memblock **ctx)
 }
 
 
+/*******************************************************************************
+ * Drop a reference to a memory block, returning true if it was the last one.
+ * In that case the block is kept alive with a reference count of 1 and the
+ * handle left intact, so that the caller can release the contents of the block
+ * before freeing it with ag_memblock_release(). Otherwise the handle is reset
+ * to null. A sole owner skips the atomic decrement, since no other thread can
+ * hold a reference through which to copy the block.
+ */
+
+bool
+ag_memblock_release_last(ag_memblock **ctx)
+{
+        size_t *hnd;
+
+        if (AG_UNLIKELY (!ctx || !(hnd = (size_t *)*ctx)))
+                return false;
+
+        if (__atomic_load_n(&hnd[-2], __ATOMIC_ACQUIRE) == 1)
+                return true;
+
+        if (AG_LIKELY (meta_refc(hnd) != REFC_FROZEN)
+            && !__atomic_sub_fetch(&hnd[-2], 1, __ATOMIC_ACQ_REL)) {
+                __atomic_store_n(&hnd[-2], 1, __ATOMIC_RELAXED);
+                return true;
+        }
+
+        *ctx = NULL;
+        return false;
+}
+
+
 /*******************************************************************************
  *
  */
@@ -286,6 +333,28 @@ ag_memblock_str(const ag_memblock *ctx)
 }
 
 
+/*******************************************************************************
+ *
+ */
+
+void
+ag_memblock_freeze(ag_memblock *ctx)
+{
+        ((size_t *)ctx)[-2] = REFC_FROZEN;
+}
+
+
+/*******************************************************************************
+ *
+ */
+
+bool
+ag_memblock_frozen(const ag_memblock *ctx)
+{
+        return meta_refc(ctx) == REFC_FROZEN;
+}
+
+
 /*******************************************************************************
  *
  */
@@ -315,6 +384,6 @@ meta_sz(const ag_memblock *ctx)
 size_t
 meta_refc(const ag_memblock *ctx)
 {
-        return ((size_t *)ctx)[-2];
+        return __atomic_load_n(&((size_t *)ctx)[-2], __ATOMIC_RELAXED);
 }
 
@@ -22,43 +22,131 @@
 
 #include "../argent.h"
 
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+
+extern inline bool              ag_alist_cursor_next(ag_alist_cursor *);
+extern inline const ag_field   *ag_alist_cursor_get(const ag_alist_cursor *);
+
+
+#define CHUNK_LEN 32
+#define INDEX_MIN 16
+
+
+/*
+ * Each chunk keeps its fields in a struct-of-arrays layout: alongside the field
+ * pointers, it caches the hash, key and value of each field in parallel arrays.
+ * Key lookups scan the dense hash array and only compare keys on a hash hit,
+ * instead of chasing the field, payload and key pointers for every field.
+ */
+struct chunk {
+        size_t           len;             /* number of fields */
+        ag_hash          hash[CHUNK_LEN]; /* key hashes       */
+        const ag_value  *key[CHUNK_LEN];  /* field keys       */
+        const ag_value  *val[CHUNK_LEN];  /* field values     */
+        ag_field        *attr[CHUNK_LEN]; /* chunk fields     */
+};
+
+
+/*
+ * As with lists, the chunks are held by a spine that is a trie of nodes with
+ * NODE_LEN slots each, and that is shared between copies of an alist; mutating
+ * a shared alist only copies the nodes on the path to the chunk it touches.
+ */
+#define NODE_BITS 5
+#define NODE_LEN  (1 << NODE_BITS)
+#define NODE_MASK (NODE_LEN - 1)
+
 
 struct node {
-        ag_field        *attr; /* node field */
-        struct node     *nxt; /* next node  */
+        union {
+                struct node     *node;  /* child node above height 1 */
+                struct chunk    *chunk; /* chunk at height 1         */
+        } slot[NODE_LEN];
+};
+
+
+struct slot {
+        ag_hash          hash; /* key hash                 */
+        size_t           pos;  /* field position + 1, or 0 */
+};
+
+
+struct index {
+        size_t           cap;    /* number of slots, power of 2 */
+        struct slot      slot[]; /* open-addressed slots        */
 };
 
 
 struct payload {
-        struct node     *head; /* start of list             */
-        struct node     *tail; /* end of list               */
-        struct node     *itr;  /* current iterator position */
-        size_t           len;  /* number of items           */
-        size_t           sz;   /* cumulative size           */
-        ag_hash          hash; /* cumulative hash           */
+        struct node     *spine;  /* list spine root           */
+        size_t           itr;    /* current iterator position */
+        size_t           len;    /* number of items           */
+        size_t           sz;     /* cumulative size           */
+        ag_hash          hash;   /* cumulative hash           */
+        struct index    *idx;    /* key index, built lazily   */
+        size_t           height; /* list spine height         */
 };
 
 
-static inline struct node       *node_new(const ag_field *);
-static inline struct node       *node_release(struct node *);
+static struct chunk     *chunk_copy(const struct chunk *);
+static void              chunk_release(struct chunk *);
+static inline void       chunk_sync(struct chunk *, size_t);
+static inline uint32_t   chunk_match(const struct chunk *, ag_hash);
+static struct node      *node_copy(const struct node *);
+static void              node_release(struct node *, size_t);
+static void              node_freeze(struct node *, size_t);
+static inline struct chunk *spine_chunk(const struct payload *, size_t);
+static struct chunk    **spine_at_mutable(struct payload *, size_t);
+static void              spine_reserve(struct payload *, size_t);
+
+
+static inline bool       key_eq(const ag_value *, const ag_value *);
+static struct index     *index_new(const struct payload *);
+static void              index_insert(struct index *, const struct payload *,
+                             size_t);
+static void              index_drop(struct payload *);
+
+
+struct par {
+        const struct payload    *src;  /* source payload             */
+        ag_alist_transform      *map;  /* ag_alist_pmap() callback    */
+        ag_alist_predicate      *pred; /* ag_alist_pfilter() callback */
+        void                    *in;   /* callback input              */
+        ag_value               **res;  /* transformed values          */
+        bool                    *keep; /* fields passing the filter   */
+};
 
 
-static struct payload   *payload_new(const struct node *);
-static void              payload_push(struct payload *, const ag_field *);
+static void             par_map(size_t, size_t, void *);
+static void             par_filter(size_t, size_t, void *);
+
+
+static const char       *form_scan(const char *, bool, size_t *);
+static ag_value         *form_decode(const char *, size_t);
+
+
+static struct payload    *payload_new(const struct payload *);
+static inline ag_field  **payload_at(const struct payload *, size_t);
+static inline const struct chunk *payload_chunk(const struct payload *, size_t);
+static ag_field         **payload_at_mutable(struct payload *, size_t);
+static void               payload_sync(struct payload *, size_t);
+static void               payload_push(struct payload *, const ag_field *);
+static size_t             payload_find(const struct payload *,
+                              const ag_value *);
 
 AG_OBJECT_DEFINE(ag_alist, AG_TYPEID_ALIST);
 
 AG_OBJECT_DEFINE_CLONE(ag_alist,
-        const struct payload *p = _p_;
-        return payload_new(p->head);
+        return payload_new(_p_);
 );
 
 AG_OBJECT_DEFINE_RELEASE(ag_alist,
         struct payload *p = _p_;
-        register struct node *n = p->head;
-
-        while (n)
-                n = node_release(n);
+        node_release(p->spine, p->height);
+        index_drop(p);
 );
 
 AG_OBJECT_DEFINE_CMP(ag_alist,
@@ -72,16 +160,12 @@ AG_OBJECT_DEFINE_CMP(ag_alist,
                 return !p1->len ? AG_CMP_EQ : AG_CMP_GT;
 
         size_t lim = p1->len < p2->len ? p1->len : p2->len;
-        register const struct node *n = p1->head;
-        register const struct node *n2 = p2->head;
         register enum ag_cmp chk;
 
         for (register size_t i = 0; i < lim; i++) {
-                if ((chk = ag_field_cmp(n->attr, n2->attr)))
+                if ((chk = ag_field_cmp(*payload_at(p1, i),
+                    *payload_at(p2, i))))
                         return chk;
-
-                n = n->nxt;
-                n2 = n2->nxt;
         }
 
         if (p1->len == p2->len)
@@ -92,15 +176,15 @@ AG_OBJECT_DEFINE_CMP(ag_alist,
 
 AG_OBJECT_DEFINE_VALID(ag_alist,
         const struct payload *p = ag_object_payload(_o_);
-        register const struct node *n = p->head;
+        register size_t i = 0;
 
-        if (AG_UNLIKELY (!n))
+        if (AG_UNLIKELY (!p->len))
                 return false;
 
-        while (n && ag_field_valid(n->attr))
-                n = n->nxt;
+        while (i < p->len && ag_field_valid(*payload_at(p, i)))
+                i++;
 
-        return !n;
+        return i == p->len;
 );
 
 AG_OBJECT_DEFINE_SZ(ag_alist,
@@ -120,7 +204,6 @@ AG_OBJECT_DEFINE_HASH(ag_alist,
 
 AG_OBJECT_DEFINE_STR(ag_alist,
         const struct payload *p = ag_object_payload(_o_);
-        struct node *n = p->head;
 
         ag_string *s = ag_string_new_empty();
         ag_string *s2 = ag_string_new_empty();
@@ -128,7 +211,7 @@ AG_OBJECT_DEFINE_STR(ag_alist,
 
         for (register size_t i = 0; i < p->len; i++) {
                 ag_string_release(&s);
-                s = ag_field_str(n->attr);
+                s = ag_field_str(*payload_at(p, i));
 
                 ag_string_release(&s2);
                 s2 = ag_string_new_fmt("(%s)", s);
@@ -138,8 +221,6 @@ AG_OBJECT_DEFINE_STR(ag_alist,
 
                 ag_string_release(&s3);
                 s3 = *s ? ag_string_new_fmt("%s %s", s, s2) : ag_string_new(s2);
-
-                n = n->nxt;
         }
 
         ag_string_release(&s);
@@ -151,6 +232,47 @@ AG_OBJECT_DEFINE_STR(ag_alist,
 );
 
 
+AG_OBJECT_DEFINE_PACK(ag_alist,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_map(_w_, p->len);
+
+        for (register size_t i = 0; i < p->len; i++) {
+                ag_value_pack(ag_field_key_peek(*payload_at(p, i)), _w_);
+                ag_value_pack(ag_field_val_peek(*payload_at(p, i)), _w_);
+        }
+);
+
+AG_OBJECT_DEFINE_UNPACK(ag_alist,
+        struct payload *p = payload_new(NULL);
+        register size_t len = ag_unpack_map(_r_);
+
+        for (register size_t i = 0; i < len; i++) {
+                AG_AUTO(ag_value) *k = ag_value_unpack(_r_);
+                AG_AUTO(ag_value) *v = ag_value_unpack(_r_);
+                AG_AUTO(ag_field) *f = ag_field_new(k, v);
+
+                payload_push(p, f);
+        }
+
+        return p;
+);
+
+AG_OBJECT_DEFINE_FREEZE(ag_alist,
+        struct payload *p = _p_;
+
+        if (AG_UNLIKELY (!p->spine))
+                return;
+
+        if (!p->idx && p->len >= INDEX_MIN)
+                p->idx = index_new(p);
+
+        if (p->idx)
+                ag_memblock_freeze(p->idx);
+
+        node_freeze(p->spine, p->height);
+);
+
 
 extern ag_alist *
 ag_alist_new(const ag_field *attr)
@@ -171,6 +293,7 @@ ag_alist_new_array(const ag_field **attr, size_t len)
         AG_ASSERT (len);
 
         struct payload *p = payload_new(NULL);
+        spine_reserve(p, len);
 
         for (register size_t i = 0; i < len; i++)
                 payload_push(p, attr[i]);
@@ -236,6 +359,42 @@ ag_alist_parse(const char *src, const char *sep, const char *delim)
 }
 
 
+extern ag_alist *
+ag_alist_parse_form(const char *src)
+{
+        AG_ASSERT_PTR (src);
+
+        struct payload *p = payload_new(NULL);
+        const char *k, *v, *end;
+        size_t klen, vlen;
+
+        while (*src) {
+                k = src;
+                end = form_scan(k, true, &klen);
+
+                v = end;
+                vlen = 0;
+
+                if (*end == '=') {
+                        v = end + 1;
+                        end = form_scan(v, false, &vlen);
+                }
+
+                if (AG_LIKELY (end > k)) {
+                        AG_AUTO(ag_value) *kv = form_decode(k, klen);
+                        AG_AUTO(ag_value) *vv = form_decode(v, vlen);
+                        AG_AUTO(ag_field) *f = ag_field_new(kv, vv);
+
+                        payload_push(p, f);
+                }
+
+                src = *end ? end + 1 : end;
+        }
+
+        return ag_object_new(AG_TYPEID_ALIST, p);
+}
+
+
 extern bool
 ag_alist_has(const ag_alist *ctx, const ag_field *attr)
 {
@@ -243,13 +402,10 @@ ag_alist_has(const ag_alist *ctx, const ag_field *attr)
         AG_ASSERT_PTR (attr);
 
         const struct payload *p = ag_object_payload(ctx);
-        register const struct node *n = p->head;
 
-        while (n) {
-                if (ag_field_eq(n->attr, attr))
+        for (register size_t i = 0; i < p->len; i++) {
+                if (ag_field_eq(*payload_at(p, i), attr))
                         return true;
-
-                n = n->nxt;
         }
 
         return false;
@@ -262,22 +418,7 @@ ag_alist_has_key(const ag_alist *ctx, const ag_value *key)
         AG_ASSERT_PTR (ctx);
         AG_ASSERT_PTR (key);
 
-        ag_value *k;
-        const struct payload *p = ag_object_payload(ctx);
-        register const struct node *n = p->head;
-
-        while (n) {
-                k = ag_field_key(n->attr);
-                if (ag_value_eq(k, key)) {
-                        ag_value_release(&k);
-                        return true;
-                }
-
-                ag_value_release(&k);
-                n = n->nxt;
-        }
-
-        return false;
+        return payload_find(ag_object_payload(ctx), key);
 }
 
 
@@ -287,19 +428,11 @@ ag_alist_has_val(const ag_alist *ctx, const ag_value *val)
         AG_ASSERT_PTR (ctx);
         AG_ASSERT_PTR (val);
 
-        ag_value *v;
         const struct payload *p = ag_object_payload(ctx);
-        register const struct node *n = p->head;
 
-        while (n) {
-                v = ag_field_val(n->attr);
-                if (ag_value_eq(v, val)) {
-                        ag_value_release(&v);
+        for (register size_t i = 0; i < p->len; i++) {
+                if (ag_value_eq(payload_chunk(p, i)->val[i % CHUNK_LEN], val))
                         return true;
-                }
-
-                ag_value_release(&v);
-                n = n->nxt;
         }
 
         return false;
@@ -313,7 +446,7 @@ ag_alist_get(const ag_alist *ctx)
         AG_ASSERT (!ag_alist_empty(ctx));
 
         const struct payload *p = ag_object_payload(ctx);
-        return ag_field_copy(p->itr->attr);
+        return ag_field_copy(*payload_at(p, p->itr));
 }
 
 
@@ -325,12 +458,7 @@ ag_alist_get_at(const ag_alist *ctx, size_t idx)
         AG_ASSERT (idx >= 1 && idx <= ag_alist_len(ctx));
 
         const struct payload *p = ag_object_payload(ctx);
-        register const struct node *n = p->head;
-
-        for (register size_t i = 1; i < idx; i++)
-                n = n->nxt;
-
-        return ag_field_copy(n->attr);
+        return ag_field_copy(*payload_at(p, idx - 1));
 }
 
 
@@ -340,23 +468,11 @@ ag_alist_val(const ag_alist *ctx, const ag_value *key)
         AG_ASSERT_PTR (ctx);
         AG_ASSERT_PTR (key);
 
-        ag_value *k;
         const struct payload *p = ag_object_payload(ctx);
-        register const struct node *n = p->head;
+        register size_t pos = payload_find(p, key);
 
-        while (n) {
-                k = ag_field_key(n->attr);
-                if (ag_value_eq(k, key)) {
-                        ag_value_release(&k);
-                        return ag_field_val(n->attr);
-                }
-
-                ag_value_release(&k);
-                n = n->nxt;
-        }
-
-        AG_ASSERT (false);
-        return NULL;
+        AG_ASSERT (pos);
+        return AG_LIKELY (pos) ? ag_field_val(*payload_at(p, pos - 1)) : NULL;
 }
 
 
@@ -367,13 +483,98 @@ ag_alist_map(const ag_alist *ctx, ag_alist_iterator *map, void *in, void *out)
         AG_ASSERT_PTR (map);
 
         const struct payload *p = ag_object_payload(ctx);
-        register const struct node *n = p->head;
         register bool flag = true;
 
-        while (n && flag) {
-                flag = map(n->attr, in, out);
-                n = n->nxt;
+        for (register size_t i = 0; i < p->len && flag; i++)
+                flag = map(*payload_at(p, i), in, out);
+}
+
+
+extern void
+ag_alist_cursor_init(ag_alist_cursor *ctx, const ag_alist *alist)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (alist);
+
+        ctx->alist = alist;
+        ctx->chunk = 0;
+        ctx->attr = ctx->end = NULL;
+}
+
+
+extern bool
+__ag_alist_cursor_chunk__(ag_alist_cursor *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        const struct payload *p = ag_object_payload(ctx->alist);
+
+        if (ctx->chunk * CHUNK_LEN >= p->len)
+                return false;
+
+        const struct chunk *c = spine_chunk(p, ctx->chunk++);
+        ctx->attr = c->attr + 1;
+        ctx->end = c->attr + c->len;
+
+        return true;
+}
+
+
+extern ag_list *
+ag_alist_pmap(const ag_alist *ctx, ag_alist_transform *map, void *in,
+    size_t grain)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (map);
+
+        const struct payload *p = ag_object_payload(ctx);
+
+        if (AG_UNLIKELY (!p->len))
+                return ag_list_new();
+
+        struct par par = { .src = p, .map = map, .in = in };
+        par.res = ag_memblock_new(p->len * sizeof *par.res);
+
+        ag_pool_run(ag_pool_shared(), p->len, grain, par_map, &par);
+        ag_list *l = ag_list_new_array((const ag_value **)par.res, p->len);
+
+        for (register size_t i = 0; i < p->len; i++)
+                ag_value_release(&par.res[i]);
+
+        void *ptr = par.res;
+        ag_memblock_release(&ptr);
+
+        return l;
+}
+
+
+extern ag_alist *
+ag_alist_pfilter(const ag_alist *ctx, ag_alist_predicate *pred, void *in,
+    size_t grain)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (pred);
+
+        const struct payload *p = ag_object_payload(ctx);
+        struct payload *p2 = payload_new(NULL);
+
+        if (AG_UNLIKELY (!p->len))
+                return ag_object_new(AG_TYPEID_ALIST, p2);
+
+        struct par par = { .src = p, .pred = pred, .in = in };
+        par.keep = ag_memblock_new(p->len * sizeof *par.keep);
+
+        ag_pool_run(ag_pool_shared(), p->len, grain, par_filter, &par);
+
+        for (register size_t i = 0; i < p->len; i++) {
+                if (par.keep[i])
+                        payload_push(p2, *payload_at(p, i));
         }
+
+        void *ptr = par.keep;
+        ag_memblock_release(&ptr);
+
+        return ag_object_new(AG_TYPEID_ALIST, p2);
 }
 
 
@@ -385,8 +586,12 @@ ag_alist_set(ag_alist **ctx, const ag_field *attr)
         AG_ASSERT (!ag_alist_empty(*ctx));
 
         struct payload *p = ag_object_payload_mutable(ctx);
-        ag_field_release(&p->itr->attr);
-        p->itr->attr = ag_value_copy(attr);
+        ag_field **f = payload_at_mutable(p, p->itr);
+
+        index_drop(p);
+        ag_field_release(f);
+        *f = ag_value_copy(attr);
+        payload_sync(p, p->itr);
 }
 
 
@@ -399,13 +604,12 @@ ag_alist_set_at(ag_alist **ctx, const ag_field *attr, size_t idx)
         AG_ASSERT (idx >= 1 && idx <= ag_alist_len(*ctx));
 
         struct payload *p = ag_object_payload_mutable(ctx);
-        register struct node *n = p->head;
-
-        for (register size_t i = 1; i < idx; i++)
-                n = n->nxt;
+        ag_field **f = payload_at_mutable(p, idx - 1);
 
-        ag_field_release(&n->attr);
-        n->attr = ag_value_copy(attr);
+        index_drop(p);
+        ag_field_release(f);
+        *f = ag_value_copy(attr);
+        payload_sync(p, idx - 1);
 }
 
 
@@ -416,19 +620,12 @@ ag_alist_val_set(ag_alist **ctx, const ag_value *key, const ag_value *val)
         AG_ASSERT_PTR (key);
         AG_ASSERT_PTR (val);
 
-        ag_value *k;
         struct payload *p = ag_object_payload_mutable(ctx);
-        register struct node *n = p->head;
+        register size_t pos = payload_find(p, key);
 
-        while (n) {
-                k = ag_field_key(n->attr);
-                if (ag_value_eq(k, key)) {
-                        ag_value_release(&k);
-                        return ag_field_val_set(&n->attr, val);
-                }
-
-                ag_value_release(&k);
-                n = n->nxt;
+        if (AG_LIKELY (pos)) {
+                ag_field_val_set(payload_at_mutable(p, pos - 1), val);
+                payload_sync(p, pos - 1);
         }
 }
 
@@ -441,12 +638,13 @@ ag_alist_map_mutable(ag_alist **ctx, ag_alist_iterator_mutable *map, void *in,
         AG_ASSERT_PTR (map);
 
         struct payload *p = ag_object_payload_mutable(ctx);
-        register struct node *n = p->head;
         register bool flag = true;
 
-        while (n && flag) {
-                flag = map(&n->attr, in, out);
-                n = n->nxt;
+        index_drop(p);
+
+        for (register size_t i = 0; i < p->len && flag; i++) {
+                flag = map(payload_at_mutable(p, i), in, out);
+                payload_sync(p, i);
         }
 }
 
@@ -457,7 +655,7 @@ ag_alist_start(ag_alist **ctx)
         AG_ASSERT_PTR (ctx && *ctx);
 
         struct payload *p = ag_object_payload_mutable(ctx);
-        p->itr = p->head;
+        p->itr = 0;
 }
 
 
@@ -468,9 +666,9 @@ ag_alist_next(ag_alist **ctx)
 
         struct payload *p = ag_object_payload_mutable(ctx);
 
-        if (AG_LIKELY (p->itr)) {
-                p->itr = p->itr->nxt;
-                return p->itr->nxt;
+        if (AG_LIKELY (p->itr < p->len)) {
+                p->itr++;
+                return p->itr + 1 < p->len;
         }
 
         return false;
@@ -487,73 +685,515 @@ ag_alist_push(ag_alist **ctx, const ag_field *attr)
         payload_push(p, attr);
 }
 
-        
-static inline struct node*
-node_new(const ag_field *val)
+
+static struct chunk *
+chunk_copy(const struct chunk *ctx)
 {
-        AG_ASSERT_PTR (val);
+        AG_ASSERT_PTR (ctx);
 
-        struct node *n = ag_memblock_new(sizeof *n);
-        n->attr = ag_field_copy(val);
-        n->nxt = NULL;
+        struct chunk *c = ag_memblock_new(sizeof *c);
+        c->len = ctx->len;
 
-        return n;
+        memcpy(c->hash, ctx->hash, ctx->len * sizeof *c->hash);
+        memcpy(c->key, ctx->key, ctx->len * sizeof *c->key);
+        memcpy(c->val, ctx->val, ctx->len * sizeof *c->val);
+
+        for (register size_t i = 0; i < ctx->len; i++)
+                c->attr[i] = ag_field_copy(ctx->attr[i]);
+
+        return c;
 }
 
-        
-static inline struct node*
-node_release(struct node *ctx)
+
+static void
+chunk_release(struct chunk *ctx)
 {
         AG_ASSERT_PTR (ctx);
 
-        struct node *nxt = ctx->nxt;
         void *ptr = ctx;
 
-        ag_field_release(&ctx->attr);
-        ag_memblock_release(&ptr);
+        if (ag_memblock_release_last(&ptr)) {
+                for (register size_t i = 0; i < ctx->len; i++)
+                        ag_field_release(&ctx->attr[i]);
 
-        return nxt;
+                ag_memblock_release(&ptr);
+        }
 }
 
-        
+
+/*
+ * Refresh the cached hash, key and value of the field at a given position of a
+ * chunk. This needs to be done whenever the field is replaced or mutated, since
+ * mutating a field may move its key and value.
+ */
+static inline void
+chunk_sync(struct chunk *ctx, size_t pos)
+{
+        const ag_field *f = ctx->attr[pos];
+
+        ctx->key[pos] = ag_field_key_peek(f);
+        ctx->val[pos] = ag_field_val_peek(f);
+        ctx->hash[pos] = ag_value_hash(ctx->key[pos]);
+}
+
+
+/*
+ * Return a bit mask of the positions in a chunk whose key hash matches a given
+ * hash. The loop has no early exit and no data dependent branches, so that the
+ * compiler is free to turn it into a vector compare across the hash array.
+ */
+static inline uint32_t
+chunk_match(const struct chunk *ctx, ag_hash hash)
+{
+        register uint32_t m = 0;
+
+        for (register size_t i = 0; i < ctx->len; i++)
+                m |= (uint32_t)(ctx->hash[i] == hash) << i;
+
+        return m;
+}
+
+
+static struct node *
+node_copy(const struct node *ctx)
+{
+        struct node *n = ag_memblock_new(sizeof *n);
+
+        for (register size_t i = 0; i < NODE_LEN; i++) {
+                n->slot[i].node = ctx && ctx->slot[i].node
+                    ? ag_memblock_copy(ctx->slot[i].node) : NULL;
+        }
+
+        return n;
+}
+
+
+static void
+node_release(struct node *ctx, size_t height)
+{
+        void *ptr = ctx;
+
+        if (AG_UNLIKELY (!ctx))
+                return;
+
+        if (ag_memblock_release_last(&ptr)) {
+                for (register size_t i = 0; i < NODE_LEN; i++) {
+                        if (height > 1)
+                                node_release(ctx->slot[i].node, height - 1);
+                        else if (ctx->slot[i].chunk)
+                                chunk_release(ctx->slot[i].chunk);
+                }
+
+                ag_memblock_release(&ptr);
+        }
+}
+
+
+static void
+node_freeze(struct node *ctx, size_t height)
+{
+        if (AG_UNLIKELY (!ctx))
+                return;
+
+        ag_memblock_freeze(ctx);
+
+        for (register size_t i = 0; i < NODE_LEN; i++) {
+                struct chunk *c = ctx->slot[i].chunk;
+
+                if (height > 1)
+                        node_freeze(ctx->slot[i].node, height - 1);
+                else if (c) {
+                        ag_memblock_freeze(c);
+
+                        for (register size_t j = 0; j < c->len; j++)
+                                ag_field_freeze(c->attr[j]);
+                }
+        }
+}
+
+
+static inline struct chunk *
+spine_chunk(const struct payload *ctx, size_t idx)
+{
+        const struct node *n = ctx->spine;
+
+        for (register size_t h = ctx->height; h > 1; h--)
+                n = n->slot[idx >> (NODE_BITS * (h - 1)) & NODE_MASK].node;
+
+        return n->slot[idx & NODE_MASK].chunk;
+}
+
+
+/*
+ * Get a handle to the slot of the chunk at a given chunk index, after making
+ * the spine tall enough to hold it and replacing every node on the path to it
+ * that is shared by a copy, and every one that is missing by an empty node.
+ */
+static struct chunk **
+spine_at_mutable(struct payload *ctx, size_t idx)
+{
+        spine_reserve(ctx, (idx + 1) * CHUNK_LEN);
+
+        struct node **n = &ctx->spine;
+        register size_t h = ctx->height;
+
+        for (;;) {
+                if (AG_UNLIKELY (!*n || ag_memblock_refc(*n) > 1)) {
+                        struct node *cp = node_copy(*n);
+                        node_release(*n, h);
+                        *n = cp;
+                }
+
+                if (h == 1)
+                        return &(*n)->slot[idx & NODE_MASK].chunk;
+
+                n = &(*n)->slot[idx >> (NODE_BITS * --h) & NODE_MASK].node;
+        }
+}
+
+
+static void
+spine_reserve(struct payload *ctx, size_t len)
+{
+        register size_t n = (len + CHUNK_LEN - 1) / CHUNK_LEN;
+
+        while (n && (!ctx->height || (n - 1) >> (NODE_BITS * ctx->height))) {
+                struct node *root = node_copy(NULL);
+                root->slot[0].node = ctx->spine;
+
+                ctx->spine = root;
+                ctx->height++;
+        }
+}
+
+
+static inline bool
+key_eq(const ag_value *lhs, const ag_value *rhs)
+{
+        return ag_value_type(lhs) == ag_value_type(rhs)
+            && ag_value_eq(lhs, rhs);
+}
+
+
+static struct index *
+index_new(const struct payload *ctx)
+{
+        size_t cap = INDEX_MIN * 2;
+
+        while (cap < ctx->len * 2)
+                cap *= 2;
+
+        struct index *idx = ag_memblock_new(sizeof *idx
+            + cap * sizeof *idx->slot);
+        idx->cap = cap;
+
+        for (register size_t i = 0; i < ctx->len; i++)
+                index_insert(idx, ctx, i);
+
+        return idx;
+}
+
+
+static void
+index_insert(struct index *ctx, const struct payload *p, size_t pos)
+{
+        const struct chunk *c = payload_chunk(p, pos);
+        const ag_value *k = c->key[pos % CHUNK_LEN];
+        register ag_hash h = c->hash[pos % CHUNK_LEN];
+        register size_t mask = ctx->cap - 1;
+        register size_t i = h & mask;
+        register size_t j;
+
+        while (ctx->slot[i].pos) {
+                j = ctx->slot[i].pos - 1;
+
+                if (ctx->slot[i].hash == h
+                    && key_eq(k, payload_chunk(p, j)->key[j % CHUNK_LEN]))
+                        return;
+
+                i = (i + 1) & mask;
+        }
+
+        ctx->slot[i].hash = h;
+        ctx->slot[i].pos = pos + 1;
+}
+
+
+static void
+index_drop(struct payload *ctx)
+{
+        void *ptr = ctx->idx;
+
+        if (ptr) {
+                ag_memblock_release(&ptr);
+                ctx->idx = NULL;
+        }
+}
+
+
+/*
+ * Check whether a form-encoded string starts with a valid escape. An escaped
+ * NUL is not treated as one, since decoding it would truncate the string, and
+ * so is kept verbatim like a malformed escape.
+ */
+static inline bool
+form_hex(const char *src)
+{
+        return *src == '%' && isxdigit((unsigned char)src[1])
+            && isxdigit((unsigned char)src[2])
+            && (src[1] != '0' || src[2] != '0');
+}
+
+
+static inline char
+form_hex_val(char c)
+{
+        if (c >= 'a')
+                return c - ('a' - 10);
+        else if (c >= 'A')
+                return c - ('A' - 10);
+        else
+                return c - '0';
+}
+
+
+/*
+ * Scan a form-encoded key (stopping at '=' or '&') or value (stopping at '&')
+ * and return the end of the token, computing its url-decoded length on the way
+ * so that form_decode() can allocate the decoded string exactly once.
+ */
+static const char *
+form_scan(const char *src, bool key, size_t *len)
+{
+        register size_t n = 0;
+
+        while (*src && *src != '&' && !(key && *src == '=')) {
+                src += form_hex(src) ? 3 : 1;
+                n++;
+        }
+
+        *len = n;
+        return src;
+}
+
+
+static ag_value *
+form_decode(const char *src, size_t len)
+{
+        ag_string *s = ag_memblock_new(len + 1);
+        char *c = s;
+
+        for (register size_t i = 0; i < len; i++) {
+                if (form_hex(src)) {
+                        *c++ = 16 * form_hex_val(src[1]) + form_hex_val(src[2]);
+                        src += 3;
+                } else {
+                        *c++ = *src == '+' ? ' ' : *src;
+                        src++;
+                }
+        }
+
+        *c = '\0';
+
+        ag_value *v = ag_value_new_string(s);
+        ag_string_release(&s);
+
+        return v;
+}
+
+
 static struct payload *
-payload_new(const struct node *head)
+payload_new(const struct payload *ref)
 {
         struct payload *p = ag_memblock_new(sizeof *p);
-        p->len = p->sz = p->hash = 0;
-        p->itr = NULL;
+        p->spine = NULL;
+        p->height = p->itr = p->len = p->sz = p->hash = 0;
+        p->idx = NULL;
 
-        if (!head) {
-                p->head = p->tail = NULL;
-                return p;
-        }
+        if (ref) {
+                *p = *ref;
 
-        register const struct node *n = head;
-        while (n) {
-                payload_push(p, n->attr);
-                n = n->nxt;
+                if (p->spine)
+                        p->spine = ag_memblock_copy(p->spine);
+
+                if (p->idx)
+                        p->idx = ag_memblock_copy(p->idx);
         }
 
         return p;
 }
 
-        
+
+static inline ag_field **
+payload_at(const struct payload *ctx, size_t idx)
+{
+        AG_ASSERT (idx < ctx->len);
+
+        return &spine_chunk(ctx, idx / CHUNK_LEN)->attr[idx % CHUNK_LEN];
+}
+
+
+static inline const struct chunk *
+payload_chunk(const struct payload *ctx, size_t idx)
+{
+        AG_ASSERT (idx < ctx->len);
+
+        return spine_chunk(ctx, idx / CHUNK_LEN);
+}
+
+
+static ag_field **
+payload_at_mutable(struct payload *ctx, size_t idx)
+{
+        AG_ASSERT (idx < ctx->len);
+
+        struct chunk **c = spine_at_mutable(ctx, idx / CHUNK_LEN);
+
+        if (AG_UNLIKELY (ag_memblock_refc(*c) > 1)) {
+                struct chunk *cp = chunk_copy(*c);
+                chunk_release(*c);
+                *c = cp;
+        }
+
+        return &(*c)->attr[idx % CHUNK_LEN];
+}
+
+
+/*
+ * Refresh the cached hash, key and value of the field at a given index after it
+ * has been written through payload_at_mutable(), which has already ensured that
+ * the chunk holding the field isn't shared.
+ */
+static void
+payload_sync(struct payload *ctx, size_t idx)
+{
+        AG_ASSERT (idx < ctx->len);
+
+        chunk_sync(spine_chunk(ctx, idx / CHUNK_LEN), idx % CHUNK_LEN);
+}
+
+
 static void
 payload_push(struct payload *ctx, const ag_field *attr)
 {
         AG_ASSERT_PTR (ctx);
         AG_ASSERT_PTR (attr);
 
-        struct node *n = node_new(attr);
+        struct chunk **c = spine_at_mutable(ctx, ctx->len / CHUNK_LEN);
 
-        if (AG_LIKELY (ctx->tail))
-                ctx->tail->nxt = n;
-        else
-                ctx->head = n;
+        if (AG_UNLIKELY (!(ctx->len % CHUNK_LEN))) {
+                *c = ag_memblock_new(sizeof **c);
+                (*c)->len = 0;
+        } else if (AG_UNLIKELY (ag_memblock_refc(*c) > 1)) {
+                struct chunk *cp = chunk_copy(*c);
+                chunk_release(*c);
+                *c = cp;
+        }
 
-        ctx->tail = n;
+        (*c)->attr[(*c)->len] = ag_field_copy(attr);
+        chunk_sync(*c, (*c)->len++);
         ctx->len++;
         ctx->sz += ag_field_sz(attr);
         ctx->hash += ag_field_hash(attr);
+
+        if (ctx->idx) {
+                if (ag_memblock_refc(ctx->idx) == 1
+                    && ctx->len * 2 <= ctx->idx->cap)
+                        index_insert(ctx->idx, ctx, ctx->len - 1);
+                else
+                        index_drop(ctx);
+        }
+}
+
+
+/*
+ * Find the position of the first field with a given key, returning its index
+ * plus one, or 0 if there is no such field. Short lists are scanned linearly,
+ * a chunk at a time, by matching the key hash against the hash array of the
+ * chunk and comparing keys only at the positions that match. Once a list
+ * reaches INDEX_MIN fields, an open-addressed index keyed on the
+ * field hash is built on first lookup and kept in step by payload_push(). The
+ * index is a cache, so we build it through a const payload unless the payload
+ * is frozen (and may therefore be shared across threads); frozen payloads get
+ * their index built up front by the freeze callback.
+ */
+static size_t
+payload_find(const struct payload *ctx, const ag_value *key)
+{
+        struct index *idx = __atomic_load_n(&ctx->idx, __ATOMIC_ACQUIRE);
+        register ag_hash h = ag_value_hash(key);
+
+        if (!idx && (ctx->len < INDEX_MIN || ag_memblock_frozen(ctx))) {
+                register uint32_t m;
+                register size_t j;
+
+                for (register size_t i = 0; i * CHUNK_LEN < ctx->len; i++) {
+                        const struct chunk *c = spine_chunk(ctx, i);
+
+                        for (m = chunk_match(c, h); m; m &= m - 1) {
+                                j = __builtin_ctz(m);
+
+                                if (key_eq(c->key[j], key))
+                                        return i * CHUNK_LEN + j + 1;
+                        }
+                }
+
+                return 0;
+        }
+
+        /*
+         * Lookups on a shared association list may run on several threads at
+         * once, so the index is published with a compare-and-swap; a thread
+         * that loses the race drops its own index and uses the winning one.
+         */
+
+        if (!idx) {
+                struct index *idx2 = index_new(ctx);
+
+                if (__atomic_compare_exchange_n(&((struct payload *)ctx)->idx,
+                    &idx, idx2, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                        idx = idx2;
+                else {
+                        void *ptr = idx2;
+                        ag_memblock_release(&ptr);
+                }
+        }
+
+        register size_t mask = idx->cap - 1;
+        register size_t i = h & mask;
+        register size_t j;
+
+        while (idx->slot[i].pos) {
+                j = idx->slot[i].pos - 1;
+
+                if (idx->slot[i].hash == h
+                    && key_eq(key, payload_chunk(ctx, j)->key[j % CHUNK_LEN]))
+                        return idx->slot[i].pos;
+
+                i = (i + 1) & mask;
+        }
+
+        return 0;
 }
 
+
+static void
+par_map(size_t lo, size_t hi, void *ctx)
+{
+        struct par *par = ctx;
+
+        for (register size_t i = lo; i < hi; i++) {
+                par->res[i] = par->map(*payload_at(par->src, i), par->in);
+                AG_ASSERT_PTR (par->res[i]);
+        }
+}
+
+
+static void
+par_filter(size_t lo, size_t hi, void *ctx)
+{
+        struct par *par = ctx;
+
+        for (register size_t i = lo; i < hi; i++)
+                par->keep[i] = par->pred(*payload_at(par->src, i), par->in);
+}
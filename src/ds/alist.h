@@ -31,6 +31,7 @@ extern "C" {
 
 #include "../ex/exception.h"
 #include "./field.h"
+#include "./list.h"
 #include "../type/value.h"
 
 
@@ -75,6 +76,16 @@ typedef bool    (ag_alist_iterator)(const ag_field *, void *, void *);
 typedef bool    (ag_alist_iterator_mutable)(ag_field **, void *, void *);
 
 
+/*
+ * Declare the callback types of the parallel association list functions. As
+ * with their ag_list counterparts, ag_alist_transform returns a new value for a
+ * given field, and ag_alist_predicate returns whether a given field should be
+ * kept; both are passed the same input parameter on every call.
+ */
+typedef ag_value *(ag_alist_transform)(const ag_field *, void *);
+typedef bool      (ag_alist_predicate)(const ag_field *, void *);
+
+
 /*
  * Declare the non-inherited manager interface for the ag_alist object. The
  * manager interface consists of three related fucntions, each of which helps
@@ -83,11 +94,18 @@ typedef bool    (ag_alist_iterator_mutable)(ag_field **, void *, void *);
  * ag_alist_new() creates an association list with a single field, whereas
  * ag_alist_new_array() creates an association list with an array of fields.
  * ag_alist_new_empty() creates an empty association list.
+ *
+ * ag_alist_parse() splits a string into fields on a given separator and
+ * delimiter. ag_alist_parse_form() parses an application/x-www-form-urlencoded
+ * string in a single pass, url-decoding each key and value as it goes; it
+ * allocates one string per key and value, so it is the one to use on request
+ * bodies and query strings. Malformed escapes and %00 are kept verbatim.
  */
 extern ag_alist *ag_alist_new(const ag_field *);
 extern ag_alist *ag_alist_new_array(const ag_field **, size_t);
 extern ag_alist *ag_alist_new_empty(void);
 extern ag_alist *ag_alist_parse(const char *, const char *, const char *);
+extern ag_alist *ag_alist_parse_form(const char *);
 
 
 /*
@@ -114,6 +132,55 @@ extern void      ag_alist_map(const ag_alist *, ag_alist_iterator *, void *,
                     void *);
 
 
+/*
+ * Declare the parallel interface for ag_alist. ag_alist_pmap() returns the list
+ * of values computed from each field of an association list, and
+ * ag_alist_pfilter() returns the association list of the fields satisfying a
+ * predicate. Both run chunks of a given grain size on the shared thread pool,
+ * with 0 letting the pool pick the grain, and keep the fields in order.
+ */
+extern ag_list  *ag_alist_pmap(const ag_alist *, ag_alist_transform *, void *,
+                    size_t);
+extern ag_alist *ag_alist_pfilter(const ag_alist *, ag_alist_predicate *,
+                    void *, size_t);
+
+
+/*
+ * Declare the cursor interface for ag_alist. As with ag_list_cursor, an
+ * ag_alist_cursor is a stack-allocated cursor that traverses an immutable
+ * association list without copying it or changing any reference counts.
+ * ag_alist_cursor_init() initialises a cursor, ag_alist_cursor_next() moves it
+ * to the next field, returning false once there are none left, and
+ * ag_alist_cursor_get() peeks at the field under it.
+ */
+typedef struct ag_alist_cursor {
+        const ag_alist   *alist; /* association list being traversed */
+        size_t            chunk; /* next chunk to visit              */
+        ag_field *const  *attr;  /* next field in chunk              */
+        ag_field *const  *end;   /* end of current chunk             */
+} ag_alist_cursor;
+
+extern void     ag_alist_cursor_init(ag_alist_cursor *, const ag_alist *);
+extern bool     __ag_alist_cursor_chunk__(ag_alist_cursor *);
+
+inline bool
+ag_alist_cursor_next(ag_alist_cursor *ctx)
+{
+        if (AG_LIKELY (ctx->attr != ctx->end)) {
+                ctx->attr++;
+                return true;
+        }
+
+        return __ag_alist_cursor_chunk__(ctx);
+}
+
+inline const ag_field *
+ag_alist_cursor_get(const ag_alist_cursor *ctx)
+{
+        return ctx->attr[-1];
+}
+
+
 /*
  * Declare the prototypes for the non-inheritied mutator functions of the
  * ag_alist interface. Each of these functions takes a pointer to an association
@@ -80,6 +80,30 @@ AG_OBJECT_DEFINE_STR(ag_field,
         return ag_string_new_fmt("%s:%s", key, val);
 );
 
+AG_OBJECT_DEFINE_PACK(ag_field,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_array(_w_, 2);
+        ag_value_pack(p->key, _w_);
+        ag_value_pack(p->val, _w_);
+);
+
+AG_OBJECT_DEFINE_UNPACK(ag_field,
+        AG_UNPACK_REQUIRE (ag_unpack_array(_r_) == 2, "ag_field");
+
+        AG_AUTO(ag_value) *k = ag_value_unpack(_r_);
+        AG_AUTO(ag_value) *v = ag_value_unpack(_r_);
+
+        return payload_new(k, v);
+);
+
+AG_OBJECT_DEFINE_FREEZE(ag_field,
+        struct payload *p = _p_;
+
+        ag_value_freeze(p->key);
+        ag_value_freeze(p->val);
+);
+
 AG_OBJECT_DEFINE(ag_field, AG_TYPEID_FIELD);
 
 
@@ -157,6 +181,26 @@ extern ag_value *ag_field_val(const ag_field *ctx)
 }
 
 
+extern const ag_value *ag_field_key_peek(const ag_field *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT (ag_object_typeid(ctx) == AG_TYPEID_FIELD);
+
+        const struct payload *p = ag_object_payload(ctx);
+        return p->key;
+}
+
+
+extern const ag_value *ag_field_val_peek(const ag_field *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT (ag_object_typeid(ctx) == AG_TYPEID_FIELD);
+
+        const struct payload *p = ag_object_payload(ctx);
+        return p->val;
+}
+
+
 extern void ag_field_key_set(ag_field **ctx, const ag_value *key)
 {
         AG_ASSERT_PTR (ctx && *ctx);
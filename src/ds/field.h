@@ -85,6 +85,16 @@ extern ag_field *ag_field_parse(const char *, const char *);
  */
 extern ag_value *ag_field_key(const ag_field *);
 extern ag_value *ag_field_val(const ag_field *);
+
+
+/*
+ * Declare the borrowing accessor functions of the ag_field object. Unlike the
+ * accessors above, ag_field_key_peek() and ag_field_val_peek() do not copy the
+ * key and value; the returned pointers are owned by the field, and remain
+ * valid only as long as the field is neither released nor mutated.
+ */
+extern const ag_value *ag_field_key_peek(const ag_field *);
+extern const ag_value *ag_field_val_peek(const ag_field *);
                 
 
 /*
@@ -23,58 +23,218 @@
 
 #include "../argent.h"
 
+#include <stdint.h>
+#include <string.h>
+
+
+/*
+ * Declare the external linkage of the inline cursor functions declared in the
+ * list interface header.
+ */
+
+
+extern inline bool              ag_list_cursor_next(ag_list_cursor *);
+extern inline const ag_value   *ag_list_cursor_get(const ag_list_cursor *);
+
+
+/*
+ * Define the chunk of a list. The values of a list are stored in fixed-size
+ * chunks, each of which is a reference counted memory block that may be shared
+ * between lists. Every chunk except the last one is always full, so the chunk
+ * and slot of a value can be computed directly from its index.
+ */
+
+
+#define CHUNK_LEN 32
+
+
+struct chunk {
+        size_t           len;            /* number of values */
+        ag_value        *val[CHUNK_LEN]; /* chunk values     */
+};
+
 
 /*
- * Define the node of a list. Our lists are singly-linked, so we only need to
- * maintain a pointer to the next node.
+ * Define the spine of a list. The spine is a trie of nodes holding the chunks
+ * of the list, with NODE_LEN slots to a node; the chunk at a given index is
+ * found by taking the index NODE_BITS bits at a time, starting from the root.
+ * Every node is a reference counted memory block that is shared between copies
+ * of a list until one of them is mutated, and the mutation then only copies the
+ * nodes on the path to the chunk it touches. Unsharing a chunk therefore costs
+ * O(log n) rather than O(n). The height of the spine is the number of nodes on
+ * such a path, and is 0 for an empty list; nodes and chunks beyond the end of
+ * the list are left null until they're filled.
  */
 
 
+#define NODE_BITS 5
+#define NODE_LEN  (1 << NODE_BITS)
+#define NODE_MASK (NODE_LEN - 1)
+
+
 struct node {
-        ag_value        *val; /* node value */
-        struct node     *nxt; /* next node  */
+        union {
+                struct node     *node;  /* child node above height 1 */
+                struct chunk    *chunk; /* chunk at height 1         */
+        } slot[NODE_LEN];
 };
 
 
 /*
- * Define the object payload of a list. We choose to keep a pointer to the last
- * node in order to speed up push operations. Again, in order to avoid having to
- * iterate through the entire list, we maintain the length, cumulative size, and
- * cumulative hash of the list.
+ * Define the object payload of a list. The payload holds a reference to the
+ * spine, so cloning a list only copies the payload itself. In order to avoid
+ * having to iterate through the entire list, we maintain the length,
+ * cumulative size, and cumulative hash of the list, along with a flag that is
+ * set while the list is known to be in ascending order.
  */
 
 
 struct payload {
-        struct node     *head; /* start of list             */
-        struct node     *tail; /* end of list               */
-        struct node     *itr;  /* current iterator position */
-        size_t           len;  /* number of items           */
-        size_t           sz;   /* cumulative size           */
-        ag_hash          hash; /* cumulative hash           */
+        struct node     *spine;  /* list spine root           */
+        size_t           itr;    /* current iterator position */
+        size_t           len;    /* number of items           */
+        size_t           sz;     /* cumulative size           */
+        ag_hash          hash;   /* cumulative hash           */
+        size_t           height; /* list spine height         */
+        bool             sorted; /* known to be sorted        */
 };
 
 
 /*
- * Declare the prototypes for the node helper functions. node_new() helps create
- * a new node, and node_release() helps destroy an existing one.
+ * Declare the prototypes for the chunk and spine helper functions. chunk_copy()
+ * and node_copy() create unshared copies, and chunk_release() and
+ * node_release() drop a reference, releasing the contents along with the last
+ * one; node_freeze() freezes a node along with everything below it.
+ * spine_chunk() gets the chunk at a given index, and spine_at_mutable() gets a
+ * handle to its slot after unsharing the path to it. spine_reserve() makes the
+ * spine tall enough for a given number of values.
  */
 
 
-static inline struct node       *node_new(const ag_value *);
-static inline struct node       *node_release(struct node *);
-
+static struct chunk     *chunk_copy(const struct chunk *);
+static void              chunk_release(struct chunk *);
+static struct node      *node_copy(const struct node *);
+static void              node_release(struct node *, size_t);
+static void              node_freeze(struct node *, size_t);
+static inline struct chunk *spine_chunk(const struct payload *, size_t);
+static struct chunk    **spine_at_mutable(struct payload *, size_t);
+static void              spine_reserve(struct payload *, size_t);
 
 
 /*
  * Declare the prototypes for the payload helper functions. payload_new() helps
- * create a new payload instance, either empty or filled with the values cloned
- * from another payload instance. payload_push() helps push a new node to the
- * end of the list.
+ * create a new payload instance, either empty or sharing the spine of another
+ * payload instance. payload_at() gets a handle to the value at a 0-based index,
+ * and payload_at_mutable() does the same after unsharing the spine and chunk
+ * holding it. payload_push() helps push a new value to the end of the list.
+ */
+
+
+static struct payload    *payload_new(const struct payload *);
+static inline ag_value  **payload_at(const struct payload *, size_t);
+static ag_value         **payload_at_mutable(struct payload *, size_t);
+static void               payload_push(struct payload *, const ag_value *);
+
+
+/*
+ * Define the state shared by the tasks of the parallel list functions. Each task
+ * runs a chunk of the source list on the shared thread pool, and writes its
+ * results to slots of its own, indexed by the position of the chunk; the
+ * calling thread then combines the results in order once all tasks are done.
+ * Chunks are made up of whole list chunks, so that ag_list_pmap() tasks can
+ * fill in the chunks of the resulting list without sharing any of them.
+ */
+
+
+struct par {
+        const struct payload    *src;   /* source payload             */
+        struct payload          *dst;   /* ag_list_pmap() result      */
+        size_t                   grain; /* values per task            */
+        ag_list_transform       *map;   /* ag_list_pmap() callback    */
+        ag_list_predicate       *pred;  /* ag_list_pfilter() callback */
+        ag_list_reducer         *red;   /* ag_list_preduce() callback */
+        void                    *in;    /* callback input             */
+        size_t                  *sz;    /* task result sizes          */
+        ag_hash                 *hash;  /* task result hashes         */
+        bool                    *keep;  /* values passing the filter  */
+        ag_value               **acc;   /* task reductions            */
+};
+
+
+/*
+ * Declare the prototypes for the parallel helper functions. par_grain() rounds
+ * the requested grain size up to whole list chunks, picking one if none was
+ * requested, and par_map(), par_filter() and par_reduce() are the tasks run by
+ * ag_list_pmap(), ag_list_pfilter() and ag_list_preduce() respectively.
  */
 
 
-static struct payload   *payload_new(const struct node *);
-static void              payload_push(struct payload *, const ag_value *);
+static size_t   par_grain(size_t, size_t);
+static void     par_map(size_t, size_t, void *);
+static void     par_filter(size_t, size_t, void *);
+static void     par_reduce(size_t, size_t, void *);
+
+
+/*
+ * Define the state of a sort. Sorting gathers the values of a list into a flat
+ * array, sorts the array, and writes the values back in their new order. The
+ * parallel merge sort first sorts runs of the array on the shared thread pool,
+ * and then merges pairs of adjacent runs, doubling the run width each round
+ * and swapping the roles of the array and the merge buffer as it goes.
+ */
+
+
+#define SORT_INSERT     16
+#define SORT_PAR_MIN    8192
+
+
+struct sort {
+        ag_list_comparator      *cmp;   /* comparator, NULL for default */
+        void                    *in;    /* comparator input             */
+        size_t                   len;   /* number of values             */
+        size_t                   width; /* values per sorted run        */
+        ag_value               **src;   /* runs being merged            */
+        ag_value               **dst;   /* merged runs                  */
+};
+
+
+/*
+ * Declare the prototypes for the sorting helper functions. value_ordered()
+ * checks whether two adjacent values keep a list sorted, and sort_cmp()
+ * compares two values through the comparator of a sort. sort_insert(),
+ * sort_intro() and sort_merge() are the insertion sort, introsort and merge
+ * sort used on the value array, helped by sort_heap() and merge() respectively;
+ * sort_radix() radix sorts the array through radix_num() or radix_str() if its
+ * values are all integers, unsigned integers or strings, and sort_par() merge
+ * sorts it on the shared thread pool with the help of the par_sort() and
+ * par_merge() tasks. payload_sort() drives all of the above.
+ */
+
+
+static inline bool              value_ordered(const ag_value *,
+                                    const ag_value *);
+static inline enum ag_cmp       sort_cmp(const struct sort *, const ag_value *,
+                                    const ag_value *);
+static void                     sort_insert(const struct sort *, ag_value **,
+                                    size_t);
+static void                     sort_intro(const struct sort *, ag_value **,
+                                    size_t, size_t);
+static void                     sort_heap(const struct sort *, ag_value **,
+                                    size_t);
+static void                     sort_merge(const struct sort *, ag_value **,
+                                    ag_value **, size_t);
+static void                     merge(const struct sort *, ag_value **,
+                                    ag_value *const *, size_t,
+                                    ag_value *const *, size_t);
+static bool                     sort_radix(ag_value **, size_t);
+static void                     radix_num(ag_value **, size_t, bool);
+static void                     radix_str(ag_value **, ag_value **, size_t,
+                                    size_t);
+static void                     sort_par(struct sort *, ag_value **);
+static void                     par_sort(size_t, size_t, void *);
+static void                     par_merge(size_t, size_t, void *);
+static void                     payload_sort(struct payload *,
+                                    ag_list_comparator *, void *, bool);
 
 
 /*
@@ -89,21 +249,21 @@ AG_OBJECT_DEFINE(ag_list, AG_TYPEID_LIST);
 /*
  * Define the __ag_list_clone__() dynamic dispatch callback function. This function is
  * called by ag_object_clone() when ag_list_clone() is invoked. We create a new
- * list using the contextual list as a reference.
+ * payload that shares the spine of the contextual list; the spine and its
+ * chunks are only copied when either list is mutated.
  */
 
 AG_OBJECT_DEFINE_CLONE(ag_list,
-        const struct payload *p = _p_;
-        return payload_new(p->head);
+        return payload_new(_p_);
 );
 
 
 /*
  * Define the __ag_list_release__() dynamic dispatch callback function. This function
- * is called by ag_object_release() when ag_list_release() is invoked. We simply
- * iterate through each of the nodes in the list and release the node through
- * node_release(). node_release() takes care of releasing the encapsulated value
- * and returns NULL when it reaches the tail node.
+ * is called by ag_object_release() when ag_list_release() is invoked. We drop
+ * the reference of the payload to its spine through node_release(), which
+ * takes care of releasing the chunks and their values if the spine is not
+ * shared with another list.
  *
  * We don't need to check whether the reference count has fallen to 1 before
  * performing the cleanup operation because ag_object_release() takes care of
@@ -112,10 +272,7 @@ AG_OBJECT_DEFINE_CLONE(ag_list,
 
 AG_OBJECT_DEFINE_RELEASE(ag_list,
         struct payload *p = _p_; 
-        register struct node *n = p->head;
-
-        while (n)
-                n = node_release(n);
+        node_release(p->spine, p->height);
 );
 
 
@@ -141,18 +298,15 @@ AG_OBJECT_DEFINE_CMP(ag_list,
                 return !p1->len ? AG_CMP_EQ : AG_CMP_GT;
 
         size_t lim = p1->len < p2->len ? p1->len : p2->len;
-        register const struct node *n1 = p1->head;
-        register const struct node *n2 = p2->head;
         register enum ag_cmp chk;
 
-        AG_ASSERT (ag_value_type(n1->val) == ag_value_type(n2->val));
+        AG_ASSERT (ag_value_type(*payload_at(p1, 0))
+            == ag_value_type(*payload_at(p2, 0)));
 
         for (register size_t i = 0; i < lim; i++) {
-                if ((chk = ag_value_cmp(n1->val, n2->val)))
+                if ((chk = ag_value_cmp(*payload_at(p1, i),
+                    *payload_at(p2, i))))
                         return chk;
-
-                n1 = n1->nxt;
-                n2 = n2->nxt;
         }
 
         if (p1->len == p2->len)
@@ -170,21 +324,21 @@ AG_OBJECT_DEFINE_CMP(ag_list,
  *
  * In our implementation, we first check if the list is not empty, and then
  * iterate through each of its values, checking if each is valid. If we reach
- * the end of the list successfully in this manner, the iterator will be NULL
- * since it'll have crossed the tail.
+ * the end of the list successfully in this manner, the index will be equal to
+ * the length of the list.
  */
 
 AG_OBJECT_DEFINE_VALID(ag_list,
         const struct payload *p = ag_object_payload(_o_);
-        register const struct node *n = p->head;
+        register size_t i = 0;
 
-        if (AG_UNLIKELY (!n))
+        if (AG_UNLIKELY (!p->len))
                 return false;
 
-        while (n && ag_value_valid(n->val))
-                n = n->nxt;
+        while (i < p->len && ag_value_valid(*payload_at(p, i)))
+                i++;
 
-        return !n;
+        return i == p->len;
 );
 
 
@@ -236,6 +390,56 @@ AG_OBJECT_DEFINE_STR(ag_list,
 );
 
 
+/*
+ * Define the __ag_list_pack__() dynamic dispatch callback function. This
+ * function is called by ag_object_pack() when a list is packed. A list is
+ * packed as an array of its values in order.
+ */
+
+AG_OBJECT_DEFINE_PACK(ag_list,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_array(_w_, p->len);
+
+        for (register size_t i = 0; i < p->len; i++)
+                ag_value_pack(*payload_at(p, i), _w_);
+);
+
+
+/*
+ * Define the __ag_list_unpack__() dynamic dispatch callback function. This
+ * function is called by ag_object_unpack() to read back the array written by
+ * __ag_list_pack__() into a new payload.
+ */
+
+AG_OBJECT_DEFINE_UNPACK(ag_list,
+        struct payload *p = payload_new(NULL);
+        register size_t len = ag_unpack_array(_r_);
+        ag_value *v;
+
+        for (register size_t i = 0; i < len; i++) {
+                v = ag_value_unpack(_r_);
+                payload_push(p, v);
+                ag_value_release(&v);
+        }
+
+        return p;
+);
+
+
+/*
+ * Define the __ag_list_freeze__() dynamic dispatch callback function. This
+ * function is called by ag_object_freeze() when a list is frozen. The spine
+ * and chunks of the list are frozen along with the values held by them, so
+ * that the list can be shared without touching any reference counts.
+ */
+
+AG_OBJECT_DEFINE_FREEZE(ag_list,
+        struct payload *p = _p_;
+        node_freeze(p->spine, p->height);
+);
+
+
 /*
  * Define the ag_list_new() interface function. Since lists are objects, we use
  * the ag_object_new() function to create a new list, passing along the type ID
@@ -250,10 +454,33 @@ ag_list_new(void)
 }
 
 
+/*
+ * Define the ag_list_new_array() interface function. This function creates a
+ * new list with the values of an array, reserving all the chunks that it needs
+ * in one go. The array must hold at least one value.
+ */
+
+
+extern ag_list *
+ag_list_new_array(const ag_value **val, size_t len)
+{
+        AG_ASSERT_PTR (val);
+        AG_ASSERT (len);
+
+        struct payload *p = payload_new(NULL);
+        spine_reserve(p, len);
+
+        for (register size_t i = 0; i < len; i++)
+                payload_push(p, val[i]);
+
+        return ag_object_new(AG_TYPEID_LIST, p);
+}
+
+
 /*
  * Define the ag_list_get() interface function. We use this function to get the
- * value at the currently iterated node, provided that the node exists. Note
- * that it's **not** safe to call this function on an empty list.
+ * value at the currently iterated position, provided that a value exists
+ * there. Note that it's **not** safe to call this function on an empty list.
  *
  * TODO: explore null values to make this function safer.
  */
@@ -266,15 +493,18 @@ ag_list_get(const ag_list *ctx)
         AG_ASSERT (!ag_list_empty(ctx));
 
         const struct payload *p = ag_object_payload(ctx);
-        return ag_value_copy(p->itr->val);
+        return ag_value_copy(*payload_at(p, p->itr));
 }
 
 
 /*
  * Define the ag_list_get_at() interface function. This function gets the value
- * at a given index, provided that a node exists at that index. Note that the
- * index is 1-based, and that currently it's **not** safe to call this function
- * on empty lists or with invalid index values.
+ * at a given index, provided that a value exists at that index. The chunk
+ * holding the value is found by walking down the spine, which only takes one
+ * step for every NODE_BITS bits of the index. Note that the index is 1-based,
+ * and that currently it's
+ * **not** safe to call this function on empty lists or with invalid index
+ * values.
  *
  * TODO: explore null values to make this function safer.
  */
@@ -288,19 +518,14 @@ ag_list_get_at(const ag_list *ctx, size_t idx)
         AG_ASSERT (idx >= 1 && idx <= ag_list_len(ctx));
 
         const struct payload *p = ag_object_payload(ctx);
-        register const struct node *n = p->head;
-
-        for (register size_t i = 1; i < idx; i++)
-                n = n->nxt;
-
-        return ag_value_copy(n->val);
+        return ag_value_copy(*payload_at(p, idx - 1));
 }
 
 
 /*
  * Define the ag_list_map() interface function. This function allows an iterator
  * to run through an immutable list, supplying it with the value at the
- * currently iterated node and optional data.
+ * currently iterated position and optional data.
  */
 
 
@@ -311,20 +536,261 @@ ag_list_map(const ag_list *ctx, ag_list_iterator *itr, void *in, void *out)
         AG_ASSERT_PTR (itr);
 
         const struct payload *p = ag_object_payload(ctx);
-        register const struct node *n = p->head;
         register bool flag = true;
 
-        while (n && flag) {
-                flag = itr(n->val, in, out);
-                n = n->nxt;
+        for (register size_t i = 0; i < p->len && flag; i++)
+                flag = itr(*payload_at(p, i), in, out);
+}
+
+
+/*
+ * Define the ag_list_cursor_init() interface function. The cursor starts out
+ * with an empty chunk, so that the first call to ag_list_cursor_next() moves it
+ * on to the first chunk of the list.
+ */
+
+
+extern void
+ag_list_cursor_init(ag_list_cursor *ctx, const ag_list *list)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (list);
+
+        ctx->list = list;
+        ctx->chunk = 0;
+        ctx->val = ctx->end = NULL;
+}
+
+
+/*
+ * Define the __ag_list_cursor_chunk__() protected function. This function is
+ * called by ag_list_cursor_next() when a cursor runs off the end of a chunk,
+ * and moves the cursor to the first value of the next chunk, if any. Since
+ * only the last chunk of a list may be partly filled, and no chunk is empty,
+ * the chunk we move to always has a value to return.
+ */
+
+
+extern bool
+__ag_list_cursor_chunk__(ag_list_cursor *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        const struct payload *p = ag_object_payload(ctx->list);
+
+        if (ctx->chunk * CHUNK_LEN >= p->len)
+                return false;
+
+        const struct chunk *c = spine_chunk(p, ctx->chunk++);
+        ctx->val = c->val + 1;
+        ctx->end = c->val + c->len;
+
+        return true;
+}
+
+
+/*
+ * Define the ag_list_search() interface function. This function finds the
+ * lower bound of a value in a sorted list by bisection, and then checks whether
+ * the value found there is equal to the one searched for. Each probe walks down
+ * the spine to the chunk holding the value, which is only a few steps even for
+ * long lists. Without a comparator, the list must be flagged as sorted.
+ */
+
+
+extern size_t
+ag_list_search(const ag_list *ctx, const ag_value *val, ag_list_comparator *cmp,
+    void *in)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (val);
+
+        const struct payload *p = ag_object_payload(ctx);
+        const struct sort s = { .cmp = cmp, .in = in };
+        register size_t lo = 0, hi = p->len, mid;
+
+        AG_ASSERT (cmp || p->sorted);
+
+        while (lo < hi) {
+                mid = lo + (hi - lo) / 2;
+
+                if (sort_cmp(&s, *payload_at(p, mid), val) == AG_CMP_LT)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        if (lo < p->len && sort_cmp(&s, *payload_at(p, lo), val) == AG_CMP_EQ)
+                return lo + 1;
+
+        return 0;
+}
+
+
+/*
+ * Define the ag_list_sorted() interface function. This function returns the
+ * sorted flag of a list, which is maintained by the sorting and mutator
+ * functions. A list that isn't flagged may still happen to be in order.
+ */
+
+
+extern bool
+ag_list_sorted(const ag_list *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        const struct payload *p = ag_object_payload(ctx);
+        return p->sorted;
+}
+
+
+/*
+ * Define the ag_list_pmap() interface function. The nodes of the spine of the
+ * resulting list are laid out in advance, so that each task fills in its own
+ * chunk slots without having to allocate or copy any node, and works out the
+ * size and hash of the values it has added, which we sum up once the tasks are
+ * done.
+ */
+
+
+extern ag_list *
+ag_list_pmap(const ag_list *ctx, ag_list_transform *map, void *in,
+    size_t grain)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (map);
+
+        const struct payload *p = ag_object_payload(ctx);
+        struct payload *p2 = payload_new(NULL);
+
+        if (AG_UNLIKELY (!p->len))
+                return ag_object_new(AG_TYPEID_LIST, p2);
+
+        struct par par = { .src = p, .dst = p2, .map = map, .in = in,
+            .grain = par_grain(p->len, grain) };
+        register size_t ntask = (p->len + par.grain - 1) / par.grain;
+
+        par.sz = ag_memblock_new(ntask * sizeof *par.sz);
+        par.hash = ag_memblock_new(ntask * sizeof *par.hash);
+
+        spine_reserve(p2, p->len);
+
+        for (register size_t i = 0; i < p->len; i += CHUNK_LEN * NODE_LEN)
+                (void)spine_at_mutable(p2, i / CHUNK_LEN);
+
+        p2->len = p->len;
+        p2->sorted = p->len < 2;
+
+        ag_pool_run(ag_pool_shared(), p->len, par.grain, par_map, &par);
+
+        for (register size_t i = 0; i < ntask; i++) {
+                p2->sz += par.sz[i];
+                p2->hash += par.hash[i];
+        }
+
+        void *ptr = par.sz;
+        ag_memblock_release(&ptr);
+        ptr = par.hash;
+        ag_memblock_release(&ptr);
+
+        return ag_object_new(AG_TYPEID_LIST, p2);
+}
+
+
+/*
+ * Define the ag_list_pfilter() interface function. The tasks only mark the
+ * values that pass the predicate, and we then push the marked values in order.
+ */
+
+
+extern ag_list *
+ag_list_pfilter(const ag_list *ctx, ag_list_predicate *pred, void *in,
+    size_t grain)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (pred);
+
+        const struct payload *p = ag_object_payload(ctx);
+        struct payload *p2 = payload_new(NULL);
+
+        if (AG_UNLIKELY (!p->len))
+                return ag_object_new(AG_TYPEID_LIST, p2);
+
+        struct par par = { .src = p, .pred = pred, .in = in,
+            .grain = par_grain(p->len, grain) };
+        par.keep = ag_memblock_new(p->len * sizeof *par.keep);
+
+        ag_pool_run(ag_pool_shared(), p->len, par.grain, par_filter, &par);
+
+        register size_t len = 0;
+        for (register size_t i = 0; i < p->len; i++)
+                len += par.keep[i];
+
+        spine_reserve(p2, len);
+
+        for (register size_t i = 0; i < p->len; i++) {
+                if (par.keep[i])
+                        payload_push(p2, *payload_at(p, i));
+        }
+
+        void *ptr = par.keep;
+        ag_memblock_release(&ptr);
+
+        return ag_object_new(AG_TYPEID_LIST, p2);
+}
+
+
+/*
+ * Define the ag_list_preduce() interface function. Each task reduces its chunk
+ * starting from the first value in the chunk, and we then fold the chunk
+ * reductions into the initial value in order; for an associative reducer this
+ * gives the same result as folding the whole list into the initial value.
+ */
+
+
+extern ag_value *
+ag_list_preduce(const ag_list *ctx, ag_list_reducer *red, const ag_value *init,
+    void *in, size_t grain)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (red);
+        AG_ASSERT_PTR (init);
+
+        const struct payload *p = ag_object_payload(ctx);
+        ag_value *acc = ag_value_copy(init);
+
+        if (AG_UNLIKELY (!p->len))
+                return acc;
+
+        struct par par = { .src = p, .red = red, .in = in,
+            .grain = par_grain(p->len, grain) };
+        register size_t ntask = (p->len + par.grain - 1) / par.grain;
+        par.acc = ag_memblock_new(ntask * sizeof *par.acc);
+
+        ag_pool_run(ag_pool_shared(), p->len, par.grain, par_reduce, &par);
+
+        for (register size_t i = 0; i < ntask; i++) {
+                ag_value *acc2 = red(acc, par.acc[i], in);
+                AG_ASSERT_PTR (acc2);
+
+                ag_value_release(&acc);
+                ag_value_release(&par.acc[i]);
+                acc = acc2;
         }
+
+        void *ptr = par.acc;
+        ag_memblock_release(&ptr);
+
+        return acc;
 }
 
 
 /*
  * Define the ag_list_set() interface function. This function sets the value at
- * the currently iterated node of the list, provided that a value already exists
- * at the current node. Note that this function is **not** safe to call on empty
+ * the currently iterated position of the list, provided that a value already
+ * exists at the current position. Only the chunk holding the value and the
+ * nodes of the spine on the path to it are copied if they're shared with
+ * another list. Note that this function is **not** safe to call on empty
  * lists.
  *
  * TODO: consider making this function safer.
@@ -339,17 +805,25 @@ ag_list_set(ag_list **ctx, const ag_value *val)
         AG_ASSERT (!ag_list_empty(*ctx));
 
         struct payload *p = ag_object_payload_mutable(ctx);
-        ag_value_release(&p->itr->val);
-        p->itr->val = ag_value_copy(val);
+        ag_value **v = payload_at_mutable(p, p->itr);
+
+        ag_value_release(v);
+        *v = ag_value_copy(val);
+
+        p->sorted = p->sorted
+            && (!p->itr || value_ordered(*payload_at(p, p->itr - 1), *v))
+            && (p->itr + 1 == p->len
+            || value_ordered(*v, *payload_at(p, p->itr + 1)));
 }
 
 
 /*
  * Define the ag_list_set_at() interface function. This function sets the value
  * at a given index in a list, assuming that there is already a value existing
- * at that index. Note that the index is 1-based, and that the internal iterator
- * is not affected by a call to this function. This function is **not** safe to
- * call on empty lists or with invalid index values.
+ * at that index. As with ag_list_set(), a shared list only has the path to the
+ * chunk holding the value copied. Note that the index is 1-based, and that
+ * the internal iterator is not affected by a call to this function. This
+ * function is **not** safe to call on empty lists or with invalid index values.
  *
  * TODO: consider making this function safer.
  */
@@ -364,13 +838,14 @@ ag_list_set_at(ag_list **ctx, const ag_value *val, size_t idx)
         AG_ASSERT (idx >= 1 && idx <= ag_list_len(*ctx));
 
         struct payload *p = ag_object_payload_mutable(ctx);
-        register struct node *n = p->head;
+        ag_value **v = payload_at_mutable(p, idx - 1);
 
-        for (register size_t i = 1; i < idx; i++)
-                n = n->nxt;
+        ag_value_release(v);
+        *v = ag_value_copy(val);
 
-        ag_value_release(&n->val);
-        n->val = ag_value_copy(val);
+        p->sorted = p->sorted
+            && (idx == 1 || value_ordered(*payload_at(p, idx - 2), *v))
+            && (idx == p->len || value_ordered(*v, *payload_at(p, idx)));
 }
 
 
@@ -390,13 +865,12 @@ ag_list_map_mutable(ag_list **ctx, ag_list_iterator_mutable *itr, void *in,
         AG_ASSERT_PTR (itr);
 
         struct payload *p = ag_object_payload_mutable(ctx);
-        register struct node *n = p->head;
         register bool flag = true;
 
-        while (n && flag) {
-                flag = itr(&n->val, in, out);
-                n = n->nxt;
-        }
+        p->sorted = p->len < 2;
+
+        for (register size_t i = 0; i < p->len && flag; i++)
+                flag = itr(payload_at_mutable(p, i), in, out);
 }
 
 
@@ -413,16 +887,17 @@ ag_list_start(ag_list **ctx)
         AG_ASSERT_PTR (ctx && *ctx);
 
         struct payload *p = ag_object_payload_mutable(ctx);
-        p->itr = p->head;
+        p->itr = 0;
 }
 
 
 /*
  * Define the ag_list_next() interface function. This function moves the
- * internal iterator of a list to the next node of the list, if possible. The
- * Boolean value returned indicates whether or not further iteration is
- * possible; in case the tail node has been reached, then false is returned.
- * This function is safe to call even on empty lists.
+ * internal iterator of a list to the next position of the list, if possible.
+ * The Boolean value returned indicates whether or not further iteration is
+ * possible; in case the tail has been reached, then false is returned. This
+ * function is safe to call even on empty lists. Moving the iterator of a
+ * shared list does not copy its spine.
  */
 
 
@@ -433,9 +908,9 @@ ag_list_next(ag_list **ctx)
 
         struct payload *p = ag_object_payload_mutable(ctx);
 
-        if (AG_LIKELY (p->itr)) {
-                p->itr = p->itr->nxt;
-                return p->itr->nxt;
+        if (AG_LIKELY (p->itr < p->len)) {
+                p->itr++;
+                return p->itr + 1 < p->len;
         }
 
         return false;
@@ -461,117 +936,948 @@ ag_list_push(ag_list **ctx, const ag_value *val)
 
 
 /*
- * Define the node_new() helper function. The node_new() function is responsible
- * for creating a new node on the heap. By default, the pointer to the next node
- * will always be NULL when a new node is created. Since we're performing a
- * shallow copy using ag_value_copy(), creating a new node is relatively
- * inexpensive.
+ * Define the ag_list_reserve() interface function. This function ensures that
+ * a list has room for at least a given number of values in total, so that
+ * pushing up to that many values doesn't need to add levels to the spine of
+ * the list. The nodes and chunks are still allocated as they're filled.
  */
 
 
-static inline struct node*
-node_new(const ag_value *val)
+extern void
+ag_list_reserve(ag_list **ctx, size_t len)
 {
-        AG_ASSERT_PTR (val);
-
-        struct node *n = ag_memblock_new(sizeof *n);
-        n->val = ag_value_copy(val);
-        n->nxt = NULL;
+        AG_ASSERT_PTR (ctx && *ctx);
 
-        return n;
+        struct payload *p = ag_object_payload_mutable(ctx);
+        spine_reserve(p, len);
 }
 
 
 /*
- * Define the node_new() helper function. We release the heap memory allocated
- * to a node and return a pointer to the next node (which may be NULL). By
- * returning a pointer to the next node, we make it easier to iterate through
- * the list with this function. Note that we're taking care to avoid casting to
- * (ag_memblock **) in the call to ag_memblock_release() in order to avoid
- * potential undefined behaviour.
- *
- * We know that there will always be only one given instance of a particular
- * node, i.e., there will be no shallow copies of the node. Hence, we can safely
- * release the value encapsulated by the node without checking the reference
- * count.
+ * Define the ag_list_sort() interface function. This function sorts a list in
+ * place through the payload_sort() helper function, without guaranteeing the
+ * relative order of equal values.
  */
 
 
-static inline struct node*
-node_release(struct node *ctx)
+extern void
+ag_list_sort(ag_list **ctx, ag_list_comparator *cmp, void *in)
 {
-        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (ctx && *ctx);
 
-        struct node *nxt = ctx->nxt;
-        void *ptr = ctx;
+        struct payload *p = ag_object_payload_mutable(ctx);
+        payload_sort(p, cmp, in, false);
+}
 
-        ag_value_release(&ctx->val);
-        ag_memblock_release(&ptr);
 
-        return nxt;
+/*
+ * Define the ag_list_sort_stable() interface function. This function is the
+ * same as ag_list_sort(), except that equal values are kept in the order in
+ * which they appear in the list.
+ */
+
+
+extern void
+ag_list_sort_stable(ag_list **ctx, ag_list_comparator *cmp, void *in)
+{
+        AG_ASSERT_PTR (ctx && *ctx);
+
+        struct payload *p = ag_object_payload_mutable(ctx);
+        payload_sort(p, cmp, in, true);
 }
 
 
 /*
- * Define the payload_new() helper function. This function is responsible for
- * creating a new payload instance, either empty or populated with the same
- * values as in another payload. In either case, the internal iterator is reset,
- * and the counters are updated accordingly.
+ * Define the chunk_copy() helper function. This function creates an unshared
+ * copy of a chunk. Since we're performing a shallow copy of each value using
+ * ag_value_copy(), copying a chunk is relatively inexpensive.
  */
 
 
-static struct payload *
-payload_new(const struct node *head)
+static struct chunk *
+chunk_copy(const struct chunk *ctx)
 {
-        struct payload *p = ag_memblock_new(sizeof *p);
-        p->len = p->sz = p->hash = 0;
-        p->itr = NULL;
+        AG_ASSERT_PTR (ctx);
 
-        if (!head) {
-                p->head = p->tail = NULL;
-                return p;
-        }
+        struct chunk *c = ag_memblock_new(sizeof *c);
+        c->len = ctx->len;
 
-        register const struct node *n = head;
-        while (n) {
-                payload_push(p, n->val);
-                n = n->nxt;
-        }
+        for (register size_t i = 0; i < ctx->len; i++)
+                c->val[i] = ag_value_copy(ctx->val[i]);
 
-        return p;
+        return c;
 }
 
 
 /*
- * Define the payload_push() helper function. This function is responsible for
- * pushing a new value encapsulated as a node into the list. There are two
- * possible scenarios where this function is called: When the list is empty, and
- * when the list is not empty. Of these two possibilities, the latter is much
- * more likely.
- *
- * When the list is empty, we set the pushed value to the start of the list.
- * Otherwise, in the case where the list is not empty, we push the value to the
- * end of the list. In either case, we update the tail pointer and the counters.
+ * Define the chunk_release() helper function. We drop a reference to a chunk,
+ * releasing its values if it isn't shared with any other spine. Note that
+ * we're taking care to avoid casting to (ag_memblock **) in the call to
+ * ag_memblock_release() in order to avoid potential undefined behaviour.
  */
 
 
 static void
-payload_push(struct payload *ctx, const ag_value *val)
+chunk_release(struct chunk *ctx)
 {
         AG_ASSERT_PTR (ctx);
-        AG_ASSERT_PTR (val);
 
-        struct node *n = node_new(val);
+        void *ptr = ctx;
 
-        if (AG_LIKELY (ctx->tail))
-                ctx->tail->nxt = n;
-        else
-                ctx->head = n;
+        if (ag_memblock_release_last(&ptr)) {
+                for (register size_t i = 0; i < ctx->len; i++)
+                        ag_value_release(&ctx->val[i]);
 
-        ctx->tail = n;
-        ctx->len++;
-        ctx->sz += ag_value_sz(val);
-        ctx->hash += ag_value_hash(val);
+                ag_memblock_release(&ptr);
+        }
+}
+
+
+/*
+ * Define the node_copy() helper function. This function creates an unshared
+ * copy of a node of a spine, or an empty node if the node is null. The child
+ * nodes or chunks are not copied, but have their reference count incremented
+ * instead.
+ */
+
+
+static struct node *
+node_copy(const struct node *ctx)
+{
+        struct node *n = ag_memblock_new(sizeof *n);
+
+        for (register size_t i = 0; i < NODE_LEN; i++) {
+                n->slot[i].node = ctx && ctx->slot[i].node
+                    ? ag_memblock_copy(ctx->slot[i].node) : NULL;
+        }
+
+        return n;
+}
+
+
+/*
+ * Define the node_release() helper function. This function is analogous to
+ * chunk_release(), dropping a reference to a node at a given height and
+ * releasing its child nodes or chunks if it isn't shared with any other spine.
+ * It is safe to call this function with a null node, which is the case for an
+ * empty list and for the slots that haven't been filled yet.
+ */
+
+
+static void
+node_release(struct node *ctx, size_t height)
+{
+        void *ptr = ctx;
+
+        if (AG_UNLIKELY (!ctx))
+                return;
+
+        if (ag_memblock_release_last(&ptr)) {
+                for (register size_t i = 0; i < NODE_LEN; i++) {
+                        if (height > 1)
+                                node_release(ctx->slot[i].node, height - 1);
+                        else if (ctx->slot[i].chunk)
+                                chunk_release(ctx->slot[i].chunk);
+                }
+
+                ag_memblock_release(&ptr);
+        }
+}
+
+
+/*
+ * Define the node_freeze() helper function. This function freezes a node at a
+ * given height along with the nodes and chunks below it and the values held by
+ * the chunks. As with node_release(), a null node is skipped.
+ */
+
+
+static void
+node_freeze(struct node *ctx, size_t height)
+{
+        if (AG_UNLIKELY (!ctx))
+                return;
+
+        ag_memblock_freeze(ctx);
+
+        for (register size_t i = 0; i < NODE_LEN; i++) {
+                struct chunk *c = ctx->slot[i].chunk;
+
+                if (height > 1)
+                        node_freeze(ctx->slot[i].node, height - 1);
+                else if (c) {
+                        ag_memblock_freeze(c);
+
+                        for (register size_t j = 0; j < c->len; j++)
+                                ag_value_freeze(c->val[j]);
+                }
+        }
+}
+
+
+/*
+ * Define the spine_chunk() helper function. This function returns the chunk at
+ * a given 0-based chunk index by walking down the spine from its root, taking
+ * NODE_BITS bits of the index at each level.
+ */
+
+
+static inline struct chunk *
+spine_chunk(const struct payload *ctx, size_t idx)
+{
+        const struct node *n = ctx->spine;
+
+        for (register size_t h = ctx->height; h > 1; h--)
+                n = n->slot[idx >> (NODE_BITS * (h - 1)) & NODE_MASK].node;
+
+        return n->slot[idx & NODE_MASK].chunk;
+}
+
+
+/*
+ * Define the spine_at_mutable() helper function. This function returns a handle
+ * to the slot of the chunk at a given 0-based chunk index, which may be null if
+ * the chunk hasn't been filled yet. The spine is first made tall enough to
+ * hold the chunk, and every node on the path to it that is shared is replaced
+ * by a copy, and every one that is missing by an empty node; the rest of the
+ * spine stays shared.
+ */
+
+
+static struct chunk **
+spine_at_mutable(struct payload *ctx, size_t idx)
+{
+        spine_reserve(ctx, (idx + 1) * CHUNK_LEN);
+
+        struct node **n = &ctx->spine;
+        register size_t h = ctx->height;
+
+        for (;;) {
+                if (AG_UNLIKELY (!*n || ag_memblock_refc(*n) > 1)) {
+                        struct node *cp = node_copy(*n);
+                        node_release(*n, h);
+                        *n = cp;
+                }
+
+                if (h == 1)
+                        return &(*n)->slot[idx & NODE_MASK].chunk;
+
+                n = &(*n)->slot[idx >> (NODE_BITS * --h) & NODE_MASK].node;
+        }
+}
+
+
+/*
+ * Define the spine_reserve() helper function. This function ensures that the
+ * spine of a list is tall enough to hold a given number of values, adding
+ * levels above the root as required. Each new root holds the old one in its
+ * first slot, so the existing nodes are neither copied nor unshared.
+ */
+
+
+static void
+spine_reserve(struct payload *ctx, size_t len)
+{
+        register size_t n = (len + CHUNK_LEN - 1) / CHUNK_LEN;
+
+        while (n && (!ctx->height || (n - 1) >> (NODE_BITS * ctx->height))) {
+                struct node *root = node_copy(NULL);
+                root->slot[0].node = ctx->spine;
+
+                ctx->spine = root;
+                ctx->height++;
+        }
 }
 
 
+/*
+ * Define the payload_new() helper function. This function is responsible for
+ * creating a new payload instance, either empty or sharing the spine of
+ * another payload. In the latter case, the iterator, counters and sorted flag
+ * are copied from the other payload.
+ */
+
+
+static struct payload *
+payload_new(const struct payload *ref)
+{
+        struct payload *p = ag_memblock_new(sizeof *p);
+        p->spine = NULL;
+        p->height = p->itr = p->len = p->sz = p->hash = 0;
+        p->sorted = true;
+
+        if (ref) {
+                *p = *ref;
+
+                if (p->spine)
+                        p->spine = ag_memblock_copy(p->spine);
+        }
+
+        return p;
+}
+
+
+/*
+ * Define the payload_at() helper function. This function returns a handle to
+ * the value at a given 0-based index; the caller must not modify it.
+ */
+
+
+static inline ag_value **
+payload_at(const struct payload *ctx, size_t idx)
+{
+        AG_ASSERT (idx < ctx->len);
+
+        return &spine_chunk(ctx, idx / CHUNK_LEN)->val[idx % CHUNK_LEN];
+}
+
+
+/*
+ * Define the payload_at_mutable() helper function. This function is similar to
+ * payload_at(), except that the nodes on the path to the chunk holding the
+ * value and the chunk itself are first copied if they're shared, so that the
+ * value may be modified in place.
+ */
+
+
+static ag_value **
+payload_at_mutable(struct payload *ctx, size_t idx)
+{
+        AG_ASSERT (idx < ctx->len);
+
+        struct chunk **c = spine_at_mutable(ctx, idx / CHUNK_LEN);
+
+        if (AG_UNLIKELY (ag_memblock_refc(*c) > 1)) {
+                struct chunk *cp = chunk_copy(*c);
+                chunk_release(*c);
+                *c = cp;
+        }
+
+        return &(*c)->val[idx % CHUNK_LEN];
+}
+
+
+/*
+ * Define the payload_push() helper function. This function is responsible for
+ * pushing a new value to the end of the list. There are two possible scenarios
+ * where this function is called: when the last chunk has room for the value,
+ * and when it doesn't. Of these two possibilities, the former is much more
+ * likely.
+ *
+ * When the last chunk is full (or when the list is empty), we put a new chunk
+ * in the next slot of the spine. Otherwise, we unshare the last chunk if
+ * required, and append the value to it. In either case, the path to the chunk
+ * is unshared first; we then update the counters, and keep the list flagged as
+ * sorted if the value isn't less than the one before it.
+ */
+
+
+static void
+payload_push(struct payload *ctx, const ag_value *val)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (val);
+
+        struct chunk **c = spine_at_mutable(ctx, ctx->len / CHUNK_LEN);
+
+        if (AG_UNLIKELY (!(ctx->len % CHUNK_LEN))) {
+                *c = ag_memblock_new(sizeof **c);
+                (*c)->len = 0;
+        } else if (AG_UNLIKELY (ag_memblock_refc(*c) > 1)) {
+                struct chunk *cp = chunk_copy(*c);
+                chunk_release(*c);
+                *c = cp;
+        }
+
+        ag_value **v = &(*c)->val[(*c)->len++];
+
+        *v = ag_value_copy(val);
+        ctx->len++;
+        ctx->sz += ag_value_sz(val);
+        ctx->hash += ag_value_hash(val);
+
+        if (ctx->sorted && ctx->len > 1)
+                ctx->sorted = value_ordered(*payload_at(ctx, ctx->len - 2), *v);
+}
+
+
+static size_t
+par_grain(size_t len, size_t grain)
+{
+        if (!grain)
+                grain = len / (ag_pool_len(ag_pool_shared()) * 4);
+
+        grain = (grain + CHUNK_LEN - 1) / CHUNK_LEN * CHUNK_LEN;
+        return grain ? grain : CHUNK_LEN;
+}
+
+
+static void
+par_map(size_t lo, size_t hi, void *ctx)
+{
+        struct par *par = ctx;
+        register size_t sz = 0;
+        register ag_hash hash = 0;
+        struct chunk *c, *c2;
+        ag_value *v;
+
+        for (register size_t i = lo; i < hi; i += CHUNK_LEN) {
+                c = spine_chunk(par->src, i / CHUNK_LEN);
+                c2 = ag_memblock_new(sizeof *c2);
+                c2->len = c->len;
+
+                for (register size_t j = 0; j < c->len; j++) {
+                        v = par->map(c->val[j], par->in);
+                        AG_ASSERT_PTR (v);
+
+                        sz += ag_value_sz(v);
+                        hash += ag_value_hash(v);
+                        c2->val[j] = v;
+                }
+
+                *spine_at_mutable(par->dst, i / CHUNK_LEN) = c2;
+        }
+
+        par->sz[lo / par->grain] = sz;
+        par->hash[lo / par->grain] = hash;
+}
+
+
+static void
+par_filter(size_t lo, size_t hi, void *ctx)
+{
+        struct par *par = ctx;
+
+        for (register size_t i = lo; i < hi; i++)
+                par->keep[i] = par->pred(*payload_at(par->src, i), par->in);
+}
+
+
+static void
+par_reduce(size_t lo, size_t hi, void *ctx)
+{
+        struct par *par = ctx;
+        ag_value *acc = ag_value_copy(*payload_at(par->src, lo));
+        ag_value *acc2;
+
+        for (register size_t i = lo + 1; i < hi; i++) {
+                acc2 = par->red(acc, *payload_at(par->src, i), par->in);
+                AG_ASSERT_PTR (acc2);
+
+                ag_value_release(&acc);
+                acc = acc2;
+        }
+
+        par->acc[lo / par->grain] = acc;
+}
+
+
+/*
+ * Define the value_ordered() helper function. This function checks whether
+ * one value may come before another in a sorted list. Only scalar values of
+ * the same type are compared; objects are only flagged as sorted by sorting
+ * them, since comparing them on every push may be expensive.
+ */
+
+
+static inline bool
+value_ordered(const ag_value *lhs, const ag_value *rhs)
+{
+        register enum ag_value_type t = ag_value_type(lhs);
+
+        return t == ag_value_type(rhs) && t != AG_VALUE_TYPE_OBJECT
+            && ag_value_cmp(lhs, rhs) != AG_CMP_GT;
+}
+
+
+static inline enum ag_cmp
+sort_cmp(const struct sort *ctx, const ag_value *lhs, const ag_value *rhs)
+{
+        return ctx->cmp ? ctx->cmp(lhs, rhs, ctx->in) : ag_value_cmp(lhs, rhs);
+}
+
+
+static void
+sort_insert(const struct sort *ctx, ag_value **val, size_t len)
+{
+        register size_t j;
+        ag_value *v;
+
+        for (register size_t i = 1; i < len; i++) {
+                v = val[i];
+
+                for (j = i; j && sort_cmp(ctx, v, val[j - 1]) == AG_CMP_LT; j--)
+                        val[j] = val[j - 1];
+
+                val[j] = v;
+        }
+}
+
+
+static void
+sort_heap(const struct sort *ctx, ag_value **val, size_t len)
+{
+        register size_t i, j, k;
+        ag_value *v;
+
+        for (i = len / 2; i-- > 0;) {
+                for (j = i; (k = 2 * j + 1) < len; j = k) {
+                        if (k + 1 < len && sort_cmp(ctx, val[k], val[k + 1])
+                            == AG_CMP_LT)
+                                k++;
+                        if (sort_cmp(ctx, val[j], val[k]) != AG_CMP_LT)
+                                break;
+
+                        v = val[j];
+                        val[j] = val[k];
+                        val[k] = v;
+                }
+        }
+
+        for (i = len; i-- > 1;) {
+                v = val[0];
+                val[0] = val[i];
+                val[i] = v;
+
+                for (j = 0; (k = 2 * j + 1) < i; j = k) {
+                        if (k + 1 < i && sort_cmp(ctx, val[k], val[k + 1])
+                            == AG_CMP_LT)
+                                k++;
+                        if (sort_cmp(ctx, val[j], val[k]) != AG_CMP_LT)
+                                break;
+
+                        v = val[j];
+                        val[j] = val[k];
+                        val[k] = v;
+                }
+        }
+}
+
+
+/*
+ * Define the sort_intro() helper function. This function is a quicksort with a
+ * median-of-three pivot that recurses into the smaller partition and loops on
+ * the larger one, switching to insertion sort for short partitions and to
+ * heapsort once the recursion gets too deep.
+ */
+
+
+static void
+sort_intro(const struct sort *ctx, ag_value **val, size_t len, size_t depth)
+{
+        register size_t i, j;
+        ag_value *pv;
+        ag_value *v;
+
+        while (len > SORT_INSERT) {
+                if (!depth--) {
+                        sort_heap(ctx, val, len);
+                        return;
+                }
+
+                i = len / 2;
+
+                if (sort_cmp(ctx, val[i], val[0]) == AG_CMP_LT) {
+                        v = val[i];
+                        val[i] = val[0];
+                        val[0] = v;
+                }
+
+                if (sort_cmp(ctx, val[len - 1], val[i]) == AG_CMP_LT) {
+                        v = val[i];
+                        val[i] = val[len - 1];
+                        val[len - 1] = v;
+
+                        if (sort_cmp(ctx, val[i], val[0]) == AG_CMP_LT) {
+                                v = val[i];
+                                val[i] = val[0];
+                                val[0] = v;
+                        }
+                }
+
+                pv = val[i];
+                i = 0;
+                j = len - 1;
+
+                for (;;) {
+                        while (sort_cmp(ctx, val[i], pv) == AG_CMP_LT)
+                                i++;
+                        while (sort_cmp(ctx, pv, val[j]) == AG_CMP_LT)
+                                j--;
+                        if (i >= j)
+                                break;
+
+                        v = val[i];
+                        val[i++] = val[j];
+                        val[j--] = v;
+                }
+
+                if (j + 1 < len - j - 1) {
+                        sort_intro(ctx, val, j + 1, depth);
+                        val += j + 1;
+                        len -= j + 1;
+                } else {
+                        sort_intro(ctx, val + j + 1, len - j - 1, depth);
+                        len = j + 1;
+                }
+        }
+
+        sort_insert(ctx, val, len);
+}
+
+
+/*
+ * Define the merge() helper function. This function merges two adjacent sorted
+ * runs into a destination array, taking from the left run on ties so that the
+ * merge is stable.
+ */
+
+
+static void
+merge(const struct sort *ctx, ag_value **dst, ag_value *const *lhs,
+    size_t llen, ag_value *const *rhs, size_t rlen)
+{
+        register size_t i = 0, j = 0, k = 0;
+
+        while (i < llen && j < rlen) {
+                if (sort_cmp(ctx, rhs[j], lhs[i]) == AG_CMP_LT)
+                        dst[k++] = rhs[j++];
+                else
+                        dst[k++] = lhs[i++];
+        }
+
+        memcpy(dst + k, lhs + i, (llen - i) * sizeof *dst);
+        memcpy(dst + k + llen - i, rhs + j, (rlen - j) * sizeof *dst);
+}
+
+
+/*
+ * Define the sort_merge() helper function. This function is a top-down merge
+ * sort using a buffer of the same length as the values, with insertion sort
+ * on short runs. Merging is skipped when the two halves are already in order,
+ * so sorting a list that is mostly sorted is cheap.
+ */
+
+
+static void
+sort_merge(const struct sort *ctx, ag_value **val, ag_value **tmp, size_t len)
+{
+        if (len <= SORT_INSERT) {
+                sort_insert(ctx, val, len);
+                return;
+        }
+
+        register size_t mid = len / 2;
+
+        sort_merge(ctx, val, tmp, mid);
+        sort_merge(ctx, val + mid, tmp + mid, len - mid);
+
+        if (sort_cmp(ctx, val[mid], val[mid - 1]) != AG_CMP_LT)
+                return;
+
+        merge(ctx, tmp, val, mid, val + mid, len - mid);
+        memcpy(val, tmp, len * sizeof *val);
+}
+
+
+/*
+ * Define the radix sort helper functions. radix_num() is a least significant
+ * digit radix sort on the 64-bit keys of integer and unsigned integer values,
+ * with the sign bit of integers flipped so that they sort as unsigned keys. It
+ * counts all eight byte digits in one pass, and skips the digits that are the
+ * same for every value. radix_str() is a most significant digit radix sort on
+ * the bytes of string values, which matches the byte order of ag_string_cmp();
+ * it distributes the values into buckets on the byte at a given depth, and
+ * recurses into each bucket on the next byte, falling back to insertion sort
+ * for short buckets. Both sorts are stable.
+ */
+
+
+struct radix {
+        uint64_t         key; /* sort key */
+        ag_value        *val; /* value    */
+};
+
+
+static void
+radix_num(ag_value **val, size_t len, bool sign)
+{
+        struct radix *a = ag_memblock_new(len * sizeof *a);
+        struct radix *b = ag_memblock_new(len * sizeof *b);
+        struct radix *t;
+        size_t cnt[8][256];
+        register size_t i, d, n;
+        register uint64_t k;
+
+        memset(cnt, 0, sizeof cnt);
+
+        for (i = 0; i < len; i++) {
+                k = sign ? (uint64_t)ag_value_int(val[i]) ^ (UINT64_C(1) << 63)
+                    : (uint64_t)ag_value_uint(val[i]);
+
+                a[i].key = k;
+                a[i].val = val[i];
+
+                for (d = 0; d < 8; d++)
+                        cnt[d][(k >> (d * 8)) & 0xff]++;
+        }
+
+        for (d = 0; d < 8; d++) {
+                if (cnt[d][(a[0].key >> (d * 8)) & 0xff] == len)
+                        continue;
+
+                for (i = 0, k = 0; i < 256; i++) {
+                        n = cnt[d][i];
+                        cnt[d][i] = k;
+                        k += n;
+                }
+
+                for (i = 0; i < len; i++)
+                        b[cnt[d][(a[i].key >> (d * 8)) & 0xff]++] = a[i];
+
+                t = a;
+                a = b;
+                b = t;
+        }
+
+        for (i = 0; i < len; i++)
+                val[i] = a[i].val;
+
+        void *ptr = a;
+        ag_memblock_release(&ptr);
+        ptr = b;
+        ag_memblock_release(&ptr);
+}
+
+
+static inline unsigned char
+radix_byte(const ag_value *val, size_t depth)
+{
+        return ((const unsigned char *)ag_value_string(val))[depth];
+}
+
+
+static void
+radix_str(ag_value **val, ag_value **tmp, size_t len, size_t depth)
+{
+        size_t cnt[256];
+        size_t off[256];
+        register size_t i, j, n;
+        register unsigned char c;
+        ag_value *v;
+
+        for (;;) {
+                if (len <= SORT_INSERT) {
+                        for (i = 1; i < len; i++) {
+                                v = val[i];
+
+                                for (j = i; j && strcmp(ag_value_string(v)
+                                    + depth, ag_value_string(val[j - 1])
+                                    + depth) < 0; j--)
+                                        val[j] = val[j - 1];
+
+                                val[j] = v;
+                        }
+
+                        return;
+                }
+
+                memset(cnt, 0, sizeof cnt);
+
+                for (i = 0; i < len; i++)
+                        cnt[radix_byte(val[i], depth)]++;
+
+                c = radix_byte(val[0], depth);
+
+                if (cnt[c] != len)
+                        break;
+
+                if (!c)
+                        return;
+
+                depth++;
+        }
+
+        for (i = 0, n = 0; i < 256; i++) {
+                off[i] = n;
+                n += cnt[i];
+        }
+
+        for (i = 0; i < len; i++)
+                tmp[off[radix_byte(val[i], depth)]++] = val[i];
+
+        memcpy(val, tmp, len * sizeof *val);
+
+        for (i = 1, n = cnt[0]; i < 256; n += cnt[i++]) {
+                if (cnt[i] > 1)
+                        radix_str(val + n, tmp, cnt[i], depth + 1);
+        }
+}
+
+
+/*
+ * Define the sort_radix() helper function. This function radix sorts an array
+ * of values if they are all integers, all unsigned integers, or all strings,
+ * returning whether it has done so.
+ */
+
+
+static bool
+sort_radix(ag_value **val, size_t len)
+{
+        register enum ag_value_type t = ag_value_type(val[0]);
+
+        if (t != AG_VALUE_TYPE_INT && t != AG_VALUE_TYPE_UINT
+            && t != AG_VALUE_TYPE_STRING)
+                return false;
+
+        for (register size_t i = 1; i < len; i++) {
+                if (ag_value_type(val[i]) != t)
+                        return false;
+        }
+
+        if (t == AG_VALUE_TYPE_STRING) {
+                ag_value **tmp = ag_memblock_new(len * sizeof *tmp);
+                radix_str(val, tmp, len, 0);
+
+                void *ptr = tmp;
+                ag_memblock_release(&ptr);
+        } else
+                radix_num(val, len, t == AG_VALUE_TYPE_INT);
+
+        return true;
+}
+
+
+/*
+ * Define the sort_par() helper function. This function splits the values into
+ * a power of two number of runs, at least as many as there are threads in the
+ * shared pool, and merge sorts the runs in parallel. The sorted runs are then
+ * merged pairwise in rounds, each pair of runs being merged by a task of its
+ * own, until a single run is left.
+ */
+
+
+static void
+sort_par(struct sort *ctx, ag_value **val)
+{
+        ag_pool *pool = ag_pool_shared();
+        ag_value **tmp = ag_memblock_new(ctx->len * sizeof *tmp);
+        ag_value **t;
+        register size_t nrun = 2;
+
+        while (nrun < ag_pool_len(pool))
+                nrun *= 2;
+
+        ctx->width = (ctx->len + nrun - 1) / nrun;
+        ctx->src = val;
+        ctx->dst = tmp;
+
+        ag_pool_run(pool, ctx->len, ctx->width, par_sort, ctx);
+
+        for (; ctx->width < ctx->len; ctx->width *= 2) {
+                nrun = (ctx->len + ctx->width * 2 - 1) / (ctx->width * 2);
+                ag_pool_run(pool, nrun, 1, par_merge, ctx);
+
+                t = ctx->src;
+                ctx->src = ctx->dst;
+                ctx->dst = t;
+        }
+
+        if (ctx->src != val)
+                memcpy(val, ctx->src, ctx->len * sizeof *val);
+
+        void *ptr = tmp;
+        ag_memblock_release(&ptr);
+}
+
+
+static void
+par_sort(size_t lo, size_t hi, void *ctx)
+{
+        struct sort *s = ctx;
+
+        sort_merge(s, s->src + lo, s->dst + lo, hi - lo);
+}
+
+
+static void
+par_merge(size_t lo, size_t hi, void *ctx)
+{
+        struct sort *s = ctx;
+        register size_t l, m, h;
+
+        for (register size_t i = lo; i < hi; i++) {
+                l = i * s->width * 2;
+                m = l + s->width < s->len ? l + s->width : s->len;
+                h = m + s->width < s->len ? m + s->width : s->len;
+
+                merge(s, s->dst + l, s->src + l, m - l, s->src + m, h - m);
+        }
+}
+
+
+/*
+ * Define the payload_sort() helper function. This function first unshares the
+ * spine and every chunk of a list, so that the values it holds are owned by
+ * the list alone, and then gathers the values into a flat array. Once sorted,
+ * the values are written back to the chunks in their new order; since the list
+ * still holds the same values, no reference counts need to change.
+ *
+ * Without a comparator, lists of integers, unsigned integers and strings are
+ * radix sorted, and a list that is already flagged as sorted is left alone.
+ * Otherwise, large lists are merge sorted on the shared thread pool when it has
+ * more than one thread; smaller lists are merge sorted if the sort needs to be
+ * stable, and sorted with an introsort if not.
+ */
+
+
+static void
+payload_sort(struct payload *ctx, ag_list_comparator *cmp, void *in,
+    bool stable)
+{
+        if (ctx->len < 2 || (!cmp && ctx->sorted)) {
+                ctx->sorted = ctx->len < 2 || !cmp;
+                return;
+        }
+
+        struct sort s = { .cmp = cmp, .in = in, .len = ctx->len };
+        ag_value **val = ag_memblock_new(ctx->len * sizeof *val);
+        register size_t i, depth = 0;
+        struct chunk *c;
+
+        for (i = 0; i < ctx->len; i += CHUNK_LEN) {
+                (void)payload_at_mutable(ctx, i);
+                c = spine_chunk(ctx, i / CHUNK_LEN);
+                memcpy(val + i, c->val, c->len * sizeof *val);
+        }
+
+        if (cmp || !sort_radix(val, ctx->len)) {
+                if (ctx->len >= SORT_PAR_MIN
+                    && ag_pool_len(ag_pool_shared()) > 1)
+                        sort_par(&s, val);
+                else if (stable) {
+                        ag_value **tmp = ag_memblock_new(ctx->len
+                            * sizeof *tmp);
+                        sort_merge(&s, val, tmp, ctx->len);
+
+                        void *ptr = tmp;
+                        ag_memblock_release(&ptr);
+                } else {
+                        for (i = ctx->len; i; i >>= 1)
+                                depth += 2;
+
+                        sort_intro(&s, val, ctx->len, depth);
+                }
+        }
+
+        for (i = 0; i < ctx->len; i += CHUNK_LEN) {
+                c = spine_chunk(ctx, i / CHUNK_LEN);
+                memcpy(c->val, val + i, c->len * sizeof *val);
+        }
+
+        ctx->sorted = !cmp;
+
+        void *ptr = val;
+        ag_memblock_release(&ptr);
+}
@@ -45,12 +45,28 @@ typedef bool    (ag_list_iterator)(const ag_value *, void *, void *);
 typedef bool    (ag_list_iterator_mutable)(ag_value **, void *, void *);
 
 
+/*
+ * Declare the callback types of the parallel list functions. Since these
+ * callbacks run concurrently on several threads, they don't share an output
+ * parameter; ag_list_transform returns a new value for a given value,
+ * ag_list_predicate returns whether a given value should be kept, and
+ * ag_list_reducer returns the combination of two values. All three are passed
+ * the same input parameter on every call.
+ */
+typedef ag_value *(ag_list_transform)(const ag_value *, void *);
+typedef bool      (ag_list_predicate)(const ag_value *, void *);
+typedef ag_value *(ag_list_reducer)(const ag_value *, const ag_value *,
+                      void *);
+
+
 /*
  * Declare the manager interface for ag_list. ag_list_new() creates a new empty
- * list instance. The remaining manager functions, which are aliases of their
- * object counterparts, are automatically generated by AG_OBJECT_DECLARE().
+ * list instance, and ag_list_new_array() creates a list from an array of
+ * values. The remaining manager functions, which are aliases of their object
+ * counterparts, are automatically generated by AG_OBJECT_DECLARE().
  */
 extern ag_list  *ag_list_new(void);
+extern ag_list  *ag_list_new_array(const ag_value **, size_t);
 
 
 /*
@@ -64,11 +80,100 @@ extern void      ag_list_map(const ag_list *, ag_list_iterator *, void *,
                     void *);
 
 
+/*
+ * Declare the parallel interface for ag_list. These functions split a list into
+ * chunks of a given grain size, and run the chunks on the shared thread pool;
+ * a grain of 0 lets the list pick one. ag_list_pmap() returns the list of
+ * transformed values, ag_list_pfilter() returns the list of values satisfying
+ * a predicate, and ag_list_preduce() folds the values of a list into an
+ * initial value. The results are in the order of the original list, and are
+ * the same as those of the equivalent serial loops; ag_list_preduce() further
+ * requires the reducer to be associative, since it reduces each chunk before
+ * combining the chunk results.
+ */
+extern ag_list  *ag_list_pmap(const ag_list *, ag_list_transform *, void *,
+                    size_t);
+extern ag_list  *ag_list_pfilter(const ag_list *, ag_list_predicate *, void *,
+                    size_t);
+extern ag_value *ag_list_preduce(const ag_list *, ag_list_reducer *,
+                    const ag_value *, void *, size_t);
+
+
+/*
+ * Declare the cursor interface for ag_list. A cursor traverses an immutable
+ * list without touching its payload, so any number of cursors can traverse a
+ * shared list at once, without copying it or changing any reference counts.
+ * Cursors are meant to be allocated on the stack and initialised with
+ * ag_list_cursor_init(); ag_list_cursor_next() moves a cursor to the next value
+ * of the list, returning false once there are none left, and
+ * ag_list_cursor_get() peeks at the value under a cursor without copying it.
+ * A cursor walks the values of a list chunk by chunk, so ag_list_cursor_next()
+ * only calls out of line to move on to the next chunk. A cursor must not be
+ * used once its list has been mutated or released.
+ */
+typedef struct ag_list_cursor {
+        const ag_list    *list;  /* list being traversed  */
+        size_t            chunk; /* next chunk to visit   */
+        ag_value *const  *val;   /* next value in chunk   */
+        ag_value *const  *end;   /* end of current chunk  */
+} ag_list_cursor;
+
+extern void     ag_list_cursor_init(ag_list_cursor *, const ag_list *);
+extern bool     __ag_list_cursor_chunk__(ag_list_cursor *);
+
+inline bool
+ag_list_cursor_next(ag_list_cursor *ctx)
+{
+        if (AG_LIKELY (ctx->val != ctx->end)) {
+                ctx->val++;
+                return true;
+        }
+
+        return __ag_list_cursor_chunk__(ctx);
+}
+
+inline const ag_value *
+ag_list_cursor_get(const ag_list_cursor *ctx)
+{
+        return ctx->val[-1];
+}
+
+
+/*
+ * Declare the sorting and searching interface for ag_list. ag_list_comparator
+ * is a callback that compares two values, and is passed the same input
+ * parameter on every call; wherever a comparator is optional, NULL stands for
+ * ag_value_cmp().
+ *
+ * ag_list_sort() sorts a list in ascending order, and ag_list_sort_stable()
+ * does the same while keeping equal values in their original order. Lists of
+ * integers, unsigned integers or strings sorted without a comparator are radix
+ * sorted, and large lists are merge sorted on the shared thread pool, so the
+ * comparator must be safe to call from several threads at once.
+ * ag_list_search() binary searches a sorted list for a value, returning the
+ * 1-based index of the first equal value, or 0 if there is none.
+ * ag_list_sorted() returns whether a list is known to be in ascending order
+ * according to ag_value_cmp(); lists are flagged as sorted by sorting them
+ * without a comparator, and the flag is kept up to date as values are pushed
+ * and set.
+ */
+typedef enum ag_cmp (ag_list_comparator)(const ag_value *, const ag_value *,
+                        void *);
+
+extern void     ag_list_sort(ag_list **, ag_list_comparator *, void *);
+extern void     ag_list_sort_stable(ag_list **, ag_list_comparator *, void *);
+extern size_t   ag_list_search(const ag_list *, const ag_value *,
+                    ag_list_comparator *, void *);
+extern bool     ag_list_sorted(const ag_list *);
+
+
 /*
  * Declare the mutator interface for ag_list. ag_list_set() and ag_list_set_at()
  * are used to set a value in a list, ag_list_push() is used to push a value to
  * the end of a list, ag_list_map_mutable() is used to iterate across a mutable
  * list, ag_list_start() and ag_list_next() are used to traverse across a list.
+ * ag_list_reserve() makes room for a given number of values in advance, so
+ * that pushing them doesn't need to grow the list.
  */
 extern void     ag_list_set(ag_list **, const ag_value *);
 extern void     ag_list_set_at(ag_list **, const ag_value *, size_t);
@@ -77,6 +182,7 @@ extern void     ag_list_map_mutable(ag_list **, ag_list_iterator_mutable *,
 extern void     ag_list_start(ag_list **);
 extern bool     ag_list_next(ag_list **);
 extern void     ag_list_push(ag_list **, const ag_value *);
+extern void     ag_list_reserve(ag_list **, size_t);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,890 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "../argent.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+
+/*
+ * Define the node of a map. A map is a hash array mapped trie, with each level
+ * of the trie indexed by the next NODE_BITS bits of the key hash. A node only
+ * holds the slots that are occupied, in the order of their bits in the bitmap,
+ * so the slot for a bit is found by counting the set bits below it. A slot is
+ * either a key-value entry or, if its key is NULL, a subnode. Once the entire
+ * hash has been consumed, the keys that still collide share a collision node,
+ * which has no bitmap and is searched linearly.
+ *
+ * Nodes are reference counted memory blocks, shared between copies of a map
+ * until one of them is mutated; a mutation unshares only the nodes on the path
+ * to the affected key.
+ */
+
+
+#define NODE_BITS 5
+#define NODE_MASK ((1u << NODE_BITS) - 1)
+#define HASH_BITS (sizeof (ag_hash) * CHAR_BIT)
+
+
+struct node;
+
+
+struct slot {
+        ag_value        *key;          /* entry key, or NULL for a subnode */
+        union {
+                ag_value        *val;  /* entry value                      */
+                struct node     *sub;  /* subnode                          */
+        };
+};
+
+
+struct node {
+        uint32_t         bmap;   /* bitmap of occupied slots */
+        uint32_t         len;    /* number of slots          */
+        struct slot      slot[]; /* slots in bitmap order    */
+};
+
+
+/*
+ * Define the object payload of a map. As with lists, we maintain the length,
+ * cumulative size and cumulative hash of the map so that we don't need to walk
+ * the trie for them. The cumulative hash is a sum over the entries, and so
+ * doesn't depend on the order in which the entries were added.
+ */
+
+
+struct payload {
+        struct node     *root; /* trie root, NULL if empty */
+        size_t           len;  /* number of entries        */
+        size_t           sz;   /* cumulative size          */
+        ag_hash          hash; /* cumulative hash          */
+};
+
+
+/*
+ * Declare the prototypes for the node helper functions. node_new() creates an
+ * empty node with room for a given number of slots, node_reserve() ensures that
+ * a node is unshared and has room for a given number of slots, and
+ * node_release() drops a reference, releasing the contents along with the last
+ * one. node_pair() creates the subtrie holding two entries whose hashes agree
+ * up to a given shift. node_get(), node_set() and node_remove() look up, set
+ * and remove a key below a node, node_map() runs an iterator across the entries
+ * below a node, and node_freeze() freezes a node along with its contents.
+ */
+
+
+static struct node      *node_new(size_t);
+static void              node_reserve(struct node **, size_t);
+static void              node_release(struct node *);
+static struct node      *node_pair(ag_value *, ag_value *, ag_hash, ag_value *,
+                             ag_value *, ag_hash, size_t);
+static const ag_value   *node_get(const struct node *, ag_hash, size_t,
+                             const ag_value *);
+static bool              node_set(struct node **, ag_hash, size_t,
+                             const ag_value *, const ag_value *);
+static void              node_remove(struct node **, ag_hash, size_t,
+                             const ag_value *);
+static bool              node_map(const struct node *, ag_map_iterator *,
+                             void *, void *);
+static void              node_freeze(struct node *);
+
+
+/*
+ * Declare the prototypes for the payload helper functions. payload_new() helps
+ * create a new payload instance, either empty or sharing the trie of another
+ * payload, and payload_set() sets a key-value pair while keeping the
+ * cumulative length, size and hash of the payload up to date.
+ */
+
+
+static struct payload   *payload_new(const struct payload *);
+static void              payload_set(struct payload *, const ag_value *,
+                             const ag_value *);
+
+
+/*
+ * Declare the prototypes for the iterators used by the object callbacks below,
+ * along with the helpers that compare keys and compute the hash of an entry.
+ */
+
+
+static bool     cmp_iterator(const ag_value *, const ag_value *, void *,
+                    void *);
+static bool     valid_iterator(const ag_value *, const ag_value *, void *,
+                    void *);
+static bool     str_iterator(const ag_value *, const ag_value *, void *,
+                    void *);
+static bool     pack_iterator(const ag_value *, const ag_value *, void *,
+                    void *);
+
+
+static inline bool      key_eq(const ag_value *, const ag_value *);
+static inline ag_hash   entry_hash(ag_hash, const ag_value *);
+
+
+/*
+ * Define the ag_map object. The ag_map type is defined as an object by its
+ * dynamic dispatch callback functions that are registered with the object
+ * registry.
+ */
+
+
+AG_OBJECT_DEFINE(ag_map, AG_TYPEID_MAP);
+
+
+/*
+ * Define the __ag_map_clone__() dynamic dispatch callback function. This
+ * function is called by ag_object_clone() when ag_map_clone() is invoked. The
+ * new payload shares the trie of the contextual map, so cloning a map is O(1)
+ * regardless of its size.
+ */
+
+AG_OBJECT_DEFINE_CLONE(ag_map,
+        return payload_new(_p_);
+);
+
+
+/*
+ * Define the __ag_map_release__() dynamic dispatch callback function. This
+ * function is called by ag_object_release() when ag_map_release() is invoked.
+ * We drop the reference of the payload to its root node, which takes care of
+ * releasing the nodes that aren't shared with another map.
+ */
+
+AG_OBJECT_DEFINE_RELEASE(ag_map,
+        struct payload *p = _p_;
+
+        if (p->root)
+                node_release(p->root);
+);
+
+
+/*
+ * Define the __ag_map_cmp__() dynamic dispatch callback function. This function
+ * is called by ag_object_cmp() when ag_map_cmp() is invoked. Maps don't have a
+ * natural order, so we order them by length and then by cumulative hash. Maps
+ * of equal length and hash are equal if they hold the same entries; otherwise
+ * they are ordered by the first entry of the first map that isn't matched in
+ * the second.
+ */
+
+AG_OBJECT_DEFINE_CMP(ag_map,
+        const struct payload *p1 = ag_object_payload(_o1_);
+        const struct payload *p2 = ag_object_payload(_o2_);
+
+        if (p1->len != p2->len)
+                return p1->len < p2->len ? AG_CMP_LT : AG_CMP_GT;
+
+        if (p1->hash != p2->hash)
+                return p1->hash < p2->hash ? AG_CMP_LT : AG_CMP_GT;
+
+        enum ag_cmp cmp = AG_CMP_EQ;
+
+        if (p1->root)
+                (void)node_map(p1->root, cmp_iterator, (void *)p2, &cmp);
+
+        return cmp;
+);
+
+
+/*
+ * Define the __ag_map_valid__() dynamic dispatch callback function. This
+ * function is called by ag_object_valid() when ag_map_valid() is invoked. As
+ * with lists, a map is valid if it's not empty and all of its keys and values
+ * are valid.
+ */
+
+AG_OBJECT_DEFINE_VALID(ag_map,
+        const struct payload *p = ag_object_payload(_o_);
+        bool valid = true;
+
+        if (AG_UNLIKELY (!p->len))
+                return false;
+
+        (void)node_map(p->root, valid_iterator, NULL, &valid);
+        return valid;
+);
+
+
+/*
+ * Define the __ag_map_sz__() dynamic dispatch callback function. This function
+ * is called by ag_object_sz() when ag_map_sz() is invoked. The size of a map is
+ * the cumulative size of its keys and values.
+ */
+
+AG_OBJECT_DEFINE_SZ(ag_map,
+        const struct payload *p = ag_object_payload(_o_);
+        return p->sz;
+);
+
+
+/*
+ * Define the __ag_map_len__() dynamic dispatch callback function. This function
+ * is called by ag_object_len() when ag_map_len() is invoked. The length of a
+ * map is the number of entries it holds.
+ */
+
+AG_OBJECT_DEFINE_LEN(ag_map,
+        const struct payload *p = ag_object_payload(_o_);
+        return p->len;
+);
+
+
+/*
+ * Define the __ag_map_hash__() dynamic dispatch callback function. This
+ * function is called by ag_object_hash() when ag_map_hash() is invoked. The
+ * hash of a map is the cumulative hash of its entries.
+ */
+
+AG_OBJECT_DEFINE_HASH(ag_map,
+        const struct payload *p = ag_object_payload(_o_);
+        return p->hash;
+);
+
+
+/*
+ * Define the __ag_map_str__() dynamic dispatch callback function. This function
+ * is called by ag_object_str() when ag_map_str() is invoked. A map is written
+ * out in the same form as an association list, with its entries in iteration
+ * order.
+ */
+
+AG_OBJECT_DEFINE_STR(ag_map,
+        const struct payload *p = ag_object_payload(_o_);
+        ag_string *s = ag_string_new_empty();
+
+        if (p->root)
+                (void)node_map(p->root, str_iterator, NULL, &s);
+
+        ag_string *s2 = ag_string_new_fmt("(%s)", s);
+        ag_string_release(&s);
+
+        return s2;
+);
+
+
+/*
+ * Define the __ag_map_pack__() dynamic dispatch callback function. This
+ * function is called by ag_object_pack() when a map is packed. A map is packed
+ * as a map of its keys and values in iteration order.
+ */
+
+AG_OBJECT_DEFINE_PACK(ag_map,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_map(_w_, p->len);
+
+        if (p->root)
+                (void)node_map(p->root, pack_iterator, NULL, _w_);
+);
+
+
+/*
+ * Define the __ag_map_unpack__() dynamic dispatch callback function. This
+ * function is called by ag_object_unpack() to read back the map written by
+ * __ag_map_pack__() into a new payload.
+ */
+
+AG_OBJECT_DEFINE_UNPACK(ag_map,
+        struct payload *p = payload_new(NULL);
+        register size_t len = ag_unpack_map(_r_);
+
+        for (register size_t i = 0; i < len; i++) {
+                AG_AUTO(ag_value) *k = ag_value_unpack(_r_);
+                AG_AUTO(ag_value) *v = ag_value_unpack(_r_);
+
+                payload_set(p, k, v);
+        }
+
+        return p;
+);
+
+
+/*
+ * Define the __ag_map_freeze__() dynamic dispatch callback function. This
+ * function is called by ag_object_freeze() when a map is frozen. The nodes of
+ * the trie are frozen along with the keys and values held by them.
+ */
+
+AG_OBJECT_DEFINE_FREEZE(ag_map,
+        struct payload *p = _p_;
+
+        if (p->root)
+                node_freeze(p->root);
+);
+
+
+/*
+ * Define the ag_map_new() interface function. Since maps are objects, we use
+ * the ag_object_new() function to create a new map, passing along the type ID
+ * and an empty payload.
+ */
+
+
+extern ag_map *
+ag_map_new(void)
+{
+        return ag_object_new(AG_TYPEID_MAP, payload_new(NULL));
+}
+
+
+/*
+ * Define the ag_map_has() interface function. We walk down the trie along the
+ * hash of the key, which takes at most one node per NODE_BITS bits of the hash.
+ */
+
+
+extern bool
+ag_map_has(const ag_map *ctx, const ag_value *key)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (key);
+
+        const struct payload *p = ag_object_payload(ctx);
+        return p->root && node_get(p->root, ag_value_hash(key), 0, key);
+}
+
+
+/*
+ * Define the ag_map_get() interface function. We look up the key in the same
+ * way as ag_map_has(), returning a copy of its value, or NULL if the key isn't
+ * in the map.
+ */
+
+
+extern ag_value *
+ag_map_get(const ag_map *ctx, const ag_value *key)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (key);
+
+        const struct payload *p = ag_object_payload(ctx);
+        const ag_value *v = p->root
+            ? node_get(p->root, ag_value_hash(key), 0, key) : NULL;
+
+        return v ? ag_value_copy(v) : NULL;
+}
+
+
+/*
+ * Define the ag_map_map() interface function. The iterator is run across the
+ * entries in trie order, and stops early if the iterator returns false.
+ */
+
+
+extern void
+ag_map_map(const ag_map *ctx, ag_map_iterator *map, void *in, void *out)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (map);
+
+        const struct payload *p = ag_object_payload(ctx);
+
+        if (p->root)
+                (void)node_map(p->root, map, in, out);
+}
+
+
+/*
+ * Define the ag_map_set() interface function. ag_object_payload_mutable() gives
+ * us a payload that shares its trie with any other copies of the map, and
+ * node_set() then unshares only the nodes on the path to the key.
+ */
+
+
+extern void
+ag_map_set(ag_map **ctx, const ag_value *key, const ag_value *val)
+{
+        AG_ASSERT_PTR (ctx && *ctx);
+        AG_ASSERT_PTR (key);
+        AG_ASSERT_PTR (val);
+
+        payload_set(ag_object_payload_mutable(ctx), key, val);
+}
+
+
+/*
+ * Define the ag_map_remove() interface function. We first check whether the key
+ * is in the map at all, so that removing a missing key neither clones the map
+ * nor unshares any of its nodes.
+ */
+
+
+extern void
+ag_map_remove(ag_map **ctx, const ag_value *key)
+{
+        AG_ASSERT_PTR (ctx && *ctx);
+        AG_ASSERT_PTR (key);
+
+        register ag_hash h = ag_value_hash(key);
+        const struct payload *p0 = ag_object_payload(*ctx);
+
+        if (!p0->root || !node_get(p0->root, h, 0, key))
+                return;
+
+        struct payload *p = ag_object_payload_mutable(ctx);
+        const ag_value *v = node_get(p->root, h, 0, key);
+
+        p->len--;
+        p->sz -= ag_value_sz(key) + ag_value_sz(v);
+        p->hash -= entry_hash(h, v);
+
+        node_remove(&p->root, h, 0, key);
+
+        if (!p->root->len) {
+                node_release(p->root);
+                p->root = NULL;
+        }
+}
+
+
+static struct node *
+node_new(size_t cap)
+{
+        struct node *n = ag_memblock_new(sizeof *n + cap * sizeof *n->slot);
+        n->bmap = 0;
+        n->len = 0;
+
+        return n;
+}
+
+
+static void
+node_reserve(struct node **ctx, size_t len)
+{
+        struct node *n = *ctx, *n2;
+        void *ptr = n;
+
+        if (len < n->len)
+                len = n->len;
+
+        if (AG_LIKELY (ag_memblock_refc(n) == 1)) {
+                if ((ag_memblock_sz(n) - sizeof *n) / sizeof *n->slot >= len)
+                        return;
+
+                n2 = node_new(len);
+                n2->bmap = n->bmap;
+                n2->len = n->len;
+                memcpy(n2->slot, n->slot, n->len * sizeof *n->slot);
+        } else {
+                n2 = node_new(len);
+                n2->bmap = n->bmap;
+                n2->len = n->len;
+
+                for (register size_t i = 0; i < n->len; i++) {
+                        if (n->slot[i].key) {
+                                n2->slot[i].key = ag_value_copy(n->slot[i].key);
+                                n2->slot[i].val = ag_value_copy(n->slot[i].val);
+                        } else {
+                                n2->slot[i].key = NULL;
+                                n2->slot[i].sub = ag_memblock_copy(
+                                    n->slot[i].sub);
+                        }
+                }
+        }
+
+        ag_memblock_release(&ptr);
+        *ctx = n2;
+}
+
+
+static void
+node_release(struct node *ctx)
+{
+        void *ptr = ctx;
+
+        if (ag_memblock_release_last(&ptr)) {
+                for (register size_t i = 0; i < ctx->len; i++) {
+                        if (ctx->slot[i].key) {
+                                ag_value_release(&ctx->slot[i].key);
+                                ag_value_release(&ctx->slot[i].val);
+                        } else
+                                node_release(ctx->slot[i].sub);
+                }
+
+                ag_memblock_release(&ptr);
+        }
+}
+
+
+/*
+ * Create the subtrie holding two entries whose hashes agree up to a given
+ * shift, taking over the references to their keys and values. The entries
+ * end up in a node of their own at the first level at which their hashes
+ * differ, or in a collision node if they never do.
+ */
+
+
+static struct node *
+node_pair(ag_value *k1, ag_value *v1, ag_hash h1, ag_value *k2, ag_value *v2,
+    ag_hash h2, size_t shift)
+{
+        struct node *n;
+
+        if (AG_UNLIKELY (shift >= HASH_BITS)) {
+                n = node_new(2);
+                n->len = 2;
+                n->slot[0].key = k1;
+                n->slot[0].val = v1;
+                n->slot[1].key = k2;
+                n->slot[1].val = v2;
+
+                return n;
+        }
+
+        register unsigned b1 = (h1 >> shift) & NODE_MASK;
+        register unsigned b2 = (h2 >> shift) & NODE_MASK;
+
+        if (b1 == b2) {
+                n = node_new(1);
+                n->bmap = 1u << b1;
+                n->len = 1;
+                n->slot[0].key = NULL;
+                n->slot[0].sub = node_pair(k1, v1, h1, k2, v2, h2,
+                    shift + NODE_BITS);
+
+                return n;
+        }
+
+        n = node_new(2);
+        n->bmap = (1u << b1) | (1u << b2);
+        n->len = 2;
+        n->slot[b1 > b2].key = k1;
+        n->slot[b1 > b2].val = v1;
+        n->slot[b1 < b2].key = k2;
+        n->slot[b1 < b2].val = v2;
+
+        return n;
+}
+
+
+static const ag_value *
+node_get(const struct node *ctx, ag_hash hash, size_t shift,
+    const ag_value *key)
+{
+        register uint32_t bit;
+        const struct slot *s;
+
+        while (shift < HASH_BITS) {
+                bit = 1u << ((hash >> shift) & NODE_MASK);
+
+                if (!(ctx->bmap & bit))
+                        return NULL;
+
+                s = &ctx->slot[__builtin_popcount(ctx->bmap & (bit - 1))];
+
+                if (s->key)
+                        return key_eq(s->key, key) ? s->val : NULL;
+
+                ctx = s->sub;
+                shift += NODE_BITS;
+        }
+
+        for (register size_t i = 0; i < ctx->len; i++) {
+                if (key_eq(ctx->slot[i].key, key))
+                        return ctx->slot[i].val;
+        }
+
+        return NULL;
+}
+
+
+/*
+ * Set a key-value pair below a node, returning whether the key was added rather
+ * than replaced. Every node on the way down is unshared by node_reserve(), so
+ * the nodes of other maps sharing the trie are never touched.
+ */
+
+
+static bool
+node_set(struct node **ctx, ag_hash hash, size_t shift, const ag_value *key,
+    const ag_value *val)
+{
+        struct node *n = *ctx;
+        struct slot *s;
+
+        if (AG_UNLIKELY (shift >= HASH_BITS)) {
+                for (register size_t i = 0; i < n->len; i++) {
+                        if (key_eq(n->slot[i].key, key)) {
+                                node_reserve(ctx, n->len);
+                                s = &(*ctx)->slot[i];
+
+                                ag_value_release(&s->val);
+                                s->val = ag_value_copy(val);
+                                return false;
+                        }
+                }
+
+                node_reserve(ctx, n->len + 1);
+                n = *ctx;
+
+                n->slot[n->len].key = ag_value_copy(key);
+                n->slot[n->len].val = ag_value_copy(val);
+                n->len++;
+
+                return true;
+        }
+
+        register uint32_t bit = 1u << ((hash >> shift) & NODE_MASK);
+        register size_t idx = __builtin_popcount(n->bmap & (bit - 1));
+
+        if (!(n->bmap & bit)) {
+                node_reserve(ctx, n->len + 1);
+                n = *ctx;
+
+                memmove(&n->slot[idx + 1], &n->slot[idx],
+                    (n->len - idx) * sizeof *n->slot);
+                n->slot[idx].key = ag_value_copy(key);
+                n->slot[idx].val = ag_value_copy(val);
+                n->bmap |= bit;
+                n->len++;
+
+                return true;
+        }
+
+        node_reserve(ctx, n->len);
+        s = &(*ctx)->slot[idx];
+
+        if (!s->key)
+                return node_set(&s->sub, hash, shift + NODE_BITS, key, val);
+
+        if (key_eq(s->key, key)) {
+                ag_value_release(&s->val);
+                s->val = ag_value_copy(val);
+                return false;
+        }
+
+        ag_value *k = s->key, *v = s->val;
+
+        s->key = NULL;
+        s->sub = node_pair(k, v, ag_value_hash(k), ag_value_copy(key),
+            ag_value_copy(val), hash, shift + NODE_BITS);
+
+        return true;
+}
+
+
+/*
+ * Remove a key that is known to be below a node. A subnode that is left with a
+ * single entry is folded back into its parent, so that the trie doesn't keep
+ * paths that lead to only one entry.
+ */
+
+
+static void
+node_remove(struct node **ctx, ag_hash hash, size_t shift, const ag_value *key)
+{
+        struct node *n;
+        struct slot *s;
+        register size_t idx = 0;
+
+        node_reserve(ctx, (*ctx)->len);
+        n = *ctx;
+
+        if (AG_UNLIKELY (shift >= HASH_BITS)) {
+                while (!key_eq(n->slot[idx].key, key))
+                        idx++;
+        } else {
+                register uint32_t bit = 1u << ((hash >> shift) & NODE_MASK);
+                idx = __builtin_popcount(n->bmap & (bit - 1));
+                s = &n->slot[idx];
+
+                if (!s->key) {
+                        node_remove(&s->sub, hash, shift + NODE_BITS, key);
+
+                        struct node *sub = s->sub;
+                        if (sub->len == 1 && sub->slot[0].key) {
+                                s->key = sub->slot[0].key;
+                                s->val = sub->slot[0].val;
+
+                                sub->len = 0;
+                                node_release(sub);
+                        }
+
+                        return;
+                }
+
+                n->bmap &= ~bit;
+        }
+
+        s = &n->slot[idx];
+        ag_value_release(&s->key);
+        ag_value_release(&s->val);
+
+        memmove(s, s + 1, (n->len - idx - 1) * sizeof *s);
+        n->len--;
+}
+
+
+static bool
+node_map(const struct node *ctx, ag_map_iterator *map, void *in, void *out)
+{
+        register bool flag = true;
+
+        for (register size_t i = 0; i < ctx->len && flag; i++) {
+                const struct slot *s = &ctx->slot[i];
+
+                flag = s->key ? map(s->key, s->val, in, out)
+                    : node_map(s->sub, map, in, out);
+        }
+
+        return flag;
+}
+
+
+static void
+node_freeze(struct node *ctx)
+{
+        if (ag_memblock_frozen(ctx))
+                return;
+
+        ag_memblock_freeze(ctx);
+
+        for (register size_t i = 0; i < ctx->len; i++) {
+                if (ctx->slot[i].key) {
+                        ag_value_freeze(ctx->slot[i].key);
+                        ag_value_freeze(ctx->slot[i].val);
+                } else
+                        node_freeze(ctx->slot[i].sub);
+        }
+}
+
+
+static struct payload *
+payload_new(const struct payload *ref)
+{
+        struct payload *p = ag_memblock_new(sizeof *p);
+        p->root = NULL;
+        p->len = p->sz = p->hash = 0;
+
+        if (ref) {
+                *p = *ref;
+
+                if (p->root)
+                        p->root = ag_memblock_copy(p->root);
+        }
+
+        return p;
+}
+
+
+static void
+payload_set(struct payload *ctx, const ag_value *key, const ag_value *val)
+{
+        register ag_hash h = ag_value_hash(key);
+
+        if (!ctx->root)
+                ctx->root = node_new(1);
+
+        const ag_value *v = node_get(ctx->root, h, 0, key);
+
+        if (v) {
+                ctx->sz -= ag_value_sz(v);
+                ctx->hash -= entry_hash(h, v);
+        }
+
+        if (node_set(&ctx->root, h, 0, key, val)) {
+                ctx->len++;
+                ctx->sz += ag_value_sz(key);
+        }
+
+        ctx->sz += ag_value_sz(val);
+        ctx->hash += entry_hash(h, val);
+}
+
+
+static bool
+cmp_iterator(const ag_value *key, const ag_value *val, void *in, void *out)
+{
+        const struct payload *p = in;
+        enum ag_cmp *cmp = out;
+
+        const ag_value *v = node_get(p->root, ag_value_hash(key), 0, key);
+
+        if (!v)
+                *cmp = AG_CMP_GT;
+        else if (ag_value_type(v) != ag_value_type(val))
+                *cmp = ag_value_type(val) < ag_value_type(v)
+                    ? AG_CMP_LT : AG_CMP_GT;
+        else
+                *cmp = ag_value_cmp(val, v);
+
+        return *cmp == AG_CMP_EQ;
+}
+
+
+static bool
+valid_iterator(const ag_value *key, const ag_value *val, void *in, void *out)
+{
+        (void)in;
+        bool *valid = out;
+
+        *valid = ag_value_valid(key) && ag_value_valid(val);
+        return *valid;
+}
+
+
+static bool
+str_iterator(const ag_value *key, const ag_value *val, void *in, void *out)
+{
+        (void)in;
+        ag_string **s = out;
+
+        AG_AUTO(ag_string) *ks = ag_value_str(key);
+        AG_AUTO(ag_string) *vs = ag_value_str(val);
+        ag_string *s2 = **s ? ag_string_new_fmt("%s (%s:%s)", *s, ks, vs)
+            : ag_string_new_fmt("(%s:%s)", ks, vs);
+
+        ag_string_release(s);
+        *s = s2;
+
+        return true;
+}
+
+
+static bool
+pack_iterator(const ag_value *key, const ag_value *val, void *in, void *out)
+{
+        (void)in;
+
+        ag_value_pack(key, out);
+        ag_value_pack(val, out);
+
+        return true;
+}
+
+
+static inline bool
+key_eq(const ag_value *lhs, const ag_value *rhs)
+{
+        return ag_value_type(lhs) == ag_value_type(rhs)
+            && ag_value_eq(lhs, rhs);
+}
+
+
+static inline ag_hash
+entry_hash(ag_hash key, const ag_value *val)
+{
+        return key * 31 + ag_value_hash(val);
+}
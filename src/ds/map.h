@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#ifndef __ARGENT_INCLUDE_MAP_H__
+#define __ARGENT_INCLUDE_MAP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "../ex/exception.h"
+#include "../type/value.h"
+
+
+/*
+ * Declare the types associated with the map interface. ag_map is an opaque
+ * object representing a hash map from values to values, stored as a hash array
+ * mapped trie. The nodes of the trie are shared between copies of a map, and a
+ * mutation only copies the nodes on the path to the affected key, so forking a
+ * map and modifying the fork costs O(log32 n) rather than a full copy. The
+ * ag_map_iterator callback iterates through the key-value pairs of a map.
+ */
+AG_OBJECT_DECLARE(ag_map, AG_TYPEID_MAP);
+typedef bool    (ag_map_iterator)(const ag_value *, const ag_value *, void *,
+                    void *);
+
+
+/*
+ * Declare the manager interface for ag_map. ag_map_new() creates a new empty
+ * map instance. The remaining manager functions, which are aliases of their
+ * object counterparts, are automatically generated by AG_OBJECT_DECLARE().
+ */
+extern ag_map   *ag_map_new(void);
+
+
+/*
+ * Declare the accessor interface for ag_map. ag_map_has() checks whether a map
+ * holds a given key, and ag_map_get() gets the value of a key, returning NULL
+ * if the key isn't in the map. ag_map_map() runs an iterator across the
+ * key-value pairs of a map in an unspecified but stable order.
+ */
+extern bool      ag_map_has(const ag_map *, const ag_value *);
+extern ag_value *ag_map_get(const ag_map *, const ag_value *);
+extern void      ag_map_map(const ag_map *, ag_map_iterator *, void *, void *);
+
+
+/*
+ * Declare the mutator interface for ag_map. ag_map_set() sets the value of a
+ * key, adding the key if it isn't already in the map, and ag_map_remove()
+ * removes a key along with its value, doing nothing if the key isn't there.
+ */
+extern void     ag_map_set(ag_map **, const ag_value *, const ag_value *);
+extern void     ag_map_remove(ag_map **, const ag_value *);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__ARGENT_INCLUDE_MAP_H__ */
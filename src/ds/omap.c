@@ -0,0 +1,1351 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "../argent.h"
+
+#include <string.h>
+
+
+/*
+ * Define the node of an ordered map. An ordered map is a B-tree of minimum
+ * degree NODE_MIN, so every node except the root holds between NODE_MIN - 1
+ * and NODE_MAX keys, and all leaves are at the same depth. The keys of a node
+ * and their values are kept in contiguous arrays, so that a node can be binary
+ * searched without chasing pointers; leaves are allocated without the child
+ * array that only internal nodes need.
+ *
+ * Nodes are reference counted memory blocks, shared between copies of an
+ * ordered map until one of them is mutated; a mutation unshares only the nodes
+ * that it touches on its way down the tree.
+ */
+
+
+#define NODE_MIN        16
+#define NODE_MAX        (2 * NODE_MIN - 1)
+#define CURSOR_DEPTH    16
+
+
+struct node {
+        size_t           len;            /* number of keys                */
+        bool             leaf;           /* whether node is a leaf        */
+        ag_value        *key[NODE_MAX];  /* keys in ascending order       */
+        ag_value        *val[NODE_MAX];  /* values of the keys            */
+        struct node     *child[];        /* NODE_MAX + 1 children, if any */
+};
+
+
+/*
+ * Define the object payload of an ordered map. As with the other containers, we
+ * maintain the length, cumulative size and cumulative hash of the ordered map
+ * so that we don't need to walk the tree for them.
+ */
+
+
+struct payload {
+        struct node     *root; /* tree root, NULL if empty */
+        size_t           len;  /* number of entries        */
+        size_t           sz;   /* cumulative size          */
+        ag_hash          hash; /* cumulative hash          */
+};
+
+
+/*
+ * Define the cursor used to walk an ordered map in order. Since nodes don't
+ * point back to their parents, the cursor keeps the path from the root to the
+ * current key along with the position in each node on the path. A B-tree of
+ * minimum degree 16 needs fewer than CURSOR_DEPTH levels for any number of
+ * keys that fits in memory.
+ */
+
+
+struct cursor {
+        size_t                   depth;                /* path length   */
+        const struct node       *node[CURSOR_DEPTH];   /* nodes on path */
+        size_t                   idx[CURSOR_DEPTH];    /* key positions */
+};
+
+
+/*
+ * Declare the prototypes for the node helper functions. node_new() creates an
+ * empty leaf or internal node, node_mut() ensures that a node is unshared, and
+ * node_release() drops a reference, releasing the contents along with the last
+ * one. node_find() binary searches a node for a key, and node_bound() finds the
+ * smallest key not less than, or greater than, a given key. node_split(),
+ * node_merge(), node_fill() and the rotations keep the tree balanced, and
+ * node_set() and node_remove() set and remove a key below a node. node_build()
+ * bulk loads a subtree of a given height from sorted arrays, node_range() runs
+ * an iterator across a range of keys, and node_freeze() freezes a node along
+ * with its contents.
+ */
+
+
+static struct node      *node_new(bool);
+static void              node_mut(struct node **);
+static void              node_release(struct node *);
+static void              node_free(struct node *);
+static bool              node_find(const struct node *, const ag_value *,
+                             size_t *);
+static const struct node *node_bound(const struct node *, const ag_value *,
+                             bool, size_t *);
+static void              node_split(struct node *, size_t);
+static void              node_merge(struct node *, size_t);
+static size_t            node_fill(struct node *, size_t);
+static void              node_rotate_left(struct node *, size_t);
+static void              node_rotate_right(struct node *, size_t);
+static bool              node_set(struct node *, const ag_value *,
+                             const ag_value *);
+static void              node_remove(struct node *, const ag_value *);
+static struct node      *node_build(ag_value **, ag_value **, size_t, size_t);
+static bool              node_range(const struct node *, const ag_value *,
+                             const ag_value *, ag_omap_iterator *, void *,
+                             void *);
+static void              node_freeze(struct node *);
+
+
+/*
+ * Declare the prototypes for the cursor helper functions. cursor_init() places
+ * a cursor at the smallest key of a tree, cursor_get() gets the key and value
+ * under a cursor, returning false once the cursor has run off the end, and
+ * cursor_next() moves a cursor to the next key.
+ */
+
+
+static void     cursor_init(struct cursor *, const struct node *);
+static bool     cursor_get(struct cursor *, const ag_value **,
+                    const ag_value **);
+static void     cursor_next(struct cursor *);
+
+
+/*
+ * Declare the prototypes for the payload helper functions. payload_new() helps
+ * create a new payload instance, either empty or sharing the tree of another
+ * payload, payload_set() sets a key-value pair while keeping the cumulative
+ * length, size and hash up to date, and payload_build() bulk loads a payload
+ * from sorted arrays of keys and values.
+ */
+
+
+static struct payload   *payload_new(const struct payload *);
+static void              payload_set(struct payload *, const ag_value *,
+                             const ag_value *);
+static struct payload   *payload_build(ag_value **, ag_value **, size_t);
+
+
+/*
+ * Declare the prototypes of the remaining helpers. key_cmp() orders keys, first
+ * by value type and then by value, and entry_hash() computes the hash of an
+ * entry.
+ */
+
+
+static inline enum ag_cmp       key_cmp(const ag_value *, const ag_value *);
+static inline ag_hash           entry_hash(const ag_value *, const ag_value *);
+
+
+/*
+ * Define the ag_omap object. The ag_omap type is defined as an object by its
+ * dynamic dispatch callback functions that are registered with the object
+ * registry.
+ */
+
+
+AG_OBJECT_DEFINE(ag_omap, AG_TYPEID_OMAP);
+
+
+/*
+ * Define the __ag_omap_clone__() dynamic dispatch callback function. This
+ * function is called by ag_object_clone() when ag_omap_clone() is invoked. The
+ * new payload shares the tree of the contextual ordered map.
+ */
+
+AG_OBJECT_DEFINE_CLONE(ag_omap,
+        return payload_new(_p_);
+);
+
+
+/*
+ * Define the __ag_omap_release__() dynamic dispatch callback function. This
+ * function is called by ag_object_release() when ag_omap_release() is invoked.
+ * We drop the reference of the payload to its root, which takes care of
+ * releasing the nodes that aren't shared with another ordered map.
+ */
+
+AG_OBJECT_DEFINE_RELEASE(ag_omap,
+        struct payload *p = _p_;
+
+        if (p->root)
+                node_release(p->root);
+);
+
+
+/*
+ * Define the __ag_omap_cmp__() dynamic dispatch callback function. This
+ * function is called by ag_object_cmp() when ag_omap_cmp() is invoked. Since
+ * the entries of an ordered map are sorted, we can compare two ordered maps
+ * lexicographically, entry by entry, with keys compared before values. As with
+ * lists, an ordered map that runs out first is the smaller one.
+ */
+
+AG_OBJECT_DEFINE_CMP(ag_omap,
+        const struct payload *p1 = ag_object_payload(_o1_);
+        const struct payload *p2 = ag_object_payload(_o2_);
+        const ag_value *k1 = NULL;
+        const ag_value *v1 = NULL;
+        const ag_value *k2 = NULL;
+        const ag_value *v2 = NULL;
+        struct cursor c1;
+        struct cursor c2;
+        register bool h1;
+        register bool h2;
+        register enum ag_cmp chk;
+
+        cursor_init(&c1, p1->root);
+        cursor_init(&c2, p2->root);
+
+        for (;;) {
+                h1 = cursor_get(&c1, &k1, &v1);
+                h2 = cursor_get(&c2, &k2, &v2);
+
+                if (!h1 || !h2)
+                        break;
+
+                if ((chk = key_cmp(k1, k2)) || (chk = key_cmp(v1, v2)))
+                        return chk;
+
+                cursor_next(&c1);
+                cursor_next(&c2);
+        }
+
+        if (h1 == h2)
+                return AG_CMP_EQ;
+
+        return h1 ? AG_CMP_GT : AG_CMP_LT;
+);
+
+
+/*
+ * Define the __ag_omap_valid__() dynamic dispatch callback function. This
+ * function is called by ag_object_valid() when ag_omap_valid() is invoked. An
+ * ordered map is valid if it's not empty and all of its keys and values are
+ * valid.
+ */
+
+AG_OBJECT_DEFINE_VALID(ag_omap,
+        const struct payload *p = ag_object_payload(_o_);
+        const ag_value *k = NULL;
+        const ag_value *v = NULL;
+        struct cursor c;
+
+        if (AG_UNLIKELY (!p->len))
+                return false;
+
+        for (cursor_init(&c, p->root); cursor_get(&c, &k, &v);
+            cursor_next(&c)) {
+                if (!ag_value_valid(k) || !ag_value_valid(v))
+                        return false;
+        }
+
+        return true;
+);
+
+
+/*
+ * Define the __ag_omap_sz__() dynamic dispatch callback function. This function
+ * is called by ag_object_sz() when ag_omap_sz() is invoked. The size of an
+ * ordered map is the cumulative size of its keys and values.
+ */
+
+AG_OBJECT_DEFINE_SZ(ag_omap,
+        const struct payload *p = ag_object_payload(_o_);
+        return p->sz;
+);
+
+
+/*
+ * Define the __ag_omap_len__() dynamic dispatch callback function. This
+ * function is called by ag_object_len() when ag_omap_len() is invoked. The
+ * length of an ordered map is the number of entries it holds.
+ */
+
+AG_OBJECT_DEFINE_LEN(ag_omap,
+        const struct payload *p = ag_object_payload(_o_);
+        return p->len;
+);
+
+
+/*
+ * Define the __ag_omap_hash__() dynamic dispatch callback function. This
+ * function is called by ag_object_hash() when ag_omap_hash() is invoked. The
+ * hash of an ordered map is the cumulative hash of its entries.
+ */
+
+AG_OBJECT_DEFINE_HASH(ag_omap,
+        const struct payload *p = ag_object_payload(_o_);
+        return p->hash;
+);
+
+
+/*
+ * Define the __ag_omap_str__() dynamic dispatch callback function. This
+ * function is called by ag_object_str() when ag_omap_str() is invoked. An
+ * ordered map is written out in the same form as an association list, with
+ * its entries in ascending order of keys.
+ */
+
+AG_OBJECT_DEFINE_STR(ag_omap,
+        const struct payload *p = ag_object_payload(_o_);
+        ag_string *s = ag_string_new_empty();
+        ag_string *s2;
+        const ag_value *k = NULL;
+        const ag_value *v = NULL;
+        struct cursor c;
+
+        for (cursor_init(&c, p->root); cursor_get(&c, &k, &v);
+            cursor_next(&c)) {
+                AG_AUTO(ag_string) *ks = ag_value_str(k);
+                AG_AUTO(ag_string) *vs = ag_value_str(v);
+
+                s2 = *s ? ag_string_new_fmt("%s (%s:%s)", s, ks, vs)
+                    : ag_string_new_fmt("(%s:%s)", ks, vs);
+                ag_string_release(&s);
+                s = s2;
+        }
+
+        s2 = ag_string_new_fmt("(%s)", s);
+        ag_string_release(&s);
+
+        return s2;
+);
+
+
+/*
+ * Define the __ag_omap_json__() dynamic dispatch callback function. This
+ * function is called by ag_object_json() when ag_omap_json() is invoked. An
+ * ordered map is rendered as a JSON object with its members in ascending order
+ * of keys. JSON member names have to be strings, so keys that aren't strings
+ * are named by their string representation.
+ */
+
+AG_OBJECT_DEFINE_JSON(ag_omap,
+        const struct payload *p = ag_object_payload(_o_);
+        ag_string *s = ag_string_new_empty();
+        ag_string *s2;
+        const ag_value *k = NULL;
+        const ag_value *v = NULL;
+        struct cursor c;
+
+        for (cursor_init(&c, p->root); cursor_get(&c, &k, &v);
+            cursor_next(&c)) {
+                AG_AUTO(ag_string) *ks = ag_value_str(k);
+                AG_AUTO(ag_string) *kj = ag_string_new_json(ks);
+                AG_AUTO(ag_string) *vj = ag_value_json(v);
+
+                s2 = *s ? ag_string_new_fmt("%s,%s:%s", s, kj, vj)
+                    : ag_string_new_fmt("%s:%s", kj, vj);
+                ag_string_release(&s);
+                s = s2;
+        }
+
+        s2 = ag_string_new_fmt("{%s}", s);
+        ag_string_release(&s);
+
+        return s2;
+);
+
+
+/*
+ * Define the __ag_omap_pack__() dynamic dispatch callback function. This
+ * function is called by ag_object_pack() when an ordered map is packed. An
+ * ordered map is packed as a map of its keys and values in ascending order.
+ */
+
+AG_OBJECT_DEFINE_PACK(ag_omap,
+        const struct payload *p = ag_object_payload(_o_);
+        const ag_value *k = NULL;
+        const ag_value *v = NULL;
+        struct cursor c;
+
+        ag_pack_map(_w_, p->len);
+
+        for (cursor_init(&c, p->root); cursor_get(&c, &k, &v);
+            cursor_next(&c)) {
+                ag_value_pack(k, _w_);
+                ag_value_pack(v, _w_);
+        }
+);
+
+
+/*
+ * Define the __ag_omap_unpack__() dynamic dispatch callback function. This
+ * function is called by ag_object_unpack() to read back the map written by
+ * __ag_omap_pack__(). Since the entries were packed in order, we can usually
+ * bulk load them; entries that arrive out of order, which can only happen if
+ * the map was packed by something else, are inserted one by one instead.
+ */
+
+AG_OBJECT_DEFINE_UNPACK(ag_omap,
+        register size_t len = ag_unpack_map(_r_);
+        ag_value **k = ag_memblock_new((len + 1) * sizeof *k);
+        ag_value **v = ag_memblock_new((len + 1) * sizeof *v);
+        register bool sorted = true;
+        struct payload *p;
+
+        for (register size_t i = 0; i < len; i++) {
+                k[i] = ag_value_unpack(_r_);
+                v[i] = ag_value_unpack(_r_);
+
+                if (i && key_cmp(k[i - 1], k[i]) != AG_CMP_LT)
+                        sorted = false;
+        }
+
+        if (AG_LIKELY (sorted))
+                p = payload_build(k, v, len);
+        else {
+                p = payload_new(NULL);
+
+                for (register size_t i = 0; i < len; i++)
+                        payload_set(p, k[i], v[i]);
+        }
+
+        for (register size_t i = 0; i < len; i++) {
+                ag_value_release(&k[i]);
+                ag_value_release(&v[i]);
+        }
+
+        void *ptr = k;
+        ag_memblock_release(&ptr);
+        ptr = v;
+        ag_memblock_release(&ptr);
+
+        return p;
+);
+
+
+/*
+ * Define the __ag_omap_freeze__() dynamic dispatch callback function. This
+ * function is called by ag_object_freeze() when an ordered map is frozen. The
+ * nodes of the tree are frozen along with the keys and values held by them.
+ */
+
+AG_OBJECT_DEFINE_FREEZE(ag_omap,
+        struct payload *p = _p_;
+
+        if (p->root)
+                node_freeze(p->root);
+);
+
+
+/*
+ * Define the ag_omap_new() interface function. Since ordered maps are objects,
+ * we use the ag_object_new() function to create a new ordered map, passing
+ * along the type ID and an empty payload.
+ */
+
+
+extern ag_omap *
+ag_omap_new(void)
+{
+        return ag_object_new(AG_TYPEID_OMAP, payload_new(NULL));
+}
+
+
+/*
+ * Define the ag_omap_new_list() interface function. We gather the keys and
+ * values of the fields into arrays and hand them over to payload_build(), which
+ * lays out the tree directly instead of splitting nodes as it goes.
+ */
+
+
+extern ag_omap *
+ag_omap_new_list(const ag_list *list)
+{
+        AG_ASSERT_PTR (list);
+
+        register size_t len = ag_list_len(list);
+        ag_value **k = ag_memblock_new((len + 1) * sizeof *k);
+        ag_value **v = ag_memblock_new((len + 1) * sizeof *v);
+
+        for (register size_t i = 0; i < len; i++) {
+                AG_AUTO(ag_value) *e = ag_list_get_at(list, i + 1);
+                AG_ASSERT (ag_value_type(e) == AG_VALUE_TYPE_OBJECT);
+
+                const ag_field *f = ag_value_object(e);
+                AG_ASSERT (ag_object_typeid(f) == AG_TYPEID_FIELD);
+
+                k[i] = ag_field_key(f);
+                v[i] = ag_field_val(f);
+
+                AG_ASSERT (!i || key_cmp(k[i - 1], k[i]) == AG_CMP_LT);
+        }
+
+        struct payload *p = payload_build(k, v, len);
+
+        for (register size_t i = 0; i < len; i++) {
+                ag_value_release(&k[i]);
+                ag_value_release(&v[i]);
+        }
+
+        void *ptr = k;
+        ag_memblock_release(&ptr);
+        ptr = v;
+        ag_memblock_release(&ptr);
+
+        return ag_object_new(AG_TYPEID_OMAP, p);
+}
+
+
+extern bool
+ag_omap_has(const ag_omap *ctx, const ag_value *key)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (key);
+
+        AG_AUTO(ag_value) *v = ag_omap_get(ctx, key);
+        return v;
+}
+
+
+/*
+ * Define the ag_omap_get() interface function. We walk down the tree, binary
+ * searching each node on the way, and return a copy of the value of the key,
+ * or NULL if the key isn't there.
+ */
+
+
+extern ag_value *
+ag_omap_get(const ag_omap *ctx, const ag_value *key)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (key);
+
+        const struct payload *p = ag_object_payload(ctx);
+        const struct node *n = p->root;
+        size_t i;
+
+        while (n) {
+                if (node_find(n, key, &i))
+                        return ag_value_copy(n->val[i]);
+
+                n = n->leaf ? NULL : n->child[i];
+        }
+
+        return NULL;
+}
+
+
+extern ag_field *
+ag_omap_lower(const ag_omap *ctx, const ag_value *key)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (key);
+
+        const struct payload *p = ag_object_payload(ctx);
+        const struct node *n;
+        size_t i;
+
+        if (!p->root || !(n = node_bound(p->root, key, false, &i)))
+                return NULL;
+
+        return ag_field_new(n->key[i], n->val[i]);
+}
+
+
+extern ag_field *
+ag_omap_upper(const ag_omap *ctx, const ag_value *key)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (key);
+
+        const struct payload *p = ag_object_payload(ctx);
+        const struct node *n;
+        size_t i;
+
+        if (!p->root || !(n = node_bound(p->root, key, true, &i)))
+                return NULL;
+
+        return ag_field_new(n->key[i], n->val[i]);
+}
+
+
+extern void
+ag_omap_map(const ag_omap *ctx, ag_omap_iterator *map, void *in, void *out)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (map);
+
+        ag_omap_range(ctx, NULL, NULL, map, in, out);
+}
+
+
+/*
+ * Define the ag_omap_range() interface function. node_range() only descends
+ * into the subtrees that can hold keys in the range, so a range scan costs
+ * O(log n) plus the number of keys visited.
+ */
+
+
+extern void
+ag_omap_range(const ag_omap *ctx, const ag_value *lo, const ag_value *hi,
+    ag_omap_iterator *map, void *in, void *out)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (map);
+
+        const struct payload *p = ag_object_payload(ctx);
+
+        if (p->root)
+                (void)node_range(p->root, lo, hi, map, in, out);
+}
+
+
+extern void
+ag_omap_set(ag_omap **ctx, const ag_value *key, const ag_value *val)
+{
+        AG_ASSERT_PTR (ctx && *ctx);
+        AG_ASSERT_PTR (key);
+        AG_ASSERT_PTR (val);
+
+        payload_set(ag_object_payload_mutable(ctx), key, val);
+}
+
+
+/*
+ * Define the ag_omap_remove() interface function. We first check whether the
+ * key is there at all, so that removing a missing key doesn't unshare anything;
+ * node_remove() can then rely on the key being present. If the root is left
+ * without keys, the tree loses a level.
+ */
+
+
+extern void
+ag_omap_remove(ag_omap **ctx, const ag_value *key)
+{
+        AG_ASSERT_PTR (ctx && *ctx);
+        AG_ASSERT_PTR (key);
+
+        AG_AUTO(ag_value) *v = ag_omap_get(*ctx, key);
+
+        if (!v)
+                return;
+
+        struct payload *p = ag_object_payload_mutable(ctx);
+
+        p->len--;
+        p->sz -= ag_value_sz(key) + ag_value_sz(v);
+        p->hash -= entry_hash(key, v);
+
+        node_mut(&p->root);
+        node_remove(p->root, key);
+
+        if (!p->root->len) {
+                struct node *r = p->root;
+
+                if (r->leaf) {
+                        node_release(r);
+                        p->root = NULL;
+                } else {
+                        p->root = r->child[0];
+                        node_free(r);
+                }
+        }
+}
+
+
+static struct node *
+node_new(bool leaf)
+{
+        size_t sz = sizeof (struct node);
+
+        if (!leaf)
+                sz += (NODE_MAX + 1) * sizeof (struct node *);
+
+        struct node *n = ag_memblock_new(sz);
+        n->len = 0;
+        n->leaf = leaf;
+
+        return n;
+}
+
+
+static void
+node_mut(struct node **ctx)
+{
+        struct node *n = *ctx;
+
+        if (AG_LIKELY (ag_memblock_refc(n) == 1))
+                return;
+
+        struct node *n2 = node_new(n->leaf);
+        n2->len = n->len;
+
+        for (register size_t i = 0; i < n->len; i++) {
+                n2->key[i] = ag_value_copy(n->key[i]);
+                n2->val[i] = ag_value_copy(n->val[i]);
+        }
+
+        if (!n->leaf) {
+                for (register size_t i = 0; i <= n->len; i++)
+                        n2->child[i] = ag_memblock_copy(n->child[i]);
+        }
+
+        node_release(n);
+        *ctx = n2;
+}
+
+
+static void
+node_release(struct node *ctx)
+{
+        void *ptr = ctx;
+
+        if (ag_memblock_release_last(&ptr)) {
+                for (register size_t i = 0; i < ctx->len; i++) {
+                        ag_value_release(&ctx->key[i]);
+                        ag_value_release(&ctx->val[i]);
+                }
+
+                if (!ctx->leaf) {
+                        for (register size_t i = 0; i <= ctx->len; i++)
+                                node_release(ctx->child[i]);
+                }
+
+                ag_memblock_release(&ptr);
+        }
+}
+
+
+/*
+ * Release a node whose contents have been moved elsewhere, without touching the
+ * keys, values and children it used to hold.
+ */
+
+
+static void
+node_free(struct node *ctx)
+{
+        void *ptr = ctx;
+        ag_memblock_release(&ptr);
+}
+
+
+/*
+ * Binary search a node for a key, setting the position of the first key that is
+ * not less than the one being searched for, and returning whether it is equal.
+ */
+
+
+static bool
+node_find(const struct node *ctx, const ag_value *key, size_t *idx)
+{
+        register size_t lo = 0, hi = ctx->len, mid;
+
+        while (lo < hi) {
+                mid = (lo + hi) / 2;
+
+                if (key_cmp(ctx->key[mid], key) == AG_CMP_LT)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        *idx = lo;
+        return lo < ctx->len && key_cmp(ctx->key[lo], key) == AG_CMP_EQ;
+}
+
+
+/*
+ * Find the smallest key that is not less than (or, if strict, greater than) a
+ * given key. Any better candidate than the one found in a node can only lie in
+ * the subtree to its left, so we keep descending there until we hit a leaf.
+ */
+
+
+static const struct node *
+node_bound(const struct node *ctx, const ag_value *key, bool strict,
+    size_t *idx)
+{
+        const struct node *n = NULL;
+        size_t i;
+
+        while (ctx) {
+                if (node_find(ctx, key, &i) && strict)
+                        i++;
+
+                if (i < ctx->len) {
+                        n = ctx;
+                        *idx = i;
+                }
+
+                ctx = ctx->leaf ? NULL : ctx->child[i];
+        }
+
+        return n;
+}
+
+
+/*
+ * Split the full child at a given position of an unshared node, moving the
+ * median key of the child up into the node.
+ */
+
+
+static void
+node_split(struct node *ctx, size_t idx)
+{
+        struct node *y = ctx->child[idx];
+        struct node *z = node_new(y->leaf);
+
+        z->len = NODE_MIN - 1;
+        memcpy(z->key, &y->key[NODE_MIN], z->len * sizeof *z->key);
+        memcpy(z->val, &y->val[NODE_MIN], z->len * sizeof *z->val);
+
+        if (!y->leaf)
+                memcpy(z->child, &y->child[NODE_MIN], NODE_MIN * sizeof *z->child);
+
+        y->len = NODE_MIN - 1;
+
+        memmove(&ctx->child[idx + 2], &ctx->child[idx + 1],
+            (ctx->len - idx) * sizeof *ctx->child);
+        memmove(&ctx->key[idx + 1], &ctx->key[idx],
+            (ctx->len - idx) * sizeof *ctx->key);
+        memmove(&ctx->val[idx + 1], &ctx->val[idx],
+            (ctx->len - idx) * sizeof *ctx->val);
+
+        ctx->child[idx + 1] = z;
+        ctx->key[idx] = y->key[NODE_MIN - 1];
+        ctx->val[idx] = y->val[NODE_MIN - 1];
+        ctx->len++;
+}
+
+
+/*
+ * Merge the children on either side of a key of an unshared node, along with
+ * the key itself, into the left child. Both children are expected to have the
+ * minimum number of keys, and to have already been unshared.
+ */
+
+
+static void
+node_merge(struct node *ctx, size_t idx)
+{
+        struct node *y = ctx->child[idx];
+        struct node *z = ctx->child[idx + 1];
+
+        y->key[y->len] = ctx->key[idx];
+        y->val[y->len] = ctx->val[idx];
+
+        memcpy(&y->key[y->len + 1], z->key, z->len * sizeof *z->key);
+        memcpy(&y->val[y->len + 1], z->val, z->len * sizeof *z->val);
+
+        if (!y->leaf) {
+                memcpy(&y->child[y->len + 1], z->child,
+                    (z->len + 1) * sizeof *z->child);
+        }
+
+        y->len += z->len + 1;
+        node_free(z);
+
+        memmove(&ctx->key[idx], &ctx->key[idx + 1],
+            (ctx->len - idx - 1) * sizeof *ctx->key);
+        memmove(&ctx->val[idx], &ctx->val[idx + 1],
+            (ctx->len - idx - 1) * sizeof *ctx->val);
+        memmove(&ctx->child[idx + 1], &ctx->child[idx + 2],
+            (ctx->len - idx - 1) * sizeof *ctx->child);
+        ctx->len--;
+}
+
+
+/*
+ * Make sure that the child at a given position of an unshared node has more
+ * than the minimum number of keys, so that a key can be removed from it. We
+ * borrow a key from a sibling if one can spare it, and merge with a sibling
+ * otherwise; the position of the child after the merge is returned.
+ */
+
+
+static size_t
+node_fill(struct node *ctx, size_t idx)
+{
+        if (idx > 0) {
+                node_mut(&ctx->child[idx - 1]);
+
+                if (ctx->child[idx - 1]->len >= NODE_MIN) {
+                        node_rotate_right(ctx, idx - 1);
+                        return idx;
+                }
+        }
+
+        if (idx < ctx->len) {
+                node_mut(&ctx->child[idx + 1]);
+
+                if (ctx->child[idx + 1]->len >= NODE_MIN) {
+                        node_rotate_left(ctx, idx);
+                        return idx;
+                }
+
+                node_merge(ctx, idx);
+                return idx;
+        }
+
+        node_merge(ctx, idx - 1);
+        return idx - 1;
+}
+
+
+static void
+node_rotate_left(struct node *ctx, size_t idx)
+{
+        struct node *l = ctx->child[idx];
+        struct node *r = ctx->child[idx + 1];
+
+        l->key[l->len] = ctx->key[idx];
+        l->val[l->len] = ctx->val[idx];
+        ctx->key[idx] = r->key[0];
+        ctx->val[idx] = r->val[0];
+
+        memmove(r->key, &r->key[1], (r->len - 1) * sizeof *r->key);
+        memmove(r->val, &r->val[1], (r->len - 1) * sizeof *r->val);
+
+        if (!l->leaf) {
+                l->child[l->len + 1] = r->child[0];
+                memmove(r->child, &r->child[1], r->len * sizeof *r->child);
+        }
+
+        l->len++;
+        r->len--;
+}
+
+
+static void
+node_rotate_right(struct node *ctx, size_t idx)
+{
+        struct node *l = ctx->child[idx];
+        struct node *r = ctx->child[idx + 1];
+
+        memmove(&r->key[1], r->key, r->len * sizeof *r->key);
+        memmove(&r->val[1], r->val, r->len * sizeof *r->val);
+        r->key[0] = ctx->key[idx];
+        r->val[0] = ctx->val[idx];
+        ctx->key[idx] = l->key[l->len - 1];
+        ctx->val[idx] = l->val[l->len - 1];
+
+        if (!r->leaf) {
+                memmove(&r->child[1], r->child,
+                    (r->len + 1) * sizeof *r->child);
+                r->child[0] = l->child[l->len];
+        }
+
+        l->len--;
+        r->len++;
+}
+
+
+/*
+ * Set a key-value pair below an unshared node that isn't full, returning
+ * whether the key was added rather than replaced. Full children are split
+ * before we descend into them, so the insertion never has to go back up.
+ */
+
+
+static bool
+node_set(struct node *ctx, const ag_value *key, const ag_value *val)
+{
+        register enum ag_cmp chk;
+        size_t i;
+
+        for (;;) {
+                if (node_find(ctx, key, &i)) {
+                        ag_value_release(&ctx->val[i]);
+                        ctx->val[i] = ag_value_copy(val);
+                        return false;
+                }
+
+                if (ctx->leaf) {
+                        memmove(&ctx->key[i + 1], &ctx->key[i],
+                            (ctx->len - i) * sizeof *ctx->key);
+                        memmove(&ctx->val[i + 1], &ctx->val[i],
+                            (ctx->len - i) * sizeof *ctx->val);
+
+                        ctx->key[i] = ag_value_copy(key);
+                        ctx->val[i] = ag_value_copy(val);
+                        ctx->len++;
+
+                        return true;
+                }
+
+                node_mut(&ctx->child[i]);
+
+                if (ctx->child[i]->len == NODE_MAX) {
+                        node_split(ctx, i);
+
+                        if (!(chk = key_cmp(key, ctx->key[i]))) {
+                                ag_value_release(&ctx->val[i]);
+                                ctx->val[i] = ag_value_copy(val);
+                                return false;
+                        }
+
+                        if (chk == AG_CMP_GT)
+                                i++;
+                }
+
+                ctx = ctx->child[i];
+        }
+}
+
+
+/*
+ * Remove a key that is known to be below an unshared node. Every child that we
+ * descend into is first topped up by node_fill() so that it can lose a key
+ * without underflowing. A key found in an internal node is replaced by its
+ * predecessor or successor, which is then removed from the subtree it came
+ * from, or else the children on either side of it are merged.
+ */
+
+
+static void
+node_remove(struct node *ctx, const ag_value *key)
+{
+        const struct node *n;
+        ag_value *k, *v;
+        size_t i;
+
+        for (;;) {
+                bool found = node_find(ctx, key, &i);
+
+                if (ctx->leaf) {
+                        AG_ASSERT (found);
+
+                        ag_value_release(&ctx->key[i]);
+                        ag_value_release(&ctx->val[i]);
+
+                        memmove(&ctx->key[i], &ctx->key[i + 1],
+                            (ctx->len - i - 1) * sizeof *ctx->key);
+                        memmove(&ctx->val[i], &ctx->val[i + 1],
+                            (ctx->len - i - 1) * sizeof *ctx->val);
+                        ctx->len--;
+
+                        return;
+                }
+
+                if (!found) {
+                        node_mut(&ctx->child[i]);
+
+                        if (ctx->child[i]->len < NODE_MIN)
+                                i = node_fill(ctx, i);
+
+                        ctx = ctx->child[i];
+                        continue;
+                }
+
+                node_mut(&ctx->child[i]);
+                node_mut(&ctx->child[i + 1]);
+
+                if (ctx->child[i]->len < NODE_MIN
+                    && ctx->child[i + 1]->len < NODE_MIN) {
+                        node_merge(ctx, i);
+                        ctx = ctx->child[i];
+                        continue;
+                }
+
+                if (ctx->child[i]->len >= NODE_MIN) {
+                        for (n = ctx->child[i]; !n->leaf; n = n->child[n->len])
+                                ;
+
+                        k = ag_value_copy(n->key[n->len - 1]);
+                        v = ag_value_copy(n->val[n->len - 1]);
+                        node_remove(ctx->child[i], k);
+                } else {
+                        for (n = ctx->child[i + 1]; !n->leaf; n = n->child[0])
+                                ;
+
+                        k = ag_value_copy(n->key[0]);
+                        v = ag_value_copy(n->val[0]);
+                        node_remove(ctx->child[i + 1], k);
+                }
+
+                ag_value_release(&ctx->key[i]);
+                ag_value_release(&ctx->val[i]);
+                ctx->key[i] = k;
+                ctx->val[i] = v;
+
+                return;
+        }
+}
+
+
+/*
+ * Bulk load a subtree of a given height from sorted arrays of keys and values.
+ * At each level we use as few children as can hold the keys, and spread the
+ * keys evenly across them; this keeps every node at least half full, which is
+ * more than the B-tree invariant requires.
+ */
+
+
+static struct node *
+node_build(ag_value **key, ag_value **val, size_t len, size_t height)
+{
+        struct node *n = node_new(!height);
+
+        if (!height) {
+                AG_ASSERT (len <= NODE_MAX);
+
+                for (register size_t i = 0; i < len; i++) {
+                        n->key[i] = ag_value_copy(key[i]);
+                        n->val[i] = ag_value_copy(val[i]);
+                }
+
+                n->len = len;
+                return n;
+        }
+
+        register size_t cap = NODE_MAX;
+
+        for (register size_t h = 1; h < height; h++)
+                cap = cap * (NODE_MAX + 1) + NODE_MAX;
+
+        register size_t c = (len + cap + 1) / (cap + 1);
+        if (c < 2)
+                c = 2;
+
+        register size_t q = (len - c + 1) / c, r = (len - c + 1) % c;
+        register size_t pos = 0, m;
+
+        for (register size_t j = 0; j < c; j++) {
+                m = q + (j < r);
+                n->child[j] = node_build(key + pos, val + pos, m, height - 1);
+                pos += m;
+
+                if (j + 1 < c) {
+                        n->key[j] = ag_value_copy(key[pos]);
+                        n->val[j] = ag_value_copy(val[pos]);
+                        pos++;
+                }
+        }
+
+        n->len = c - 1;
+        return n;
+}
+
+
+static bool
+node_range(const struct node *ctx, const ag_value *lo, const ag_value *hi,
+    ag_omap_iterator *map, void *in, void *out)
+{
+        size_t i = 0;
+
+        if (lo)
+                (void)node_find(ctx, lo, &i);
+
+        for (; i <= ctx->len; i++) {
+                if (!ctx->leaf && !node_range(ctx->child[i], lo, hi, map, in,
+                    out))
+                        return false;
+
+                if (i == ctx->len)
+                        break;
+
+                if (hi && key_cmp(ctx->key[i], hi) != AG_CMP_LT)
+                        return false;
+
+                if (!map(ctx->key[i], ctx->val[i], in, out))
+                        return false;
+
+                lo = NULL;
+        }
+
+        return true;
+}
+
+
+static void
+node_freeze(struct node *ctx)
+{
+        if (ag_memblock_frozen(ctx))
+                return;
+
+        ag_memblock_freeze(ctx);
+
+        for (register size_t i = 0; i < ctx->len; i++) {
+                ag_value_freeze(ctx->key[i]);
+                ag_value_freeze(ctx->val[i]);
+        }
+
+        if (!ctx->leaf) {
+                for (register size_t i = 0; i <= ctx->len; i++)
+                        node_freeze(ctx->child[i]);
+        }
+}
+
+
+static void
+cursor_init(struct cursor *ctx, const struct node *root)
+{
+        ctx->depth = 0;
+
+        while (root) {
+                AG_ASSERT (ctx->depth < CURSOR_DEPTH);
+
+                ctx->node[ctx->depth] = root;
+                ctx->idx[ctx->depth++] = 0;
+                root = root->leaf ? NULL : root->child[0];
+        }
+}
+
+
+static bool
+cursor_get(struct cursor *ctx, const ag_value **key, const ag_value **val)
+{
+        while (ctx->depth
+            && ctx->idx[ctx->depth - 1] >= ctx->node[ctx->depth - 1]->len)
+                ctx->depth--;
+
+        if (!ctx->depth)
+                return false;
+
+        const struct node *n = ctx->node[ctx->depth - 1];
+        *key = n->key[ctx->idx[ctx->depth - 1]];
+        *val = n->val[ctx->idx[ctx->depth - 1]];
+
+        return true;
+}
+
+
+static void
+cursor_next(struct cursor *ctx)
+{
+        const struct node *n = ctx->node[ctx->depth - 1];
+        register size_t i = ctx->idx[ctx->depth - 1]++;
+
+        if (n->leaf)
+                return;
+
+        for (n = n->child[i + 1]; n; n = n->leaf ? NULL : n->child[0]) {
+                AG_ASSERT (ctx->depth < CURSOR_DEPTH);
+
+                ctx->node[ctx->depth] = n;
+                ctx->idx[ctx->depth++] = 0;
+        }
+}
+
+
+static struct payload *
+payload_new(const struct payload *ref)
+{
+        struct payload *p = ag_memblock_new(sizeof *p);
+        p->root = NULL;
+        p->len = p->sz = p->hash = 0;
+
+        if (ref) {
+                *p = *ref;
+
+                if (p->root)
+                        p->root = ag_memblock_copy(p->root);
+        }
+
+        return p;
+}
+
+
+static void
+payload_set(struct payload *ctx, const ag_value *key, const ag_value *val)
+{
+        struct node *n = ctx->root;
+        size_t i;
+
+        while (n) {
+                if (node_find(n, key, &i)) {
+                        ctx->sz -= ag_value_sz(n->val[i]);
+                        ctx->hash -= entry_hash(key, n->val[i]);
+                        break;
+                }
+
+                n = n->leaf ? NULL : n->child[i];
+        }
+
+        if (!ctx->root)
+                ctx->root = node_new(true);
+
+        node_mut(&ctx->root);
+
+        if (ctx->root->len == NODE_MAX) {
+                struct node *r = node_new(false);
+                r->child[0] = ctx->root;
+                ctx->root = r;
+                node_split(r, 0);
+        }
+
+        if (node_set(ctx->root, key, val)) {
+                ctx->len++;
+                ctx->sz += ag_value_sz(key);
+        }
+
+        ctx->sz += ag_value_sz(val);
+        ctx->hash += entry_hash(key, val);
+}
+
+
+static struct payload *
+payload_build(ag_value **key, ag_value **val, size_t len)
+{
+        struct payload *p = payload_new(NULL);
+
+        if (AG_UNLIKELY (!len))
+                return p;
+
+        register size_t height = 0, cap = NODE_MAX;
+
+        while (cap < len) {
+                cap = cap * (NODE_MAX + 1) + NODE_MAX;
+                height++;
+        }
+
+        p->root = node_build(key, val, len, height);
+        p->len = len;
+
+        for (register size_t i = 0; i < len; i++) {
+                p->sz += ag_value_sz(key[i]) + ag_value_sz(val[i]);
+                p->hash += entry_hash(key[i], val[i]);
+        }
+
+        return p;
+}
+
+
+static inline enum ag_cmp
+key_cmp(const ag_value *lhs, const ag_value *rhs)
+{
+        register enum ag_value_type t1 = ag_value_type(lhs);
+        register enum ag_value_type t2 = ag_value_type(rhs);
+
+        if (t1 != t2)
+                return t1 < t2 ? AG_CMP_LT : AG_CMP_GT;
+
+        return ag_value_cmp(lhs, rhs);
+}
+
+
+static inline ag_hash
+entry_hash(const ag_value *key, const ag_value *val)
+{
+        return ag_value_hash(key) * 31 + ag_value_hash(val);
+}
+
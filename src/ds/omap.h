@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#ifndef __ARGENT_INCLUDE_OMAP_H__
+#define __ARGENT_INCLUDE_OMAP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "../ex/exception.h"
+#include "../type/value.h"
+#include "./field.h"
+#include "./list.h"
+
+
+/*
+ * Declare the types associated with the ordered map interface. ag_omap is an
+ * opaque object representing a map from values to values that is kept sorted
+ * by key, stored as a B-tree with wide nodes whose keys are held in contiguous
+ * arrays. Keys of different value types are ordered by type. As with ag_map,
+ * the nodes are shared between copies of an ordered map until one of them is
+ * mutated. The ag_omap_iterator callback iterates through the key-value pairs
+ * of an ordered map in ascending order of keys.
+ */
+AG_OBJECT_DECLARE(ag_omap, AG_TYPEID_OMAP);
+typedef bool    (ag_omap_iterator)(const ag_value *, const ag_value *, void *,
+                    void *);
+
+
+/*
+ * Declare the manager interface for ag_omap. ag_omap_new() creates a new empty
+ * ordered map, and ag_omap_new_list() bulk loads an ordered map from a list of
+ * ag_field objects sorted in strictly ascending order of keys, building the
+ * B-tree bottom up in O(n) rather than inserting the fields one by one.
+ */
+extern ag_omap  *ag_omap_new(void);
+extern ag_omap  *ag_omap_new_list(const ag_list *);
+
+
+/*
+ * Declare the accessor interface for ag_omap. ag_omap_has() checks whether an
+ * ordered map holds a key, and ag_omap_get() gets the value of a key, returning
+ * NULL if the key isn't there. ag_omap_lower() gets the field with the smallest
+ * key not less than a given key, and ag_omap_upper() the field with the
+ * smallest key greater than a given key; both return NULL if there is no such
+ * field. ag_omap_map() runs an iterator across all the key-value pairs in
+ * ascending order of keys, and ag_omap_range() does the same for the keys in
+ * the half-open range [lo, hi), where a NULL bound leaves that end open. Both
+ * stop early if the iterator returns false.
+ */
+extern bool      ag_omap_has(const ag_omap *, const ag_value *);
+extern ag_value *ag_omap_get(const ag_omap *, const ag_value *);
+extern ag_field *ag_omap_lower(const ag_omap *, const ag_value *);
+extern ag_field *ag_omap_upper(const ag_omap *, const ag_value *);
+extern void      ag_omap_map(const ag_omap *, ag_omap_iterator *, void *,
+                    void *);
+extern void      ag_omap_range(const ag_omap *, const ag_value *,
+                    const ag_value *, ag_omap_iterator *, void *, void *);
+
+
+/*
+ * Declare the mutator interface for ag_omap. ag_omap_set() sets the value of a
+ * key, adding the key if it isn't already there, and ag_omap_remove() removes
+ * a key along with its value, doing nothing if the key isn't there.
+ */
+extern void     ag_omap_set(ag_omap **, const ag_value *, const ag_value *);
+extern void     ag_omap_remove(ag_omap **, const ag_value *);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__ARGENT_INCLUDE_OMAP_H__ */
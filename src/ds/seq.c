@@ -0,0 +1,442 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "../argent.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ * Define the structure of a sequence. Every source and stage of a pipeline is
+ * a sequence of its own, pulling values from the sequences it draws from
+ * through its pull callback; pulling from the last stage of a pipeline thus
+ * runs a single value through all of its stages. A stage that creates a value,
+ * such as a map or a generator, keeps the value until it is pulled again, so
+ * that the stages downstream of it can peek at the value without copying it.
+ * The fields other than the pull callback and the value are used only by the
+ * kinds of sequence that need them.
+ */
+
+
+typedef const ag_value *(seq_pull)(ag_seq *);
+
+
+struct ag_seq {
+        seq_pull                *pull;    /* pulls the next value      */
+        ag_value                *val;     /* value owned by the stage  */
+        ag_seq                  *src;     /* upstream sequence         */
+        ag_seq                  *src2;    /* second upstream sequence  */
+        ag_list                 *list;    /* source list               */
+        ag_list_cursor           cur;     /* source list cursor        */
+        ag_seq_generator        *gen;     /* source generator          */
+        ag_seq_dispose          *dispose; /* generator disposal        */
+        void                    *ctx;     /* generator context         */
+        ag_list_transform       *map;     /* map callback              */
+        ag_list_predicate       *pred;    /* filter callback           */
+        void                    *in;      /* map and filter input      */
+        size_t                   n;       /* values left to take/skip  */
+        bool                     done;    /* generator has run out     */
+};
+
+
+/*
+ * Define the context of a sequence of file lines. The line buffer is managed by
+ * getline(), and is therefore allocated with malloc() rather than as a memory
+ * block.
+ */
+
+
+struct lines {
+        FILE    *file; /* file being read */
+        char    *bfr;  /* line buffer     */
+        size_t   sz;   /* buffer size     */
+};
+
+
+/*
+ * Declare the prototypes for the helper functions. seq_new() creates a sequence
+ * with a given pull callback, and the pull_*() functions are the pull callbacks
+ * for each kind of sequence. lines_next() and lines_dispose() are the generator
+ * and disposal callbacks behind ag_seq_from_lines().
+ */
+
+
+static ag_seq                   *seq_new(seq_pull *);
+static const ag_value           *pull_list(ag_seq *);
+static const ag_value           *pull_gen(ag_seq *);
+static const ag_value           *pull_map(ag_seq *);
+static const ag_value           *pull_filter(ag_seq *);
+static const ag_value           *pull_take(ag_seq *);
+static const ag_value           *pull_skip(ag_seq *);
+static const ag_value           *pull_zip(ag_seq *);
+static ag_value                 *lines_next(void *);
+static void                      lines_dispose(void *);
+
+
+/*
+ * Define the ag_seq_new() interface function. This function creates a source
+ * sequence from a generator and its context.
+ */
+
+
+extern ag_seq *
+ag_seq_new(ag_seq_generator *gen, void *ctx, ag_seq_dispose *dispose)
+{
+        AG_ASSERT_PTR (gen);
+
+        ag_seq *s = seq_new(pull_gen);
+        s->gen = gen;
+        s->ctx = ctx;
+        s->dispose = dispose;
+
+        return s;
+}
+
+
+/*
+ * Define the ag_seq_from_list() interface function. This function creates a
+ * source sequence that walks a list through a cursor. The sequence holds its
+ * own copy of the list, so that the list outlives the cursor even if the caller
+ * releases its handle.
+ */
+
+
+extern ag_seq *
+ag_seq_from_list(const ag_list *list)
+{
+        AG_ASSERT_PTR (list);
+
+        ag_seq *s = seq_new(pull_list);
+        s->list = ag_list_copy(list);
+        ag_list_cursor_init(&s->cur, s->list);
+
+        return s;
+}
+
+
+/*
+ * Define the ag_seq_from_lines() interface function. This function creates a
+ * generated sequence that reads the lines of a file one at a time.
+ */
+
+
+extern ag_seq *
+ag_seq_from_lines(FILE *file)
+{
+        AG_ASSERT_PTR (file);
+
+        struct lines *l = ag_memblock_new(sizeof *l);
+        l->file = file;
+        l->bfr = NULL;
+        l->sz = 0;
+
+        return ag_seq_new(lines_next, l, lines_dispose);
+}
+
+
+/*
+ * Define the ag_seq_release() interface function. This function releases a
+ * sequence, the sequences it draws from, and the resources held by each of
+ * them.
+ */
+
+
+extern void
+ag_seq_release(ag_seq **hnd)
+{
+        ag_seq *s;
+
+        if (AG_LIKELY (hnd && (s = *hnd))) {
+                ag_seq_release(&s->src);
+                ag_seq_release(&s->src2);
+                ag_value_release(&s->val);
+                ag_list_release(&s->list);
+
+                if (s->dispose)
+                        s->dispose(s->ctx);
+
+                void *ptr = s;
+                ag_memblock_release(&ptr);
+                *hnd = NULL;
+        }
+}
+
+
+/*
+ * Define the stage interface functions. Each of these functions creates a
+ * stage drawing from the sequence passed to it, and sets up the state needed
+ * by the pull callback of the stage.
+ */
+
+
+extern ag_seq *
+ag_seq_map(ag_seq *src, ag_list_transform *map, void *in)
+{
+        AG_ASSERT_PTR (src);
+        AG_ASSERT_PTR (map);
+
+        ag_seq *s = seq_new(pull_map);
+        s->src = src;
+        s->map = map;
+        s->in = in;
+
+        return s;
+}
+
+
+extern ag_seq *
+ag_seq_filter(ag_seq *src, ag_list_predicate *pred, void *in)
+{
+        AG_ASSERT_PTR (src);
+        AG_ASSERT_PTR (pred);
+
+        ag_seq *s = seq_new(pull_filter);
+        s->src = src;
+        s->pred = pred;
+        s->in = in;
+
+        return s;
+}
+
+
+extern ag_seq *
+ag_seq_take(ag_seq *src, size_t n)
+{
+        AG_ASSERT_PTR (src);
+
+        ag_seq *s = seq_new(pull_take);
+        s->src = src;
+        s->n = n;
+
+        return s;
+}
+
+
+extern ag_seq *
+ag_seq_skip(ag_seq *src, size_t n)
+{
+        AG_ASSERT_PTR (src);
+
+        ag_seq *s = seq_new(pull_skip);
+        s->src = src;
+        s->n = n;
+
+        return s;
+}
+
+
+extern ag_seq *
+ag_seq_zip(ag_seq *src, ag_seq *src2)
+{
+        AG_ASSERT_PTR (src);
+        AG_ASSERT_PTR (src2);
+
+        ag_seq *s = seq_new(pull_zip);
+        s->src = src;
+        s->src2 = src2;
+
+        return s;
+}
+
+
+/*
+ * Define the ag_seq_next() interface function. This function pulls the next
+ * value through the pull callback of the sequence.
+ */
+
+
+extern const ag_value *
+ag_seq_next(ag_seq *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        return ctx->pull(ctx);
+}
+
+
+/*
+ * Define the ag_seq_collect() interface function. This function drains a
+ * sequence into a new list; this is the only point of a pipeline at which the
+ * values are copied into a list.
+ */
+
+
+extern ag_list *
+ag_seq_collect(ag_seq *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        ag_list *l = ag_list_new();
+        const ag_value *v;
+
+        while ((v = ctx->pull(ctx)))
+                ag_list_push(&l, v);
+
+        return l;
+}
+
+
+static ag_seq *
+seq_new(seq_pull *pull)
+{
+        ag_seq *s = ag_memblock_new(sizeof *s);
+        s->pull = pull;
+
+        return s;
+}
+
+
+static const ag_value *
+pull_list(ag_seq *ctx)
+{
+        return ag_list_cursor_next(&ctx->cur) ? ag_list_cursor_get(&ctx->cur)
+            : NULL;
+}
+
+
+/*
+ * Define the pull_gen() helper function. Once a generator has returned NULL, it
+ * isn't called again, so generators don't need to cope with being called past
+ * their end.
+ */
+
+
+static const ag_value *
+pull_gen(ag_seq *ctx)
+{
+        ag_value_release(&ctx->val);
+
+        if (AG_LIKELY (!ctx->done)) {
+                ctx->val = ctx->gen(ctx->ctx);
+                ctx->done = !ctx->val;
+        }
+
+        return ctx->val;
+}
+
+
+static const ag_value *
+pull_map(ag_seq *ctx)
+{
+        const ag_value *v = ctx->src->pull(ctx->src);
+
+        ag_value_release(&ctx->val);
+
+        if (AG_LIKELY (v)) {
+                ctx->val = ctx->map(v, ctx->in);
+                AG_ASSERT_PTR (ctx->val);
+        }
+
+        return ctx->val;
+}
+
+
+static const ag_value *
+pull_filter(ag_seq *ctx)
+{
+        const ag_value *v;
+
+        while ((v = ctx->src->pull(ctx->src)) && !ctx->pred(v, ctx->in))
+                ;
+
+        return v;
+}
+
+
+static const ag_value *
+pull_take(ag_seq *ctx)
+{
+        if (!ctx->n)
+                return NULL;
+
+        ctx->n--;
+        return ctx->src->pull(ctx->src);
+}
+
+
+static const ag_value *
+pull_skip(ag_seq *ctx)
+{
+        for (; ctx->n; ctx->n--) {
+                if (!ctx->src->pull(ctx->src))
+                        return NULL;
+        }
+
+        return ctx->src->pull(ctx->src);
+}
+
+
+static const ag_value *
+pull_zip(ag_seq *ctx)
+{
+        const ag_value *v = ctx->src->pull(ctx->src);
+        const ag_value *v2 = v ? ctx->src2->pull(ctx->src2) : NULL;
+
+        ag_value_release(&ctx->val);
+
+        if (AG_LIKELY (v2)) {
+                AG_AUTO(ag_field) *f = ag_field_new(v, v2);
+                ctx->val = ag_value_new_object(f);
+        }
+
+        return ctx->val;
+}
+
+
+/*
+ * Define the lines_next() and lines_dispose() helper functions. lines_next()
+ * reads the next line of a file, stripping its line terminator, whether it is
+ * a bare line feed or a carriage return and line feed pair.
+ */
+
+
+static ag_value *
+lines_next(void *ctx)
+{
+        struct lines *l = ctx;
+        register ssize_t len = getline(&l->bfr, &l->sz, l->file);
+
+        if (len < 0)
+                return NULL;
+
+        if (len && l->bfr[len - 1] == '\n')
+                l->bfr[--len] = '\0';
+
+        if (len && l->bfr[len - 1] == '\r')
+                l->bfr[--len] = '\0';
+
+        AG_AUTO(ag_string) *s = ag_string_new(l->bfr);
+        return ag_value_new_string(s);
+}
+
+
+static void
+lines_dispose(void *ctx)
+{
+        struct lines *l = ctx;
+        void *ptr = l;
+
+        free(l->bfr);
+        ag_memblock_release(&ptr);
+}
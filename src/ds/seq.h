@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#ifndef __ARGENT_INCLUDE_SEQ_H__
+#define __ARGENT_INCLUDE_SEQ_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdio.h>
+
+#include "../ex/exception.h"
+#include "../type/value.h"
+#include "./list.h"
+
+
+/*
+ * Declare the types associated with the sequence interface. ag_seq is an opaque
+ * handle to a lazy sequence of values, made up of a source followed by any
+ * number of stages. Values are pulled through all of the stages one at a time,
+ * so a pipeline runs in a single pass without building any intermediate lists.
+ * Unlike lists, sequences are not objects; a sequence can be traversed only
+ * once, and isn't safe to share between threads.
+ *
+ * ag_seq_generator is the callback behind a generated sequence, returning the
+ * next value of the sequence, or NULL once there are none left; the sequence
+ * takes ownership of the values it returns. ag_seq_dispose is called with the
+ * generator context when a generated sequence is released.
+ */
+typedef struct ag_seq   ag_seq;
+typedef ag_value        *(ag_seq_generator)(void *);
+typedef void             (ag_seq_dispose)(void *);
+
+
+/*
+ * Declare the source interface for ag_seq. ag_seq_new() creates a sequence from
+ * a generator, which is how cursors over external data are plugged in.
+ * ag_seq_from_list() creates a sequence over the values of a list, holding a
+ * copy of the list until it is released. ag_seq_from_lines() creates a sequence
+ * of the lines read from a file, as strings without their line terminators;
+ * the file is left open when the sequence is released. ag_seq_release()
+ * releases a sequence along with all of its stages and sources.
+ */
+extern ag_seq   *ag_seq_new(ag_seq_generator *, void *, ag_seq_dispose *);
+extern ag_seq   *ag_seq_from_list(const ag_list *);
+extern ag_seq   *ag_seq_from_lines(FILE *);
+extern void      ag_seq_release(ag_seq **);
+
+
+/*
+ * Declare the stage interface for ag_seq. Each of these functions takes over
+ * the sequences passed to it, and returns a new sequence that draws from them,
+ * so only the last sequence of a pipeline needs to be released.
+ *
+ * ag_seq_map() transforms each value, and ag_seq_filter() keeps the values that
+ * satisfy a predicate; both take the same callbacks as the parallel list
+ * functions. ag_seq_take() stops after a given number of values, without
+ * drawing any more from its source, and ag_seq_skip() drops a given number of
+ * values first. ag_seq_zip() pairs up the values of two sequences into fields,
+ * stopping as soon as either of them runs out.
+ */
+extern ag_seq   *ag_seq_map(ag_seq *, ag_list_transform *, void *);
+extern ag_seq   *ag_seq_filter(ag_seq *, ag_list_predicate *, void *);
+extern ag_seq   *ag_seq_take(ag_seq *, size_t);
+extern ag_seq   *ag_seq_skip(ag_seq *, size_t);
+extern ag_seq   *ag_seq_zip(ag_seq *, ag_seq *);
+
+
+/*
+ * Declare the sink interface for ag_seq. ag_seq_next() pulls the next value of
+ * a sequence, returning NULL once there are none left; the value belongs to
+ * the sequence, and remains valid only until the next pull. ag_seq_collect()
+ * pulls all of the remaining values of a sequence into a new list.
+ */
+extern const ag_value   *ag_seq_next(ag_seq *);
+extern ag_list          *ag_seq_collect(ag_seq *);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__ARGENT_INCLUDE_SEQ_H__ */
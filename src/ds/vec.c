@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "../argent.h"
+
+#include <string.h>
+
+
+/*
+ * Declare the helper functions describing the element types of the vectors
+ * defined below. These functions are expanded inline into the vector functions
+ * generated by AG_VEC_DEFINE(), so that each vector operates directly on its
+ * unboxed elements.
+ */
+
+
+/*
+ * Define the helper functions for vectors of integers.
+ */
+
+
+static inline ag_int vint_copy(ag_int v) { return v; }
+static inline void vint_release(ag_int v) { (void)v; }
+static inline enum ag_cmp vint_cmp(ag_int a, ag_int b)
+{ return ag_int_cmp(a, b); }
+static inline ag_hash vint_hash(ag_int v) { return ag_hash_new(v); }
+static inline size_t vint_sz(ag_int v) { return sizeof v; }
+static inline bool vint_is(const ag_value *v) { return ag_value_type_int(v); }
+static inline ag_value *vint_value(ag_int v) { return ag_value_new_int(v); }
+static inline ag_int vint_unvalue(const ag_value *v) { return ag_value_int(v); }
+static inline ag_string *vint_json(ag_int v)
+{ return ag_string_new_fmt("%ld", v); }
+static inline void vint_pack(ag_pack *w, ag_int v) { ag_pack_int(w, v); }
+static inline ag_int vint_unpack(struct ag_unpack *r)
+{ return ag_unpack_int(r); }
+static inline void vint_freeze(ag_int v) { (void)v; }
+
+
+/*
+ * Define the helper functions for vectors of unsigned integers.
+ */
+
+
+static inline ag_uint vuint_copy(ag_uint v) { return v; }
+static inline void vuint_release(ag_uint v) { (void)v; }
+static inline enum ag_cmp vuint_cmp(ag_uint a, ag_uint b)
+{ return ag_uint_cmp(a, b); }
+static inline ag_hash vuint_hash(ag_uint v) { return ag_hash_new(v); }
+static inline size_t vuint_sz(ag_uint v) { return sizeof v; }
+static inline bool vuint_is(const ag_value *v)
+{ return ag_value_type_uint(v); }
+static inline ag_value *vuint_value(ag_uint v) { return ag_value_new_uint(v); }
+static inline ag_uint vuint_unvalue(const ag_value *v)
+{ return ag_value_uint(v); }
+static inline ag_string *vuint_json(ag_uint v)
+{ return ag_string_new_fmt("%lu", v); }
+static inline void vuint_pack(ag_pack *w, ag_uint v) { ag_pack_uint(w, v); }
+static inline ag_uint vuint_unpack(struct ag_unpack *r)
+{ return ag_unpack_uint(r); }
+static inline void vuint_freeze(ag_uint v) { (void)v; }
+
+
+/*
+ * Define the helper functions for vectors of floating point numbers. Unlike
+ * ag_float_cmp(), vfloat_cmp() compares exactly; the approximate equality used
+ * by the former isn't transitive, and so would confuse the sort.
+ */
+
+
+static inline ag_float vfloat_copy(ag_float v) { return v; }
+static inline void vfloat_release(ag_float v) { (void)v; }
+static inline enum ag_cmp vfloat_cmp(ag_float a, ag_float b)
+{ return a < b ? AG_CMP_LT : (a > b ? AG_CMP_GT : AG_CMP_EQ); }
+static inline ag_hash vfloat_hash(ag_float v) { return ag_hash_new(v); }
+static inline size_t vfloat_sz(ag_float v) { return sizeof v; }
+static inline bool vfloat_is(const ag_value *v)
+{ return ag_value_type_float(v); }
+static inline ag_value *vfloat_value(ag_float v)
+{ return ag_value_new_float(v); }
+static inline ag_float vfloat_unvalue(const ag_value *v)
+{ return ag_value_float(v); }
+static inline ag_string *vfloat_json(ag_float v)
+{ return ag_string_new_fmt("%.4f", v); }
+static inline void vfloat_pack(ag_pack *w, ag_float v) { ag_pack_float(w, v); }
+static inline ag_float vfloat_unpack(struct ag_unpack *r)
+{ return ag_unpack_float(r); }
+static inline void vfloat_freeze(ag_float v) { (void)v; }
+
+
+/*
+ * Define the helper functions for vectors of strings. The vector holds its own
+ * reference to each string, so copying an element is cheap.
+ */
+
+
+static inline ag_string *vstr_copy(const ag_string *v)
+{ return ag_string_copy(v); }
+static inline void vstr_release(ag_string *v) { ag_string_release(&v); }
+static inline enum ag_cmp vstr_cmp(const ag_string *a, const ag_string *b)
+{ return ag_string_cmp(a, b); }
+static inline ag_hash vstr_hash(const ag_string *v)
+{ return ag_hash_new_str(v); }
+static inline size_t vstr_sz(const ag_string *v) { return ag_string_sz(v); }
+static inline bool vstr_is(const ag_value *v)
+{ return ag_value_type_string(v); }
+static inline ag_value *vstr_value(const ag_string *v)
+{ return ag_value_new_string(v); }
+static inline ag_string *vstr_unvalue(const ag_value *v)
+{ return ag_string_copy(ag_value_string(v)); }
+static inline ag_string *vstr_json(const ag_string *v) { return ag_string_new_json(v); }
+static inline void vstr_pack(ag_pack *w, const ag_string *v)
+{ ag_pack_string(w, v); }
+static inline ag_string *vstr_unpack(struct ag_unpack *r)
+{ return ag_unpack_string(r); }
+static inline void vstr_freeze(ag_string *v) { ag_string_freeze(v); }
+
+
+/*
+ * Define the vector types. The vectors are defined as objects by their dynamic
+ * dispatch callback functions that are generated by AG_VEC_DEFINE() and
+ * registered with the object registry.
+ */
+
+
+AG_VEC_DEFINE(ag_vec_int, ag_int, ag_int, AG_TYPEID_VEC_INT, vint);
+AG_VEC_DEFINE(ag_vec_uint, ag_uint, ag_uint, AG_TYPEID_VEC_UINT, vuint);
+AG_VEC_DEFINE(ag_vec_float, ag_float, ag_float, AG_TYPEID_VEC_FLOAT, vfloat);
+AG_VEC_DEFINE(ag_vec_str, ag_string *, const ag_string *, AG_TYPEID_VEC_STR,
+    vstr);
+
+AG_VEC_DEFINE_NUM(ag_vec_int, ag_int);
+AG_VEC_DEFINE_NUM(ag_vec_uint, ag_uint);
+AG_VEC_DEFINE_NUM(ag_vec_float, ag_float);
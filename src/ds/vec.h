@@ -0,0 +1,650 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#ifndef __ARGENT_INCLUDE_VEC_H__
+#define __ARGENT_INCLUDE_VEC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "../ex/exception.h"
+#include "../type/value.h"
+#include "./list.h"
+
+
+/*
+ * Declare the interface of a typed vector. A typed vector is an object holding
+ * an unboxed array of elements of a single type, laid out contiguously so that
+ * loops over it can be vectorised by the compiler. Copies of a vector share the
+ * element array until one of them is mutated.
+ *
+ * AG_VEC_DECLARE() declares the interface of a vector type T holding elements
+ * of type E, which are passed in as arguments of type A; E is also made
+ * available as T_elem. Alongside the object interface generated by
+ * AG_OBJECT_DECLARE(), T_new() creates an empty vector, T_new_array() creates
+ * a vector from an array of elements, and T_new_list() creates a vector from a
+ * list of values of the matching type. T_get_at() gets
+ * a copy of the element at a 1-based index, T_data() exposes the element array
+ * itself, and T_list() converts a vector back into a list. T_set_at() sets the
+ * element at a 1-based index, T_push() appends an element, T_reserve() makes
+ * room for a given number of elements, and T_sort() sorts the elements in
+ * ascending order.
+ */
+#define AG_VEC_DECLARE(T, E, A, TID)                                    \
+        AG_OBJECT_DECLARE(T, TID);                                      \
+        typedef E T##_elem;                                             \
+        extern T        *T##_new(void);                                 \
+        extern T        *T##_new_array(const E *, size_t);              \
+        extern T        *T##_new_list(const ag_list *);                 \
+        extern E         T##_get_at(const T *, size_t);                 \
+        extern const T##_elem *T##_data(const T *);                     \
+        extern ag_list  *T##_list(const T *);                           \
+        extern void      T##_set_at(T **, A, size_t);                   \
+        extern void      T##_push(T **, A);                             \
+        extern void      T##_reserve(T **, size_t);                     \
+        extern void      T##_sort(T **)
+
+
+/*
+ * Declare the reductions of a numeric vector type T holding elements of type E.
+ * T_sum() returns the sum of the elements, or 0 for an empty vector, and
+ * T_min() and T_max() return the smallest and largest element of a vector that
+ * is not empty.
+ */
+#define AG_VEC_DECLARE_NUM(T, E)                                        \
+        extern E T##_sum(const T *);                                    \
+        extern E T##_min(const T *);                                    \
+        extern E T##_max(const T *)
+
+
+/*
+ * Declare the vector types provided by the Argent Library, which hold unboxed
+ * integers, unsigned integers, floating point numbers and strings.
+ */
+AG_VEC_DECLARE(ag_vec_int, ag_int, ag_int, AG_TYPEID_VEC_INT);
+AG_VEC_DECLARE(ag_vec_uint, ag_uint, ag_uint, AG_TYPEID_VEC_UINT);
+AG_VEC_DECLARE(ag_vec_float, ag_float, ag_float, AG_TYPEID_VEC_FLOAT);
+AG_VEC_DECLARE(ag_vec_str, ag_string *, const ag_string *,
+    AG_TYPEID_VEC_STR);
+
+AG_VEC_DECLARE_NUM(ag_vec_int, ag_int);
+AG_VEC_DECLARE_NUM(ag_vec_uint, ag_uint);
+AG_VEC_DECLARE_NUM(ag_vec_float, ag_float);
+
+
+/*
+ * Define the implementation of a vector type T declared with AG_VEC_DECLARE().
+ * The element type is described by a set of helper functions sharing the
+ * prefix P, which must be in scope where the vector is defined:
+ *
+ *   - E P_copy(A) copies an element
+ *   - void P_release(E) releases an element
+ *   - enum ag_cmp P_cmp(A, A) compares two elements
+ *   - ag_hash P_hash(A) hashes an element
+ *   - size_t P_sz(A) returns the size of an element
+ *   - bool P_is(const ag_value *) checks whether a value holds an element
+ *   - ag_value *P_value(A) boxes an element into a value
+ *   - E P_unvalue(const ag_value *) unboxes an element from a value
+ *   - ag_string *P_json(A) renders an element as JSON
+ *   - void P_pack(ag_pack *, A) packs an element
+ *   - E P_unpack(struct ag_unpack *) unpacks an element
+ *   - void P_freeze(E) freezes an element
+ *
+ * The payload of a vector holds its length and a reference to its element
+ * array, a memory block whose capacity is implied by its size. Sorting uses an
+ * introsort specialised on P_cmp(), so that comparisons are inlined rather than
+ * called through a function pointer as they would be by qsort().
+ */
+#define AG_VEC_DEFINE(T, E, A, TID, P)                                  \
+        struct T##_payload {                                            \
+                size_t   len;                                           \
+                E       *val;                                           \
+        };                                                              \
+                                                                        \
+        static struct T##_payload *                                     \
+        T##_payload_new(const struct T##_payload *ref)                  \
+        {                                                               \
+                struct T##_payload *p = ag_memblock_new(sizeof *p);     \
+                p->len = 0;                                             \
+                p->val = NULL;                                          \
+                                                                        \
+                if (ref && ref->val) {                                  \
+                        p->len = ref->len;                              \
+                        p->val = ag_memblock_copy(ref->val);            \
+                }                                                       \
+                                                                        \
+                return p;                                               \
+        }                                                               \
+                                                                        \
+        static void                                                     \
+        T##_payload_own(struct T##_payload *ctx, size_t len)            \
+        {                                                               \
+                register size_t cap = ctx->val                          \
+                    ? ag_memblock_sz(ctx->val) / sizeof (E) : 0;        \
+                register bool own = ctx->val                            \
+                    && ag_memblock_refc(ctx->val) == 1;                 \
+                                                                        \
+                if (AG_LIKELY (own && cap >= len))                      \
+                        return;                                         \
+                                                                        \
+                if (cap < len)                                          \
+                        cap = cap * 2 > len ? cap * 2 : len;            \
+                if (cap < 8)                                            \
+                        cap = 8;                                        \
+                                                                        \
+                E *v = ag_memblock_new(cap * sizeof (E));               \
+                void *ptr = ctx->val;                                   \
+                                                                        \
+                for (register size_t i = 0; i < ctx->len; i++)          \
+                        v[i] = own ? ctx->val[i] : P##_copy(ctx->val[i]); \
+                                                                        \
+                ag_memblock_release(&ptr);                              \
+                ctx->val = v;                                           \
+        }                                                               \
+                                                                        \
+        static inline void                                              \
+        T##_sort_insert(E *v, size_t len)                               \
+        {                                                               \
+                register size_t j;                                      \
+                E e;                                                    \
+                                                                        \
+                for (register size_t i = 1; i < len; i++) {             \
+                        e = v[i];                                       \
+                                                                        \
+                        for (j = i; j && P##_cmp(e, v[j - 1])           \
+                            == AG_CMP_LT; j--)                          \
+                                v[j] = v[j - 1];                        \
+                                                                        \
+                        v[j] = e;                                       \
+                }                                                       \
+        }                                                               \
+                                                                        \
+        static void                                                     \
+        T##_sort_heap(E *v, size_t len)                                 \
+        {                                                               \
+                register size_t i, j, k;                                \
+                E e;                                                    \
+                                                                        \
+                for (i = len / 2; i-- > 0;) {                           \
+                        for (j = i; (k = 2 * j + 1) < len; j = k) {     \
+                                if (k + 1 < len && P##_cmp(v[k],        \
+                                    v[k + 1]) == AG_CMP_LT)             \
+                                        k++;                            \
+                                if (P##_cmp(v[j], v[k]) != AG_CMP_LT)   \
+                                        break;                          \
+                                e = v[j]; v[j] = v[k]; v[k] = e;        \
+                        }                                               \
+                }                                                       \
+                                                                        \
+                for (i = len; i-- > 1;) {                               \
+                        e = v[0]; v[0] = v[i]; v[i] = e;                \
+                                                                        \
+                        for (j = 0; (k = 2 * j + 1) < i; j = k) {       \
+                                if (k + 1 < i && P##_cmp(v[k],          \
+                                    v[k + 1]) == AG_CMP_LT)             \
+                                        k++;                            \
+                                if (P##_cmp(v[j], v[k]) != AG_CMP_LT)   \
+                                        break;                          \
+                                e = v[j]; v[j] = v[k]; v[k] = e;        \
+                        }                                               \
+                }                                                       \
+        }                                                               \
+                                                                        \
+        static void                                                     \
+        T##_sort_intro(E *v, size_t len, size_t depth)                  \
+        {                                                               \
+                register size_t i, j;                                   \
+                E e;                                                    \
+                E pv;                                                   \
+                                                                        \
+                while (len > 16) {                                      \
+                        if (!depth--) {                                 \
+                                T##_sort_heap(v, len);                  \
+                                return;                                 \
+                        }                                               \
+                                                                        \
+                        i = len / 2;                                    \
+                        if (P##_cmp(v[i], v[0]) == AG_CMP_LT) {         \
+                                e = v[i]; v[i] = v[0]; v[0] = e;        \
+                        }                                               \
+                        if (P##_cmp(v[len - 1], v[i]) == AG_CMP_LT) {   \
+                                e = v[i]; v[i] = v[len - 1];            \
+                                v[len - 1] = e;                         \
+                                if (P##_cmp(v[i], v[0]) == AG_CMP_LT) { \
+                                        e = v[i]; v[i] = v[0];          \
+                                        v[0] = e;                       \
+                                }                                       \
+                        }                                               \
+                                                                        \
+                        pv = v[i];                                      \
+                        i = 0;                                          \
+                        j = len - 1;                                    \
+                                                                        \
+                        for (;;) {                                      \
+                                while (P##_cmp(v[i], pv) == AG_CMP_LT)  \
+                                        i++;                            \
+                                while (P##_cmp(pv, v[j]) == AG_CMP_LT)  \
+                                        j--;                            \
+                                if (i >= j)                             \
+                                        break;                          \
+                                e = v[i]; v[i] = v[j]; v[j] = e;        \
+                                i++;                                    \
+                                j--;                                    \
+                        }                                               \
+                                                                        \
+                        if (j + 1 < len - j - 1) {                      \
+                                T##_sort_intro(v, j + 1, depth);        \
+                                v += j + 1;                             \
+                                len -= j + 1;                           \
+                        } else {                                        \
+                                T##_sort_intro(v + j + 1, len - j - 1,  \
+                                    depth);                             \
+                                len = j + 1;                            \
+                        }                                               \
+                }                                                       \
+                                                                        \
+                T##_sort_insert(v, len);                                \
+        }                                                               \
+                                                                        \
+        AG_OBJECT_DEFINE(T, TID);                                       \
+                                                                        \
+        ag_memblock *                                                   \
+        __##T##_clone__(const ag_memblock *_p_)                         \
+        {                                                               \
+                AG_ASSERT_PTR (_p_);                                    \
+                return T##_payload_new(_p_);                            \
+        }                                                               \
+                                                                        \
+        void                                                            \
+        __##T##_release__(ag_memblock *_p_)                             \
+        {                                                               \
+                AG_ASSERT_PTR (_p_);                                    \
+                struct T##_payload *p = _p_;                            \
+                void *ptr = p->val;                                     \
+                                                                        \
+                if (ag_memblock_release_last(&ptr)) {                   \
+                        for (register size_t i = 0; i < p->len; i++)    \
+                                P##_release(p->val[i]);                 \
+                                                                        \
+                        ag_memblock_release(&ptr);                      \
+                }                                                       \
+        }                                                               \
+                                                                        \
+        enum ag_cmp                                                     \
+        __##T##_cmp__(const ag_object *_o1_, const ag_object *_o2_)     \
+        {                                                               \
+                const struct T##_payload *p1 = ag_object_payload(_o1_); \
+                const struct T##_payload *p2 = ag_object_payload(_o2_); \
+                register size_t len = p1->len < p2->len                 \
+                    ? p1->len : p2->len;                                \
+                register enum ag_cmp chk;                               \
+                                                                        \
+                for (register size_t i = 0; i < len; i++) {             \
+                        if ((chk = P##_cmp(p1->val[i], p2->val[i])))    \
+                                return chk;                             \
+                }                                                       \
+                                                                        \
+                if (p1->len == p2->len)                                 \
+                        return AG_CMP_EQ;                               \
+                                                                        \
+                return p1->len < p2->len ? AG_CMP_LT : AG_CMP_GT;       \
+        }                                                               \
+                                                                        \
+        bool                                                            \
+        __##T##_valid__(const ag_object *_o_)                           \
+        {                                                               \
+                const struct T##_payload *p = ag_object_payload(_o_);   \
+                return p->len;                                          \
+        }                                                               \
+                                                                        \
+        size_t                                                          \
+        __##T##_sz__(const ag_object *_o_)                              \
+        {                                                               \
+                const struct T##_payload *p = ag_object_payload(_o_);   \
+                register size_t sz = 0;                                 \
+                                                                        \
+                for (register size_t i = 0; i < p->len; i++)            \
+                        sz += P##_sz(p->val[i]);                        \
+                                                                        \
+                return sz;                                              \
+        }                                                               \
+                                                                        \
+        size_t                                                          \
+        __##T##_len__(const ag_object *_o_)                             \
+        {                                                               \
+                const struct T##_payload *p = ag_object_payload(_o_);   \
+                return p->len;                                          \
+        }                                                               \
+                                                                        \
+        ag_hash                                                         \
+        __##T##_hash__(const ag_object *_o_)                            \
+        {                                                               \
+                const struct T##_payload *p = ag_object_payload(_o_);   \
+                register ag_hash h = 0;                                 \
+                                                                        \
+                for (register size_t i = 0; i < p->len; i++)            \
+                        h += P##_hash(p->val[i]);                       \
+                                                                        \
+                return h;                                               \
+        }                                                               \
+                                                                        \
+        ag_string *                                                     \
+        __##T##_str__(const ag_object *_o_)                             \
+        {                                                               \
+                return ag_string_new_fmt(#T " len = %lu",               \
+                    ag_object_len(_o_));                                \
+        }                                                               \
+                                                                        \
+        ag_string *                                                     \
+        __##T##_json__(const ag_object *_o_)                            \
+        {                                                               \
+                const struct T##_payload *p = ag_object_payload(_o_);   \
+                ag_string *s = ag_string_new_empty();                   \
+                ag_string *s2, *e;                                      \
+                                                                        \
+                for (register size_t i = 0; i < p->len; i++) {          \
+                        e = P##_json(p->val[i]);                        \
+                        s2 = i ? ag_string_new_fmt("%s,%s", s, e)       \
+                            : ag_string_copy(e);                        \
+                                                                        \
+                        ag_string_release(&e);                          \
+                        ag_string_release(&s);                          \
+                        s = s2;                                         \
+                }                                                       \
+                                                                        \
+                s2 = ag_string_new_fmt("[%s]", s);                      \
+                ag_string_release(&s);                                  \
+                                                                        \
+                return s2;                                              \
+        }                                                               \
+                                                                        \
+        void                                                            \
+        __##T##_pack__(const ag_object *_o_, ag_pack *_w_)              \
+        {                                                               \
+                const struct T##_payload *p = ag_object_payload(_o_);   \
+                ag_pack_array(_w_, p->len);                             \
+                                                                        \
+                for (register size_t i = 0; i < p->len; i++)            \
+                        P##_pack(_w_, p->val[i]);                       \
+        }                                                               \
+                                                                        \
+        ag_memblock *                                                   \
+        __##T##_unpack__(struct ag_unpack *_r_)                         \
+        {                                                               \
+                struct T##_payload *p = T##_payload_new(NULL);          \
+                register size_t len = ag_unpack_array(_r_);             \
+                                                                        \
+                T##_payload_own(p, len);                                \
+                                                                        \
+                for (register size_t i = 0; i < len; i++)               \
+                        p->val[p->len++] = P##_unpack(_r_);             \
+                                                                        \
+                return p;                                               \
+        }                                                               \
+                                                                        \
+        void                                                            \
+        __##T##_freeze__(ag_memblock *_p_)                              \
+        {                                                               \
+                struct T##_payload *p = _p_;                            \
+                                                                        \
+                if (!p->val || ag_memblock_frozen(p->val))              \
+                        return;                                         \
+                                                                        \
+                ag_memblock_freeze(p->val);                             \
+                                                                        \
+                for (register size_t i = 0; i < p->len; i++)            \
+                        P##_freeze(p->val[i]);                          \
+        }                                                               \
+                                                                        \
+        extern T *                                                      \
+        T##_new(void)                                                   \
+        {                                                               \
+                return ag_object_new(TID, T##_payload_new(NULL));       \
+        }                                                               \
+                                                                        \
+        extern T *                                                      \
+        T##_new_array(const E *val, size_t len)                         \
+        {                                                               \
+                AG_ASSERT_PTR (val);                                    \
+                                                                        \
+                struct T##_payload *p = T##_payload_new(NULL);          \
+                T##_payload_own(p, len);                                \
+                                                                        \
+                for (register size_t i = 0; i < len; i++)               \
+                        p->val[i] = P##_copy(val[i]);                   \
+                                                                        \
+                p->len = len;                                           \
+                return ag_object_new(TID, p);                           \
+        }                                                               \
+                                                                        \
+        static bool                                                     \
+        T##_list_push(const ag_value *val, void *in, void *out)         \
+        {                                                               \
+                (void)in;                                               \
+                struct T##_payload *p = out;                            \
+                                                                        \
+                AG_ASSERT (P##_is(val));                                \
+                p->val[p->len++] = P##_unvalue(val);                    \
+                                                                        \
+                return true;                                            \
+        }                                                               \
+                                                                        \
+        extern T *                                                      \
+        T##_new_list(const ag_list *list)                               \
+        {                                                               \
+                AG_ASSERT_PTR (list);                                   \
+                                                                        \
+                struct T##_payload *p = T##_payload_new(NULL);          \
+                T##_payload_own(p, ag_list_len(list));                  \
+                ag_list_map(list, T##_list_push, NULL, p);              \
+                                                                        \
+                return ag_object_new(TID, p);                           \
+        }                                                               \
+                                                                        \
+        extern E                                                        \
+        T##_get_at(const T *ctx, size_t idx)                            \
+        {                                                               \
+                AG_ASSERT_PTR (ctx);                                    \
+                                                                        \
+                const struct T##_payload *p = ag_object_payload(ctx);   \
+                AG_ASSERT (idx >= 1 && idx <= p->len);                  \
+                                                                        \
+                return P##_copy(p->val[idx - 1]);                       \
+        }                                                               \
+                                                                        \
+        extern const T##_elem *                                         \
+        T##_data(const T *ctx)                                          \
+        {                                                               \
+                AG_ASSERT_PTR (ctx);                                    \
+                                                                        \
+                const struct T##_payload *p = ag_object_payload(ctx);   \
+                return p->val;                                          \
+        }                                                               \
+                                                                        \
+        extern ag_list *                                                \
+        T##_list(const T *ctx)                                          \
+        {                                                               \
+                AG_ASSERT_PTR (ctx);                                    \
+                                                                        \
+                const struct T##_payload *p = ag_object_payload(ctx);   \
+                ag_list *l = ag_list_new();                             \
+                ag_value *v;                                            \
+                                                                        \
+                ag_list_reserve(&l, p->len);                            \
+                                                                        \
+                for (register size_t i = 0; i < p->len; i++) {          \
+                        v = P##_value(p->val[i]);                       \
+                        ag_list_push(&l, v);                            \
+                        ag_value_release(&v);                           \
+                }                                                       \
+                                                                        \
+                return l;                                               \
+        }                                                               \
+                                                                        \
+        extern void                                                     \
+        T##_set_at(T **ctx, A val, size_t idx)                          \
+        {                                                               \
+                AG_ASSERT_PTR (ctx && *ctx);                            \
+                                                                        \
+                struct T##_payload *p = ag_object_payload_mutable(ctx); \
+                AG_ASSERT (idx >= 1 && idx <= p->len);                  \
+                                                                        \
+                T##_payload_own(p, p->len);                             \
+                E cp = P##_copy(val);                                   \
+                P##_release(p->val[idx - 1]);                           \
+                p->val[idx - 1] = cp;                                   \
+        }                                                               \
+                                                                        \
+        extern void                                                     \
+        T##_push(T **ctx, A val)                                        \
+        {                                                               \
+                AG_ASSERT_PTR (ctx && *ctx);                            \
+                                                                        \
+                struct T##_payload *p = ag_object_payload_mutable(ctx); \
+                T##_payload_own(p, p->len + 1);                         \
+                p->val[p->len++] = P##_copy(val);                       \
+        }                                                               \
+                                                                        \
+        extern void                                                     \
+        T##_reserve(T **ctx, size_t len)                                \
+        {                                                               \
+                AG_ASSERT_PTR (ctx && *ctx);                            \
+                                                                        \
+                struct T##_payload *p = ag_object_payload_mutable(ctx); \
+                T##_payload_own(p, len > p->len ? len : p->len);        \
+        }                                                               \
+                                                                        \
+        extern void                                                     \
+        T##_sort(T **ctx)                                               \
+        {                                                               \
+                AG_ASSERT_PTR (ctx && *ctx);                            \
+                                                                        \
+                struct T##_payload *p = ag_object_payload_mutable(ctx); \
+                register size_t depth = 0;                              \
+                                                                        \
+                if (p->len < 2)                                         \
+                        return;                                         \
+                                                                        \
+                for (register size_t n = p->len; n; n >>= 1)            \
+                        depth += 2;                                     \
+                                                                        \
+                T##_payload_own(p, p->len);                             \
+                T##_sort_intro(p->val, p->len, depth);                  \
+        }
+
+
+/*
+ * Define the reductions of a numeric vector type T declared with
+ * AG_VEC_DECLARE_NUM(), using the payload defined by AG_VEC_DEFINE(). Each
+ * reduction keeps four independent accumulators, so that the loop can be
+ * vectorised or pipelined even for floating point elements, where the compiler
+ * is otherwise not allowed to reorder the additions. Sums of floating point
+ * elements may therefore differ in their last bits from a strictly sequential
+ * sum.
+ */
+#define AG_VEC_DEFINE_NUM(T, E)                                         \
+        extern E                                                        \
+        T##_sum(const T *ctx)                                           \
+        {                                                               \
+                AG_ASSERT_PTR (ctx);                                    \
+                                                                        \
+                const struct T##_payload *p = ag_object_payload(ctx);   \
+                const E *v = p->val;                                    \
+                register size_t len = p->len, i = 0;                    \
+                E s[4] = {0, 0, 0, 0};                                  \
+                                                                        \
+                for (; i + 4 <= len; i += 4) {                          \
+                        s[0] += v[i];                                   \
+                        s[1] += v[i + 1];                               \
+                        s[2] += v[i + 2];                               \
+                        s[3] += v[i + 3];                               \
+                }                                                       \
+                                                                        \
+                for (; i < len; i++)                                    \
+                        s[0] += v[i];                                   \
+                                                                        \
+                return (s[0] + s[1]) + (s[2] + s[3]);                   \
+        }                                                               \
+                                                                        \
+        extern E                                                        \
+        T##_min(const T *ctx)                                           \
+        {                                                               \
+                AG_ASSERT_PTR (ctx);                                    \
+                                                                        \
+                const struct T##_payload *p = ag_object_payload(ctx);   \
+                AG_ASSERT (p->len);                                     \
+                                                                        \
+                const E *v = p->val;                                    \
+                register size_t len = p->len, i = 0;                    \
+                E m[4] = {v[0], v[0], v[0], v[0]};                      \
+                                                                        \
+                for (; i + 4 <= len; i += 4) {                          \
+                        m[0] = v[i] < m[0] ? v[i] : m[0];               \
+                        m[1] = v[i + 1] < m[1] ? v[i + 1] : m[1];       \
+                        m[2] = v[i + 2] < m[2] ? v[i + 2] : m[2];       \
+                        m[3] = v[i + 3] < m[3] ? v[i + 3] : m[3];       \
+                }                                                       \
+                                                                        \
+                for (; i < len; i++)                                    \
+                        m[0] = v[i] < m[0] ? v[i] : m[0];               \
+                                                                        \
+                m[0] = m[1] < m[0] ? m[1] : m[0];                       \
+                m[2] = m[3] < m[2] ? m[3] : m[2];                       \
+                return m[2] < m[0] ? m[2] : m[0];                       \
+        }                                                               \
+                                                                        \
+        extern E                                                        \
+        T##_max(const T *ctx)                                           \
+        {                                                               \
+                AG_ASSERT_PTR (ctx);                                    \
+                                                                        \
+                const struct T##_payload *p = ag_object_payload(ctx);   \
+                AG_ASSERT (p->len);                                     \
+                                                                        \
+                const E *v = p->val;                                    \
+                register size_t len = p->len, i = 0;                    \
+                E m[4] = {v[0], v[0], v[0], v[0]};                      \
+                                                                        \
+                for (; i + 4 <= len; i += 4) {                          \
+                        m[0] = v[i] > m[0] ? v[i] : m[0];               \
+                        m[1] = v[i + 1] > m[1] ? v[i + 1] : m[1];       \
+                        m[2] = v[i + 2] > m[2] ? v[i + 2] : m[2];       \
+                        m[3] = v[i + 3] > m[3] ? v[i + 3] : m[3];       \
+                }                                                       \
+                                                                        \
+                for (; i < len; i++)                                    \
+                        m[0] = v[i] > m[0] ? v[i] : m[0];               \
+                                                                        \
+                m[0] = m[1] > m[0] ? m[1] : m[0];                       \
+                m[2] = m[3] > m[2] ? m[3] : m[2];                       \
+                return m[2] > m[0] ? m[2] : m[0];                       \
+        }
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__ARGENT_INCLUDE_VEC_H__ */
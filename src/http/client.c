@@ -150,6 +150,56 @@ AG_OBJECT_DEFINE_STR(ag_http_client,
 );
 
 
+/*
+ * Define the __ag_http_client_pack__() dynamic dispatch function. This function
+ * is called by ag_object_pack() when an HTTP client object is packed. We pack
+ * the properties of the client as an array.
+ */
+AG_OBJECT_DEFINE_PACK(ag_http_client,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_array(_w_, 5);
+        ag_pack_string(_w_, p->ip);
+        ag_pack_uint(_w_, p->port);
+        ag_pack_string(_w_, p->host);
+        ag_pack_string(_w_, p->agent);
+        ag_pack_string(_w_, p->referer);
+);
+
+
+/*
+ * Define the __ag_http_client_unpack__() dynamic dispatch function. This
+ * function is called by ag_object_unpack() to read back the properties of an
+ * HTTP client written by __ag_http_client_pack__().
+ */
+AG_OBJECT_DEFINE_UNPACK(ag_http_client,
+        AG_UNPACK_REQUIRE (ag_unpack_array(_r_) == 5, "ag_http_client");
+
+        AG_AUTO(ag_string) *ip = ag_unpack_string(_r_);
+        ag_uint port = ag_unpack_uint(_r_);
+        AG_AUTO(ag_string) *host = ag_unpack_string(_r_);
+        AG_AUTO(ag_string) *agent = ag_unpack_string(_r_);
+        AG_AUTO(ag_string) *referer = ag_unpack_string(_r_);
+
+        return payload_new(ip, port, host, agent, referer);
+);
+
+
+/*
+ * Define the __ag_http_client_freeze__() dynamic dispatch function. This
+ * function is called by ag_object_freeze() when an HTTP client object is
+ * frozen, and freezes each of the string properties of the client.
+ */
+AG_OBJECT_DEFINE_FREEZE(ag_http_client,
+        struct payload *p = _p_;
+
+        ag_string_freeze(p->ip);
+        ag_string_freeze(p->host);
+        ag_string_freeze(p->agent);
+        ag_string_freeze(p->referer);
+);
+
+
 
 
 /*
@@ -0,0 +1,1606 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+
+#define _GNU_SOURCE
+
+#include "../argent.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+
+/*
+ * The native engine serves the AG_HTTP_SERVER_FASTCGI and AG_HTTP_SERVER_HTTP
+ * backends over non-blocking sockets, with each worker thread running its own
+ * epoll loop on the shared listening socket. The loop, the connections and
+ * their buffers are common to both; only the parsing of the input and the
+ * framing of the output differ, with the FastCGI 1.0 record protocol spoken
+ * to a web server in front of us in the first case and HTTP/1.1 spoken to the
+ * clients themselves in the second.
+ *
+ * Unlike libfcgi, a FastCGI connection may carry any number of multiplexed
+ * requests and may be kept open across requests when the web server sets
+ * FCGI_KEEP_CONN. An HTTP connection is kept alive unless the client asks
+ * otherwise, and may have requests pipelined on it, which are answered in
+ * order. Either way, the handler of a request runs on the worker thread as
+ * soon as the request is complete, and its response is written out as the
+ * socket becomes writable, so a slow peer never blocks the worker.
+ */
+
+
+#define FCGI_VERSION            1
+#define FCGI_HEADER_LEN         8
+#define FCGI_CONTENT_MAX        65535
+
+#define FCGI_BEGIN_REQUEST      1
+#define FCGI_ABORT_REQUEST      2
+#define FCGI_END_REQUEST        3
+#define FCGI_PARAMS             4
+#define FCGI_STDIN              5
+#define FCGI_STDOUT             6
+#define FCGI_GET_VALUES         9
+#define FCGI_GET_VALUES_RESULT  10
+#define FCGI_UNKNOWN_TYPE       11
+
+#define FCGI_RESPONDER          1
+#define FCGI_KEEP_CONN          1
+#define FCGI_REQUEST_COMPLETE   0
+#define FCGI_UNKNOWN_ROLE       3
+
+
+/*
+ * The size by which the input buffer of a connection grows before each read,
+ * and the number of events collected by each call to epoll_wait().
+ */
+#define READ_CHUNK      16384
+#define EVENT_MAX       64
+
+
+/*
+ * The amount of unwritten output above which a connection stops reading and
+ * parsing its input until the peer has taken some of it, so that a client that
+ * pipelines requests without reading the responses can't make us buffer them
+ * without limit.
+ */
+#define OUT_MAX         (256 << 10)
+
+
+/*
+ * A growable byte buffer. The data is held in a memory block that doubles
+ * whenever it needs to grow, starting from BUF_MIN bytes.
+ */
+#define BUF_MIN 256
+
+struct buf {
+        char    *data;
+        size_t   len;
+        size_t   cap;
+};
+
+
+/*
+ * A FastCGI param of a request. The key and value are slices of the params
+ * stream of the request rather than copies, and the value is terminated in
+ * place so that it can be handed out as a C string.
+ */
+struct param {
+        const char      *key;
+        size_t           klen;
+        char            *val;
+        size_t           vlen;
+};
+
+
+/*
+ * A request in progress on a connection. The params stream is accumulated in
+ * its own buffer, since its records may be interleaved with those of other
+ * requests, and is split into params once it ends; the stdin stream is held
+ * as the request body. The requests of a connection form a singly linked list.
+ */
+struct req {
+        struct req      *next;
+        struct conn     *conn;
+        struct buf       params;
+        struct buf       body;
+        struct param    *kv;
+        size_t           nkv;
+        uint16_t         id;
+        bool             keep;
+        bool             ready;
+};
+
+
+/*
+ * The limits of an HTTP request: the size of its request line and header
+ * fields, beyond which it is answered with 431, and the size of its body,
+ * beyond which it is answered with 413.
+ */
+#define HTTP_HEAD_MAX   16384
+#define HTTP_BODY_MAX   (16 << 20)
+
+
+/*
+ * A header field of an HTTP request. The name and value are held as offsets
+ * from the start of the request rather than as pointers, since the input
+ * buffer may grow or be compacted while the body of the request is received.
+ * The value is terminated in place.
+ */
+struct field {
+        uint32_t         key;
+        uint32_t         klen;
+        uint32_t         val;
+};
+
+
+/*
+ * The CGI variables that an HTTP request provides besides its header fields,
+ * which are resolved to the HTTP_ variables. Their values are set in the var
+ * array of the HTTP state of a connection, in the order of g_var, just before
+ * the request is served.
+ */
+static const char *g_var[] = {
+        "REQUEST_METHOD",
+        "REQUEST_URI",
+        "QUERY_STRING",
+        "SERVER_PROTOCOL",
+        "CONTENT_TYPE",
+        "CONTENT_LENGTH",
+        "SERVER_NAME",
+        "SERVER_PORT",
+        "REMOTE_ADDR",
+        "REMOTE_PORT",
+        "GATEWAY_INTERFACE",
+        "SERVER_SOFTWARE",
+};
+
+#define VAR_COUNT (sizeof g_var / sizeof *g_var)
+
+
+/*
+ * The HTTP state of a connection. The request at the start of the input
+ * buffer is parsed incrementally: the search for the end of its head resumes
+ * from scan as more input arrives, and once the head is complete, head holds
+ * its length, clen the length of the body, and the other offsets locate the
+ * parts of the request line and the header fields. While the request is
+ * served, base points to it; the handler's response is collected in resp, and
+ * the HTTP status line and header fields that replace its CGI header fields
+ * are built in hdr. The addresses of the connection are formatted once, when
+ * it is accepted.
+ */
+struct http {
+        struct field    *fld;
+        size_t           nfld;
+        size_t           cap;
+        size_t           scan;
+        size_t           head;
+        size_t           clen;
+        uint32_t         target;
+        uint32_t         query;
+        uint32_t         proto;
+        bool             keep;
+        bool             cont;
+        char            *base;
+        const char      *var[VAR_COUNT];
+        struct buf       resp;
+        struct buf       hdr;
+        char             host[256];
+        char             hport[8];
+        char             raddr[INET6_ADDRSTRLEN];
+        char             rport[8];
+        char             laddr[INET6_ADDRSTRLEN];
+        char             lport[8];
+};
+
+
+/*
+ * A connection from a web server or an HTTP client. The input buffer holds
+ * the input not yet parsed, and the output buffer the output not yet written,
+ * of which the first sent bytes have already been written. The connection is
+ * closed once its output has been written if close is set, which happens when
+ * a FastCGI request without FCGI_KEEP_CONN or an HTTP request that does not
+ * keep the connection alive completes, or when the peer shuts down its side of
+ * the connection. Reading is stalled while there is more than OUT_MAX bytes of
+ * unwritten output, and events holds the epoll events currently watched for.
+ * A FastCGI connection has a list of the requests in progress on it, and an
+ * HTTP connection has its HTTP state. The connections of a worker form a doubly
+ * linked list so that they can be closed when the worker stops.
+ */
+struct conn {
+        struct conn     *prev;
+        struct conn     *next;
+        struct req      *reqs;
+        struct http     *http;
+        struct buf       in;
+        struct buf       out;
+        size_t           sent;
+        int              fd;
+        uint32_t         events;
+        bool             close;
+        bool             stall;
+};
+
+
+/*
+ * The event loop of a worker thread. The listening socket is registered with
+ * a NULL event pointer and the wake descriptor with a pointer to the loop
+ * itself; every other event pointer is a connection.
+ */
+struct loop {
+        struct conn     *conns;
+        const bool      *drain;
+        int              ep;
+        int              lfd;
+        int              wake;
+        bool             listening;
+        bool             http;
+};
+
+
+static void      buf_reserve(struct buf *, size_t);
+static void      buf_put(struct buf *, const void *, size_t);
+static void      buf_release(struct buf *);
+
+static void      record_put(struct conn *, int, uint16_t, const void *,
+                    size_t);
+static void      record_end(struct conn *, uint16_t, int);
+static void      record_values(struct conn *, const char *, size_t);
+static bool      record_handle(struct conn *, int, uint16_t, const char *,
+                    size_t);
+static ssize_t   fcgi_parse(struct conn *);
+
+static bool      nv_len(const unsigned char **, const unsigned char *,
+                    size_t *);
+
+static struct req *req_new(struct conn *, uint16_t, bool);
+static struct req *req_find(struct conn *, uint16_t);
+static void      req_release(struct conn *, struct req *);
+static bool      req_parse(struct req *);
+static void      req_run(struct conn *, struct req *);
+
+static const char *fcgi_param(void *, const char *);
+static const char *fcgi_body(void *);
+static void      fcgi_write(void *, const char *, size_t);
+
+static struct http *http_new(int);
+static void      http_release(struct http *);
+static ssize_t   http_parse(struct conn *);
+static int       http_head(struct http *);
+static void      http_run(struct conn *);
+static void      http_reply(struct conn *);
+static void      http_error(struct conn *, int);
+static void      http_send(struct conn *, const char *, size_t, const char *,
+                    size_t);
+static const char *http_field(const struct http *, const char *);
+static void      http_host(struct http *);
+static void      http_addr(const struct sockaddr_storage *, char *, char *);
+
+static const char *http_param(void *, const char *);
+static const char *http_body(void *);
+static void      http_write(void *, const char *, size_t);
+
+static void      loop_accept(struct loop *);
+static void      loop_close(struct loop *, struct conn *);
+static bool      loop_idle(const struct conn *);
+static bool      conn_full(const struct conn *);
+static bool      conn_read(struct conn *);
+static bool      conn_flush(struct loop *, struct conn *);
+static bool      conn_watch(struct loop *, struct conn *);
+
+
+/*
+ * Run the event loop of the calling worker thread for a given native backend
+ * on the given listening socket until the drain flag is set and every
+ * connection of the worker has gone idle. Listening sockets shared by several
+ * workers are registered with EPOLLEXCLUSIVE so that a new connection wakes
+ * only one of them. The wake descriptor, if not negative, is an eventfd written
+ * to while the workers are being drained so that they notice the drain flag;
+ * it is registered edge-triggered since it is never read.
+ */
+extern void
+__ag_http_engine_run__(int lfd, int wake, const bool *drain,
+    enum ag_http_server_backend backend)
+{
+        AG_ASSERT (lfd >= 0);
+        AG_ASSERT_PTR (drain);
+        AG_ASSERT (backend != AG_HTTP_SERVER_LIBFCGI);
+
+        struct loop l = {.lfd = lfd, .wake = wake, .drain = drain,
+            .listening = true, .http = backend == AG_HTTP_SERVER_HTTP};
+        struct epoll_event ev[EVENT_MAX];
+
+        l.ep = epoll_create1(EPOLL_CLOEXEC);
+        AG_REQUIRE (l.ep >= 0, AG_ERNO_HTTP);
+
+        int fl = fcntl(lfd, F_GETFL);
+        AG_REQUIRE (fl >= 0 && fcntl(lfd, F_SETFL, fl | O_NONBLOCK) >= 0,
+            AG_ERNO_HTTP);
+
+        ev[0] = (struct epoll_event){.events = EPOLLIN | EPOLLEXCLUSIVE};
+        AG_REQUIRE (!epoll_ctl(l.ep, EPOLL_CTL_ADD, lfd, ev), AG_ERNO_HTTP);
+
+        if (wake >= 0) {
+                ev[0] = (struct epoll_event){.events = EPOLLIN | EPOLLET,
+                    .data.ptr = &l};
+                AG_REQUIRE (!epoll_ctl(l.ep, EPOLL_CTL_ADD, wake, ev),
+                    AG_ERNO_HTTP);
+        }
+
+        for (;;) {
+                if (__atomic_load_n(drain, __ATOMIC_ACQUIRE)) {
+                        if (l.listening) {
+                                (void)epoll_ctl(l.ep, EPOLL_CTL_DEL, lfd, NULL);
+                                l.listening = false;
+                        }
+
+                        for (struct conn *c = l.conns, *n; c; c = n) {
+                                n = c->next;
+
+                                if (loop_idle(c))
+                                        loop_close(&l, c);
+                        }
+
+                        if (!l.conns)
+                                break;
+                }
+
+                int n = epoll_wait(l.ep, ev, EVENT_MAX, -1);
+
+                if (AG_UNLIKELY (n < 0)) {
+                        AG_REQUIRE (errno == EINTR, AG_ERNO_HTTP);
+                        continue;
+                }
+
+                for (register int i = 0; i < n; i++) {
+                        struct conn *c = ev[i].data.ptr;
+
+                        if (!c) {
+                                if (l.listening)
+                                        loop_accept(&l);
+
+                                continue;
+                        }
+
+                        if (c == (void *)&l)
+                                continue;
+
+                        bool ok = true;
+
+                        if (ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                                ok = conn_read(c);
+
+                        if (ok)
+                                ok = conn_flush(&l, c);
+
+                        if (!ok)
+                                loop_close(&l, c);
+                }
+        }
+
+        while (l.conns)
+                loop_close(&l, l.conns);
+
+        close(l.ep);
+}
+
+
+/*
+ * Accept the pending connections on the listening socket. A failure other
+ * than running out of pending connections, such as running out of file
+ * descriptors, is logged and leaves the remaining connections for later.
+ */
+static void
+loop_accept(struct loop *l)
+{
+        for (;;) {
+                int fd = accept4(l->lfd, NULL, NULL,
+                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+                if (fd < 0) {
+                        if (errno == EINTR || errno == ECONNABORTED)
+                                continue;
+
+                        if (errno != EAGAIN && errno != EWOULDBLOCK)
+                                ag_log_warning("accept() failed: %s",
+                                    strerror(errno));
+
+                        return;
+                }
+
+                int on = 1;
+                (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+
+                struct conn *c = ag_memblock_new(sizeof *c);
+                c->fd = fd;
+                c->events = EPOLLIN;
+
+                if (l->http)
+                        c->http = http_new(fd);
+
+                struct epoll_event ev = {.events = EPOLLIN, .data.ptr = c};
+
+                if (AG_UNLIKELY (epoll_ctl(l->ep, EPOLL_CTL_ADD, fd, &ev))) {
+                        close(fd);
+
+                        if (c->http)
+                                http_release(c->http);
+
+                        ag_memblock *m = c;
+                        ag_memblock_release(&m);
+                        continue;
+                }
+
+                if ((c->next = l->conns))
+                        c->next->prev = c;
+
+                l->conns = c;
+        }
+}
+
+
+static void
+loop_close(struct loop *l, struct conn *c)
+{
+        if (c->prev)
+                c->prev->next = c->next;
+        else
+                l->conns = c->next;
+
+        if (c->next)
+                c->next->prev = c->prev;
+
+        while (c->reqs)
+                req_release(c, c->reqs);
+
+        if (c->http)
+                http_release(c->http);
+
+        close(c->fd);
+        buf_release(&c->in);
+        buf_release(&c->out);
+
+        ag_memblock *m = c;
+        ag_memblock_release(&m);
+}
+
+
+/*
+ * Check whether a connection can be closed while the worker is being drained.
+ * A FastCGI connection can be once it has no request in progress, no partially
+ * received record and no unwritten output. An HTTP connection only needs to
+ * have written all its output, since every complete request that it has
+ * received has then been answered; a partially received request is dropped,
+ * as otherwise a client could hold up the drain for as long as it likes by
+ * never finishing it.
+ */
+static inline bool
+loop_idle(const struct conn *c)
+{
+        return c->sent == c->out.len && (c->http || (!c->reqs && !c->in.len));
+}
+
+
+/*
+ * Check whether a connection has more unwritten output than it may buffer.
+ */
+static inline bool
+conn_full(const struct conn *c)
+{
+        return c->out.len - c->sent > OUT_MAX;
+}
+
+
+/*
+ * Parse as much of the input of a connection as possible, compacting the
+ * unparsed remainder to the start of the input buffer, and read more while
+ * some is available. Reading stops once the connection is to be closed, and
+ * is stalled once its output is full until conn_flush() resumes it. The peer
+ * shutting down its side of the connection closes it after the responses to
+ * its complete requests have been written. Returns false if the connection has
+ * failed or has sent malformed FastCGI records.
+ */
+static bool
+conn_read(struct conn *c)
+{
+        for (;;) {
+                ssize_t used = c->http ? http_parse(c) : fcgi_parse(c);
+
+                if (used < 0)
+                        return false;
+
+                c->in.len -= used;
+                memmove(c->in.data, c->in.data + used, c->in.len);
+
+                if (c->close || (c->stall = conn_full(c)))
+                        return true;
+
+                buf_reserve(&c->in, READ_CHUNK);
+
+                ssize_t n = read(c->fd, c->in.data + c->in.len,
+                    c->in.cap - c->in.len);
+
+                if (n < 0 && errno == EINTR)
+                        continue;
+
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                        return true;
+
+                if (n < 0)
+                        return false;
+
+                if (!n) {
+                        c->close = true;
+                        return true;
+                }
+
+                c->in.len += n;
+        }
+}
+
+
+/*
+ * Write as much of the pending output of a connection as the socket accepts,
+ * resuming a stalled read once enough of it has been written. Returns false if
+ * the connection failed, or if it is to be closed and all its output has been
+ * written.
+ */
+static bool
+conn_flush(struct loop *l, struct conn *c)
+{
+        for (;;) {
+                while (c->sent < c->out.len) {
+                        ssize_t n = send(c->fd, c->out.data + c->sent,
+                            c->out.len - c->sent, MSG_NOSIGNAL);
+
+                        if (n > 0) {
+                                c->sent += n;
+                                continue;
+                        }
+
+                        if (n < 0 && errno == EINTR)
+                                continue;
+
+                        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                                break;
+
+                        return false;
+                }
+
+                if (c->sent == c->out.len)
+                        c->out.len = c->sent = 0;
+
+                if (!c->stall || conn_full(c))
+                        break;
+
+                c->stall = false;
+
+                if (!conn_read(c))
+                        return false;
+        }
+
+        if (c->close && !c->out.len)
+                return false;
+
+        return conn_watch(l, c);
+}
+
+
+/*
+ * Watch a connection for input unless it is to be closed or its reading is
+ * stalled, and for the socket becoming writable only while output remains.
+ * Returns false if the events can't be changed.
+ */
+static bool
+conn_watch(struct loop *l, struct conn *c)
+{
+        uint32_t events = (c->close || c->stall ? 0 : EPOLLIN)
+            | (c->out.len ? EPOLLOUT : 0);
+
+        if (events != c->events) {
+                struct epoll_event ev = {.events = events, .data.ptr = c};
+
+                if (epoll_ctl(l->ep, EPOLL_CTL_MOD, c->fd, &ev))
+                        return false;
+
+                c->events = events;
+        }
+
+        return true;
+}
+
+
+/*
+ * Handle every complete FastCGI record in the input buffer of a connection,
+ * stopping early if the connection is to be closed or its output is full.
+ * Returns the number of bytes handled, or -1 if a record is malformed.
+ */
+static ssize_t
+fcgi_parse(struct conn *c)
+{
+        const unsigned char *p = (unsigned char *)c->in.data;
+        const unsigned char *end = p + c->in.len;
+
+        while (!c->close && !conn_full(c) && end - p >= FCGI_HEADER_LEN) {
+                size_t clen = (size_t)p[4] << 8 | p[5];
+                size_t total = FCGI_HEADER_LEN + clen + p[6];
+
+                if (AG_UNLIKELY (p[0] != FCGI_VERSION))
+                        return -1;
+
+                if ((size_t)(end - p) < total)
+                        break;
+
+                uint16_t id = p[2] << 8 | p[3];
+
+                if (!record_handle(c, p[1], id,
+                    (const char *)p + FCGI_HEADER_LEN, clen))
+                        return -1;
+
+                p += total;
+        }
+
+        return p - (unsigned char *)c->in.data;
+}
+
+
+/*
+ * Handle a record received on a connection. Management records, which have
+ * a request ID of 0, are answered immediately; records of an unknown request
+ * ID are ignored, as the specification requires, as are the FCGI_DATA records
+ * of the filter role, which we do not support. Returns false if the record is
+ * malformed.
+ */
+static bool
+record_handle(struct conn *c, int type, uint16_t id, const char *body,
+    size_t len)
+{
+        if (!id) {
+                if (type == FCGI_GET_VALUES)
+                        record_values(c, body, len);
+                else {
+                        unsigned char b[8] = {type};
+                        record_put(c, FCGI_UNKNOWN_TYPE, 0, b, sizeof b);
+                }
+
+                return true;
+        }
+
+        if (type == FCGI_BEGIN_REQUEST) {
+                if (AG_UNLIKELY (len < 8))
+                        return false;
+
+                const unsigned char *b = (const unsigned char *)body;
+
+                if ((b[0] << 8 | b[1]) != FCGI_RESPONDER)
+                        record_end(c, id, FCGI_UNKNOWN_ROLE);
+                else if (!req_find(c, id))
+                        (void)req_new(c, id, b[2] & FCGI_KEEP_CONN);
+
+                return true;
+        }
+
+        struct req *r = req_find(c, id);
+
+        if (!r)
+                return true;
+
+        switch (type) {
+        case FCGI_ABORT_REQUEST:
+                c->close |= !r->keep;
+                req_release(c, r);
+                record_end(c, id, FCGI_REQUEST_COMPLETE);
+                break;
+
+        case FCGI_PARAMS:
+                if (r->ready)
+                        break;
+
+                if (len)
+                        buf_put(&r->params, body, len);
+                else if (!(r->ready = req_parse(r)))
+                        return false;
+
+                break;
+
+        case FCGI_STDIN:
+                if (len)
+                        buf_put(&r->body, body, len);
+                else if (r->ready)
+                        req_run(c, r);
+                else
+                        return false;
+
+                break;
+
+        default:
+                break;
+        }
+
+        return true;
+}
+
+
+/*
+ * Append a record of a given type to the output of a connection, split into
+ * as many records as needed to respect the maximum content length. An empty
+ * content is written as a single empty record, which ends a stream.
+ */
+static void
+record_put(struct conn *c, int type, uint16_t id, const void *data,
+    size_t len)
+{
+        const char *p = data;
+
+        do {
+                size_t n = len < FCGI_CONTENT_MAX ? len : FCGI_CONTENT_MAX;
+                unsigned char h[FCGI_HEADER_LEN] = {FCGI_VERSION, type,
+                    id >> 8, id & 0xff, n >> 8, n & 0xff, 0, 0};
+
+                buf_reserve(&c->out, sizeof h + n);
+                buf_put(&c->out, h, sizeof h);
+                buf_put(&c->out, p, n);
+
+                p += n;
+                len -= n;
+        } while (len);
+}
+
+
+static void
+record_end(struct conn *c, uint16_t id, int status)
+{
+        unsigned char b[8] = {0, 0, 0, 0, status};
+        record_put(c, FCGI_END_REQUEST, id, b, sizeof b);
+}
+
+
+/*
+ * Answer an FCGI_GET_VALUES query with the values of the variables that we
+ * know of among those queried. FCGI_MPXS_CONNS is always 1, and since the
+ * number of connections and requests is bounded only by the file descriptor
+ * limit, we report a generous limit for the other two.
+ */
+static void
+record_values(struct conn *c, const char *body, size_t len)
+{
+        static const char *var[][2] = {
+                {"FCGI_MAX_CONNS", "1024"},
+                {"FCGI_MAX_REQS", "1024"},
+                {"FCGI_MPXS_CONNS", "1"},
+        };
+
+        const unsigned char *p = (const unsigned char *)body;
+        const unsigned char *end = p + len;
+        struct buf out = {0};
+        size_t klen, vlen;
+
+        while (nv_len(&p, end, &klen) && nv_len(&p, end, &vlen)
+            && (size_t)(end - p) >= klen + vlen) {
+                for (register size_t i = 0; i < 3; i++) {
+                        size_t n = strlen(var[i][0]);
+                        unsigned char v = strlen(var[i][1]);
+
+                        if (n == klen && !memcmp(p, var[i][0], n)) {
+                                unsigned char k = n;
+
+                                buf_put(&out, &k, 1);
+                                buf_put(&out, &v, 1);
+                                buf_put(&out, var[i][0], n);
+                                buf_put(&out, var[i][1], v);
+                        }
+                }
+
+                p += klen + vlen;
+        }
+
+        record_put(c, FCGI_GET_VALUES_RESULT, 0, out.data, out.len);
+        buf_release(&out);
+}
+
+
+/*
+ * Decode the length of a name or value of a name-value pair, which is encoded
+ * in one byte if it is less than 128, and otherwise in four bytes with the
+ * high bit set.
+ */
+static bool
+nv_len(const unsigned char **p, const unsigned char *end, size_t *len)
+{
+        const unsigned char *b = *p;
+
+        if (b < end && !(*b & 0x80)) {
+                *len = *b;
+                *p = b + 1;
+                return true;
+        }
+
+        if (end - b < 4)
+                return false;
+
+        *len = (size_t)(b[0] & 0x7f) << 24 | (size_t)b[1] << 16
+            | (size_t)b[2] << 8 | b[3];
+        *p = b + 4;
+
+        return true;
+}
+
+
+static struct req *
+req_new(struct conn *c, uint16_t id, bool keep)
+{
+        struct req *r = ag_memblock_new(sizeof *r);
+
+        r->conn = c;
+        r->id = id;
+        r->keep = keep;
+        r->next = c->reqs;
+        c->reqs = r;
+
+        return r;
+}
+
+
+static struct req *
+req_find(struct conn *c, uint16_t id)
+{
+        register struct req *r = c->reqs;
+
+        while (r && r->id != id)
+                r = r->next;
+
+        return r;
+}
+
+
+static void
+req_release(struct conn *c, struct req *r)
+{
+        register struct req **p = &c->reqs;
+
+        while (*p != r)
+                p = &(*p)->next;
+
+        *p = r->next;
+
+        buf_release(&r->params);
+        buf_release(&r->body);
+
+        ag_memblock *m = r->kv;
+        ag_memblock_release(&m);
+        m = r;
+        ag_memblock_release(&m);
+}
+
+
+/*
+ * Split the complete params stream of a request into params. The keys and
+ * values are left in place in the params buffer; each value is terminated by
+ * overwriting the first length byte of the next pair, which has already been
+ * decoded by then, or the spare byte reserved at the end of the buffer for the
+ * last value. Returns false if the stream is malformed.
+ */
+static bool
+req_parse(struct req *r)
+{
+        buf_reserve(&r->params, 1);
+
+        const unsigned char *p = (unsigned char *)r->params.data;
+        const unsigned char *end = p + r->params.len;
+        size_t cap = 0;
+
+        while (p < end) {
+                size_t klen, vlen;
+
+                if (!nv_len(&p, end, &klen) || !nv_len(&p, end, &vlen)
+                    || (size_t)(end - p) < klen + vlen)
+                        return false;
+
+                if (r->nkv == cap) {
+                        cap = cap ? cap << 1 : 32;
+                        ag_memblock *m = r->kv;
+
+                        if (m)
+                                ag_memblock_resize(&m, cap * sizeof *r->kv);
+                        else
+                                m = ag_memblock_new(cap * sizeof *r->kv);
+
+                        r->kv = m;
+                }
+
+                r->kv[r->nkv++] = (struct param){.key = (const char *)p,
+                    .klen = klen, .val = (char *)p + klen, .vlen = vlen};
+                p += klen + vlen;
+        }
+
+        for (register size_t i = 0; i < r->nkv; i++)
+                r->kv[i].val[r->kv[i].vlen] = '\0';
+
+        return true;
+}
+
+
+/*
+ * Serve a request whose params and stdin streams are complete, end its stdout
+ * stream and the request itself, and release it. The connection is closed
+ * once its output has been written unless the web server asked for it to be
+ * kept open.
+ */
+static void
+req_run(struct conn *c, struct req *r)
+{
+        static const struct ag_http_server_io io = {
+                .param = fcgi_param,
+                .body = fcgi_body,
+                .write = fcgi_write,
+        };
+
+        __ag_http_server_serve__(&io, r);
+
+        record_put(c, FCGI_STDOUT, r->id, NULL, 0);
+        record_end(c, r->id, FCGI_REQUEST_COMPLETE);
+
+        c->close |= !r->keep;
+        req_release(c, r);
+}
+
+
+static const char *
+fcgi_param(void *ctx, const char *key)
+{
+        const struct req *r = ctx;
+        size_t len = strlen(key);
+
+        for (register size_t i = 0; i < r->nkv; i++) {
+                const struct param *p = &r->kv[i];
+
+                if (p->klen == len && !memcmp(p->key, key, len))
+                        return p->val;
+        }
+
+        return NULL;
+}
+
+
+static const char *
+fcgi_body(void *ctx)
+{
+        struct req *r = ctx;
+
+        buf_reserve(&r->body, 1);
+        r->body.data[r->body.len] = '\0';
+
+        return r->body.data;
+}
+
+
+static void
+fcgi_write(void *ctx, const char *data, size_t len)
+{
+        struct req *r = ctx;
+
+        if (len)
+                record_put(r->conn, FCGI_STDOUT, r->id, data, len);
+}
+
+
+static struct http *
+http_new(int fd)
+{
+        struct http *h = ag_memblock_new(sizeof *h);
+        struct sockaddr_storage sa;
+        socklen_t len = sizeof sa;
+
+        strcpy(h->rport, "0");
+        strcpy(h->lport, "0");
+
+        if (!getpeername(fd, (struct sockaddr *)&sa, &len))
+                http_addr(&sa, h->raddr, h->rport);
+
+        len = sizeof sa;
+
+        if (!getsockname(fd, (struct sockaddr *)&sa, &len))
+                http_addr(&sa, h->laddr, h->lport);
+
+        return h;
+}
+
+
+static void
+http_release(struct http *h)
+{
+        buf_release(&h->resp);
+        buf_release(&h->hdr);
+
+        ag_memblock *m = h->fld;
+        ag_memblock_release(&m);
+        m = h;
+        ag_memblock_release(&m);
+}
+
+
+/*
+ * Format the address and port of an IPv4 or IPv6 socket address, leaving
+ * them as they are for any other kind of address, such as that of a UNIX
+ * socket.
+ */
+static void
+http_addr(const struct sockaddr_storage *sa, char *addr, char *port)
+{
+        if (sa->ss_family == AF_INET) {
+                const struct sockaddr_in *in = (const void *)sa;
+
+                (void)inet_ntop(AF_INET, &in->sin_addr, addr,
+                    INET6_ADDRSTRLEN);
+                (void)snprintf(port, 8, "%u", ntohs(in->sin_port));
+        } else if (sa->ss_family == AF_INET6) {
+                const struct sockaddr_in6 *in = (const void *)sa;
+
+                (void)inet_ntop(AF_INET6, &in->sin6_addr, addr,
+                    INET6_ADDRSTRLEN);
+                (void)snprintf(port, 8, "%u", ntohs(in->sin6_port));
+        }
+}
+
+
+/*
+ * Serve every complete HTTP request in the input buffer of a connection, in
+ * order, stopping early if the connection is to be closed or its output is
+ * full. The end of the head of the first incomplete request is searched for
+ * only in the input that has arrived since the last search, and its head is
+ * parsed as soon as it is complete, so that a request arriving in pieces is not
+ * parsed repeatedly and that a client expecting 100 (Continue) is answered
+ * before it sends the body. Malformed or oversized requests are answered with
+ * an error, after which the connection is closed. Returns the number of bytes
+ * consumed.
+ */
+static ssize_t
+http_parse(struct conn *c)
+{
+        struct http *h = c->http;
+        size_t off = 0;
+
+        buf_reserve(&c->in, 1);
+
+        while (!c->close && !conn_full(c)) {
+                char *base = c->in.data + off;
+                size_t len = c->in.len - off;
+
+                if (!h->head) {
+                        if (!h->scan && len >= 2 && !memcmp(base, "\r\n", 2)) {
+                                off += 2;
+                                continue;
+                        }
+
+                        size_t from = h->scan > 3 ? h->scan - 3 : 0;
+                        char *e = memmem(base + from, len - from, "\r\n\r\n",
+                            4);
+
+                        h->scan = len;
+
+                        if (!e) {
+                                if (len > HTTP_HEAD_MAX)
+                                        http_error(c, 431);
+
+                                break;
+                        }
+
+                        h->head = e + 4 - base;
+                        h->base = base;
+
+                        int status = h->head > HTTP_HEAD_MAX ? 431
+                            : http_head(h);
+
+                        if (status) {
+                                http_error(c, status);
+                                break;
+                        }
+
+                        if (h->cont && len < h->head + h->clen)
+                                http_send(c, "HTTP/1.1 100 Continue\r\n\r\n",
+                                    25, NULL, 0);
+                }
+
+                if (len < h->head + h->clen)
+                        break;
+
+                h->base = base;
+                http_run(c);
+
+                off += h->head + h->clen;
+                h->scan = h->head = h->clen = h->nfld = 0;
+        }
+
+        return off;
+}
+
+
+/*
+ * Compare the name of a header field with the name of a CGI variable without
+ * its HTTP_ prefix, ignoring case and treating '-' in the field name as '_'.
+ */
+static inline bool
+field_is(const char *name, size_t len, const char *var)
+{
+        for (register size_t i = 0; i < len; i++) {
+                register int ch = name[i] == '-' ? '_'
+                    : toupper((unsigned char)name[i]);
+
+                if (ch != var[i])
+                        return false;
+        }
+
+        return !var[len];
+}
+
+
+/*
+ * Parse the head of the HTTP request at h->base, terminating the parts of the
+ * request line and the values of the header fields in place. Returns 0 if the
+ * head is valid, or otherwise the status with which to answer the request.
+ * A body is only accepted with a Content-Length; a chunked body is answered
+ * with 501, as is allowed for a transfer coding that we do not implement.
+ */
+static int
+http_head(struct http *h)
+{
+        char *base = h->base;
+        char *last = base + h->head - 2;
+        char *eol = memchr(base, '\r', last - base);
+        char *sp = memchr(base, ' ', eol - base);
+        char *sp2 = sp ? memchr(sp + 1, ' ', eol - sp - 1) : NULL;
+
+        if (!sp || sp == base || !sp2 || sp2 == sp + 1 || eol[1] != '\n')
+                return 400;
+
+        if (eol - sp2 != 9 || memcmp(sp2 + 1, "HTTP/1.", 7))
+                return 400;
+
+        if (sp2[8] != '0' && sp2[8] != '1')
+                return 505;
+
+        char *q = memchr(sp + 1, '?', sp2 - sp - 1);
+
+        h->keep = sp2[8] == '1';
+        h->cont = false;
+        h->target = sp + 1 - base;
+        h->query = (q ? q + 1 : sp2) - base;
+        h->proto = sp2 + 1 - base;
+        *sp = *sp2 = *eol = '\0';
+
+        bool clen = false;
+
+        for (char *p = eol + 2; p < last; p = eol + 2) {
+                eol = memchr(p, '\r', last - p);
+                char *colon = memchr(p, ':', eol - p);
+
+                if (eol[1] != '\n' || !colon || colon == p
+                    || memchr(p, ' ', colon - p) || memchr(p, '\t', colon - p))
+                        return 400;
+
+                char *v = colon + 1;
+                char *e = eol;
+
+                while (*v == ' ' || *v == '\t')
+                        v++;
+
+                while (e > v && (e[-1] == ' ' || e[-1] == '\t'))
+                        e--;
+
+                *e = '\0';
+
+                size_t klen = colon - p;
+
+                if (field_is(p, klen, "CONTENT_LENGTH")) {
+                        char *end;
+                        unsigned long n = strtoul(v, &end, 10);
+
+                        if (clen || !*v || *end || *v == '-' || *v == '+')
+                                return 400;
+
+                        if (n > HTTP_BODY_MAX)
+                                return 413;
+
+                        h->clen = n;
+                        clen = true;
+                } else if (field_is(p, klen, "TRANSFER_ENCODING"))
+                        return 501;
+                else if (field_is(p, klen, "CONNECTION")) {
+                        if (strcasestr(v, "close"))
+                                h->keep = false;
+                        else if (strcasestr(v, "keep-alive"))
+                                h->keep = true;
+                } else if (field_is(p, klen, "EXPECT"))
+                        h->cont = !strcasecmp(v, "100-continue");
+
+                if (h->nfld == h->cap) {
+                        h->cap = h->cap ? h->cap << 1 : 16;
+                        ag_memblock *m = h->fld;
+
+                        if (m)
+                                ag_memblock_resize(&m, h->cap * sizeof *h->fld);
+                        else
+                                m = ag_memblock_new(h->cap * sizeof *h->fld);
+
+                        h->fld = m;
+                }
+
+                h->fld[h->nfld++] = (struct field){.key = p - base,
+                    .klen = klen, .val = v - base};
+        }
+
+        return 0;
+}
+
+
+/*
+ * Serve the complete request at h->base. Only the methods that the handler
+ * API can represent are served, and others are answered with 501; a request
+ * with a content type that the server cannot parse is likewise answered with
+ * 415 rather than handed on to raise an exception. The byte following the
+ * body, which may belong to the next pipelined request, is saved and
+ * overwritten for the duration of the handler so that the body can be handed
+ * out in place as a C string.
+ */
+static void
+http_run(struct conn *c)
+{
+        static const struct ag_http_server_io io = {
+                .param = http_param,
+                .body = http_body,
+                .write = http_write,
+        };
+
+        static const char *meth[] = {"GET", "POST", "PUT", "PATCH", "DELETE"};
+
+        struct http *h = c->http;
+        char *base = h->base;
+        register size_t i = 0;
+
+        while (i < 5 && strcmp(base, meth[i]))
+                i++;
+
+        if (i == 5) {
+                http_error(c, 501);
+                return;
+        }
+
+        const char *ct = http_field(h, "CONTENT_TYPE");
+        const char *cl = http_field(h, "CONTENT_LENGTH");
+
+        if (ct)
+                ((char *)ct)[strcspn(ct, "; \t")] = '\0';
+
+        if (ct && *ct && !__ag_http_mime_known__(ct)) {
+                http_error(c, 415);
+                return;
+        }
+
+        http_host(h);
+
+        h->var[0] = base;
+        h->var[1] = base + h->target;
+        h->var[2] = base + h->query;
+        h->var[3] = base + h->proto;
+        h->var[4] = ct ? ct : "";
+        h->var[5] = cl ? cl : "";
+        h->var[6] = *h->host ? h->host : *h->laddr ? h->laddr : "localhost";
+        h->var[7] = *h->host ? h->hport : h->lport;
+        h->var[8] = h->raddr;
+        h->var[9] = h->rport;
+        h->var[10] = "CGI/1.1";
+        h->var[11] = "Argent";
+
+        char *end = base + h->head + h->clen;
+        char save = *end;
+
+        *end = '\0';
+        h->resp.len = 0;
+
+        __ag_http_server_serve__(&io, c);
+
+        *end = save;
+        http_reply(c);
+}
+
+
+/*
+ * Split the Host header field of the request being served into the server
+ * name and port. The port is taken as 0, and so left out of the URL of the
+ * request, if the field has none or an invalid one; the server name is left
+ * empty if the field is missing or too long, so that the local address of the
+ * connection is used instead.
+ */
+static void
+http_host(struct http *h)
+{
+        const char *host = http_field(h, "HOST");
+        size_t n = 0;
+
+        *h->host = '\0';
+        strcpy(h->hport, "0");
+
+        if (!host || !*host)
+                return;
+
+        if (*host == '[') {
+                const char *e = strchr(host, ']');
+                n = e ? (size_t)(e - host + 1) : 0;
+        } else
+                n = strcspn(host, ":");
+
+        if (!n || n >= sizeof h->host)
+                return;
+
+        memcpy(h->host, host, n);
+        h->host[n] = '\0';
+
+        if (host[n] == ':') {
+                char *e;
+                unsigned long port = strtoul(host + n + 1, &e, 10);
+
+                if (!*e && port && port <= 65535)
+                        (void)snprintf(h->hport, sizeof h->hport, "%lu", port);
+        }
+}
+
+
+/*
+ * Send the response of the handler to the request being served, replacing its
+ * CGI header fields with an HTTP/1.1 status line taken from the Status field,
+ * or 200 (OK) without one, and the remaining fields, followed by the length
+ * of the body and whether the connection is kept alive.
+ */
+static void
+http_reply(struct conn *c)
+{
+        struct http *h = c->http;
+        const char *p = h->resp.len ? h->resp.data : "";
+        const char *sep = memmem(p, h->resp.len, "\r\n\r\n", 4);
+        const char *body = sep ? sep + 4 : p;
+        size_t blen = h->resp.len - (body - p);
+        const char *status = NULL;
+        char bfr[128];
+
+        for (const char *l = p; sep && l <= sep;
+            l = (char *)memmem(l, sep + 2 - l, "\r\n", 2) + 2) {
+                if (!strncasecmp(l, "Status:", 7)) {
+                        status = l + 7;
+                        break;
+                }
+        }
+
+        h->hdr.len = 0;
+        buf_put(&h->hdr, "HTTP/1.1 ", 9);
+
+        if (status) {
+                while (*status == ' ')
+                        status++;
+
+                for (; *status != '\r'; status++) {
+                        if (*status != '(' && *status != ')')
+                                buf_put(&h->hdr, status, 1);
+                }
+        } else
+                buf_put(&h->hdr, "200 OK", 6);
+
+        buf_put(&h->hdr, "\r\n", 2);
+
+        for (const char *l = p, *e; sep && l <= sep; l = e) {
+                e = (char *)memmem(l, sep + 2 - l, "\r\n", 2) + 2;
+
+                if (e - l > 2 && strncasecmp(l, "Status:", 7))
+                        buf_put(&h->hdr, l, e - l);
+        }
+
+        const char *conn = !h->keep ? "Connection: close\r\n"
+            : h->base[h->proto + 7] == '0' ? "Connection: keep-alive\r\n"
+            : "";
+        int n = snprintf(bfr, sizeof bfr, "Content-Length: %zu\r\n%s\r\n",
+            blen, conn);
+
+        buf_put(&h->hdr, bfr, n);
+        http_send(c, h->hdr.data, h->hdr.len, body, blen);
+
+        c->close |= !h->keep;
+}
+
+
+/*
+ * Answer the request being parsed with an error status and an empty body,
+ * and close the connection once the answer has been written.
+ */
+static void
+http_error(struct conn *c, int status)
+{
+        const char *reason = "Bad Request";
+        char bfr[128];
+
+        switch (status) {
+        case 413:
+                reason = "Content Too Large";
+                break;
+        case 415:
+                reason = "Unsupported Media Type";
+                break;
+        case 431:
+                reason = "Request Header Fields Too Large";
+                break;
+        case 501:
+                reason = "Not Implemented";
+                break;
+        case 505:
+                reason = "HTTP Version Not Supported";
+                break;
+        }
+
+        int n = snprintf(bfr, sizeof bfr, "HTTP/1.1 %d %s\r\nContent-Length: 0"
+            "\r\nConnection: close\r\n\r\n", status, reason);
+
+        http_send(c, bfr, n, NULL, 0);
+        c->close = true;
+}
+
+
+/*
+ * Send the head and body of a response. If no earlier output is pending on
+ * the connection, both are written straight from where they lie with a single
+ * gathering write, and only what the socket does not accept is copied to the
+ * output buffer; otherwise both are queued behind the pending output so that
+ * pipelined responses keep their order. sendmsg() stands in for writev() so
+ * that a client that has gone away raises EPIPE rather than SIGPIPE.
+ */
+static void
+http_send(struct conn *c, const char *hdr, size_t hlen, const char *body,
+    size_t blen)
+{
+        size_t n = 0;
+
+        if (c->sent == c->out.len) {
+                struct iovec iov[2] = {
+                        {.iov_base = (void *)hdr, .iov_len = hlen},
+                        {.iov_base = (void *)body, .iov_len = blen},
+                };
+                struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 2};
+                ssize_t rc;
+
+                do
+                        rc = sendmsg(c->fd, &msg, MSG_NOSIGNAL);
+                while (rc < 0 && errno == EINTR);
+
+                n = rc > 0 ? rc : 0;
+        }
+
+        if (n < hlen) {
+                buf_put(&c->out, hdr + n, hlen - n);
+                n = hlen;
+        }
+
+        if (blen > n - hlen)
+                buf_put(&c->out, body + (n - hlen), blen - (n - hlen));
+}
+
+
+/*
+ * Get the value of a header field of the request being served, given its name
+ * as a CGI variable without the HTTP_ prefix.
+ */
+static const char *
+http_field(const struct http *h, const char *var)
+{
+        for (register size_t i = 0; i < h->nfld; i++) {
+                const struct field *f = &h->fld[i];
+
+                if (field_is(h->base + f->key, f->klen, var))
+                        return h->base + f->val;
+        }
+
+        return NULL;
+}
+
+
+static const char *
+http_param(void *ctx, const char *key)
+{
+        const struct http *h = ((struct conn *)ctx)->http;
+
+        if (!strncmp(key, "HTTP_", 5))
+                return http_field(h, key + 5);
+
+        for (register size_t i = 0; i < VAR_COUNT; i++) {
+                if (!strcmp(key, g_var[i]))
+                        return h->var[i];
+        }
+
+        return NULL;
+}
+
+
+static const char *
+http_body(void *ctx)
+{
+        const struct http *h = ((struct conn *)ctx)->http;
+        return h->base + h->head;
+}
+
+
+static void
+http_write(void *ctx, const char *data, size_t len)
+{
+        struct http *h = ((struct conn *)ctx)->http;
+        buf_put(&h->resp, data, len);
+}
+
+
+static void
+buf_reserve(struct buf *b, size_t len)
+{
+        if (b->len + len <= b->cap)
+                return;
+
+        size_t cap = b->cap ? b->cap : BUF_MIN;
+
+        while (cap < b->len + len)
+                cap <<= 1;
+
+        ag_memblock *m = b->data;
+
+        if (m)
+                ag_memblock_resize(&m, cap);
+        else
+                m = ag_memblock_new(cap);
+
+        b->data = m;
+        b->cap = cap;
+}
+
+
+static void
+buf_put(struct buf *b, const void *data, size_t len)
+{
+        if (AG_UNLIKELY (!len))
+                return;
+
+        buf_reserve(b, len);
+        memcpy(b->data + b->len, data, len);
+        b->len += len;
+}
+
+
+static void
+buf_release(struct buf *b)
+{
+        ag_memblock *m = b->data;
+        ag_memblock_release(&m);
+
+        *b = (struct buf){0};
+}
@@ -25,6 +25,8 @@
 
 #include "../argent.h"
 
+#include <strings.h>
+
 
 
 
@@ -175,6 +177,28 @@ ag_http_mime_parse(const char *str)
 
 
 
+/*******************************************************************************
+ * The __ag_http_mime_known__() protected function checks whether a given string
+ * names one of the MIME types in g_mime, ignoring case. Unlike
+ * ag_http_mime_parse(), it does not raise an exception for an unknown string,
+ * so that the server engine can reject such a request rather than exit.
+ */
+
+extern bool
+__ag_http_mime_known__(const char *str)
+{
+        AG_ASSERT_PTR (str);
+
+        for (register int i = 0; i <= AG_HTTP_MIME_TEXT_XML; i++)
+                if (!strcasecmp(str, g_mime[i]))
+                        return true;
+
+        return false;
+}
+
+
+
+
 /*******************************************************************************
  * The ag_http_mime_str() interface function returns the string representation
  * of a given ag_http_mime enumerator. We simply return the string contained in
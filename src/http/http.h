@@ -287,12 +287,20 @@ extern ag_string        *ag_http_client_referer(const ag_http_client *);
  *   3. The HTTP client
  *   4. The HTTP URL
  *   5. The HTTP body key-value parameters
+ *   6. The captures of the route that the request was served through
  *
  * There is only one manager function, ag_http_request_new(), and the remaining
  * functions declared below are all accessors. Since the ag_http_request object
  * has been declared through the AG_OBJECT_DECLARE() macro, its inherited object
  * methods are metaprogrammatically declared.
  *
+ * ag_http_request_capture() gets the value of a :name or *name capture of the
+ * route pattern that matched the request, given its name, or NULL if there is
+ * no such capture. The value is not copied: it is a slice of the URL path of
+ * the request, which is not NUL-terminated and whose length is returned
+ * through the last parameter, and which is valid for as long as the request.
+ * Captures are not packed along with the request.
+ *
  * See the following files for more details:
  *   - include/typeid.h
  *   - include/object.h
@@ -313,6 +321,9 @@ extern ag_http_client           *ag_http_request_client(
                                     const ag_http_request *);
 extern ag_http_url              *ag_http_request_url(const ag_http_request *);
 extern ag_alist                 *ag_http_request_param(const ag_http_request *);
+extern const char               *ag_http_request_capture(
+                                    const ag_http_request *, const char *,
+                                    size_t *);
 
 
 /**
@@ -360,21 +371,139 @@ extern void             ag_http_response_flush(ag_http_response **);
 /**
  * HTTP server
  * TODO: Add description
+ *
+ * The server is configured through the ag_http_server_opt struct passed to
+ * ag_http_server_init(); passing NULL selects the defaults. The threads field
+ * sets the number of worker threads that serve requests concurrently, each
+ * with its own FastCGI request, environment and ag_http_request; 0 is treated
+ * as 1. ag_http_server_env() and ag_http_server_request() return the state of
+ * the request being served by the calling thread, and handlers are shared by
+ * all threads.
+ *
+ * Handlers are registered against route patterns, for any method through
+ * ag_http_server_register() or for a given one through
+ * ag_http_server_register_method(), which takes precedence. A segment of a
+ * pattern of the form :name captures a segment of the request path, and a last
+ * segment of the form *name captures the rest of it, with static segments
+ * taking precedence over captures; the captures are then available through
+ * ag_http_request_capture(). A request whose path matches no route is answered
+ * with 404, and one whose path matches a route without a handler for its
+ * method with 405.
+ *
+ * By default the server accepts requests on the socket inherited as fd 0 from
+ * a process manager such as spawn-fcgi. Setting the listen field to a UNIX
+ * socket path or a "host:port" or ":port" TCP address makes the server open
+ * the socket itself, with a listen queue of backlog connections (128 if 0),
+ * when ag_http_server_run() is called. Setting the procs field to a non-zero
+ * value enables the pre-fork mode, in which ag_http_server_run() forks procs
+ * worker processes that share the socket and the handlers registered so far,
+ * and supervises them: crashed workers are restarted, and on SIGTERM or SIGINT
+ * the workers finish the requests they are serving before exiting, after which
+ * ag_http_server_run() returns.
+ *
+ * The backend field selects how the FastCGI protocol is spoken. The default
+ * AG_HTTP_SERVER_LIBFCGI backend serves one request at a time per worker
+ * thread through libfcgi's blocking FCGX_Accept_r() loop. The native
+ * AG_HTTP_SERVER_FASTCGI backend parses and writes FastCGI records itself over
+ * non-blocking sockets, with an epoll loop per worker thread that serves any
+ * number of connections, each of which may carry multiplexed requests and be
+ * kept open across requests with FCGI_KEEP_CONN. Its params are looked up in
+ * place in the received params stream instead of being copied into an
+ * environment array. The AG_HTTP_SERVER_HTTP backend does away with the web
+ * server in front and serves HTTP/1.1 clients directly, with keep-alive and
+ * pipelining, filling the same CGI environment from the request line and
+ * header fields so that handlers cannot tell the backends apart; it is meant
+ * to be given a TCP listen address. In every case handlers run on the worker
+ * thread, one request at a time.
  **/
 
+enum ag_http_server_backend {
+        AG_HTTP_SERVER_LIBFCGI,
+        AG_HTTP_SERVER_FASTCGI,
+        AG_HTTP_SERVER_HTTP,
+};
+
+struct ag_http_server_opt {
+        size_t                           threads;  /* threads per process */
+        size_t                           procs;    /* pre-fork processes  */
+        const char                      *listen;   /* listen address      */
+        int                              backlog;  /* listen queue length */
+        enum ag_http_server_backend      backend;  /* FastCGI backend     */
+};
+
 typedef void (ag_http_handler)(const ag_http_request *);
 
-extern void     ag_http_server_init(void);
+extern void     ag_http_server_init(const struct ag_http_server_opt *);
 extern void     ag_http_server_exit(void);
 
 extern const struct ag_http_env *ag_http_server_env(void);
 extern const ag_http_request    *ag_http_server_request(void);
 
 extern void     ag_http_server_register(const char *, const ag_plugin *);
+extern void     ag_http_server_register_method(enum ag_http_method,
+                    const char *, const ag_plugin *);
 extern void     ag_http_server_respond(const ag_http_response *);
 extern void     ag_http_server_run(void);
 
 
+/*
+ * The server backends hand each request to the server through
+ * __ag_http_server_serve__(), along with the functions that look up a param
+ * of the request, return its body as a C string, and write to its response.
+ * These, like the backend entry points, are protected: they have external
+ * linkage only so that the backends can live in their own files, and are not
+ * part of the interface. __ag_http_mime_known__() lets a backend turn away a
+ * request with a content type that ag_http_mime_parse() would reject.
+ */
+struct ag_http_server_io {
+        const char      *(*param)(void *, const char *);
+        const char      *(*body)(void *);
+        void             (*write)(void *, const char *, size_t);
+};
+
+extern void     __ag_http_server_serve__(const struct ag_http_server_io *,
+                    void *);
+extern void     __ag_http_engine_run__(int, int, const bool *,
+                    enum ag_http_server_backend);
+extern bool     __ag_http_mime_known__(const char *);
+
+
+/*
+ * The server routes requests through an ag_http_router, which is likewise
+ * protected. A lookup fills an ag_http_route with a copy of the handler found,
+ * if any, whether the path matched a route at all, and the captures of the
+ * route, each of which is a slice of the path with the name of its capture.
+ * __ag_http_request_capture__() attaches the captures to the request, sharing
+ * their names rather than copying them.
+ */
+#define AG_HTTP_CAPTURE_MAX 8
+
+struct ag_http_capture {
+        ag_string       *key;
+        size_t           off;
+        size_t           len;
+};
+
+struct ag_http_route {
+        ag_plugin               *hnd;
+        bool                     path;
+        size_t                   ncap;
+        struct ag_http_capture   cap[AG_HTTP_CAPTURE_MAX];
+};
+
+struct ag_http_router;
+
+extern struct ag_http_router    *__ag_http_router_new__(void);
+extern void      __ag_http_router_release__(struct ag_http_router **);
+extern void      __ag_http_router_add__(struct ag_http_router *,
+                    const enum ag_http_method *, const char *,
+                    const ag_plugin *);
+extern void      __ag_http_router_find__(struct ag_http_router *,
+                    enum ag_http_method, const char *, struct ag_http_route *);
+extern void      __ag_http_request_capture__(ag_http_request **,
+                    const struct ag_http_capture *, size_t);
+
+
 #ifdef __cplusplus
 }
 #endif
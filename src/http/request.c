@@ -23,6 +23,8 @@
 
 #include "../argent.h"
 
+#include <string.h>
+
 
 struct payload {
         enum ag_http_mime        type;
@@ -30,19 +32,27 @@ struct payload {
         ag_http_client          *usr;
         ag_http_url             *url;
         ag_alist                *param;
+        size_t                   ncap;
+        struct ag_http_capture   cap[AG_HTTP_CAPTURE_MAX];
 };
 
 
 static struct payload   *payload_new(enum ag_http_method, enum ag_http_mime,
                             const ag_http_url *, const ag_http_client *,
                             const ag_alist *);
+static void              payload_capture(struct payload *,
+                            const struct ag_http_capture *, size_t);
 
 
 AG_OBJECT_DEFINE(ag_http_request, AG_TYPEID_HTTP_REQUEST);
 
 AG_OBJECT_DEFINE_CLONE(ag_http_request,
         const struct payload *p = _p_;
-        return payload_new(p->meth, p->type, p->url, p->usr, p->param);
+        struct payload *cp = payload_new(p->meth, p->type, p->url, p->usr,
+            p->param);
+
+        payload_capture(cp, p->cap, p->ncap);
+        return cp;
 );
 
 
@@ -52,6 +62,9 @@ AG_OBJECT_DEFINE_RELEASE(ag_http_request,
         ag_http_client_release(&p->usr);
         ag_http_url_release(&p->url);
         ag_alist_release(&p->param);
+
+        for (register size_t i = 0; i < p->ncap; i++)
+                ag_string_release(&p->cap[i].key);
 );
 
 
@@ -96,6 +109,44 @@ AG_OBJECT_DEFINE_STR(ag_http_request,
 );
 
 
+AG_OBJECT_DEFINE_PACK(ag_http_request,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_array(_w_, 5);
+        ag_pack_int(_w_, p->meth);
+        ag_pack_int(_w_, p->type);
+        ag_object_pack(p->url, _w_);
+        ag_object_pack(p->usr, _w_);
+        ag_object_pack(p->param, _w_);
+);
+
+
+AG_OBJECT_DEFINE_UNPACK(ag_http_request,
+        AG_UNPACK_REQUIRE (ag_unpack_array(_r_) == 5, "ag_http_request");
+
+        enum ag_http_method meth = ag_unpack_int(_r_);
+        enum ag_http_mime type = ag_unpack_int(_r_);
+        AG_AUTO(ag_http_url) *url = ag_object_unpack(_r_);
+        AG_AUTO(ag_http_client) *usr = ag_object_unpack(_r_);
+        AG_AUTO(ag_alist) *param = ag_object_unpack(_r_);
+
+        AG_UNPACK_REQUIRE (ag_object_typeid(url) == AG_TYPEID_HTTP_URL
+            && ag_object_typeid(usr) == AG_TYPEID_HTTP_CLIENT
+            && ag_object_typeid(param) == AG_TYPEID_ALIST, "ag_http_request");
+
+        return payload_new(meth, type, url, usr, param);
+);
+
+
+AG_OBJECT_DEFINE_FREEZE(ag_http_request,
+        struct payload *p = _p_;
+
+        ag_http_url_freeze(p->url);
+        ag_http_client_freeze(p->usr);
+        ag_alist_freeze(p->param);
+);
+
+
 
 extern ag_http_request *
 ag_http_request_new(enum ag_http_method meth, enum ag_http_mime type,
@@ -160,6 +211,55 @@ ag_http_request_param(const ag_http_request *ctx)
 }
 
 
+/*
+ * The values of the captures are slices of the URL path of the request, which
+ * the request keeps alive, so only their offsets are kept. The path returned by
+ * ag_http_url_path() is a shallow copy, and so releasing it does not free it.
+ */
+extern const char *
+ag_http_request_capture(const ag_http_request *ctx, const char *key,
+    size_t *len)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_STR (key);
+        AG_ASSERT_PTR (len);
+
+        const struct payload *p = ag_object_payload(ctx);
+
+        for (register size_t i = 0; i < p->ncap; i++) {
+                if (!strcmp(p->cap[i].key, key)) {
+                        AG_AUTO(ag_string) *path = ag_http_url_path(p->url);
+
+                        *len = p->cap[i].len;
+                        return path + p->cap[i].off;
+                }
+        }
+
+        return NULL;
+}
+
+
+/*
+ * Attach the captures of the route that a request was served through. The
+ * request is expected to be the only reference to its payload, as it is when
+ * the server has just made it, and is otherwise cloned first.
+ */
+extern void
+__ag_http_request_capture__(ag_http_request **ctx,
+    const struct ag_http_capture *cap, size_t ncap)
+{
+        AG_ASSERT_PTR (ctx && *ctx);
+        AG_ASSERT (ncap <= AG_HTTP_CAPTURE_MAX);
+
+        struct payload *p = ag_object_payload_mutable(ctx);
+
+        for (register size_t i = 0; i < p->ncap; i++)
+                ag_string_release(&p->cap[i].key);
+
+        payload_capture(p, cap, ncap);
+}
+
+
 static struct payload *
 payload_new(enum ag_http_method meth, enum ag_http_mime type,
     const ag_http_url *url, const ag_http_client *usr, const ag_alist *param)
@@ -179,3 +279,15 @@ payload_new(enum ag_http_method meth, enum ag_http_mime type,
         return p;
 }
 
+
+static void
+payload_capture(struct payload *p, const struct ag_http_capture *cap,
+    size_t ncap)
+{
+        for (register size_t i = 0; i < ncap; i++) {
+                p->cap[i] = cap[i];
+                p->cap[i].key = ag_string_copy(cap[i].key);
+        }
+
+        p->ncap = ncap;
+}
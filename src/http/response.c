@@ -81,6 +81,31 @@ AG_OBJECT_DEFINE_STR(ag_http_response,
 );
 
 
+AG_OBJECT_DEFINE_PACK(ag_http_response,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_array(_w_, 3);
+        ag_pack_int(_w_, p->mime);
+        ag_pack_int(_w_, p->status);
+        ag_pack_string(_w_, p->body);
+);
+
+AG_OBJECT_DEFINE_UNPACK(ag_http_response,
+        AG_UNPACK_REQUIRE (ag_unpack_array(_r_) == 3, "ag_http_response");
+
+        enum ag_http_mime mime = ag_unpack_int(_r_);
+        enum ag_http_status status = ag_unpack_int(_r_);
+        AG_AUTO(ag_string) *body = ag_unpack_string(_r_);
+
+        return payload_new(mime, status, body);
+);
+
+AG_OBJECT_DEFINE_FREEZE(ag_http_response,
+        struct payload *p = _p_;
+        ag_string_freeze(p->body);
+);
+
+
 
 
 extern ag_http_response *
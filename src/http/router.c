@@ -0,0 +1,465 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "../argent.h"
+
+#include <pthread.h>
+#include <string.h>
+
+
+/*
+ * The router matches request paths against a compressed radix tree of the
+ * registered route patterns. A static node is labelled with the longest run of
+ * path bytes shared by the patterns below it, and its static children start
+ * with distinct bytes. A pattern segment starting with ':' becomes a param
+ * node, which captures one path segment, and a final segment starting with '*'
+ * becomes a wildcard node, which captures the rest of the path. Each node
+ * holds a handler per method, plus one for any method.
+ *
+ * Lookups run concurrently with registration and take no lock. A registration
+ * never modifies a node that lookups may see: it copies the nodes on the path
+ * from the root to the node that it changes, and publishes the new root once
+ * the copies are complete, leaving the unchanged subtrees shared between the
+ * two trees. Each node that has been copied is retired on a list, since it may
+ * still be in use by lookups. Lookups run within a reader epoch, the same way
+ * as those of an ag_cregistry, so the registration waits for the lookups that
+ * may still see the retired nodes before freeing them, along with the handlers
+ * that they alone still hold. A node owns its handlers, its capture name and
+ * its array of children, but not the children themselves, which are shared.
+ */
+
+#define HND_ANY (AG_HTTP_METHOD_DELETE + 1)
+#define HND_MAX (HND_ANY + 1)
+
+struct node {
+        struct node     **kid;          /* static children        */
+        size_t            nkid;         /* number of children     */
+        struct node      *param;        /* :param child           */
+        struct node      *wild;         /* *wildcard child        */
+        ag_string        *key;          /* capture name           */
+        ag_plugin        *hnd[HND_MAX]; /* handlers by method     */
+        struct node      *next;         /* next retired node      */
+        size_t            len;          /* length of the label    */
+        char              seg[];        /* static label           */
+};
+
+struct ag_http_router {
+        struct node      *root;         /* current tree           */
+        struct node      *old;          /* retired nodes          */
+        struct ag_epoch  *ep;           /* lookup epochs          */
+        pthread_mutex_t   wr;           /* serialises writers     */
+};
+
+
+static struct node      *node_new(const char *, size_t);
+static struct node      *node_copy(struct ag_http_router *, struct node *,
+                            size_t);
+static void              node_free(struct node *);
+static void              node_free_tree(struct node *);
+static void              node_insert(struct ag_http_router *, struct node *,
+                            const char *, size_t, const ag_plugin *);
+static struct node      *node_capture(struct ag_http_router *,
+                            struct node **, const char *, size_t);
+static const struct node *node_find(const struct node *, const char *, size_t,
+                            size_t, struct ag_http_route *);
+static size_t            pattern_static(const char *);
+
+
+extern struct ag_http_router *
+__ag_http_router_new__(void)
+{
+        struct ag_http_router *r = ag_memblock_new(sizeof *r);
+
+        r->old = NULL;
+        r->root = node_new("", 0);
+        r->ep = __ag_epoch_new__();
+        pthread_mutex_init(&r->wr, NULL);
+
+        return r;
+}
+
+
+/*
+ * Release a router along with its tree. No other thread may be using the
+ * router by the time it is released.
+ */
+extern void
+__ag_http_router_release__(struct ag_http_router **hnd)
+{
+        struct ag_http_router *r;
+
+        if (AG_LIKELY (hnd && (r = *hnd))) {
+                node_free_tree(r->root);
+                __ag_epoch_release__(&r->ep);
+                pthread_mutex_destroy(&r->wr);
+
+                ag_memblock *m = r;
+                ag_memblock_release(&m);
+                *hnd = NULL;
+        }
+}
+
+
+/*
+ * Register the handler of a route pattern for a given method, or for any
+ * method if meth is NULL, replacing the handler registered earlier for the
+ * same pattern and method. A handler for a specific method takes precedence
+ * over a handler for any method. A pattern is a path in which a segment of the
+ * form :name captures one segment of the request path, and a last segment of
+ * the form *name captures the rest of the request path, which may be empty.
+ * Patterns that capture at the same place must use the same name, and no
+ * pattern may have more than AG_HTTP_CAPTURE_MAX captures.
+ */
+extern void
+__ag_http_router_add__(struct ag_http_router *ctx,
+    const enum ag_http_method *meth, const char *pat, const ag_plugin *hnd)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT (*pat == '/');
+        AG_ASSERT_PTR (hnd);
+
+        size_t ncap = 0;
+
+        for (const char *p = pat; (p = strchr(p, '/')); p++)
+                ncap += p[1] == ':' || p[1] == '*';
+
+        AG_ASSERT (ncap <= AG_HTTP_CAPTURE_MAX);
+
+        pthread_mutex_lock(&ctx->wr);
+
+        struct node *root = node_copy(ctx, ctx->root, 0);
+        node_insert(ctx, root, pat, meth ? *meth : HND_ANY, hnd);
+
+        __atomic_store_n(&ctx->root, root, __ATOMIC_SEQ_CST);
+        __ag_epoch_sync__(ctx->ep);
+
+        for (struct node *n = ctx->old, *next; n; n = next) {
+                next = n->next;
+                node_free(n);
+        }
+
+        ctx->old = NULL;
+        pthread_mutex_unlock(&ctx->wr);
+}
+
+
+/*
+ * Find the handler of a request path for a given method. Static segments take
+ * precedence over params, and params over wildcards, with the matching falling
+ * back to the next alternative whenever the path cannot be matched in full.
+ * The handler found, if any, is returned as a copy owned by the caller in
+ * rt->hnd, and the values of the captures of its route are returned in rt->cap
+ * as slices of the path; their names belong to the router. rt->path is set if
+ * the path matches a route even if the method has no handler on it, so that
+ * the caller can tell 404 from 405.
+ */
+extern void
+__ag_http_router_find__(struct ag_http_router *ctx, enum ag_http_method meth,
+    const char *path, struct ag_http_route *rt)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (path);
+        AG_ASSERT_PTR (rt);
+
+        size_t *rd = __ag_epoch_enter__(ctx->ep);
+        const struct node *root = __atomic_load_n(&ctx->root, __ATOMIC_SEQ_CST);
+
+        rt->hnd = NULL;
+        rt->ncap = 0;
+
+        const struct node *n = node_find(root, path, strlen(path), 0, rt);
+
+        if ((rt->path = n)) {
+                ag_plugin *hnd = n->hnd[meth] ? n->hnd[meth]
+                    : n->hnd[HND_ANY];
+
+                if (hnd)
+                        rt->hnd = ag_plugin_copy(hnd);
+        }
+
+        __ag_epoch_leave__(rd);
+}
+
+
+/*
+ * Make a node with a given static label.
+ */
+static struct node *
+node_new(const char *seg, size_t len)
+{
+        struct node *n = ag_memblock_new(sizeof *n + len + 1);
+
+        memcpy(n->seg, seg, len);
+        n->len = len;
+
+        return n;
+}
+
+
+/*
+ * Copy a node that lookups may see so that it can be modified, dropping the
+ * first skip bytes of its label, and retire the original, which the copy
+ * always takes the place of. The children are shared with the original. The
+ * link to the next retired node is the only field of a node that lookups may
+ * see which is ever written, and lookups never read it.
+ */
+static struct node *
+node_copy(struct ag_http_router *r, struct node *n, size_t skip)
+{
+        struct node *cp = node_new(n->seg + skip, n->len - skip);
+
+        if (n->nkid) {
+                cp->kid = ag_memblock_new(n->nkid * sizeof *cp->kid);
+                memcpy(cp->kid, n->kid, n->nkid * sizeof *cp->kid);
+                cp->nkid = n->nkid;
+        }
+
+        cp->param = n->param;
+        cp->wild = n->wild;
+        cp->key = n->key ? ag_string_copy(n->key) : NULL;
+
+        for (register size_t i = 0; i < HND_MAX; i++)
+                cp->hnd[i] = n->hnd[i] ? ag_plugin_copy(n->hnd[i]) : NULL;
+
+        n->next = r->old;
+        r->old = n;
+
+        return cp;
+}
+
+
+/*
+ * Free a node along with what it owns, leaving its children alone.
+ */
+static void
+node_free(struct node *n)
+{
+        for (register size_t i = 0; i < HND_MAX; i++)
+                ag_plugin_release(&n->hnd[i]);
+
+        ag_string_release(&n->key);
+
+        ag_memblock *m = n->kid;
+        ag_memblock_release(&m);
+
+        m = n;
+        ag_memblock_release(&m);
+}
+
+
+/*
+ * Free a node along with the whole subtree below it.
+ */
+static void
+node_free_tree(struct node *n)
+{
+        if (!n)
+                return;
+
+        for (register size_t i = 0; i < n->nkid; i++)
+                node_free_tree(n->kid[i]);
+
+        node_free_tree(n->param);
+        node_free_tree(n->wild);
+        node_free(n);
+}
+
+
+/*
+ * Insert the rest of a pattern below a node that has not been published yet,
+ * copying the nodes that the pattern passes through, or making new ones where
+ * it leaves the tree, and setting the handler of the node where it ends.
+ */
+static void
+node_insert(struct ag_http_router *r, struct node *n, const char *pat,
+    size_t meth, const ag_plugin *hnd)
+{
+        if (!*pat) {
+                ag_plugin_release(&n->hnd[meth]);
+                n->hnd[meth] = ag_plugin_copy(hnd);
+                return;
+        }
+
+        if ((*pat == ':' || *pat == '*') && n->len
+            && n->seg[n->len - 1] == '/') {
+                bool wild = *pat == '*';
+                size_t len = strcspn(pat + 1, "/");
+
+                AG_ASSERT (len && (!wild || !pat[len + 1]));
+
+                struct node *c = node_capture(r, wild ? &n->wild
+                    : &n->param, pat + 1, len);
+
+                node_insert(r, c, pat + len + 1, meth, hnd);
+                return;
+        }
+
+        size_t len = pattern_static(pat);
+        register size_t i = 0;
+
+        while (i < n->nkid && *n->kid[i]->seg != *pat)
+                i++;
+
+        if (i == n->nkid) {
+                ag_memblock *m = n->kid;
+
+                if (m)
+                        ag_memblock_resize(&m, (i + 1) * sizeof *n->kid);
+                else
+                        m = ag_memblock_new(sizeof *n->kid);
+
+                n->kid = m;
+                n->kid[n->nkid++] = node_new(pat, len);
+
+                node_insert(r, n->kid[i], pat + len, meth, hnd);
+                return;
+        }
+
+        struct node *c = n->kid[i];
+        register size_t k = 1;
+
+        while (k < c->len && k < len && c->seg[k] == pat[k])
+                k++;
+
+        if (k == c->len) {
+                n->kid[i] = node_copy(r, c, 0);
+                node_insert(r, n->kid[i], pat + k, meth, hnd);
+                return;
+        }
+
+        struct node *mid = node_new(pat, k);
+
+        mid->kid = ag_memblock_new(sizeof *mid->kid);
+        mid->kid[0] = node_copy(r, c, k);
+        mid->nkid = 1;
+
+        n->kid[i] = mid;
+        node_insert(r, mid, pat + k, meth, hnd);
+}
+
+
+/*
+ * Get the param or wildcard child in a slot of a node that has not been
+ * published yet, copying it or making a new one. The capture name must be the
+ * same as that of the child already there.
+ */
+static struct node *
+node_capture(struct ag_http_router *r, struct node **slot, const char *name,
+    size_t len)
+{
+        if (*slot) {
+                AG_ASSERT (!strncmp((*slot)->key, name, len)
+                    && !(*slot)->key[len]);
+
+                return *slot = node_copy(r, *slot, 0);
+        }
+
+        *slot = node_new("", 0);
+        (*slot)->key = ag_string_new_fmt("%.*s", (int)len, name);
+
+        return *slot;
+}
+
+
+/*
+ * Match the rest of a path from off onwards below a node whose label has
+ * already been matched, and return the node where the path ends if it has a
+ * handler. The captures are pushed onto rt->cap on the way down, and popped
+ * again when an alternative fails.
+ */
+static const struct node *
+node_find(const struct node *n, const char *path, size_t len, size_t off,
+    struct ag_http_route *rt)
+{
+        const struct node *found;
+
+        if (off == len) {
+                for (register size_t i = 0; i < HND_MAX; i++) {
+                        if (n->hnd[i])
+                                return n;
+                }
+        }
+
+        if (off < len) {
+                for (register size_t i = 0; i < n->nkid; i++) {
+                        const struct node *c = n->kid[i];
+
+                        if (*c->seg != path[off])
+                                continue;
+
+                        if (c->len <= len - off
+                            && !memcmp(c->seg, path + off, c->len)
+                            && (found = node_find(c, path, len, off + c->len,
+                            rt)))
+                                return found;
+
+                        break;
+                }
+        }
+
+        if (n->param && off < len && path[off] != '/') {
+                size_t end = off + strcspn(path + off, "/");
+                struct ag_http_capture *cap = &rt->cap[rt->ncap++];
+
+                cap->key = n->param->key;
+                cap->off = off;
+                cap->len = end - off;
+
+                if ((found = node_find(n->param, path, len, end, rt)))
+                        return found;
+
+                rt->ncap--;
+        }
+
+        if (n->wild) {
+                struct ag_http_capture *cap = &rt->cap[rt->ncap++];
+
+                cap->key = n->wild->key;
+                cap->off = off;
+                cap->len = len - off;
+
+                if ((found = node_find(n->wild, path, len, len, rt)))
+                        return found;
+
+                rt->ncap--;
+        }
+
+        return NULL;
+}
+
+
+/*
+ * Get the length of the static run at the start of a pattern, which ends
+ * where a segment starts with ':' or '*'.
+ */
+static size_t
+pattern_static(const char *pat)
+{
+        register size_t i = 0;
+
+        while (pat[i] && !(i && pat[i - 1] == '/'
+            && (pat[i] == ':' || pat[i] == '*')))
+                i++;
+
+        return i;
+}
@@ -2,50 +2,129 @@
 
 #include <fcgiapp.h>
 
-
-static void plugin_release(void *hnd)
-{
-        AG_ASSERT_PTR (hnd);
-
-        ag_plugin *p = hnd;
-        ag_plugin_release(&p);
-}
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+
+/*
+ * The server state is split in two. The process-wide state in g_srv holds the
+ * router, which is shared by every worker thread so that handlers
+ * registered or replaced at runtime by any thread take effect for all of them,
+ * along with the server options, the listening socket, the lock guarding
+ * FCGX_Accept_r() and the state used to drain the workers of a process. The
+ * per-thread state in g_http holds the request being served by the calling
+ * thread, as the backend's I/O functions and context, along with its
+ * environment and its parsed ag_http_request, so that ag_http_server_env() and
+ * ag_http_server_request() always refer to the request of the calling thread.
+ */
+static struct {
+        struct ag_http_server_opt        opt;
+        struct ag_http_router           *routes;
+        pthread_mutex_t                  accept;
+        int                              fd;
+        int                              wake;
+        bool                             drain;
+        size_t                           live;
+        size_t                           acceptor;
+} *g_srv = NULL;
 
 
 static AG_THREADLOCAL struct {
-        struct ag_http_env       env;
-        FCGX_Request             cgi;
-        ag_registry             *reg;
-        ag_http_request         *req;
+        struct ag_http_env                       env;
+        const struct ag_http_server_io          *io;
+        void                                    *ctx;
+        ag_http_request                         *req;
 } *g_http = NULL;
 
 
+/*
+ * The context of a request served by the libfcgi backend: the libfcgi request
+ * itself, and the request body once it has been read.
+ */
+struct cgi {
+        FCGX_Request     req;
+        char            *body;
+};
+
+
+static void      pool_run(bool);
+static void      pool_drain(pthread_t *);
+static void      master_run(void);
+static pid_t     master_spawn(sigset_t *);
+static void     *worker_run(void *);
+static void      worker_cgi(size_t);
+static void      worker_wake(int);
+static int       listen_open(const char *, int);
+
+static const char *cgi_param(void *, const char *);
+static const char *cgi_body(void *);
+static void      cgi_write(void *, const char *, size_t);
+
+
+/*
+ * The signal sent to the libfcgi worker thread waiting in accept() when the
+ * workers of a process are being drained, and the interval at which it is sent
+ * until every worker has stopped. Resending covers a worker that checks the
+ * drain flag just before the flag is set and only then enters accept(). Only
+ * the worker holding the accept lock is signalled, which g_srv->acceptor
+ * tracks by the index of the worker plus one, so that the blocking calls of
+ * workers still serving requests are not interrupted. Workers of the native
+ * backends are instead woken by writing to the g_srv->wake eventfd, on which
+ * all of them wait.
+ */
+#define SIG_WAKE        (SIGRTMIN)
+#define DRAIN_POLL_MS   100
+
+
+/*
+ * Initialise the server with the given options, or with the default options of
+ * a single thread in a single process on the inherited socket if none are
+ * given. The calling thread does not serve requests
+ * until ag_http_server_run() is called, but it may already register handlers.
+ */
 extern void
-ag_http_server_init(void)
+ag_http_server_init(const struct ag_http_server_opt *opt)
 {
-        AG_ASSERT (!g_http);
+        AG_ASSERT (!g_srv);
 
-        g_http = ag_memblock_new(sizeof *g_http);
-        g_http->reg = ag_registry_new(plugin_release);
-        g_http->req = NULL;
-        g_http->env = (const struct ag_http_env){'\0'};
-        
-        AG_REQUIRE (!FCGX_Init(), AG_ERNO_HTTP);
-        AG_REQUIRE (!FCGX_InitRequest(&g_http->cgi, 0, 0), AG_ERNO_HTTP);
+        g_srv = ag_memblock_new(sizeof *g_srv);
+        g_srv->opt = opt ? *opt : (struct ag_http_server_opt){.threads = 1};
+        g_srv->routes = __ag_http_router_new__();
+        g_srv->wake = -1;
+        pthread_mutex_init(&g_srv->accept, NULL);
+
+        if (!g_srv->opt.threads)
+                g_srv->opt.threads = 1;
+
+        if (!g_srv->opt.backlog)
+                g_srv->opt.backlog = 128;
+
+        if (g_srv->opt.backend == AG_HTTP_SERVER_LIBFCGI)
+                AG_REQUIRE (!FCGX_Init(), AG_ERNO_HTTP);
 }
 
 
 extern void
 ag_http_server_exit(void)
 {
-        if (AG_UNLIKELY (!g_http))
+        if (AG_UNLIKELY (!g_srv))
                 return;
 
-        ag_registry_release(&g_http->reg);
-        ag_http_request_release(&g_http->req);
+        __ag_http_router_release__(&g_srv->routes);
+        pthread_mutex_destroy(&g_srv->accept);
 
-        ag_memblock *m = g_http;
+        ag_memblock *m = g_srv;
         ag_memblock_release(&m);
+        g_srv = NULL;
 }
 
         
@@ -55,7 +134,7 @@ env_read(const char *key)
         AG_ASSERT_PTR (g_http);
         AG_ASSERT_STR (key);
 
-        const char *v = FCGX_GetParam(key, g_http->cgi.envp);
+        const char *v = g_http->io->param(g_http->ctx, key);
         ag_log_debug("%s = %s", key, v ? v : "(empty)");
 
         return v ? v : "";
@@ -121,10 +200,21 @@ ag_http_server_register(const char *path, const ag_plugin *plug)
 {
         AG_ASSERT_STR (path);
         AG_ASSERT_PTR (plug);
-        AG_ASSERT_PTR (g_http);
+        AG_ASSERT_PTR (g_srv);
 
-        ag_registry_push(g_http->reg, ag_hash_new_str(path),
-            ag_plugin_copy(plug));
+        __ag_http_router_add__(g_srv->routes, NULL, path, plug);
+}
+
+
+extern void
+ag_http_server_register_method(enum ag_http_method meth, const char *path,
+    const ag_plugin *plug)
+{
+        AG_ASSERT_STR (path);
+        AG_ASSERT_PTR (plug);
+        AG_ASSERT_PTR (g_srv);
+
+        __ag_http_router_add__(g_srv->routes, &meth, path, plug);
 }
 
 
@@ -134,64 +224,38 @@ ag_http_server_respond(const ag_http_response *resp)
         AG_ASSERT_PTR (g_http);
 
         AG_AUTO(ag_string) *s = ag_http_response_str(resp);
-        FCGX_FPrintF(g_http->cgi.out, s);
+        g_http->io->write(g_http->ctx, s, strlen(s));
 }
 
 
 static void
-default_http_handler(void)
+default_http_handler(enum ag_http_status status)
 {
         AG_AUTO(ag_http_url) *u = ag_http_request_url(g_http->req);
         AG_AUTO(ag_string) *us = ag_http_url_str(u);
         ag_log_warning("request handler for %s not found, using default", us);
 
         AG_AUTO(ag_http_response) *r = ag_http_response_new_empty(
-            AG_HTTP_MIME_TEXT_HTML, AG_HTTP_STATUS_404_NOT_FOUND);
+            AG_HTTP_MIME_TEXT_HTML, status);
         ag_http_server_respond(r);
 }
 
 
-static inline ag_string *
+static inline ag_alist *
 param_get(void)
 {
         AG_ASSERT_PTR (g_http);
 
-        AG_AUTO(ag_string) *s = ag_string_new(g_http->env.query_string);
-        return ag_string_url_decode(s);
+        return ag_alist_parse_form(g_http->env.query_string);
 }
 
 
-static ag_string *
+static inline ag_alist *
 param_post(void)
 {
         AG_ASSERT_PTR (g_http);
 
-        size_t sz = 1024;
-        char *bfr = ag_memblock_new(sz);
-
-        size_t read = 0;
-        int err = 0;
-
-        do {
-                sz = sz << 1;
-                ag_memblock *m = bfr;
-                ag_memblock_resize(&m, sz);
-
-                read += FCGX_GetStr(bfr + read, sz - read, g_http->cgi.in);
-                if (AG_UNLIKELY (!read || 
-                    (err = FCGX_GetError(g_http->cgi.in))))
-                        ag_memblock_release(&m);
-
-                AG_REQUIRE (!err, AG_ERNO_HTTP);
-        } while(read == sz);
-
-        bfr[read] = '\0';
-        AG_AUTO(ag_string) *s = ag_string_new(bfr); 
-   
-        ag_memblock *m = bfr; 
-        ag_memblock_release(&m);
-
-        return ag_string_url_decode(s);
+        return ag_alist_parse_form(g_http->io->body(g_http->ctx));
 }
 
 
@@ -209,9 +273,8 @@ srv_req(void)
         AG_AUTO(ag_http_url) *u = ag_http_url_parse_env(e);
         AG_AUTO(ag_http_client) *c = ag_http_client_parse_env(e);
 
-        AG_AUTO(ag_string) *s = (m == AG_HTTP_METHOD_GET ||
+        AG_AUTO(ag_alist) *p = (m == AG_HTTP_METHOD_GET ||
             m == AG_HTTP_METHOD_DELETE) ? param_get() : param_post();
-        AG_AUTO(ag_alist) *p = ag_alist_parse(s, "=", "&");
 
         ag_http_request_release(&g_http->req);
         g_http->req = ag_http_request_new(m, t, u, c, p);
@@ -225,27 +288,472 @@ srv_resp(void)
 
         AG_AUTO(ag_http_url) *u = ag_http_request_url(g_http->req);
         AG_AUTO(ag_string) *p = ag_http_url_path(u);
-        ag_hash h = ag_hash_new_str(p);
+        struct ag_http_route rt;
 
-        const ag_plugin *plg = ag_registry_get(g_http->reg, h);
+        __ag_http_router_find__(g_srv->routes,
+            ag_http_request_method(g_http->req), p, &rt);
+
+        AG_AUTO(ag_plugin) *plg = rt.hnd;
 
         if (AG_LIKELY (plg)) {
+                if (rt.ncap)
+                        __ag_http_request_capture__(&g_http->req, rt.cap,
+                            rt.ncap);
+
                 ag_http_handler *hnd = ag_plugin_hnd(plg);
                 hnd(g_http->req);
         } else
-                default_http_handler();
+                default_http_handler(rt.path
+                    ? AG_HTTP_STATUS_405_METHOD_NOT_ALLOWED
+                    : AG_HTTP_STATUS_404_NOT_FOUND);
 }
 
 
+/*
+ * Serve a request handed over by a backend on the calling worker thread, with
+ * the given I/O functions and context.
+ */
 extern void
-ag_http_server_run(void)
+__ag_http_server_serve__(const struct ag_http_server_io *io, void *ctx)
 {
         AG_ASSERT_PTR (g_http);
+        AG_ASSERT_PTR (io);
+
+        g_http->io = io;
+        g_http->ctx = ctx;
+
+        srv_req();
+        srv_resp();
+
+        g_http->io = NULL;
+        g_http->ctx = NULL;
+}
+
+
+/*
+ * Serve requests until the server stops. The listening socket is opened here
+ * rather than by ag_http_server_init(), so that handlers can be registered
+ * before the server starts listening; without a listen address, the socket
+ * inherited as fd 0 from a process manager such as spawn-fcgi is used. In pre-
+ * fork mode the calling process becomes the master of the worker processes,
+ * and otherwise it serves requests itself.
+ */
+extern void
+ag_http_server_run(void)
+{
+        AG_ASSERT_PTR (g_srv);
+
+        const char *addr = g_srv->opt.listen;
+
+        g_srv->fd = addr ? listen_open(addr, g_srv->opt.backlog) : 0;
+        AG_REQUIRE (g_srv->fd >= 0, AG_ERNO_HTTP);
+
+        if (g_srv->opt.procs)
+                master_run();
+        else
+                pool_run(false);
+
+        if (addr)
+                close(g_srv->fd);
+}
+
+
+/*
+ * Open a listening socket on a UNIX socket path or a "host:port" or ":port"
+ * TCP address. As with libfcgi, a stale UNIX socket left at the path by a
+ * previous run is removed first.
+ */
+static int
+listen_open(const char *addr, int backlog)
+{
+        const char *port = strrchr(addr, ':');
+        int fd;
+
+        if (*addr != '/' && port) {
+                AG_AUTO(ag_string) *host = ag_string_new_fmt("%.*s",
+                    (int)(port - addr), addr);
+                struct addrinfo hint = {.ai_family = AF_UNSPEC,
+                    .ai_socktype = SOCK_STREAM, .ai_flags = AI_PASSIVE};
+                struct addrinfo *ai;
+
+                if (getaddrinfo(*host ? host : NULL, port + 1, &hint, &ai))
+                        return -1;
+
+                int on = 1;
+                fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, 0);
+
+                if (fd >= 0 && (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on,
+                    sizeof on) || bind(fd, ai->ai_addr, ai->ai_addrlen))) {
+                        close(fd);
+                        fd = -1;
+                }
+
+                freeaddrinfo(ai);
+        } else {
+                struct sockaddr_un sa = {.sun_family = AF_UNIX};
+
+                if (strlen(addr) >= sizeof sa.sun_path)
+                        return -1;
+
+                strcpy(sa.sun_path, addr);
+                (void)unlink(addr);
+
+                fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+                if (fd >= 0 && bind(fd, (struct sockaddr *)&sa, sizeof sa)) {
+                        close(fd);
+                        fd = -1;
+                }
+        }
+
+        if (fd >= 0 && listen(fd, backlog)) {
+                close(fd);
+                fd = -1;
+        }
+
+        return fd;
+}
+
+
+/*
+ * Serve requests on the configured number of worker threads of the calling
+ * process until the workers stop, which for the libfcgi backend happens once
+ * accepting a request fails because the listening socket is closed or libfcgi
+ * is asked to shut down, and for the native backends once the pool is
+ * drained. Unless the pool is to be drained on SIGTERM, the calling thread is
+ * the first worker, so a single threaded server spawns no threads at all. A
+ * drained pool instead keeps the calling thread to wait for the signal.
+ */
+static void
+pool_run(bool drain)
+{
+        size_t n = g_srv->opt.threads - !drain;
+        pthread_t *thr = ag_memblock_new(sizeof *thr * (n + 1));
+
+        g_srv->live = n;
+
+        if (drain && g_srv->opt.backend != AG_HTTP_SERVER_LIBFCGI) {
+                g_srv->wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+                AG_REQUIRE (g_srv->wake >= 0, AG_ERNO_HTTP);
+        }
+
+        for (register size_t i = 0; i < n; i++)
+                AG_REQUIRE (!pthread_create(&thr[i], NULL, worker_run,
+                    (void *)(i + 1)), AG_ERNO_HTTP);
+
+        if (drain)
+                pool_drain(thr);
+        else
+                (void)worker_run((void *)(n + 1));
+
+        for (register size_t i = 0; i < n; i++)
+                pthread_join(thr[i], NULL);
+
+        ag_memblock *m = thr;
+        ag_memblock_release(&m);
+
+        if (g_srv->wake >= 0) {
+                close(g_srv->wake);
+                g_srv->wake = -1;
+        }
+}
+
+
+/*
+ * Wait for SIGTERM or SIGINT, which the worker threads of the process have
+ * blocked, and then drain the workers: each finishes the request it is serving
+ * and stops before accepting another. The worker blocked in accept() is woken
+ * by SIG_WAKE, whose handler does nothing; it is installed without SA_RESTART
+ * so that accept() fails with EINTR, and libfcgi then gives up since a
+ * shutdown is pending; the workers of the native backends are woken through
+ * the wake eventfd. We also return if the workers stop on their own.
+ */
+static void
+pool_drain(pthread_t *thr)
+{
+        struct timespec ts = {.tv_nsec = DRAIN_POLL_MS * 1000000L};
+        sigset_t set;
+
+        sigemptyset(&set);
+        sigaddset(&set, SIGTERM);
+        sigaddset(&set, SIGINT);
+
+        while (__atomic_load_n(&g_srv->live, __ATOMIC_ACQUIRE)) {
+                if (sigtimedwait(&set, NULL, &ts) > 0
+                    && !__atomic_load_n(&g_srv->drain, __ATOMIC_ACQUIRE)) {
+                        ag_log_info("draining worker process %d", getpid());
+
+                        __atomic_store_n(&g_srv->drain, true,
+                            __ATOMIC_RELEASE);
+                        FCGX_ShutdownPending();
+                }
+
+                if (!__atomic_load_n(&g_srv->drain, __ATOMIC_ACQUIRE))
+                        continue;
+
+                if (g_srv->wake >= 0) {
+                        (void)eventfd_write(g_srv->wake, 1);
+                        continue;
+                }
+
+                register size_t a = __atomic_load_n(&g_srv->acceptor,
+                    __ATOMIC_ACQUIRE);
 
-        while (FCGX_Accept_r(&g_http->cgi) >= 0) {
-                srv_req();
-                srv_resp();
-                FCGX_Finish_r(&g_http->cgi);
+                if (a)
+                        (void)pthread_kill(thr[a - 1], SIG_WAKE);
         }
 }
 
+
+/*
+ * Run the master process of the pre-fork mode. The master forks the configured
+ * number of worker processes, which inherit the listening socket and a copy-on-
+ * write copy of the router, and then supervises them. A worker that crashes or
+ * exits with an error is replaced, after a second's pause if it ran for less
+ * than a second so that a worker failing at startup does not cause a fork
+ * storm. On SIGTERM or SIGINT, the master forwards SIGTERM to the workers
+ * so that they drain, and returns once all of them have exited.
+ */
+static void
+master_run(void)
+{
+        size_t n = g_srv->opt.procs;
+        pid_t *pid = ag_memblock_new(sizeof *pid * n);
+        time_t *born = ag_memblock_new(sizeof *born * n);
+        size_t live = n;
+        bool drain = false;
+        sigset_t set, old;
+
+        sigemptyset(&set);
+        sigaddset(&set, SIGTERM);
+        sigaddset(&set, SIGINT);
+        sigaddset(&set, SIGCHLD);
+        pthread_sigmask(SIG_BLOCK, &set, &old);
+
+        for (register size_t i = 0; i < n; i++) {
+                pid[i] = master_spawn(&old);
+                born[i] = time(NULL);
+        }
+
+        while (live) {
+                int sig;
+
+                if (sigwait(&set, &sig))
+                        continue;
+
+                if (sig != SIGCHLD) {
+                        if (!drain)
+                                ag_log_info("draining %zu worker processes",
+                                    live);
+
+                        drain = true;
+
+                        for (register size_t i = 0; i < n; i++) {
+                                if (pid[i] > 0)
+                                        (void)kill(pid[i], SIGTERM);
+                        }
+
+                        continue;
+                }
+
+                int status;
+                pid_t p;
+
+                while ((p = waitpid(-1, &status, WNOHANG)) > 0) {
+                        register size_t i = 0;
+
+                        while (i < n && pid[i] != p)
+                                i++;
+
+                        if (i == n)
+                                continue;
+
+                        bool crash = WIFSIGNALED(status)
+                            || WEXITSTATUS(status) != EXIT_SUCCESS;
+
+                        if (drain || !crash) {
+                                pid[i] = 0;
+                                live--;
+                                continue;
+                        }
+
+                        ag_log_warning("worker process %d exited abnormally,"
+                            " restarting", p);
+
+                        if (time(NULL) - born[i] < 1)
+                                sleep(1);
+
+                        pid[i] = master_spawn(&old);
+                        born[i] = time(NULL);
+                }
+        }
+
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+        ag_memblock *m = pid;
+        ag_memblock_release(&m);
+        m = born;
+        ag_memblock_release(&m);
+}
+
+
+/*
+ * Fork a worker process for the master. The worker keeps SIGTERM and SIGINT
+ * blocked, as inherited from the master, so that pool_drain() can wait for
+ * them, but restores the rest of the signal mask that the master had before it
+ * started supervising, which is passed through the only parameter. The worker
+ * never returns into the caller of ag_http_server_run().
+ */
+static pid_t
+master_spawn(sigset_t *mask)
+{
+        pid_t pid = fork();
+        AG_REQUIRE (pid >= 0, AG_ERNO_HTTP);
+
+        if (pid)
+                return pid;
+
+        sigset_t set = *mask;
+        sigaddset(&set, SIGTERM);
+        sigaddset(&set, SIGINT);
+        sigdelset(&set, SIGCHLD);
+        pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+        pool_run(true);
+        _exit(EXIT_SUCCESS);
+}
+
+
+/*
+ * Run a worker thread with the configured backend until it stops. The index of
+ * the worker plus one is passed through the only parameter.
+ */
+static void *
+worker_run(void *arg)
+{
+        AG_ASSERT (!g_http);
+
+        g_http = ag_memblock_new(sizeof *g_http);
+
+        if (g_srv->opt.backend == AG_HTTP_SERVER_LIBFCGI)
+                worker_cgi((size_t)arg);
+        else
+                __ag_http_engine_run__(g_srv->fd, g_srv->wake, &g_srv->drain,
+                    g_srv->opt.backend);
+
+        ag_http_request_release(&g_http->req);
+
+        ag_memblock *m = g_http;
+        ag_memblock_release(&m);
+        g_http = NULL;
+
+        __atomic_sub_fetch(&g_srv->live, 1, __ATOMIC_RELEASE);
+        return NULL;
+}
+
+
+/*
+ * Run the accept loop of a libfcgi worker thread with its own FastCGI request
+ * on the listening socket. libfcgi requires concurrent calls to
+ * FCGX_Accept_r() on the same socket to be serialised, so each worker holds
+ * the accept lock only while waiting for its next request, and checks whether
+ * the process is being drained before it waits.
+ */
+static void
+worker_cgi(size_t idx)
+{
+        static const struct ag_http_server_io io = {
+                .param = cgi_param,
+                .body = cgi_body,
+                .write = cgi_write,
+        };
+
+        struct sigaction sa = {.sa_handler = worker_wake};
+        sigemptyset(&sa.sa_mask);
+        (void)sigaction(SIG_WAKE, &sa, NULL);
+
+        struct cgi c = {.body = NULL};
+        AG_REQUIRE (!FCGX_InitRequest(&c.req, g_srv->fd, 0), AG_ERNO_HTTP);
+
+        for (;;) {
+                pthread_mutex_lock(&g_srv->accept);
+                __atomic_store_n(&g_srv->acceptor, idx, __ATOMIC_RELEASE);
+
+                int rc = __atomic_load_n(&g_srv->drain, __ATOMIC_ACQUIRE)
+                    ? -1 : FCGX_Accept_r(&c.req);
+
+                __atomic_store_n(&g_srv->acceptor, 0, __ATOMIC_RELEASE);
+                pthread_mutex_unlock(&g_srv->accept);
+
+                if (rc < 0)
+                        break;
+
+                __ag_http_server_serve__(&io, &c);
+                FCGX_Finish_r(&c.req);
+
+                ag_memblock *m = c.body;
+                ag_memblock_release(&m);
+                c.body = NULL;
+        }
+
+        FCGX_Free(&c.req, 1);
+}
+
+
+static void
+worker_wake(int sig)
+{
+        (void)sig;
+}
+
+
+
+static const char *
+cgi_param(void *ctx, const char *key)
+{
+        struct cgi *c = ctx;
+        return FCGX_GetParam(key, c->req.envp);
+}
+
+
+/*
+ * Read the request body into a buffer that doubles whenever FCGX_GetStr() fills
+ * it. The body is parsed as a form by the caller, which url-decodes the keys
+ * and values itself; decoding the whole body up front would turn an encoded
+ * '&' or '=' into a delimiter.
+ */
+static const char *
+cgi_body(void *ctx)
+{
+        struct cgi *c = ctx;
+        size_t sz = 1024;
+        char *bfr = ag_memblock_new(sz + 1);
+        size_t read = 0;
+
+        while ((read += FCGX_GetStr(bfr + read, sz - read, c->req.in))
+            == sz) {
+                sz <<= 1;
+                ag_memblock *m = bfr;
+                ag_memblock_resize(&m, sz + 1);
+                bfr = m;
+        }
+
+        ag_memblock *m = bfr;
+        int err = FCGX_GetError(c->req.in);
+
+        if (AG_UNLIKELY (err))
+                ag_memblock_release(&m);
+
+        AG_REQUIRE (!err, AG_ERNO_HTTP);
+
+        bfr[read] = '\0';
+        return c->body = bfr;
+}
+
+
+static void
+cgi_write(void *ctx, const char *data, size_t len)
+{
+        struct cgi *c = ctx;
+        (void)FCGX_PutStr(data, len, c->req.out);
+}
@@ -138,6 +138,52 @@ AG_OBJECT_DEFINE_STR(ag_http_url,
 );
 
 
+/*
+ * Define the __ag_http_url_pack__() dynamic dispatch callback function. This
+ * function is called by ag_object_pack() when an HTTP URL object is packed. We
+ * pack the components of the URL as an array.
+ */
+AG_OBJECT_DEFINE_PACK(ag_http_url,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_array(_w_, 4);
+        ag_pack_bool(_w_, p->secure);
+        ag_pack_uint(_w_, p->port);
+        ag_pack_string(_w_, p->host);
+        ag_pack_string(_w_, p->path);
+);
+
+
+/*
+ * Define the __ag_http_url_unpack__() dynamic dispatch callback function. This
+ * function is called by ag_object_unpack() to read back the components of an
+ * HTTP URL written by __ag_http_url_pack__().
+ */
+AG_OBJECT_DEFINE_UNPACK(ag_http_url,
+        AG_UNPACK_REQUIRE (ag_unpack_array(_r_) == 4, "ag_http_url");
+
+        bool secure = ag_unpack_bool(_r_);
+        ag_uint port = ag_unpack_uint(_r_);
+        AG_AUTO(ag_string) *host = ag_unpack_string(_r_);
+        AG_AUTO(ag_string) *path = ag_unpack_string(_r_);
+
+        return payload_new(secure, host, port, path);
+);
+
+
+/*
+ * Define the __ag_http_url_freeze__() dynamic dispatch callback function. This
+ * function is called by ag_object_freeze() when an HTTP URL object is frozen,
+ * and freezes the host and path strings of the URL.
+ */
+AG_OBJECT_DEFINE_FREEZE(ag_http_url,
+        struct payload *p = _p_;
+
+        ag_string_freeze(p->host);
+        ag_string_freeze(p->path);
+);
+
+
 
 /*
  * Define the ag_http_url_new() interface function. This function creates a new
@@ -249,9 +295,8 @@ ag_http_url_parse_env(const struct ag_http_env *cgi)
         AG_AUTO(ag_string) *s2 = ag_string_lower(s);
         bool secure = ag_string_eq(s2, "on");
 
-        AG_AUTO(ag_string) *p = ag_string_new(cgi->request_uri);
-        AG_AUTO(ag_string) *p2 = ag_string_split(p, "?");
-        AG_AUTO(ag_string) *path = ag_string_split(p2, "#");
+        AG_AUTO(ag_string) *path = ag_string_new_fmt("%.*s",
+            (int)strcspn(cgi->request_uri, "?#"), cgi->request_uri);
 
         ag_uint port = ag_uint_parse(cgi->server_port);
 
@@ -23,6 +23,8 @@
 
 #include "../argent.h"
 
+#include <string.h>
+
 
 /*******************************************************************************
  * Although the object registry presents a unified interface, it is actually
@@ -44,7 +46,10 @@
 static ag_registry *g_argent;
 static ag_registry *g_client;
 
-static void     reg_dispose(void *);
+static void                      reg_init(void);
+static void                      reg_dispose(void *);
+static struct ag_object_vtable  *vt_select(const char *,
+                                    const struct ag_object_vtable *, bool);
 
 
 /*******************************************************************************
@@ -63,6 +68,9 @@ static size_t            def_len(const ag_object *);
 static size_t            def_hash(const ag_object *);
 static ag_string        *def_str(const ag_object *);
 static ag_string        *def_json(const ag_object *);
+static void              def_pack(const ag_object *, ag_pack *);
+static ag_memblock      *def_unpack(struct ag_unpack *);
+static void              def_freeze(ag_memblock *);
 
 
 /*******************************************************************************
@@ -79,28 +87,33 @@ static ag_string        *def_json(const ag_object *);
  * The processed object v-table (destination) is passed through the first
  * parameter, the object v-table provided by the client code (source) is passed
  * through the second, the object typename through the third, and the object
- * method callback suffix is passed through the fourth.
+ * method callback suffix is passed through the fourth. The fifth parameter
+ * indicates whether or not the selection should be logged, since static
+ * registration happens before the logging unit has been initialised.
  */
 
-#define CBK_SELECT(D, S, T, M)                                  \
-        ag_log_debug("selecting %s callback for %s_%s()",       \
-            S->M ? "custom" : "default", T, #M);                \
-        D->M = S->M ? S->M : def_##M
+#define CBK_SELECT(D, S, T, M, L) do {                                  \
+        if (L) {                                                        \
+                ag_log_debug("selecting %s callback for %s_%s()",       \
+                    S->M ? "custom" : "default", T, #M);                \
+        }                                                               \
+        D->M = S->M ? S->M : def_##M;                                   \
+} while (0)
 
 
 /*******************************************************************************
  * The `ag_object_registry_init()` interface function initialises the object
- * registry by creating new instances of the internal registries. Both of the
- * internal registries are passed the `reg_dispose()` helper function as the
- * disposal callback.
+ * registry by creating new instances of the internal registries through the
+ * `reg_init()` helper function. Since object types defined through the
+ * `AG_OBJECT_DEFINE()` macro are registered by constructors that run before
+ * `main()`, the internal registries may well exist by the time this function
+ * is called, in which case they are left untouched.
  */
 
 extern void
 ag_object_registry_init(void)
 {
-        g_argent = ag_registry_new(reg_dispose);
-        g_client = ag_registry_new(reg_dispose);
-        
+        reg_init();
         ag_log_info("started object registry");
 }
 
@@ -116,6 +129,7 @@ ag_object_registry_exit(void)
 {
         ag_registry_release(&g_argent);
         ag_registry_release(&g_client);
+        g_argent = g_client = NULL;
         
         ag_log_info("stopped object registry");
 }
@@ -156,16 +170,8 @@ ag_object_registry_push(ag_typeid typeid, const char *typenm,
 {
         AG_ASSERT_PTR (vt);
 
-        struct ag_object_vtable *v = ag_memblock_new(sizeof *v);
-        CBK_SELECT(v, vt, typenm, clone);
-        CBK_SELECT(v, vt, typenm, release);
-        CBK_SELECT(v, vt, typenm, cmp);
-        CBK_SELECT(v, vt, typenm, valid);
-        CBK_SELECT(v, vt, typenm, sz);
-        CBK_SELECT(v, vt, typenm, len);
-        CBK_SELECT(v, vt, typenm, hash);
-        CBK_SELECT(v, vt, typenm, str);
-        CBK_SELECT(v, vt, typenm, json);
+        reg_init();
+        struct ag_object_vtable *v = vt_select(typenm, vt, true);
         
         ag_registry *r = typeid < 0 ? g_argent : g_client;
         ag_hash h = ag_hash_new(typeid);
@@ -175,6 +181,81 @@ ag_object_registry_push(ag_typeid typeid, const char *typenm,
 }
 
 
+/*******************************************************************************
+ * The `__ag_object_register_static__()` protected function is called by the
+ * constructor generated by the `AG_OBJECT_DEFINE()` macro in order to register
+ * an object type before `main()` runs. The type name, type ID and the constant
+ * v-table emitted by the macro are passed through the three parameters, with
+ * any callback that has not been defined being a null weak symbol.
+ *
+ * This is the same as `ag_object_registry_push()`, except that nothing is
+ * logged because the logging unit has not yet been initialised, and the
+ * internal registries are created on demand. If the type ID has already been
+ * registered, then the existing v-table is kept.
+ */
+
+extern void
+__ag_object_register_static__(const char *typenm, ag_typeid typeid,
+    const struct ag_object_vtable *vt)
+{
+        AG_ASSERT_STR (typenm);
+        AG_ASSERT_PTR (vt);
+
+        reg_init();
+
+        ag_registry *r = typeid < 0 ? g_argent : g_client;
+        ag_hash h = ag_hash_new(typeid);
+
+        if (AG_LIKELY (!ag_registry_get(r, h)))
+                ag_registry_push(r, h, vt_select(typenm, vt, false));
+}
+
+
+/*******************************************************************************
+ * The `reg_init()` helper function creates the internal registries if they
+ * have not already been created. Both of the internal registries are passed
+ * the `reg_dispose()` helper function as the disposal callback.
+ */
+
+static void
+reg_init(void)
+{
+        if (AG_UNLIKELY (!g_argent)) {
+                g_argent = ag_registry_new(reg_dispose);
+                g_client = ag_registry_new(reg_dispose);
+        }
+}
+
+
+/*******************************************************************************
+ * The `vt_select()` helper function creates a copy of an object v-table (second
+ * parameter) in which every callback that has not been provided is replaced by
+ * its default callback. The type name is passed through the first parameter,
+ * and the third parameter specifies whether or not the selection is logged.
+ */
+
+static struct ag_object_vtable *
+vt_select(const char *typenm, const struct ag_object_vtable *vt, bool log)
+{
+        struct ag_object_vtable *v = ag_memblock_new(sizeof *v);
+
+        CBK_SELECT(v, vt, typenm, clone, log);
+        CBK_SELECT(v, vt, typenm, release, log);
+        CBK_SELECT(v, vt, typenm, cmp, log);
+        CBK_SELECT(v, vt, typenm, valid, log);
+        CBK_SELECT(v, vt, typenm, sz, log);
+        CBK_SELECT(v, vt, typenm, len, log);
+        CBK_SELECT(v, vt, typenm, hash, log);
+        CBK_SELECT(v, vt, typenm, str, log);
+        CBK_SELECT(v, vt, typenm, json, log);
+        CBK_SELECT(v, vt, typenm, pack, log);
+        CBK_SELECT(v, vt, typenm, unpack, log);
+        CBK_SELECT(v, vt, typenm, freeze, log);
+
+        return v;
+}
+
+
 /*******************************************************************************
  * The `reg_dispose()` helper function is the callback function invoked by
  * `ag_registry_release()` to dispose of each object v-table instance contained
@@ -280,8 +361,7 @@ def_len(const ag_object *hnd)
 static ag_hash
 def_hash(const ag_object *hnd)
 {
-        AG_AUTO(ag_uuid) *u = ag_object_uuid(hnd);
-        return ag_uuid_hash(u);
+        return ag_uuid_hash(ag_object_uuid_peek(hnd));
 }
 
 
@@ -295,10 +375,11 @@ def_hash(const ag_object *hnd)
 static ag_string *
 def_str(const ag_object *hnd)
 {
-        AG_AUTO(ag_uuid) *u = ag_object_uuid(hnd);
-        AG_AUTO(ag_string)  *ustr = ag_uuid_str(u);
+        char ustr[AG_UUID_STR_LEN];
         AG_AUTO(ag_string)  *mstr = ag_memblock_str(hnd);
 
+        ag_uuid_fmt(ag_object_uuid_peek(hnd), ustr);
+
         return ag_string_new_fmt("typeid = %d, uuid = %s, address = %s",
             ag_object_typeid(hnd), ustr, mstr);
 }
@@ -307,13 +388,63 @@ def_str(const ag_object *hnd)
 static ag_string *
 def_json(const ag_object *hnd)
 {
-        AG_AUTO(ag_uuid) *u = ag_object_uuid(hnd);
-        AG_AUTO(ag_string) *ustr = ag_uuid_str(u);
+        char ustr[AG_UUID_STR_LEN];
         AG_AUTO(ag_string) *mstr = ag_memblock_str(hnd);
 
+        ag_uuid_fmt(ag_object_uuid_peek(hnd), ustr);
+
         return ag_string_new_fmt(
             "{\"object\":"
             "{\"typeid\":\"%d\",\"uuid\":\"%s\",\"address\":\"%s\"}}",
             ag_object_typeid(hnd), ustr, mstr);
 }
 
+
+/*******************************************************************************
+ * The `def_pack()` helper function is the default callback function for the
+ * `ag_object_pack()` method. Just like `def_clone()`, it treats the payload as
+ * a flat sequence of bytes and writes it as a binary blob; types that hold
+ * pointers in their payload are expected to provide their own callback.
+ */
+
+static void
+def_pack(const ag_object *hnd, ag_pack *pk)
+{
+        const ag_memblock *p = ag_object_payload(hnd);
+        ag_pack_bin(pk, p, ag_memblock_sz(p));
+}
+
+
+/*******************************************************************************
+ * The `def_unpack()` helper function is the default callback function for the
+ * `ag_object_unpack()` method, and is the converse of `def_pack()`. We read the
+ * binary blob written by `def_pack()` into a new payload.
+ */
+
+static ag_memblock *
+def_unpack(struct ag_unpack *rd)
+{
+        size_t sz;
+        const void *b = ag_unpack_bin(rd, &sz);
+
+        AG_UNPACK_REQUIRE (sz, "ag_object");
+
+        ag_memblock *p = ag_memblock_new(sz);
+        memcpy(p, b, sz);
+
+        return p;
+}
+
+
+/*******************************************************************************
+ * The `def_freeze()` helper function is the default callback function for the
+ * `ag_object_freeze()` method. The payload itself is frozen by
+ * `ag_object_freeze()`, so there is nothing more to do for a payload that does
+ * not hold any pointers.
+ */
+
+static void
+def_freeze(ag_memblock *hnd)
+{
+        (void)hnd;
+}
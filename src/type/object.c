@@ -30,7 +30,7 @@
 
 struct ag_object {
         ag_typeid        typeid;  /* Object type ID */
-        ag_uuid         *uuid;    /* Object ID      */
+        ag_uuid          uuid;    /* Object ID      */
         ag_memblock     *payload; /* Object payload */
 };
 
@@ -55,7 +55,7 @@ ag_object_new(ag_typeid typeid, ag_memblock *payload)
 
         ag_object *ctx = ag_memblock_new(sizeof *ctx);
         
-        ctx->uuid    = ag_uuid_new();
+        ag_uuid_generate(&ctx->uuid, AG_UUID_V4);
         ctx->typeid  = typeid;
         ctx->payload = payload;
 
@@ -88,16 +88,18 @@ ag_object_release(ag_object **ctx)
         ag_memblock *m;
 
         if (AG_LIKELY (ctx && (o = *ctx))) {
-                if (ag_memblock_refc(o) == 1) {
-                        ag_uuid_release(&o->uuid);
+                m = o;
+
+                if (ag_memblock_release_last(&m)) {
                         vtable_get(o)->release(o->payload);
 
                         m = o->payload;
                         ag_memblock_release(&m);
+
+                        m = o;
+                        ag_memblock_release(&m);
                 }
 
-                m = o;
-                ag_memblock_release(&m);
                 *ctx = m;
         }
 }
@@ -127,7 +129,19 @@ ag_object_uuid(const ag_object *ctx)
 {
         AG_ASSERT_PTR (ctx);
 
-        return ag_uuid_copy(ctx->uuid);
+        ag_uuid *u = ag_memblock_new(sizeof *u);
+        *u = ctx->uuid;
+
+        return u;
+}
+
+
+extern const ag_uuid *
+ag_object_uuid_peek(const ag_object *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        return &ctx->uuid;
 }
 
 
@@ -194,6 +208,78 @@ ag_object_json(const ag_object *ctx)
 }
 
 
+/*
+ * An object is packed as a MessagePack extension whose body is the type ID of
+ * the object followed by its payload as written by the pack callback of its
+ * type. Unpacking reverses this, checking that the callback consumed exactly
+ * the body of the extension.
+ */
+extern void
+ag_object_pack(const ag_object *ctx, ag_pack *pk)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (pk);
+
+        size_t mark = ag_pack_ext_open(pk, AG_PACK_EXT_OBJECT);
+        ag_pack_int(pk, ctx->typeid);
+        vtable_get(ctx)->pack(ctx, pk);
+        ag_pack_ext_close(pk, mark);
+}
+
+
+extern ag_object *
+ag_object_unpack(struct ag_unpack *rd)
+{
+        AG_ASSERT_PTR (rd);
+
+        size_t len;
+        int8_t ext = ag_unpack_ext(rd, &len);
+        AG_UNPACK_REQUIRE (ext == AG_PACK_EXT_OBJECT, "ag_object");
+
+        const unsigned char *end = rd->pos + len;
+        ag_typeid typeid = ag_unpack_int(rd);
+        const struct ag_object_vtable *vt = ag_object_registry_get(typeid);
+        AG_UNPACK_REQUIRE (vt, "ag_object");
+
+        ag_memblock *payload = vt->unpack(rd);
+        AG_UNPACK_REQUIRE (rd->pos == end, "ag_object");
+
+        return ag_object_new(typeid, payload);
+}
+
+
+/*
+ * Freezing an object makes it immortal: its reference count is replaced by a
+ * sentinel through ag_memblock_freeze(), so that copying and releasing it are
+ * no-ops that never write to it. The freeze callback of the type is expected to
+ * freeze everything reachable from the payload, so that the whole graph can be
+ * shared without reference counting. A frozen object can't be modified in
+ * place; mutators go through ag_object_payload_mutable() and so work on an
+ * unfrozen clone. A frozen object is never released.
+ */
+extern void
+ag_object_freeze(ag_object *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        if (ag_memblock_frozen(ctx))
+                return;
+
+        ag_memblock_freeze(ctx);
+        ag_memblock_freeze(ctx->payload);
+        vtable_get(ctx)->freeze(ctx->payload);
+}
+
+
+extern bool
+ag_object_frozen(const ag_object *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        return ag_memblock_frozen(ctx);
+}
+
+
 extern const ag_memblock *
 ag_object_payload(const ag_object *ctx)
 {
@@ -209,16 +295,26 @@ ag_object_payload_mutable(ag_object **ctx)
         AG_ASSERT_PTR (ctx && *ctx);
 
         ag_object *o = *ctx;
-        ag_memblock *m = o;
 
-        if (ag_memblock_refc(m) > 1) {
-                ag_memblock_release(&m);
-                *ctx = ag_object_clone(o);
+        if (ag_memblock_refc(o) > 1) {
+                ag_object *cp = ag_object_clone(o);
+
+                ag_object_release(&o);
+                *ctx = cp;
         }
 
         return (*ctx)->payload;
 }
 
+
+/*
+ * Object types defined through AG_OBJECT_DEFINE() register themselves through
+ * a constructor before main() runs, so no symbol lookup is needed for them. The
+ * dynamic registration path below is retained for plugins that register their
+ * types explicitly through AG_OBJECT_REGISTER(); their callbacks are resolved
+ * by name through dlsym(), and so need to be exported.
+ */
+
 static void *
 sym_load(void *dso, const char *type, const char *meth)
 {
@@ -238,6 +334,12 @@ __ag_object_register__(const char *type, ag_typeid tid)
 {
         AG_ASSERT_STR (type);
 
+        if (ag_object_registry_get(tid)) {
+                ag_log_debug("%s (%d) already registered statically", type,
+                    tid);
+                return;
+        }
+
         dlerror();
         void *dso = dlopen(NULL, RTLD_LAZY | RTLD_GLOBAL);
 
@@ -257,6 +359,9 @@ __ag_object_register__(const char *type, ag_typeid tid)
         vt.hash = sym_load(dso, type, "hash");
         vt.str = sym_load(dso, type, "str");
         vt.json = sym_load(dso, type, "json");
+        vt.pack = sym_load(dso, type, "pack");
+        vt.unpack = sym_load(dso, type, "unpack");
+        vt.freeze = sym_load(dso, type, "freeze");
 
         ag_object_registry_push(tid, type, &vt);
         dlclose(dso);
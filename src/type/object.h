@@ -33,6 +33,7 @@ extern "C" {
 #include "../util/hash.h"
 #include "../base/base.h"
 #include "./typeid.h"
+#include "./pack.h"
 #include "../util/uuid.h"
 
 
@@ -149,6 +150,18 @@ typedef struct ag_object ag_object;
                 AG_ASSERT (ag_object_typeid(ctx) == __##T##_tid__);     \
                 return ag_object_json(ctx);                             \
         }                                                               \
+        inline void T ## _freeze(T *ctx)                                \
+        {                                                               \
+                AG_ASSERT_PTR (ctx);                                    \
+                AG_ASSERT (ag_object_typeid(ctx) == __##T##_tid__);     \
+                ag_object_freeze(ctx);                                  \
+        }                                                               \
+        inline bool T ## _frozen(const T *ctx)                          \
+        {                                                               \
+                AG_ASSERT_PTR (ctx);                                    \
+                AG_ASSERT (ag_object_typeid(ctx) == __##T##_tid__);     \
+                return ag_object_frozen(ctx);                           \
+        }                                                               \
         extern void __ ## T ## _register__(void)
 
 
@@ -242,6 +255,40 @@ typedef struct ag_object ag_object;
         }
 
 
+#define AG_OBJECT_DEFINE_PACK(T, CLOS)                                  \
+        void                                                            \
+        __##T##_pack__(const ag_object *_o_, ag_pack *_w_)              \
+        {                                                               \
+                AG_ASSERT_PTR (_o_);                                    \
+                AG_ASSERT_PTR (_w_);                                    \
+                AG_ASSERT (ag_object_typeid(_o_) == __##T##_tid__);     \
+                CLOS                                                    \
+        }
+
+
+#define AG_OBJECT_DEFINE_UNPACK(T, CLOS)                \
+        ag_memblock *                                   \
+        __##T##_unpack__(struct ag_unpack *_r_)         \
+        {                                               \
+                AG_ASSERT_PTR (_r_);                    \
+                CLOS                                    \
+        }
+
+
+#define AG_OBJECT_DEFINE_FREEZE(T, CLOS)        \
+        void                                    \
+        __##T##_freeze__(ag_memblock *_p_)      \
+        {                                       \
+                AG_ASSERT_PTR (_p_);            \
+                CLOS                            \
+        }
+
+
+/*
+ * AG_OBJECT_DEFINE() builds the vtable of a type from weak references to its
+ * callbacks, so that a callback the type leaves undefined is a null entry while
+ * the callbacks that it does define remain ordinary strong symbols.
+ */
 #define AG_OBJECT_DEFINE(T, TID)                                        \
         const ag_typeid __##T##_tid__ = TID;                            \
         extern inline T *T##_copy(const T *);                           \
@@ -261,6 +308,64 @@ typedef struct ag_object ag_object;
         extern inline ag_hash T##_hash(const T *);                      \
         extern inline ag_string *T##_str(const T *);                    \
         extern inline ag_string *T##_json(const T *);                   \
+        extern inline void T##_freeze(T *);                             \
+        extern inline bool T##_frozen(const T *);                       \
+        extern ag_object_clone_virt __##T##_clone__;                    \
+        extern ag_object_release_virt __##T##_release__;                \
+        extern ag_object_cmp_virt __##T##_cmp__;                        \
+        extern ag_object_valid_virt __##T##_valid__;                    \
+        extern ag_object_sz_virt __##T##_sz__;                          \
+        extern ag_object_len_virt __##T##_len__;                        \
+        extern ag_object_hash_virt __##T##_hash__;                      \
+        extern ag_object_str_virt __##T##_str__;                        \
+        extern ag_object_json_virt __##T##_json__;                      \
+        extern ag_object_pack_virt __##T##_pack__;                      \
+        extern ag_object_unpack_virt __##T##_unpack__;                  \
+        extern ag_object_freeze_virt __##T##_freeze__;                  \
+        static ag_object_clone_virt __##T##_clone_ref__                 \
+            __attribute__((weakref("__" #T "_clone__")));               \
+        static ag_object_release_virt __##T##_release_ref__             \
+            __attribute__((weakref("__" #T "_release__")));             \
+        static ag_object_cmp_virt __##T##_cmp_ref__                     \
+            __attribute__((weakref("__" #T "_cmp__")));                 \
+        static ag_object_valid_virt __##T##_valid_ref__                 \
+            __attribute__((weakref("__" #T "_valid__")));               \
+        static ag_object_sz_virt __##T##_sz_ref__                       \
+            __attribute__((weakref("__" #T "_sz__")));                  \
+        static ag_object_len_virt __##T##_len_ref__                     \
+            __attribute__((weakref("__" #T "_len__")));                 \
+        static ag_object_hash_virt __##T##_hash_ref__                   \
+            __attribute__((weakref("__" #T "_hash__")));                \
+        static ag_object_str_virt __##T##_str_ref__                     \
+            __attribute__((weakref("__" #T "_str__")));                 \
+        static ag_object_json_virt __##T##_json_ref__                   \
+            __attribute__((weakref("__" #T "_json__")));                \
+        static ag_object_pack_virt __##T##_pack_ref__                   \
+            __attribute__((weakref("__" #T "_pack__")));                \
+        static ag_object_unpack_virt __##T##_unpack_ref__               \
+            __attribute__((weakref("__" #T "_unpack__")));              \
+        static ag_object_freeze_virt __##T##_freeze_ref__               \
+            __attribute__((weakref("__" #T "_freeze__")));              \
+        static const struct ag_object_vtable __##T##_vtable__ = {      \
+                .clone = __##T##_clone_ref__,                           \
+                .release = __##T##_release_ref__,                       \
+                .cmp = __##T##_cmp_ref__,                               \
+                .valid = __##T##_valid_ref__,                           \
+                .sz = __##T##_sz_ref__,                                 \
+                .len = __##T##_len_ref__,                               \
+                .hash = __##T##_hash_ref__,                             \
+                .str = __##T##_str_ref__,                               \
+                .json = __##T##_json_ref__,                             \
+                .pack = __##T##_pack_ref__,                             \
+                .unpack = __##T##_unpack_ref__,                         \
+                .freeze = __##T##_freeze_ref__,                         \
+        };                                                              \
+        __attribute__((constructor)) static void                        \
+        __##T##_ctor__(void)                                            \
+        {                                                               \
+                __ag_object_register_static__(#T, TID,                  \
+                    &__##T##_vtable__);                                 \
+        }                                                               \
         extern void __##T##_register__(void)                            \
         {                                                               \
                 __ag_object_register__(#T, TID);                        \
@@ -276,6 +381,7 @@ extern enum ag_cmp               ag_object_cmp(const ag_object *,
                                     const ag_object *);
 extern ag_typeid                 ag_object_typeid(const ag_object *);
 extern ag_uuid                  *ag_object_uuid(const ag_object *);
+extern const ag_uuid            *ag_object_uuid_peek(const ag_object *);
 extern bool                      ag_object_valid(const ag_object *);
 extern size_t                    ag_object_sz(const ag_object *);
 extern size_t                    ag_object_refc(const ag_object *);
@@ -283,6 +389,10 @@ extern size_t                    ag_object_len(const ag_object *);
 extern ag_hash                   ag_object_hash(const ag_object *);
 extern ag_string                *ag_object_str(const ag_object *);
 extern ag_string                *ag_object_json(const ag_object *);
+extern void                      ag_object_pack(const ag_object *, ag_pack *);
+extern ag_object                *ag_object_unpack(struct ag_unpack *);
+extern void                      ag_object_freeze(ag_object *);
+extern bool                      ag_object_frozen(const ag_object *);
 extern const ag_memblock        *ag_object_payload(const ag_object *);
 extern ag_memblock              *ag_object_payload_mutable(ag_object **);
 extern void                      __ag_object_register__(const char *,
@@ -323,6 +433,9 @@ typedef size_t           (ag_object_len_virt)(const ag_object *);
 typedef ag_hash          (ag_object_hash_virt)(const ag_object *);
 typedef ag_string       *(ag_object_str_virt)(const ag_object *);
 typedef ag_string       *(ag_object_json_virt)(const ag_object *);
+typedef void             (ag_object_pack_virt)(const ag_object *, ag_pack *);
+typedef ag_memblock     *(ag_object_unpack_virt)(struct ag_unpack *);
+typedef void             (ag_object_freeze_virt)(ag_memblock *);
 
 
 struct ag_object_vtable {
@@ -335,6 +448,9 @@ struct ag_object_vtable {
         ag_object_hash_virt     *hash;    /* Hash computation callback    */
         ag_object_str_virt      *str;     /* String generation callback   */
         ag_object_json_virt     *json;    /* JSON representation callback */
+        ag_object_pack_virt     *pack;    /* Binary encoding callback     */
+        ag_object_unpack_virt   *unpack;  /* Binary decoding callback     */
+        ag_object_freeze_virt   *freeze;  /* Payload freezing callback    */
 };
 
 
@@ -344,6 +460,9 @@ extern const struct ag_object_vtable    *ag_object_registry_get(ag_typeid);
 extern void                              ag_object_registry_push(ag_typeid,
                                             const char *,
                                             const struct ag_object_vtable *);
+extern void                              __ag_object_register_static__(
+                                            const char *, ag_typeid,
+                                            const struct ag_object_vtable *);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,951 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "../argent.h"
+
+#include <string.h>
+
+
+/*******************************************************************************
+ * The writer keeps its output in a memory block that grows geometrically, so
+ * that a long run of small writes costs amortised O(1) per byte. We track the
+ * number of bytes written separately from the capacity of the buffer.
+ */
+
+struct ag_pack {
+        unsigned char   *bfr;   /* Output buffer       */
+        size_t           len;   /* Bytes written       */
+        size_t           cap;   /* Capacity of buffer  */
+};
+
+#define PACK_CAP_MIN ((size_t) 64)
+
+
+/*******************************************************************************
+ * The MessagePack format markers that we either emit or accept. The fix*
+ * markers are the base values of their respective ranges.
+ */
+
+enum {
+        MK_FIXMAP       = 0x80,
+        MK_FIXARRAY     = 0x90,
+        MK_FIXSTR       = 0xa0,
+        MK_NIL          = 0xc0,
+        MK_FALSE        = 0xc2,
+        MK_TRUE         = 0xc3,
+        MK_BIN8         = 0xc4,
+        MK_BIN16        = 0xc5,
+        MK_BIN32        = 0xc6,
+        MK_EXT8         = 0xc7,
+        MK_EXT16        = 0xc8,
+        MK_EXT32        = 0xc9,
+        MK_FLOAT32      = 0xca,
+        MK_FLOAT64      = 0xcb,
+        MK_UINT8        = 0xcc,
+        MK_UINT16       = 0xcd,
+        MK_UINT32       = 0xce,
+        MK_UINT64       = 0xcf,
+        MK_INT8         = 0xd0,
+        MK_INT16        = 0xd1,
+        MK_INT32        = 0xd2,
+        MK_INT64        = 0xd3,
+        MK_FIXEXT1      = 0xd4,
+        MK_FIXEXT2      = 0xd5,
+        MK_FIXEXT4      = 0xd6,
+        MK_FIXEXT8      = 0xd7,
+        MK_FIXEXT16     = 0xd8,
+        MK_STR8         = 0xd9,
+        MK_STR16        = 0xda,
+        MK_STR32        = 0xdb,
+        MK_ARRAY16      = 0xdc,
+        MK_ARRAY32      = 0xdd,
+        MK_MAP16        = 0xde,
+        MK_MAP32        = 0xdf,
+        MK_NEGFIXINT    = 0xe0,
+};
+
+
+/*******************************************************************************
+ * Helper functions for the writer. `pack_reserve()` ensures that there is room
+ * for a given number of bytes and returns a pointer to where they should be
+ * written, and the `put_*()` helpers write big-endian scalars as required by
+ * MessagePack.
+ */
+
+static unsigned char    *pack_reserve(ag_pack *, size_t);
+static void              pack_head(ag_pack *, unsigned char, size_t);
+
+static inline void      put_be16(unsigned char *, uint16_t);
+static inline void      put_be32(unsigned char *, uint32_t);
+static inline void      put_be64(unsigned char *, uint64_t);
+
+
+/*******************************************************************************
+ * Helper functions for the reader. `unpack_need()` raises a parse exception if
+ * the input is too short to hold a given number of bytes, and the `get_*()`
+ * helpers read big-endian scalars.
+ */
+
+static inline void      unpack_need(const struct ag_unpack *, size_t,
+                            const char *);
+static size_t           unpack_len(struct ag_unpack *, size_t, const char *);
+
+static inline uint16_t  get_be16(const unsigned char *);
+static inline uint32_t  get_be32(const unsigned char *);
+static inline uint64_t  get_be64(const unsigned char *);
+
+
+/*******************************************************************************
+ * `ag_pack_new()` creates a new writer with an empty output buffer, and
+ * `ag_pack_release()` releases it along with its buffer. The output written so
+ * far is available through `ag_pack_bfr()` and `ag_pack_len()`; the buffer is
+ * owned by the writer and is invalidated by further writes.
+ */
+
+extern ag_pack *
+ag_pack_new(void)
+{
+        ag_pack *ctx = ag_memblock_new(sizeof *ctx);
+
+        ctx->bfr = ag_memblock_new(PACK_CAP_MIN);
+        ctx->cap = PACK_CAP_MIN;
+        ctx->len = 0;
+
+        return ctx;
+}
+
+
+extern void
+ag_pack_release(ag_pack **ctx)
+{
+        ag_pack *p;
+
+        if (AG_LIKELY (ctx && (p = *ctx))) {
+                if (ag_memblock_release_last((ag_memblock **)ctx)) {
+                        ag_memblock_release((ag_memblock **)&p->bfr);
+                        ag_memblock_release((ag_memblock **)ctx);
+                }
+        }
+}
+
+
+extern const char *
+ag_pack_bfr(const ag_pack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        return (const char *)ctx->bfr;
+}
+
+
+extern size_t
+ag_pack_len(const ag_pack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        return ctx->len;
+}
+
+
+/*******************************************************************************
+ * The scalar writers. Integers are written in the smallest format that can hold
+ * them, but signed and unsigned integers are kept in their own families of
+ * formats so that the reader can tell them apart. Floats are always written as
+ * 64-bit IEEE 754 values so that they round trip exactly.
+ */
+
+extern void
+ag_pack_nil(ag_pack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        *pack_reserve(ctx, 1) = MK_NIL;
+}
+
+
+extern void
+ag_pack_bool(ag_pack *ctx, bool val)
+{
+        AG_ASSERT_PTR (ctx);
+
+        *pack_reserve(ctx, 1) = val ? MK_TRUE : MK_FALSE;
+}
+
+
+extern void
+ag_pack_int(ag_pack *ctx, ag_int val)
+{
+        AG_ASSERT_PTR (ctx);
+
+        register unsigned char *b;
+
+        if (val >= -32 && val <= 127) {
+                *pack_reserve(ctx, 1) = (unsigned char)(int8_t)val;
+        } else if (val >= INT8_MIN && val <= INT8_MAX) {
+                b = pack_reserve(ctx, 2);
+                b[0] = MK_INT8;
+                b[1] = (unsigned char)(int8_t)val;
+        } else if (val >= INT16_MIN && val <= INT16_MAX) {
+                b = pack_reserve(ctx, 3);
+                b[0] = MK_INT16;
+                put_be16(b + 1, (uint16_t)(int16_t)val);
+        } else if (val >= INT32_MIN && val <= INT32_MAX) {
+                b = pack_reserve(ctx, 5);
+                b[0] = MK_INT32;
+                put_be32(b + 1, (uint32_t)(int32_t)val);
+        } else {
+                b = pack_reserve(ctx, 9);
+                b[0] = MK_INT64;
+                put_be64(b + 1, (uint64_t)(int64_t)val);
+        }
+}
+
+
+extern void
+ag_pack_uint(ag_pack *ctx, ag_uint val)
+{
+        AG_ASSERT_PTR (ctx);
+
+        register unsigned char *b;
+
+        if (val <= UINT8_MAX) {
+                b = pack_reserve(ctx, 2);
+                b[0] = MK_UINT8;
+                b[1] = (unsigned char)val;
+        } else if (val <= UINT16_MAX) {
+                b = pack_reserve(ctx, 3);
+                b[0] = MK_UINT16;
+                put_be16(b + 1, (uint16_t)val);
+        } else if (val <= UINT32_MAX) {
+                b = pack_reserve(ctx, 5);
+                b[0] = MK_UINT32;
+                put_be32(b + 1, (uint32_t)val);
+        } else {
+                b = pack_reserve(ctx, 9);
+                b[0] = MK_UINT64;
+                put_be64(b + 1, (uint64_t)val);
+        }
+}
+
+
+extern void
+ag_pack_float(ag_pack *ctx, ag_float val)
+{
+        AG_ASSERT_PTR (ctx);
+
+        uint64_t bits;
+        memcpy(&bits, &val, sizeof bits);
+
+        unsigned char *b = pack_reserve(ctx, 9);
+        b[0] = MK_FLOAT64;
+        put_be64(b + 1, bits);
+}
+
+
+/*******************************************************************************
+ * The variable length writers. Strings and binary blobs are written as a header
+ * carrying their length followed by their bytes; arrays and maps are written as
+ * a header carrying their item count, and it is up to the caller to write the
+ * items (or key-value pairs in the case of maps) that follow.
+ */
+
+extern void
+ag_pack_str(ag_pack *ctx, const char *str, size_t len)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (str);
+
+        if (len < 32)
+                *pack_reserve(ctx, 1) = MK_FIXSTR | (unsigned char)len;
+        else if (len <= UINT8_MAX)
+                pack_head(ctx, MK_STR8, len);
+        else if (len <= UINT16_MAX)
+                pack_head(ctx, MK_STR16, len);
+        else
+                pack_head(ctx, MK_STR32, len);
+
+        if (AG_LIKELY (len))
+                memcpy(pack_reserve(ctx, len), str, len);
+}
+
+
+extern void
+ag_pack_string(ag_pack *ctx, const char *str)
+{
+        AG_ASSERT_PTR (str);
+
+        ag_pack_str(ctx, str, strlen(str));
+}
+
+
+extern void
+ag_pack_bin(ag_pack *ctx, const void *bin, size_t len)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (bin);
+
+        if (len <= UINT8_MAX)
+                pack_head(ctx, MK_BIN8, len);
+        else if (len <= UINT16_MAX)
+                pack_head(ctx, MK_BIN16, len);
+        else
+                pack_head(ctx, MK_BIN32, len);
+
+        if (AG_LIKELY (len))
+                memcpy(pack_reserve(ctx, len), bin, len);
+}
+
+
+extern void
+ag_pack_array(ag_pack *ctx, size_t len)
+{
+        AG_ASSERT_PTR (ctx);
+
+        if (len < 16)
+                *pack_reserve(ctx, 1) = MK_FIXARRAY | (unsigned char)len;
+        else if (len <= UINT16_MAX)
+                pack_head(ctx, MK_ARRAY16, len);
+        else
+                pack_head(ctx, MK_ARRAY32, len);
+}
+
+
+extern void
+ag_pack_map(ag_pack *ctx, size_t len)
+{
+        AG_ASSERT_PTR (ctx);
+
+        if (len < 16)
+                *pack_reserve(ctx, 1) = MK_FIXMAP | (unsigned char)len;
+        else if (len <= UINT16_MAX)
+                pack_head(ctx, MK_MAP16, len);
+        else
+                pack_head(ctx, MK_MAP32, len);
+}
+
+
+/*******************************************************************************
+ * Extensions are written in two steps because we don't know the size of the
+ * body until it has been written. `ag_pack_ext_open()` reserves room for the
+ * largest possible header and returns its offset as a mark, and
+ * `ag_pack_ext_close()` writes the smallest header that fits the body, sliding
+ * the body down over the unused part of the reserved header. Extensions may be
+ * nested, since an inner extension is always closed before its outer one.
+ */
+
+extern size_t
+ag_pack_ext_open(ag_pack *ctx, int8_t type)
+{
+        AG_ASSERT_PTR (ctx);
+
+        size_t mark = ctx->len;
+        unsigned char *b = pack_reserve(ctx, 6);
+
+        b[0] = MK_EXT32;
+        b[5] = (unsigned char)type;
+
+        return mark;
+}
+
+
+extern void
+ag_pack_ext_close(ag_pack *ctx, size_t mark)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT (mark + 6 <= ctx->len);
+
+        unsigned char *b = ctx->bfr + mark;
+        unsigned char type = b[5];
+        size_t len = ctx->len - mark - 6;
+        size_t hdr;
+
+        switch (len) {
+        case 1: case 2: case 4: case 8: case 16:
+                hdr = 2;
+                break;
+        default:
+                if (len <= UINT8_MAX)
+                        hdr = 3;
+                else if (len <= UINT16_MAX)
+                        hdr = 4;
+                else
+                        hdr = 6;
+        }
+
+        if (hdr < 6) {
+                memmove(b + hdr, b + 6, len);
+                ctx->len -= 6 - hdr;
+        }
+
+        switch (hdr) {
+        case 2:
+                b[0] = len == 1 ? MK_FIXEXT1 : len == 2 ? MK_FIXEXT2
+                    : len == 4 ? MK_FIXEXT4 : len == 8 ? MK_FIXEXT8
+                    : MK_FIXEXT16;
+                b[1] = type;
+                break;
+        case 3:
+                b[0] = MK_EXT8;
+                b[1] = (unsigned char)len;
+                b[2] = type;
+                break;
+        case 4:
+                b[0] = MK_EXT16;
+                put_be16(b + 1, (uint16_t)len);
+                b[3] = type;
+                break;
+        default:
+                b[0] = MK_EXT32;
+                put_be32(b + 1, (uint32_t)len);
+                b[5] = type;
+        }
+}
+
+
+/*******************************************************************************
+ * `ag_unpack_init()` points a reader to an input buffer of a given length, and
+ * `ag_unpack_done()` checks whether the reader has consumed the entire buffer.
+ * `ag_unpack_type()` peeks at the type of the next item without consuming it.
+ */
+
+extern void
+ag_unpack_init(struct ag_unpack *ctx, const void *bfr, size_t len)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (bfr);
+
+        ctx->pos = bfr;
+        ctx->end = ctx->pos + len;
+}
+
+
+extern bool
+ag_unpack_done(const struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        return ctx->pos >= ctx->end;
+}
+
+
+extern enum ag_pack_type
+ag_unpack_type(const struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        unpack_need(ctx, 1, "ag_unpack_type");
+
+        register unsigned char m = *ctx->pos;
+
+        if (m <= 0x7f || m >= MK_NEGFIXINT)
+                return AG_PACK_TYPE_INT;
+
+        if (m < MK_FIXARRAY)
+                return AG_PACK_TYPE_MAP;
+
+        if (m < MK_FIXSTR)
+                return AG_PACK_TYPE_ARRAY;
+
+        if (m < MK_NIL)
+                return AG_PACK_TYPE_STR;
+
+        switch (m) {
+        case MK_NIL:
+                return AG_PACK_TYPE_NIL;
+        case MK_FALSE: case MK_TRUE:
+                return AG_PACK_TYPE_BOOL;
+        case MK_BIN8: case MK_BIN16: case MK_BIN32:
+                return AG_PACK_TYPE_BIN;
+        case MK_FLOAT32: case MK_FLOAT64:
+                return AG_PACK_TYPE_FLOAT;
+        case MK_UINT8: case MK_UINT16: case MK_UINT32: case MK_UINT64:
+                return AG_PACK_TYPE_UINT;
+        case MK_INT8: case MK_INT16: case MK_INT32: case MK_INT64:
+                return AG_PACK_TYPE_INT;
+        case MK_STR8: case MK_STR16: case MK_STR32:
+                return AG_PACK_TYPE_STR;
+        case MK_ARRAY16: case MK_ARRAY32:
+                return AG_PACK_TYPE_ARRAY;
+        case MK_MAP16: case MK_MAP32:
+                return AG_PACK_TYPE_MAP;
+        default:
+                return AG_PACK_TYPE_EXT;
+        }
+}
+
+
+/*******************************************************************************
+ * The scalar readers. `ag_unpack_int()` and `ag_unpack_uint()` accept any
+ * integer format as long as the value fits the requested type, and
+ * `ag_unpack_float()` accepts both 32-bit and 64-bit floats.
+ */
+
+extern void
+ag_unpack_nil(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        unpack_need(ctx, 1, "ag_unpack_nil");
+        AG_UNPACK_REQUIRE (*ctx->pos == MK_NIL, "ag_unpack_nil");
+
+        ctx->pos++;
+}
+
+
+extern bool
+ag_unpack_bool(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        unpack_need(ctx, 1, "ag_unpack_bool");
+
+        register unsigned char m = *ctx->pos++;
+        AG_UNPACK_REQUIRE (m == MK_TRUE || m == MK_FALSE, "ag_unpack_bool");
+
+        return m == MK_TRUE;
+}
+
+
+extern ag_int
+ag_unpack_int(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        unpack_need(ctx, 1, "ag_unpack_int");
+
+        register unsigned char m = *ctx->pos;
+        register const unsigned char *b = ctx->pos + 1;
+        uint64_t u;
+
+        if (m <= 0x7f || m >= MK_NEGFIXINT) {
+                ctx->pos++;
+                return (int8_t)m;
+        }
+
+        switch (m) {
+        case MK_INT8:
+                unpack_need(ctx, 2, "ag_unpack_int");
+                ctx->pos += 2;
+                return (int8_t)b[0];
+        case MK_INT16:
+                unpack_need(ctx, 3, "ag_unpack_int");
+                ctx->pos += 3;
+                return (int16_t)get_be16(b);
+        case MK_INT32:
+                unpack_need(ctx, 5, "ag_unpack_int");
+                ctx->pos += 5;
+                return (int32_t)get_be32(b);
+        case MK_INT64:
+                unpack_need(ctx, 9, "ag_unpack_int");
+                ctx->pos += 9;
+                return (ag_int)(int64_t)get_be64(b);
+        default:
+                u = ag_unpack_uint(ctx);
+                AG_UNPACK_REQUIRE (u <= (uint64_t)INTPTR_MAX, "ag_unpack_int");
+                return (ag_int)u;
+        }
+}
+
+
+extern ag_uint
+ag_unpack_uint(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        unpack_need(ctx, 1, "ag_unpack_uint");
+
+        register unsigned char m = *ctx->pos;
+        register const unsigned char *b = ctx->pos + 1;
+        ag_int i;
+
+        switch (m) {
+        case MK_UINT8:
+                unpack_need(ctx, 2, "ag_unpack_uint");
+                ctx->pos += 2;
+                return b[0];
+        case MK_UINT16:
+                unpack_need(ctx, 3, "ag_unpack_uint");
+                ctx->pos += 3;
+                return get_be16(b);
+        case MK_UINT32:
+                unpack_need(ctx, 5, "ag_unpack_uint");
+                ctx->pos += 5;
+                return get_be32(b);
+        case MK_UINT64:
+                unpack_need(ctx, 9, "ag_unpack_uint");
+                ctx->pos += 9;
+                return (ag_uint)get_be64(b);
+        default:
+                AG_UNPACK_REQUIRE (ag_unpack_type(ctx) == AG_PACK_TYPE_INT,
+                    "ag_unpack_uint");
+                i = ag_unpack_int(ctx);
+                AG_UNPACK_REQUIRE (i >= 0, "ag_unpack_uint");
+                return (ag_uint)i;
+        }
+}
+
+
+extern ag_float
+ag_unpack_float(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        unpack_need(ctx, 1, "ag_unpack_float");
+
+        register unsigned char m = *ctx->pos;
+        uint32_t bits32;
+        uint64_t bits64;
+        float f;
+        double d;
+
+        if (m == MK_FLOAT32) {
+                unpack_need(ctx, 5, "ag_unpack_float");
+                bits32 = get_be32(ctx->pos + 1);
+                memcpy(&f, &bits32, sizeof f);
+                ctx->pos += 5;
+                return f;
+        }
+
+        AG_UNPACK_REQUIRE (m == MK_FLOAT64, "ag_unpack_float");
+        unpack_need(ctx, 9, "ag_unpack_float");
+        bits64 = get_be64(ctx->pos + 1);
+        memcpy(&d, &bits64, sizeof d);
+        ctx->pos += 9;
+
+        return d;
+}
+
+
+/*******************************************************************************
+ * The variable length readers. `ag_unpack_str()` and `ag_unpack_bin()` don't
+ * copy anything; they return a pointer into the input buffer and write the
+ * length of the item through their second parameter. `ag_unpack_array()` and
+ * `ag_unpack_map()` return the item count of the container, leaving the reader
+ * positioned at its first item.
+ */
+
+extern const char *
+ag_unpack_str(struct ag_unpack *ctx, size_t *len)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (len);
+        unpack_need(ctx, 1, "ag_unpack_str");
+
+        register unsigned char m = *ctx->pos;
+
+        if (m >= MK_FIXSTR && m < MK_NIL) {
+                ctx->pos++;
+                *len = m & 0x1f;
+        } else if (m == MK_STR8) {
+                *len = unpack_len(ctx, 1, "ag_unpack_str");
+        } else if (m == MK_STR16) {
+                *len = unpack_len(ctx, 2, "ag_unpack_str");
+        } else {
+                AG_UNPACK_REQUIRE (m == MK_STR32, "ag_unpack_str");
+                *len = unpack_len(ctx, 4, "ag_unpack_str");
+        }
+
+        unpack_need(ctx, *len, "ag_unpack_str");
+        const char *s = (const char *)ctx->pos;
+        ctx->pos += *len;
+
+        return s;
+}
+
+
+extern ag_string *
+ag_unpack_string(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        size_t len;
+        const char *s = ag_unpack_str(ctx, &len);
+
+        ag_string *str = ag_memblock_new(len + 1);
+        memcpy(str, s, len);
+        str[len] = '\0';
+
+        return str;
+}
+
+
+extern const void *
+ag_unpack_bin(struct ag_unpack *ctx, size_t *len)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (len);
+        unpack_need(ctx, 1, "ag_unpack_bin");
+
+        register unsigned char m = *ctx->pos;
+
+        if (m == MK_BIN8) {
+                *len = unpack_len(ctx, 1, "ag_unpack_bin");
+        } else if (m == MK_BIN16) {
+                *len = unpack_len(ctx, 2, "ag_unpack_bin");
+        } else {
+                AG_UNPACK_REQUIRE (m == MK_BIN32, "ag_unpack_bin");
+                *len = unpack_len(ctx, 4, "ag_unpack_bin");
+        }
+
+        unpack_need(ctx, *len, "ag_unpack_bin");
+        const void *b = ctx->pos;
+        ctx->pos += *len;
+
+        return b;
+}
+
+
+extern size_t
+ag_unpack_array(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        unpack_need(ctx, 1, "ag_unpack_array");
+
+        register unsigned char m = *ctx->pos;
+
+        if (m >= MK_FIXARRAY && m < MK_FIXSTR) {
+                ctx->pos++;
+                return m & 0x0f;
+        }
+
+        if (m == MK_ARRAY16)
+                return unpack_len(ctx, 2, "ag_unpack_array");
+
+        AG_UNPACK_REQUIRE (m == MK_ARRAY32, "ag_unpack_array");
+        return unpack_len(ctx, 4, "ag_unpack_array");
+}
+
+
+extern size_t
+ag_unpack_map(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+        unpack_need(ctx, 1, "ag_unpack_map");
+
+        register unsigned char m = *ctx->pos;
+
+        if (m >= MK_FIXMAP && m < MK_FIXARRAY) {
+                ctx->pos++;
+                return m & 0x0f;
+        }
+
+        if (m == MK_MAP16)
+                return unpack_len(ctx, 2, "ag_unpack_map");
+
+        AG_UNPACK_REQUIRE (m == MK_MAP32, "ag_unpack_map");
+        return unpack_len(ctx, 4, "ag_unpack_map");
+}
+
+
+/*******************************************************************************
+ * `ag_unpack_ext()` reads the header of an extension, returning its type and
+ * writing the length of its body through the second parameter. The reader is
+ * left positioned at the start of the body, and we check that the entire body
+ * is present in the input.
+ */
+
+extern int8_t
+ag_unpack_ext(struct ag_unpack *ctx, size_t *len)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (len);
+        unpack_need(ctx, 1, "ag_unpack_ext");
+
+        register unsigned char m = *ctx->pos;
+
+        switch (m) {
+        case MK_FIXEXT1: case MK_FIXEXT2: case MK_FIXEXT4: case MK_FIXEXT8:
+        case MK_FIXEXT16:
+                ctx->pos++;
+                *len = (size_t)1 << (m - MK_FIXEXT1);
+                break;
+        case MK_EXT8:
+                *len = unpack_len(ctx, 1, "ag_unpack_ext");
+                break;
+        case MK_EXT16:
+                *len = unpack_len(ctx, 2, "ag_unpack_ext");
+                break;
+        default:
+                AG_UNPACK_REQUIRE (m == MK_EXT32, "ag_unpack_ext");
+                *len = unpack_len(ctx, 4, "ag_unpack_ext");
+        }
+
+        unpack_need(ctx, *len + 1, "ag_unpack_ext");
+        return (int8_t)*ctx->pos++;
+}
+
+
+/*******************************************************************************
+ * `ag_unpack_skip()` skips over the next item, including all the items nested
+ * within it if it happens to be an array or a map. We avoid recursion by
+ * keeping a count of the items that still need to be skipped.
+ */
+
+extern void
+ag_unpack_skip(struct ag_unpack *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        register size_t pending = 1;
+        size_t len;
+
+        while (pending--) {
+                switch (ag_unpack_type(ctx)) {
+                case AG_PACK_TYPE_NIL:
+                        ag_unpack_nil(ctx);
+                        break;
+                case AG_PACK_TYPE_BOOL:
+                        (void)ag_unpack_bool(ctx);
+                        break;
+                case AG_PACK_TYPE_INT:
+                        (void)ag_unpack_int(ctx);
+                        break;
+                case AG_PACK_TYPE_UINT:
+                        (void)ag_unpack_uint(ctx);
+                        break;
+                case AG_PACK_TYPE_FLOAT:
+                        (void)ag_unpack_float(ctx);
+                        break;
+                case AG_PACK_TYPE_STR:
+                        (void)ag_unpack_str(ctx, &len);
+                        break;
+                case AG_PACK_TYPE_BIN:
+                        (void)ag_unpack_bin(ctx, &len);
+                        break;
+                case AG_PACK_TYPE_ARRAY:
+                        pending += ag_unpack_array(ctx);
+                        break;
+                case AG_PACK_TYPE_MAP:
+                        pending += 2 * ag_unpack_map(ctx);
+                        break;
+                default:
+                        (void)ag_unpack_ext(ctx, &len);
+                        ctx->pos += len;
+                }
+        }
+}
+
+
+static unsigned char *
+pack_reserve(ag_pack *ctx, size_t len)
+{
+        register size_t cap = ctx->cap;
+
+        if (AG_UNLIKELY (ctx->len + len > cap)) {
+                while (ctx->len + len > cap)
+                        cap *= 2;
+
+                ag_memblock_resize((ag_memblock **)&ctx->bfr, cap);
+                ctx->cap = cap;
+        }
+
+        unsigned char *b = ctx->bfr + ctx->len;
+        ctx->len += len;
+
+        return b;
+}
+
+
+static void
+pack_head(ag_pack *ctx, unsigned char mark, size_t len)
+{
+        register unsigned char *b;
+
+        switch (mark) {
+        case MK_STR8: case MK_BIN8:
+                b = pack_reserve(ctx, 2);
+                b[1] = (unsigned char)len;
+                break;
+        case MK_STR16: case MK_BIN16: case MK_ARRAY16: case MK_MAP16:
+                b = pack_reserve(ctx, 3);
+                put_be16(b + 1, (uint16_t)len);
+                break;
+        default:
+                AG_ASSERT (len <= UINT32_MAX);
+                b = pack_reserve(ctx, 5);
+                put_be32(b + 1, (uint32_t)len);
+        }
+
+        b[0] = mark;
+}
+
+
+static inline void
+put_be16(unsigned char *b, uint16_t v)
+{
+        b[0] = (unsigned char)(v >> 8);
+        b[1] = (unsigned char)v;
+}
+
+
+static inline void
+put_be32(unsigned char *b, uint32_t v)
+{
+        put_be16(b, (uint16_t)(v >> 16));
+        put_be16(b + 2, (uint16_t)v);
+}
+
+
+static inline void
+put_be64(unsigned char *b, uint64_t v)
+{
+        put_be32(b, (uint32_t)(v >> 32));
+        put_be32(b + 4, (uint32_t)v);
+}
+
+
+static inline void
+unpack_need(const struct ag_unpack *ctx, size_t len, const char *fn)
+{
+        AG_UNPACK_REQUIRE ((size_t)(ctx->end - ctx->pos) >= len, fn);
+}
+
+
+static size_t
+unpack_len(struct ag_unpack *ctx, size_t width, const char *fn)
+{
+        unpack_need(ctx, width + 1, fn);
+
+        register const unsigned char *b = ctx->pos + 1;
+        size_t len = width == 1 ? b[0] : width == 2 ? get_be16(b)
+            : get_be32(b);
+
+        ctx->pos += width + 1;
+        return len;
+}
+
+
+static inline uint16_t
+get_be16(const unsigned char *b)
+{
+        return (uint16_t)((b[0] << 8) | b[1]);
+}
+
+
+static inline uint32_t
+get_be32(const unsigned char *b)
+{
+        return ((uint32_t)get_be16(b) << 16) | get_be16(b + 2);
+}
+
+
+static inline uint64_t
+get_be64(const unsigned char *b)
+{
+        return ((uint64_t)get_be32(b) << 32) | get_be32(b + 4);
+}
+
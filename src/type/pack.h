@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#ifndef __ARGENT_INCLUDE_PACK_H__
+#define __ARGENT_INCLUDE_PACK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "../base/base.h"
+#include "./primitives.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*******************************************************************************
+ * The Argent Library provides a compact, length-prefixed binary encoding for
+ * values and objects so that they can be cached, written to disk, or passed
+ * between worker processes. The encoding is a subset of MessagePack, so the
+ * output of `ag_pack` can be read by any conforming MessagePack decoder.
+ *
+ * The `ag_pack` type is the writer; it owns a growable output buffer and emits
+ * the smallest MessagePack representation of each item written to it. Signed
+ * integers are always written in the signed (or fixint) formats, and unsigned
+ * integers in the unsigned formats, so that `ag_int` and `ag_uint` values keep
+ * their type on a round trip.
+ *
+ * Objects are written as a MessagePack extension of type `AG_PACK_EXT_OBJECT`
+ * whose body starts with the object type ID followed by whatever the `pack`
+ * v-table callback of that type writes. The extension header is sized after
+ * the body is written, so small objects carry only a 2--3 byte envelope.
+ *
+ * See src/type/pack.c for more details.
+ */
+
+#define AG_PACK_EXT_OBJECT ((int8_t) 0x41)
+
+typedef struct ag_pack ag_pack;
+
+extern ag_pack          *ag_pack_new(void);
+extern void              ag_pack_release(ag_pack **);
+extern const char       *ag_pack_bfr(const ag_pack *);
+extern size_t            ag_pack_len(const ag_pack *);
+
+extern void     ag_pack_nil(ag_pack *);
+extern void     ag_pack_bool(ag_pack *, bool);
+extern void     ag_pack_int(ag_pack *, ag_int);
+extern void     ag_pack_uint(ag_pack *, ag_uint);
+extern void     ag_pack_float(ag_pack *, ag_float);
+extern void     ag_pack_str(ag_pack *, const char *, size_t);
+extern void     ag_pack_string(ag_pack *, const char *);
+extern void     ag_pack_bin(ag_pack *, const void *, size_t);
+extern void     ag_pack_array(ag_pack *, size_t);
+extern void     ag_pack_map(ag_pack *, size_t);
+extern size_t   ag_pack_ext_open(ag_pack *, int8_t);
+extern void     ag_pack_ext_close(ag_pack *, size_t);
+
+
+/*******************************************************************************
+ * The `ag_unpack` struct is the reader. It is deliberately a plain struct that
+ * lives on the stack of the caller, holding nothing more than a cursor into the
+ * input buffer; the buffer itself is neither copied nor owned by the reader.
+ *
+ * Strings and binary blobs are returned by `ag_unpack_str()` and
+ * `ag_unpack_bin()` as pointers into the input buffer along with their length,
+ * so they remain valid only as long as the buffer does and are *not* null
+ * terminated. `ag_unpack_string()` is provided for the common case where an
+ * owned `ag_string` is required.
+ *
+ * Malformed or truncated input raises the `AG_ERNO_PARSE` exception.
+ */
+
+enum ag_pack_type {
+        AG_PACK_TYPE_NIL,
+        AG_PACK_TYPE_BOOL,
+        AG_PACK_TYPE_INT,
+        AG_PACK_TYPE_UINT,
+        AG_PACK_TYPE_FLOAT,
+        AG_PACK_TYPE_STR,
+        AG_PACK_TYPE_BIN,
+        AG_PACK_TYPE_ARRAY,
+        AG_PACK_TYPE_MAP,
+        AG_PACK_TYPE_EXT,
+};
+
+struct ag_unpack {
+        const unsigned char     *pos;   /* Current read position */
+        const unsigned char     *end;   /* End of input buffer   */
+};
+
+extern void                      ag_unpack_init(struct ag_unpack *,
+                                    const void *, size_t);
+extern bool                      ag_unpack_done(const struct ag_unpack *);
+extern enum ag_pack_type         ag_unpack_type(const struct ag_unpack *);
+extern void                      ag_unpack_nil(struct ag_unpack *);
+extern bool                      ag_unpack_bool(struct ag_unpack *);
+extern ag_int                    ag_unpack_int(struct ag_unpack *);
+extern ag_uint                   ag_unpack_uint(struct ag_unpack *);
+extern ag_float                  ag_unpack_float(struct ag_unpack *);
+extern const char               *ag_unpack_str(struct ag_unpack *, size_t *);
+extern ag_string                *ag_unpack_string(struct ag_unpack *);
+extern const void               *ag_unpack_bin(struct ag_unpack *, size_t *);
+extern size_t                    ag_unpack_array(struct ag_unpack *);
+extern size_t                    ag_unpack_map(struct ag_unpack *);
+extern int8_t                    ag_unpack_ext(struct ag_unpack *, size_t *);
+extern void                      ag_unpack_skip(struct ag_unpack *);
+
+
+/*******************************************************************************
+ * `AG_UNPACK_REQUIRE()` raises the `AG_ERNO_PARSE` exception if a given
+ * predicate about the input being unpacked doesn't hold. Since the input is
+ * binary, the exception reports only the context in which unpacking failed.
+ */
+
+#define AG_UNPACK_REQUIRE(P, CTX) do {                                  \
+        struct ag_exception_parse _u_ = {.str = "<binary>", .ctx = CTX}; \
+        AG_REQUIRE_OPT (P, AG_ERNO_PARSE, &_u_);                        \
+} while (0)
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__ARGENT_INCLUDE_PACK_H__ */
+
@@ -85,6 +85,42 @@ ag_string_new_fmt(const char *fmt, ...)
 }
 
 
+/*
+ * Define the ag_string_new_json() interface function. This function creates a
+ * new string holding a C string rendered as a JSON string literal, with quotes,
+ * backslashes and control characters escaped. The worst case of a \u escape
+ * for every character bounds the size of the buffer.
+ */
+extern ag_string *
+ag_string_new_json(const char *src)
+{
+        AG_ASSERT_PTR (src);
+
+        register size_t len = strlen(src), n = 0;
+        char *bfr = ag_memblock_new(len * 6 + 3);
+        register unsigned char c;
+
+        bfr[n++] = '"';
+
+        while ((c = *src++)) {
+                if (c == '"' || c == '\\') {
+                        bfr[n++] = '\\';
+                        bfr[n++] = c;
+                } else if (c < 0x20)
+                        n += sprintf(bfr + n, "\\u%04x", c);
+                else
+                        bfr[n++] = c;
+        }
+
+        bfr[n++] = '"';
+        bfr[n] = '\0';
+
+        char *s = ag_string_new(bfr);
+        ag_memblock_release((ag_memblock **)&bfr);
+        return (s);
+}
+
+
 /*
  * Define the ag_string_copy() interface function. This function creates a
  * shallow copy of a dynamic string.
@@ -130,6 +166,20 @@ ag_string_release(ag_string **ctx)
 }
 
 
+/*
+ * Define the ag_string_freeze() interface function. This function freezes a
+ * dynamic string, which is useful for strings that live as long as the process
+ * does, such as interned strings. A frozen string is never released.
+ */
+extern void
+ag_string_freeze(ag_string *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        ag_memblock_freeze(ctx);
+}
+
+
 /*
  * Define the ag_string_cmp() interface function. This function compares two
  * strings lexicographically. We have adapted the code from the uf8cmp()
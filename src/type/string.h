@@ -58,17 +58,21 @@ typedef char    ag_string;
  *
  * ag_string_new() creates a new string instance from a statically allocated
  * C-style string, and. ag_string_new_fmt() creates a new string instances from
- * formatted string. ag_string_copy() creates a shallow copy of a string, and
+ * formatted string. ag_string_new_json() creates a new string holding a C-style
+ * string rendered as a JSON string literal. ag_string_copy() creates a shallow copy of a string, and
  * ag_string_clone() creates a deep copy. String instances are released through
- * ag_string_release().
+ * ag_string_release(). ag_string_freeze() makes a string immortal, so that
+ * copying and releasing it no longer touch its reference count.
  */
 
 
 extern ag_string        *ag_string_new(const char *);
 extern ag_string        *ag_string_new_fmt(const char *, ...);
+extern ag_string        *ag_string_new_json(const char *);
 extern ag_string        *ag_string_copy(const ag_string *);
 extern ag_string        *ag_string_clone(const ag_string *);
 extern void              ag_string_release(ag_string **);
+extern void              ag_string_freeze(ag_string *);
 
 
 inline ag_string *
@@ -41,6 +41,12 @@ typedef int ag_typeid;
 #define AG_TYPEID_HTTP_REQUEST  ((ag_typeid) -6)
 #define AG_TYPEID_HTTP_RESPONSE ((ag_typeid) -7)
 #define AG_TYPEID_PLUGIN        ((ag_typeid) -8)
+#define AG_TYPEID_MAP           ((ag_typeid) -9)
+#define AG_TYPEID_OMAP          ((ag_typeid) -10)
+#define AG_TYPEID_VEC_INT       ((ag_typeid) -11)
+#define AG_TYPEID_VEC_UINT      ((ag_typeid) -12)
+#define AG_TYPEID_VEC_FLOAT     ((ag_typeid) -13)
+#define AG_TYPEID_VEC_STR       ((ag_typeid) -14)
 
 
 #ifdef __cplusplus
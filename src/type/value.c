@@ -143,6 +143,22 @@ ag_value_release(ag_value **ctx)
 }
 
 
+extern void
+ag_value_freeze(ag_value *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        if (ag_value_type_object(ctx))
+                ag_object_freeze((ag_object *)ag_value_object(ctx));
+
+        if (ag_value_type_string(ctx))
+                ag_string_freeze((ag_string *)ag_value_string(ctx));
+
+        if (ag_value_type_float(ctx))
+                ag_memblock_freeze((void *)((uintptr_t)ctx & MASK_PTR));
+}
+
+
 extern enum ag_cmp
 ag_value_cmp(const ag_value *ctx, const ag_value *cmp)
 {
@@ -324,6 +340,105 @@ ag_value_str(const ag_value *ctx)
 }
 
 
+/*
+ * Define the ag_value_json() interface function. This function renders a value
+ * as JSON: a string value as a JSON string literal, an object value through
+ * ag_object_json(), and a numeric value as its string representation.
+ */
+
+
+extern ag_string *
+ag_value_json(const ag_value *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        switch (ag_value_type(ctx)) {
+        case AG_VALUE_TYPE_STRING:
+                return ag_string_new_json(ag_value_string(ctx));
+                break;
+        case AG_VALUE_TYPE_OBJECT:
+                return ag_object_json(ag_value_object(ctx));
+                break;
+        default:
+                return ag_value_str(ctx);
+        }
+}
+
+
+/*
+ * Define the ag_value_pack() interface function. This function writes the
+ * binary encoding of a value through a packer. Numeric and string values map
+ * directly onto their MessagePack counterparts, and object values are packed
+ * through ag_object_pack().
+ */
+
+
+extern void
+ag_value_pack(const ag_value *ctx, ag_pack *pk)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (pk);
+
+        switch (ag_value_type(ctx)) {
+        case AG_VALUE_TYPE_STRING:
+                ag_pack_string(pk, ag_value_string(ctx));
+                break;
+        case AG_VALUE_TYPE_OBJECT:
+                ag_object_pack(ag_value_object(ctx), pk);
+                break;
+        case AG_VALUE_TYPE_FLOAT:
+                ag_pack_float(pk, ag_value_float(ctx));
+                break;
+        case AG_VALUE_TYPE_UINT:
+                ag_pack_uint(pk, ag_value_uint(ctx));
+                break;
+        default:
+                ag_pack_int(pk, ag_value_int(ctx));
+        }
+}
+
+
+/*
+ * Define the ag_value_unpack() interface function. This function is the
+ * converse of ag_value_pack(), reading the next item from an unpacker and
+ * returning it as a new value. Strings cost a single allocation each, since
+ * the string read from the input buffer is handed over to the value.
+ */
+
+
+extern ag_value *
+ag_value_unpack(struct ag_unpack *rd)
+{
+        AG_ASSERT_PTR (rd);
+
+        ag_value *v;
+        ag_string *s;
+        ag_object *o;
+
+        switch (ag_unpack_type(rd)) {
+        case AG_PACK_TYPE_STR:
+                s = ag_unpack_string(rd);
+                v = ag_value_new_string(s);
+                ag_string_release(&s);
+                return v;
+        case AG_PACK_TYPE_EXT:
+                o = ag_object_unpack(rd);
+                v = ag_value_new_object(o);
+                ag_object_release(&o);
+                return v;
+        case AG_PACK_TYPE_FLOAT:
+                return ag_value_new_float(ag_unpack_float(rd));
+        case AG_PACK_TYPE_UINT:
+                return ag_value_new_uint(ag_unpack_uint(rd));
+        case AG_PACK_TYPE_INT:
+                return ag_value_new_int(ag_unpack_int(rd));
+        default:
+                AG_UNPACK_REQUIRE (false, "ag_value");
+                return NULL;
+        }
+}
+
+
 extern ag_int
 ag_value_int(const ag_value *ctx)
 {
@@ -52,6 +52,7 @@ extern ag_value         *ag_value_new_string(const ag_string *);
 extern ag_value         *ag_value_new_object(const ag_object *);
 extern ag_value         *ag_value_copy(const ag_value *);
 extern void              ag_value_release(ag_value **);
+extern void              ag_value_freeze(ag_value *);
 
 
 
@@ -79,6 +80,9 @@ extern ag_hash                   ag_value_hash(const ag_value *);
 extern size_t                    ag_value_sz(const ag_value *);
 extern size_t                    ag_value_len(const ag_value *);
 extern ag_string                *ag_value_str(const ag_value *);
+extern ag_string                *ag_value_json(const ag_value *);
+extern void                      ag_value_pack(const ag_value *, ag_pack *);
+extern ag_value                 *ag_value_unpack(struct ag_unpack *);
 extern ag_int                    ag_value_int(const ag_value *);
 extern ag_uint                   ag_value_uint(const ag_value *);
 extern ag_float                  ag_value_float(const ag_value *);
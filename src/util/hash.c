@@ -24,30 +24,200 @@
 #include "../argent.h"
 
 #include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/random.h>
 
 
+/*******************************************************************************
+ * The hash functions follow the design of wyhash: the input is consumed eight
+ * bytes at a time, and each pair of words is folded into the state with a full
+ * 64x64 to 128-bit multiplication whose high and low halves are XORed together.
+ * `SECRET` holds the odd constants mixed into the input at each step, and
+ * `g_seed` the per-process seed that keys every hash.
+ */
+
+static const uint64_t SECRET[] = {
+        UINT64_C(0x2d358dccaa6c78a5), UINT64_C(0x8bb84b93962eacc9),
+        UINT64_C(0x4b33a62ed433d4a3), UINT64_C(0x4d5a2da51de1aa47)
+};
+
+static uint64_t g_seed;
+
+
+/*******************************************************************************
+ * `mum()` multiplies two words into a 128-bit product, leaving the low half in
+ * the first and the high half in the second, and `mix()` folds the two halves
+ * of the product into a single word. `read8()` and `read4()` load unaligned
+ * words, and `read3()` packs one to three trailing bytes into a word.
+ */
+
+static inline void
+mum(uint64_t *a, uint64_t *b)
+{
+        __uint128_t r = (__uint128_t)*a * *b;
+
+        *a = (uint64_t)r;
+        *b = (uint64_t)(r >> 64);
+}
+
+
+static inline uint64_t
+mix(uint64_t a, uint64_t b)
+{
+        mum(&a, &b);
+        return a ^ b;
+}
+
+
+static inline uint64_t
+read8(const uint8_t *p)
+{
+        uint64_t v;
+        memcpy(&v, p, sizeof v);
+
+        return v;
+}
+
+
+static inline uint64_t
+read4(const uint8_t *p)
+{
+        uint32_t v;
+        memcpy(&v, p, sizeof v);
+
+        return v;
+}
+
+
+static inline uint64_t
+read3(const uint8_t *p, size_t len)
+{
+        return ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8)
+            | p[len - 1];
+}
+
+
+/*******************************************************************************
+ * `seed_init()` picks the per-process seed before main() runs, so that the seed
+ * never changes once hashes have been taken. It is given the highest
+ * constructor priority since the constructors registering object types already
+ * hash their type IDs. The seed comes from the kernel's random number
+ * generator, falling back to mixing the clock, the process ID and an address
+ * if that fails.
+ */
+
+__attribute__((constructor(101))) static void
+seed_init(void)
+{
+        if (getrandom(&g_seed, sizeof g_seed, GRND_NONBLOCK)
+            != (ssize_t)sizeof g_seed) {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+
+                g_seed = mix((uint64_t)ts.tv_nsec ^ SECRET[0],
+                    ((uint64_t)ts.tv_sec << 20) ^ (uint64_t)getpid()
+                    ^ (uint64_t)(uintptr_t)&ts ^ SECRET[1]);
+        }
+}
+
+
+extern uint64_t
+ag_hash_seed(void)
+{
+        return g_seed;
+}
+
+
+/*******************************************************************************
+ * `ag_hash_new()` hashes an integer by folding it with the seed through a
+ * single 128-bit multiplication, which mixes every input bit into both the low
+ * and the high bits of the result.
+ */
+
 extern ag_hash
 ag_hash_new(size_t key)
 {
-        key = (key ^ (key >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
-        key = (key ^ (key >> 27)) * UINT64_C(0x94d049bb133111eb);
-        key = key ^ (key >> 31);
-    
-        return key;
+        uint64_t a = (uint64_t)key ^ SECRET[0];
+        uint64_t b = g_seed ^ SECRET[1];
+
+        mum(&a, &b);
+        return mix(a ^ SECRET[0], b ^ SECRET[1]);
 }
 
 
+/*******************************************************************************
+ * `ag_hash_new_len()` hashes a given number of bytes. Inputs of up to 16 bytes
+ * are read as two overlapping pairs of words without any loop; longer inputs
+ * are consumed 48 bytes at a time through three independent lanes, then 16
+ * bytes at a time, with the last 16 bytes read from the end of the input.
+ */
+
 extern ag_hash
-ag_hash_new_str(const char *key)
+ag_hash_new_len(const void *key, size_t len)
 {
         AG_ASSERT_PTR (key);
 
-        register ag_hash hash = 5381;
-        register int c;
+        register const uint8_t *p = key;
+        uint64_t seed = g_seed ^ mix(g_seed ^ SECRET[0], SECRET[1]);
+        uint64_t a, b;
+
+        if (AG_LIKELY (len <= 16)) {
+                if (len >= 4) {
+                        register size_t off = (len >> 3) << 2;
+
+                        a = (read4(p) << 32) | read4(p + off);
+                        b = (read4(p + len - 4) << 32)
+                            | read4(p + len - 4 - off);
+                } else if (len) {
+                        a = read3(p, len);
+                        b = 0;
+                } else
+                        a = b = 0;
+        } else {
+                register size_t i = len;
+
+                if (AG_UNLIKELY (i > 48)) {
+                        uint64_t see1 = seed;
+                        uint64_t see2 = seed;
+
+                        do {
+                                seed = mix(read8(p) ^ SECRET[1],
+                                    read8(p + 8) ^ seed);
+                                see1 = mix(read8(p + 16) ^ SECRET[2],
+                                    read8(p + 24) ^ see1);
+                                see2 = mix(read8(p + 32) ^ SECRET[3],
+                                    read8(p + 40) ^ see2);
+                                p += 48;
+                                i -= 48;
+                        } while (i > 48);
+
+                        seed ^= see1 ^ see2;
+                }
+
+                while (i > 16) {
+                        seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                        p += 16;
+                        i -= 16;
+                }
+
+                a = read8(p + i - 16);
+                b = read8(p + i - 8);
+        }
 
-        while ((c = *key++))
-                hash = ((hash << 5) + hash) + c;
+        a ^= SECRET[1];
+        b ^= seed;
+        mum(&a, &b);
 
-        return hash;
+        return mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
 }
 
+
+extern ag_hash
+ag_hash_new_str(const char *key)
+{
+        AG_ASSERT_PTR (key);
+
+        return ag_hash_new_len(key, strlen(key));
+}
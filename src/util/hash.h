@@ -30,12 +30,26 @@ extern "C" {
 
 
 #include <stddef.h>
+#include <stdint.h>
 
 
+/*******************************************************************************
+ * The `ag_hash` type holds 64-bit hashes. `ag_hash_new()` hashes an integer,
+ * and `ag_hash_new_len()` hashes a given number of bytes, consuming the bytes
+ * eight at a time; `ag_hash_new_str()` is a convenience wrapper around it for
+ * null-terminated strings. All three are keyed with a random seed chosen once
+ * per process, which `ag_hash_seed()` returns. Hashes are therefore stable for
+ * the lifetime of a process but differ between runs, so they must not be
+ * persisted or sent across processes, and attacker-chosen keys such as query
+ * parameter names cannot be crafted to collide in advance.
+ */
+
 typedef size_t ag_hash;
 
-extern ag_hash ag_hash_new(size_t);
-extern ag_hash ag_hash_new_str(const char *);
+extern ag_hash  ag_hash_new(size_t);
+extern ag_hash  ag_hash_new_len(const void *, size_t);
+extern ag_hash  ag_hash_new_str(const char *);
+extern uint64_t ag_hash_seed(void);
 
 
 #ifdef __cplusplus
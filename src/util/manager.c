@@ -66,21 +66,13 @@ ag_init(int argc, char *argv[])
                 n = list[i];
                 ag_exception_registry_set(n.erno, n.msg, n.hnd);
         }
-
-        AG_OBJECT_REGISTER(ag_field);
-        AG_OBJECT_REGISTER(ag_list);
-        AG_OBJECT_REGISTER(ag_alist);
-        AG_OBJECT_REGISTER(ag_http_url);
-        AG_OBJECT_REGISTER(ag_http_client);
-        AG_OBJECT_REGISTER(ag_http_request);
-        AG_OBJECT_REGISTER(ag_http_response);
-        AG_OBJECT_REGISTER(ag_plugin);
 }
 
 
 extern void
 ag_exit(int status)
 {
+        ag_pool_exit();
         ag_object_registry_exit();
         ag_exception_registry_exit();
 
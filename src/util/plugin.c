@@ -70,6 +70,30 @@ AG_OBJECT_DEFINE_STR(ag_plugin,
         return ag_string_new_fmt("%s::%s()", p->dso, p->sym);
 );
 
+AG_OBJECT_DEFINE_PACK(ag_plugin,
+        const struct payload *p = ag_object_payload(_o_);
+
+        ag_pack_array(_w_, 2);
+        ag_pack_string(_w_, p->dso);
+        ag_pack_string(_w_, p->sym);
+);
+
+AG_OBJECT_DEFINE_UNPACK(ag_plugin,
+        AG_UNPACK_REQUIRE (ag_unpack_array(_r_) == 2, "ag_plugin");
+
+        AG_AUTO(ag_string) *dso = ag_unpack_string(_r_);
+        AG_AUTO(ag_string) *sym = ag_unpack_string(_r_);
+
+        return payload_new(dso, sym);
+);
+
+AG_OBJECT_DEFINE_FREEZE(ag_plugin,
+        struct payload *p = _p_;
+
+        ag_string_freeze(p->dso);
+        ag_string_freeze(p->sym);
+);
+
 
 extern ag_plugin *
 ag_plugin_new(const char *dso, const char *sym)
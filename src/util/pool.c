@@ -0,0 +1,306 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "../argent.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+
+/*******************************************************************************
+ * An `ag_pool` runs one loop at a time. The loop being run is described by the
+ * task callback, its context, the length of the index range and the grain, and
+ * its chunks are handed out through the `next` counter, which threads bump
+ * atomically to claim a chunk. Workers sleep on the `work` condition variable
+ * until the generation count changes, and the thread running the loop sleeps
+ * on the `done` condition variable until no worker is busy with the loop.
+ *
+ * Only one thread at a time may run a loop on a pool, which is enforced by the
+ * `run` mutex; the remaining fields are protected by the `lock` mutex, except
+ * for `next`, which is only touched atomically while the loop is being run.
+ */
+
+struct ag_pool {
+        pthread_mutex_t  run;   /* serialises loops           */
+        pthread_mutex_t  lock;  /* protects the pool state    */
+        pthread_cond_t   work;  /* signals a new loop         */
+        pthread_cond_t   done;  /* signals idle workers       */
+        size_t           gen;   /* loop generation            */
+        size_t           busy;  /* workers busy with the loop */
+        bool             stop;  /* whether to shut down       */
+        ag_pool_task    *task;  /* loop task                  */
+        void            *ctx;   /* loop task context          */
+        size_t           len;   /* loop index range           */
+        size_t           grain; /* loop chunk length          */
+        size_t           next;  /* next chunk to claim        */
+        size_t           nthr;  /* number of worker threads   */
+        pthread_t        thr[]; /* worker threads             */
+};
+
+
+/*******************************************************************************
+ * `in_task` is set on threads while they run a task, so that a nested call to
+ * `ag_pool_run()` can run serially instead of waiting on a pool that may have
+ * no free workers. The shared pool is created by `shared_init()` through
+ * `shared_once`.
+ */
+
+static _Thread_local bool        in_task;
+static pthread_once_t            shared_once = PTHREAD_ONCE_INIT;
+static ag_pool                  *shared_pool;
+
+static void     *worker(void *);
+static void      chunk_run(ag_pool *);
+static void      shared_init(void);
+
+
+/*******************************************************************************
+ * `ag_pool_new()` creates a new pool with a given number of worker threads.
+ * The thread calling `ag_pool_run()` also works through the loop, so a pool of
+ * `n` workers runs loops on `n + 1` threads. If a worker thread can't be
+ * created, the pool makes do with the ones that could be.
+ */
+
+extern ag_pool *
+ag_pool_new(size_t nthr)
+{
+        ag_pool *p = ag_memblock_new(sizeof *p + nthr * sizeof *p->thr);
+
+        pthread_mutex_init(&p->run, NULL);
+        pthread_mutex_init(&p->lock, NULL);
+        pthread_cond_init(&p->work, NULL);
+        pthread_cond_init(&p->done, NULL);
+
+        for (register size_t i = 0; i < nthr; i++) {
+                if (pthread_create(&p->thr[i], NULL, worker, p)) {
+                        ag_log_warning("created %zu of %zu pool threads", i,
+                            nthr);
+                        break;
+                }
+
+                p->nthr++;
+        }
+
+        return p;
+}
+
+
+/*******************************************************************************
+ * `ag_pool_release()` shuts down the worker threads of a pool, waiting for them
+ * to exit, and releases the pool.
+ */
+
+extern void
+ag_pool_release(ag_pool **hnd)
+{
+        ag_pool *p;
+
+        if (AG_LIKELY (hnd && (p = *hnd))) {
+                pthread_mutex_lock(&p->lock);
+                p->stop = true;
+                pthread_cond_broadcast(&p->work);
+                pthread_mutex_unlock(&p->lock);
+
+                for (register size_t i = 0; i < p->nthr; i++)
+                        pthread_join(p->thr[i], NULL);
+
+                pthread_cond_destroy(&p->done);
+                pthread_cond_destroy(&p->work);
+                pthread_mutex_destroy(&p->lock);
+                pthread_mutex_destroy(&p->run);
+
+                void *ptr = p;
+                ag_memblock_release(&ptr);
+                *hnd = NULL;
+        }
+}
+
+
+/*******************************************************************************
+ * `ag_pool_len()` returns the number of threads that run a loop on a pool,
+ * counting the calling thread along with the workers.
+ */
+
+extern size_t
+ag_pool_len(const ag_pool *ctx)
+{
+        AG_ASSERT_PTR (ctx);
+
+        return ctx->nthr + 1;
+}
+
+
+/*******************************************************************************
+ * `ag_pool_run()` runs a loop over the index range [0, len) on a pool. Loops of
+ * a single chunk, and loops started from within a task, are run directly on
+ * the calling thread. Otherwise the loop is published to the workers, and the
+ * calling thread claims chunks along with them; once all chunks have been
+ * claimed, we wait for the workers to finish theirs before returning.
+ */
+
+extern void
+ag_pool_run(ag_pool *ctx, size_t len, size_t grain, ag_pool_task *task,
+    void *arg)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (task);
+
+        if (AG_UNLIKELY (!len))
+                return;
+
+        if (!grain) {
+                grain = len / (ag_pool_len(ctx) * 4);
+                if (!grain)
+                        grain = 1;
+        }
+
+        if (len <= grain || !ctx->nthr || in_task) {
+                register bool nested = in_task;
+
+                in_task = true;
+                for (register size_t i = 0; i < len; i += grain)
+                        task(i, len - i < grain ? len : i + grain, arg);
+                in_task = nested;
+
+                return;
+        }
+
+        pthread_mutex_lock(&ctx->run);
+        pthread_mutex_lock(&ctx->lock);
+
+        ctx->task = task;
+        ctx->ctx = arg;
+        ctx->len = len;
+        ctx->grain = grain;
+        ctx->next = 0;
+        ctx->gen++;
+
+        pthread_cond_broadcast(&ctx->work);
+        pthread_mutex_unlock(&ctx->lock);
+
+        chunk_run(ctx);
+
+        pthread_mutex_lock(&ctx->lock);
+
+        while (ctx->busy)
+                pthread_cond_wait(&ctx->done, &ctx->lock);
+
+        ctx->task = NULL;
+        ctx->len = 0;
+
+        pthread_mutex_unlock(&ctx->lock);
+        pthread_mutex_unlock(&ctx->run);
+}
+
+
+/*******************************************************************************
+ * `ag_pool_shared()` returns the shared pool, creating it on first use with one
+ * worker thread less than the number of online processors.
+ */
+
+extern ag_pool *
+ag_pool_shared(void)
+{
+        pthread_once(&shared_once, shared_init);
+
+        return shared_pool;
+}
+
+
+/*******************************************************************************
+ * `ag_pool_exit()` releases the shared pool if it has been created.
+ */
+
+extern void
+ag_pool_exit(void)
+{
+        ag_pool_release(&shared_pool);
+}
+
+
+/*******************************************************************************
+ * `worker()` is the start routine of the worker threads. A worker waits for a
+ * new loop generation, registers itself as busy, and claims chunks until there
+ * are none left; the last worker to go idle wakes up the thread running the
+ * loop. Since `ag_pool_run()` waits for all workers to go idle before it
+ * returns, a worker never sees the state of a loop change under it.
+ */
+
+static void *
+worker(void *arg)
+{
+        ag_pool *p = arg;
+        size_t gen = 0;
+
+        pthread_mutex_lock(&p->lock);
+
+        for (;;) {
+                while (!p->stop && (gen == p->gen || !p->task))
+                        pthread_cond_wait(&p->work, &p->lock);
+
+                if (p->stop)
+                        break;
+
+                gen = p->gen;
+                p->busy++;
+                pthread_mutex_unlock(&p->lock);
+
+                chunk_run(p);
+
+                pthread_mutex_lock(&p->lock);
+                if (!--p->busy)
+                        pthread_cond_signal(&p->done);
+        }
+
+        pthread_mutex_unlock(&p->lock);
+        return NULL;
+}
+
+
+/*******************************************************************************
+ * `chunk_run()` claims and runs the chunks of the current loop of a pool until
+ * there are none left.
+ */
+
+static void
+chunk_run(ag_pool *ctx)
+{
+        register size_t i, len = ctx->len, grain = ctx->grain;
+
+        in_task = true;
+
+        while ((i = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED)
+            * grain) < len)
+                ctx->task(i, len - i < grain ? len : i + grain, ctx->ctx);
+
+        in_task = false;
+}
+
+
+static void
+shared_init(void)
+{
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+        shared_pool = ag_pool_new(n > 1 ? (size_t)n - 1 : 0);
+}
@@ -0,0 +1,70 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#ifndef __ARGENT_INCLUDE_POOL_H__
+#define __ARGENT_INCLUDE_POOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+/*******************************************************************************
+ * The `ag_pool` ADT is a fixed set of worker threads that run data parallel
+ * loops. `ag_pool_run()` splits the index range [0, len) into consecutive
+ * chunks of `grain` indices, and calls the `ag_pool_task` callback once for
+ * each chunk with its bounds and a context pointer. The calling thread works
+ * through the chunks alongside the workers, and `ag_pool_run()` only returns
+ * once every chunk is done. A grain of 0 picks a grain that gives each thread a
+ * few chunks to balance uneven workloads.
+ *
+ * Chunks may run in any order and on any thread, so a task should write its
+ * results to slots of its own; the chunk bounds being deterministic, callers
+ * can then combine the results in order. Calls to `ag_pool_run()` made from
+ * within a task run serially on the calling worker.
+ *
+ * `ag_pool_shared()` returns a pool sized to the number of online processors,
+ * created on first use and shared by the parallel container functions.
+ * `ag_pool_exit()` shuts it down, and is called by `ag_exit()`.
+ */
+
+typedef struct ag_pool  ag_pool;
+typedef void            (ag_pool_task)(size_t, size_t, void *);
+
+extern ag_pool  *ag_pool_new(size_t);
+extern void      ag_pool_release(ag_pool **);
+extern size_t    ag_pool_len(const ag_pool *);
+extern void      ag_pool_run(ag_pool *, size_t, size_t, ag_pool_task *,
+                     void *);
+extern ag_pool  *ag_pool_shared(void);
+extern void      ag_pool_exit(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__ARGENT_INCLUDE_POOL_H__ */
@@ -23,38 +23,129 @@
 
 #include "../argent.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 
 /*******************************************************************************
- * Every registry entry is recorded as a node in a bucket list of a hash map.
- * These nodes are represented by the `node` struct, and are implemented as key
- * value pairs along with a pointer to the next node. The key is a hash value
- * that is also used to determine the bucket in which the node is placed.
+ * Every registry entry is recorded in a slot of an open-addressing hash table.
+ * Each slot holds the full hash key of its entry inline, so that probing only
+ * compares keys without chasing any pointers, along with the entry data and its
+ * distance from its home slot. The distance is stored off by one so that a zero
+ * distance marks an empty slot.
  */
 
-struct node {
-        ag_hash          key;   /* node key  */
-        void            *data;  /* node data */
-        struct node     *next;  /* next node */
+struct slot {
+        ag_hash          key;   /* entry key               */
+        void            *data;  /* entry data              */
+        size_t           dist;  /* probe distance + 1      */
 };
 
-static struct node      *node_new(ag_hash, void *);
-static inline void       node_release(struct node *, ag_registry_release_cbk *);
+
+/*******************************************************************************
+ * The slots are held in a `table` struct, whose capacity is always a power of
+ * two so that the home slot of a key can be found with a shift instead of a
+ * modulo. The `shift` field holds the number of bits to shift a scrambled key
+ * by to get its home slot.
+ */
+
+struct table {
+        struct slot     *slot;  /* slot array               */
+        size_t           cap;   /* number of slots          */
+        size_t           len;   /* number of occupied slots */
+        unsigned         shift; /* home slot shift          */
+};
+
+static void      table_init(struct table *, size_t);
+static size_t    table_home(const struct table *, ag_hash);
+static void     *table_get(const struct table *, ag_hash);
+static void      table_put(struct table *, ag_hash, void *);
+static void      table_erase(struct table *, size_t);
+static size_t    table_find(const struct table *, ag_hash);
 
 
 /*******************************************************************************
  * The `ag_registry` ADT was forward declared in include/registry.h, and is
- * implemented as a hash map of `node` structs. 
+ * implemented as a Robin Hood hash table. When the table grows beyond its load
+ * factor, a table of twice the capacity takes its place, and the entries of the
+ * old table are moved across a few at a time by each subsequent push or removal
+ * so that no single push pays for rehashing the whole registry. Until the old
+ * table is drained, lookups check both tables.
  */
 
 struct ag_registry {
-        size_t                    len;  /* number of buckets     */
-        struct node             **buck; /* buckets of node lists */
+        struct table              cur;  /* current table         */
+        struct table              old;  /* table being drained   */
+        size_t                    mig;  /* next slot to drain    */
         ag_registry_release_cbk  *disp; /* cleanup callback      */
 };
 
+static void     registry_grow(ag_registry *, size_t);
+static void     registry_migrate(ag_registry *, size_t);
+
+
+/*******************************************************************************
+ * The `ag_epoch` struct was forward declared in include/registry.h, and tracks
+ * the readers of data that writers replace without waiting for them. Readers
+ * announce themselves by incrementing a reader count for the current epoch
+ * before loading the data, and writers flip the epoch after publishing new
+ * data, then wait for the reader count of the previous epoch to drop to zero
+ * before reclaiming the data that they replaced.
+ *
+ * The reader counts are spread over `READ_STRIPES` cache lines, with each
+ * thread picking a stripe once, so that concurrent readers from different
+ * threads do not contend on a single counter.
+ */
+
+#define READ_STRIPES    16
+
+struct stripe {
+        size_t           n[2];  /* readers per epoch */
+} __attribute__((aligned(64)));
+
+struct ag_epoch {
+        unsigned         cur;   /* current epoch     */
+        struct stripe    rd[READ_STRIPES]; /* reader counts */
+};
+
+
+/*******************************************************************************
+ * The `ag_cregistry` ADT was also forward declared in include/registry.h, and
+ * holds a pointer to its current snapshot table, which is never modified once
+ * published. Lookups read the snapshot within a reader epoch, so that writers
+ * can reclaim the snapshot that they replace once its readers have left.
+ */
+
+struct ag_cregistry {
+        struct table            *snap;  /* current snapshot      */
+        struct ag_epoch         *ep;    /* reader epochs         */
+        pthread_mutex_t          wr;    /* serialises writers    */
+        ag_registry_copy_cbk    *copy;  /* lookup copy callback  */
+        ag_registry_release_cbk *disp;  /* cleanup callback      */
+};
+
+static struct table     *snapshot_clone(const struct table *);
+static void              snapshot_publish(ag_cregistry *, struct table *,
+                             void *);
+
+
+/*******************************************************************************
+ * The registry starts off with `CAP_MIN` slots, which is the same as the number
+ * of buckets it used to have as a chained hash map. The table grows once more
+ * than 4/5th of its slots are occupied, and each push or removal moves up to
+ * `MIGRATE_STEP` entries out of the old table while it is being drained. Since
+ * the old table is at most 4/5th full and the new table only fills up after at
+ * least as many pushes, the old table is always drained before the next growth.
+ */
+
+#define CAP_MIN         64
+#define LOAD_NUM        4
+#define LOAD_DEN        5
+#define MIGRATE_STEP    4
+
 
 /*******************************************************************************
  * We are not using the `ag_memblock` interface in order to avoid a possible
@@ -74,9 +165,9 @@ struct ag_registry {
 
 /*******************************************************************************
  * `ag_registry_new()` creates a new registry instance. The registry is
- * implemented as a hash map of generic data. The number of buckets is set to be
- * the native word size in bits. The callback to dispose the contained data is 
- * passed through the first parameter.
+ * implemented as a Robin Hood hash table of generic data, starting with
+ * `CAP_MIN` slots. The callback to dispose the contained data is passed through
+ * the first parameter.
  */
 
 extern ag_registry *
@@ -87,23 +178,20 @@ ag_registry_new(ag_registry_release_cbk *disp)
         ag_registry *r = malloc(sizeof *r);
         MEM_CHECK (r);
 
-        r->len = sizeof(size_t) * 8;
+        table_init(&r->cur, CAP_MIN);
+        memset(&r->old, 0, sizeof r->old);
+        r->mig = 0;
         r->disp = disp;
 
-        size_t sz = sizeof *r->buck * r->len;
-        r->buck = malloc(sz);
-        MEM_CHECK (r->buck);
-        memset(r->buck, 0, sz);
-
         return r;
 }
 
 
 /*******************************************************************************
  * `ag_registry_release()` is responsible for releasing the heap memory being
- * used by a registry instance, including all the nodes contained within the
- * registry hash map. The registry instance that needs to be released is passed
- * to this function as a double pointer.
+ * used by a registry instance, including all the entries contained within both
+ * its tables. The registry instance that needs to be released is passed to this
+ * function as a double pointer.
  */
 
 extern void
@@ -112,28 +200,43 @@ ag_registry_release(ag_registry **hnd)
         ag_registry *r;
 
         if (AG_LIKELY (hnd && (r = *hnd))) {
-                for (register size_t i = 0; i < r->len; i++) {
-                        register struct node *n = r->buck[i];
+                struct table *t[] = {&r->cur, &r->old};
 
-                        while (n) {
-                                register struct node *n2 = n->next;
-                                node_release(n, r->disp);
-                                n = n2;
+                for (register size_t i = 0; i < 2; i++) {
+                        for (register size_t j = 0; j < t[i]->cap; j++) {
+                                if (t[i]->slot[j].dist)
+                                        r->disp(t[i]->slot[j].data);
                         }
+
+                        free(t[i]->slot);
                 }
 
-                free(r->buck);
                 free(r);
+                *hnd = NULL;
         }
 }
 
 
+/*******************************************************************************
+ * `ag_registry_len()` gets the number of entries in a registry instance, which
+ * is passed through the only parameter.
+ */
+
+extern size_t
+ag_registry_len(const ag_registry *hnd)
+{
+        AG_ASSERT_PTR (hnd);
+
+        return hnd->cur.len + hnd->old.len;
+}
+
+
 /*******************************************************************************
  * `ag_registry_get() gets the registry item with a given hash key. The registry
  * instance is passed through the first parameter, and the hash key through the
- * second. The hash key is searched for in the registry hash map, and if found,
- * the corresponding value is returned. If the hash key is not found, then
- * `NULL` is returned.
+ * second. The hash key is searched for in the current table, and then in the
+ * table being drained if there is one; if found, the corresponding value is
+ * returned. If the hash key is not found, then `NULL` is returned.
  */
 
 extern void *
@@ -141,16 +244,12 @@ ag_registry_get(const ag_registry *hnd, ag_hash key)
 {
         AG_ASSERT_PTR (hnd);
 
-        register struct node *n = hnd->buck[key % hnd->len];
+        void *data = table_get(&hnd->cur, key);
 
-        while (n) {
-                if (n->key == key)
-                        return n->data;
-
-                n = n->next;
-        }
+        if (!data && AG_UNLIKELY (hnd->old.len))
+                data = table_get(&hnd->old, key);
 
-        return NULL;
+        return data;
 }
 
 
@@ -158,11 +257,11 @@ ag_registry_get(const ag_registry *hnd, ag_hash key)
  * `ag_registry_push()` pushes a new registry entry into a registry instance.
  * The registry instance is passed through the first parameter, and the hash key
  * of the registry entry along with its associated data are passed respectively
- * through the remaining parameters.
+ * through the remaining parameters. If there is already an entry with the same
+ * hash key, its data is disposed of and replaced by the new data.
  *
- * A new node is created for the registry entry and appended to the end of the
- * list in the appropriate bucket of the hash map contained in the registry
- * instance.
+ * The entry is always placed in the current table, growing the registry first
+ * if the push would take the table past its load factor.
  */
 
 extern void
@@ -171,54 +270,561 @@ ag_registry_push(ag_registry *hnd, ag_hash key, void *data)
         AG_ASSERT_PTR (hnd);
         AG_ASSERT_PTR (data);
 
-        register struct node *n = hnd->buck[key % hnd->len];
+        registry_migrate(hnd, MIGRATE_STEP);
 
-        if (n) {
-                while (n && n->next)
-                        n = n->next;
+        if (AG_UNLIKELY (hnd->old.len)) {
+                register size_t i = table_find(&hnd->old, key);
 
-                n->next = node_new(key, data);
-        } else
-                hnd->buck[key % hnd->len] = node_new(key, data);
+                if (i != SIZE_MAX) {
+                        hnd->disp(hnd->old.slot[i].data);
+                        table_erase(&hnd->old, i);
+                }
+        }
+
+        register size_t i = table_find(&hnd->cur, key);
+
+        if (i != SIZE_MAX) {
+                hnd->disp(hnd->cur.slot[i].data);
+                hnd->cur.slot[i].data = data;
+                return;
+        }
+
+        if (AG_UNLIKELY ((hnd->cur.len + 1) * LOAD_DEN
+            > hnd->cur.cap * LOAD_NUM))
+                registry_grow(hnd, hnd->cur.cap * 2);
+
+        table_put(&hnd->cur, key, data);
 }
 
 
 /*******************************************************************************
- * `node_new()` is a helper function to create a new node in the hash map of a
- * registry instance. The hash key and corresponding value of the registry item
- * are passed through the parameters respectively, and a new node instance is
- * returned, with its `next` pointer set to `NULL`.
+ * `ag_registry_remove()` removes the registry entry with a given hash key from
+ * a registry instance, disposing of its data. The registry instance is passed
+ * through the first parameter, and the hash key through the second. Removing a
+ * hash key that is not in the registry has no effect.
  */
 
-static struct node *
-node_new(ag_hash key, void *data)
+extern void
+ag_registry_remove(ag_registry *hnd, ag_hash key)
 {
-        AG_ASSERT_PTR (data);
+        AG_ASSERT_PTR (hnd);
 
-        struct node *n = malloc(sizeof *n);
-        MEM_CHECK(n);
+        registry_migrate(hnd, MIGRATE_STEP);
 
-        n->key = key;
-        n->data = data;
-        n->next = NULL;
+        struct table *t[] = {&hnd->cur, &hnd->old};
+        register size_t i;
 
-        return n;
+        for (register size_t j = 0; j < 2; j++) {
+                if (t[j]->len && (i = table_find(t[j], key)) != SIZE_MAX) {
+                        hnd->disp(t[j]->slot[i].data);
+                        table_erase(t[j], i);
+                        return;
+                }
+        }
 }
 
 
 /*******************************************************************************
- * `node_release()` is the converse of `node_new()`. It releases a given node
- * (passed through the first parameter), taking care to first dispose of the
- * custom registry data using the callback passed through the second parameter.
+ * `ag_registry_reserve()` makes room in a registry instance for at least a
+ * given number of entries, so that pushing up to that many entries does not
+ * cause the registry to grow. Unlike the growth triggered by a push, reserving
+ * rehashes all the entries at once, since the caller has asked to pay for it
+ * up front.
  */
 
-static inline void
-node_release(struct node *hnd, ag_registry_release_cbk *disp)
+extern void
+ag_registry_reserve(ag_registry *hnd, size_t len)
 {
         AG_ASSERT_PTR (hnd);
+
+        registry_migrate(hnd, SIZE_MAX);
+
+        register size_t cap = hnd->cur.cap;
+
+        while (len * LOAD_DEN > cap * LOAD_NUM)
+                cap *= 2;
+
+        if (cap > hnd->cur.cap) {
+                registry_grow(hnd, cap);
+                registry_migrate(hnd, SIZE_MAX);
+        }
+}
+
+
+/*******************************************************************************
+ * `ag_cregistry_new()` creates a new concurrent registry instance with an empty
+ * snapshot. The callback to copy the data found by lookups is passed through
+ * the first parameter, and the callback to dispose of the data through the
+ * second.
+ */
+
+extern ag_cregistry *
+ag_cregistry_new(ag_registry_copy_cbk *copy, ag_registry_release_cbk *disp)
+{
+        AG_ASSERT_PTR (copy);
         AG_ASSERT_PTR (disp);
 
-        disp(hnd->data);
-        free(hnd);
+        ag_cregistry *r = malloc(sizeof *r);
+        MEM_CHECK (r);
+
+        r->snap = malloc(sizeof *r->snap);
+        MEM_CHECK (r->snap);
+        table_init(r->snap, CAP_MIN);
+
+        r->ep = __ag_epoch_new__();
+
+        pthread_mutex_init(&r->wr, NULL);
+        r->copy = copy;
+        r->disp = disp;
+
+        return r;
+}
+
+
+/*******************************************************************************
+ * `ag_cregistry_release()` releases a concurrent registry instance along with
+ * the data in its snapshot. No other thread may be using the registry by the
+ * time it is released.
+ */
+
+extern void
+ag_cregistry_release(ag_cregistry **hnd)
+{
+        ag_cregistry *r;
+
+        if (AG_LIKELY (hnd && (r = *hnd))) {
+                for (register size_t i = 0; i < r->snap->cap; i++) {
+                        if (r->snap->slot[i].dist)
+                                r->disp(r->snap->slot[i].data);
+                }
+
+                free(r->snap->slot);
+                free(r->snap);
+                __ag_epoch_release__(&r->ep);
+                pthread_mutex_destroy(&r->wr);
+                free(r);
+                *hnd = NULL;
+        }
+}
+
+
+/*******************************************************************************
+ * `ag_cregistry_get()` gets a copy of the data registered against a given hash
+ * key, or `NULL` if there is none. The copy is made while the lookup is still
+ * registered as a reader of the snapshot, so the data cannot be disposed of by
+ * a concurrent write before it has been copied.
+ */
+
+extern void *
+ag_cregistry_get(ag_cregistry *hnd, ag_hash key)
+{
+        AG_ASSERT_PTR (hnd);
+
+        size_t *rd = __ag_epoch_enter__(hnd->ep);
+        void *data = table_get(__atomic_load_n(&hnd->snap, __ATOMIC_SEQ_CST),
+            key);
+
+        if (data)
+                data = hnd->copy(data);
+
+        __ag_epoch_leave__(rd);
+        return data;
+}
+
+
+/*******************************************************************************
+ * `ag_cregistry_push()` registers data against a given hash key, replacing any
+ * data already registered against the key. The write is made on a copy of the
+ * current snapshot, which is then published in its place.
+ */
+
+extern void
+ag_cregistry_push(ag_cregistry *hnd, ag_hash key, void *data)
+{
+        AG_ASSERT_PTR (hnd);
+        AG_ASSERT_PTR (data);
+
+        pthread_mutex_lock(&hnd->wr);
+
+        struct table *t = snapshot_clone(hnd->snap);
+        register size_t i = table_find(t, key);
+        void *old = NULL;
+
+        if (i != SIZE_MAX) {
+                old = t->slot[i].data;
+                t->slot[i].data = data;
+        } else
+                table_put(t, key, data);
+
+        snapshot_publish(hnd, t, old);
+        pthread_mutex_unlock(&hnd->wr);
+}
+
+
+/*******************************************************************************
+ * `ag_cregistry_remove()` removes the data registered against a given hash key,
+ * if any, in the same way as `ag_cregistry_push()` replaces it.
+ */
+
+extern void
+ag_cregistry_remove(ag_cregistry *hnd, ag_hash key)
+{
+        AG_ASSERT_PTR (hnd);
+
+        pthread_mutex_lock(&hnd->wr);
+
+        register size_t i = table_find(hnd->snap, key);
+
+        if (i != SIZE_MAX) {
+                struct table *t = snapshot_clone(hnd->snap);
+                void *old = t->slot[i].data;
+
+                table_erase(t, i);
+                snapshot_publish(hnd, t, old);
+        }
+
+        pthread_mutex_unlock(&hnd->wr);
+}
+
+
+/*******************************************************************************
+ * `ag_cregistry_len()` gets the number of entries in the current snapshot of a
+ * concurrent registry instance.
+ */
+
+extern size_t
+ag_cregistry_len(const ag_cregistry *hnd)
+{
+        AG_ASSERT_PTR (hnd);
+
+        return __atomic_load_n(&hnd->snap, __ATOMIC_ACQUIRE)->len;
+}
+
+
+/*******************************************************************************
+ * `__ag_epoch_new__()` creates a new set of reader epochs with no readers.
+ */
+
+extern struct ag_epoch *
+__ag_epoch_new__(void)
+{
+        struct ag_epoch *e = aligned_alloc(_Alignof(struct ag_epoch),
+            sizeof *e);
+        MEM_CHECK (e);
+        memset(e, 0, sizeof *e);
+
+        return e;
+}
+
+
+/*******************************************************************************
+ * `__ag_epoch_release__()` releases a set of reader epochs. No reader may be
+ * left by the time it is released.
+ */
+
+extern void
+__ag_epoch_release__(struct ag_epoch **hnd)
+{
+        if (AG_LIKELY (hnd && *hnd)) {
+                free(*hnd);
+                *hnd = NULL;
+        }
+}
+
+
+/*******************************************************************************
+ * `__ag_epoch_enter__()` registers the calling thread as a reader in the
+ * current epoch, and returns the counter to decrement when the read is over.
+ * The epoch is checked again after incrementing its counter; if a writer
+ * flipped the epoch in between, the increment may have come too late for the
+ * writer to see, so the reader backs off and retries with the new epoch.
+ */
+
+extern size_t *
+__ag_epoch_enter__(struct ag_epoch *hnd)
+{
+        static unsigned next = 0;
+        static AG_THREADLOCAL unsigned stripe = READ_STRIPES;
+
+        if (AG_UNLIKELY (stripe == READ_STRIPES))
+                stripe = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED)
+                    % READ_STRIPES;
+
+        for (;;) {
+                register unsigned e = __atomic_load_n(&hnd->cur,
+                    __ATOMIC_SEQ_CST);
+                size_t *n = &hnd->rd[stripe].n[e];
+
+                __atomic_add_fetch(n, 1, __ATOMIC_SEQ_CST);
+
+                if (AG_LIKELY (__atomic_load_n(&hnd->cur, __ATOMIC_SEQ_CST)
+                    == e))
+                        return n;
+
+                __atomic_sub_fetch(n, 1, __ATOMIC_SEQ_CST);
+        }
+}
+
+
+/*******************************************************************************
+ * `__ag_epoch_leave__()` is the converse of `__ag_epoch_enter__()`, and marks
+ * the end of a read through the counter returned by the latter.
+ */
+
+extern void
+__ag_epoch_leave__(size_t *n)
+{
+        __atomic_sub_fetch(n, 1, __ATOMIC_RELEASE);
+}
+
+
+/*******************************************************************************
+ * `__ag_epoch_sync__()` flips the epoch and waits until no reader remains in
+ * the previous epoch. A writer calls it after publishing new data with a
+ * sequentially consistent store; any reader still in the previous epoch may be
+ * reading the data that was replaced, whereas readers entering the new epoch
+ * are bound to see the new data, so the replaced data can be reclaimed once
+ * this function returns. Writers must be serialised by the caller.
+ */
+
+extern void
+__ag_epoch_sync__(struct ag_epoch *hnd)
+{
+        register unsigned e = hnd->cur;
+
+        __atomic_store_n(&hnd->cur, !e, __ATOMIC_SEQ_CST);
+
+        for (register size_t i = 0; i < READ_STRIPES; i++) {
+                while (__atomic_load_n(&hnd->rd[i].n[e], __ATOMIC_SEQ_CST))
+                        sched_yield();
+        }
+}
+
+
+/*******************************************************************************
+ * `registry_grow()` replaces the current table of a registry instance with an
+ * empty table of a given capacity, keeping the former as the table to drain.
+ * Any table still being drained is drained completely first, although this is
+ * only possible through `ag_registry_reserve()`.
+ */
+
+static void
+registry_grow(ag_registry *hnd, size_t cap)
+{
+        registry_migrate(hnd, SIZE_MAX);
+        free(hnd->old.slot);
+
+        hnd->old = hnd->cur;
+        hnd->mig = 0;
+        table_init(&hnd->cur, cap);
+}
+
+
+/*******************************************************************************
+ * `registry_migrate()` moves up to a given number of entries from the table
+ * being drained to the current table of a registry instance. The entries are
+ * taken in slot order, resuming from where the last call left off, and are
+ * erased rather than simply cleared so that the probe sequences of the entries
+ * still in the old table stay intact. Erasing may shift the next entry back
+ * into the slot just drained, which is why the slot is checked again.
+ */
+
+static void
+registry_migrate(ag_registry *hnd, size_t n)
+{
+        register struct table *t = &hnd->old;
+        register size_t i = hnd->mig;
+
+        while (t->len && n--) {
+                while (!t->slot[i].dist)
+                        i++;
+
+                table_put(&hnd->cur, t->slot[i].key, t->slot[i].data);
+                table_erase(t, i);
+        }
+
+        hnd->mig = i;
+}
+
+
+/*******************************************************************************
+ * `table_init()` initialises a table with a given power of two capacity and no
+ * entries.
+ */
+
+static void
+table_init(struct table *hnd, size_t cap)
+{
+        hnd->slot = calloc(cap, sizeof *hnd->slot);
+        MEM_CHECK (hnd->slot);
+
+        hnd->cap = cap;
+        hnd->len = 0;
+        hnd->shift = 64 - __builtin_ctzll(cap);
+}
+
+
+/*******************************************************************************
+ * `table_home()` gets the home slot of a hash key in a table. The key is
+ * scrambled with a Fibonacci multiplication and its top bits are taken; the
+ * hash functions mix their keys well, but client code may push keys of its own
+ * whose low bits are not well distributed.
+ */
+
+static inline size_t
+table_home(const struct table *hnd, ag_hash key)
+{
+        return (size_t)(((uint64_t)key * UINT64_C(0x9e3779b97f4a7c15))
+            >> hnd->shift);
+}
+
+
+/*******************************************************************************
+ * `table_find()` gets the slot index of a hash key in a table, or `SIZE_MAX`
+ * if the key is not present. The probe stops as soon as it reaches a slot whose
+ * entry is closer to its own home than the key would be, since Robin Hood
+ * insertion guarantees that the key cannot lie beyond such a slot.
+ */
+
+static size_t
+table_find(const struct table *hnd, ag_hash key)
+{
+        register const size_t mask = hnd->cap - 1;
+        register size_t i = table_home(hnd, key);
+        register size_t d = 1;
+
+        while (hnd->slot[i].dist >= d) {
+                if (hnd->slot[i].key == key)
+                        return i;
+
+                i = (i + 1) & mask;
+                d++;
+        }
+
+        return SIZE_MAX;
+}
+
+
+/*******************************************************************************
+ * `table_get()` gets the data associated with a hash key in a table, or `NULL`
+ * if the key is not present.
+ */
+
+static void *
+table_get(const struct table *hnd, ag_hash key)
+{
+        register size_t i = table_find(hnd, key);
+
+        return i == SIZE_MAX ? NULL : hnd->slot[i].data;
 }
 
+
+/*******************************************************************************
+ * `table_put()` places a new entry in a table that is known not to contain its
+ * hash key and to have a free slot. Following the Robin Hood scheme, the entry
+ * displaces any entry closer to its home slot than the entry being placed, and
+ * the displaced entry continues the probe in its stead.
+ */
+
+static void
+table_put(struct table *hnd, ag_hash key, void *data)
+{
+        register const size_t mask = hnd->cap - 1;
+        register size_t i = table_home(hnd, key);
+        struct slot s = {.key = key, .data = data, .dist = 1};
+
+        while (hnd->slot[i].dist) {
+                if (hnd->slot[i].dist < s.dist) {
+                        struct slot tmp = hnd->slot[i];
+                        hnd->slot[i] = s;
+                        s = tmp;
+                }
+
+                i = (i + 1) & mask;
+                s.dist++;
+        }
+
+        hnd->slot[i] = s;
+        hnd->len++;
+}
+
+
+/*******************************************************************************
+ * `table_erase()` erases the entry in a given slot of a table by shifting the
+ * following entries of the same probe run back by one slot, so that no
+ * tombstones are needed.
+ */
+
+static void
+table_erase(struct table *hnd, size_t idx)
+{
+        register const size_t mask = hnd->cap - 1;
+        register size_t i = idx;
+        register size_t j = (i + 1) & mask;
+
+        while (hnd->slot[j].dist > 1) {
+                hnd->slot[i] = hnd->slot[j];
+                hnd->slot[i].dist--;
+
+                i = j;
+                j = (j + 1) & mask;
+        }
+
+        memset(&hnd->slot[i], 0, sizeof hnd->slot[i]);
+        hnd->len--;
+}
+
+
+/*******************************************************************************
+ * `snapshot_clone()` copies a snapshot table so that a writer can modify the
+ * copy. The copy is given twice the capacity if one more entry would take it
+ * past the load factor, in which case the entries are rehashed into it.
+ */
+
+static struct table *
+snapshot_clone(const struct table *src)
+{
+        struct table *t = malloc(sizeof *t);
+        MEM_CHECK (t);
+
+        if (AG_UNLIKELY ((src->len + 1) * LOAD_DEN > src->cap * LOAD_NUM)) {
+                table_init(t, src->cap * 2);
+
+                for (register size_t i = 0; i < src->cap; i++) {
+                        if (src->slot[i].dist)
+                                table_put(t, src->slot[i].key,
+                                    src->slot[i].data);
+                }
+        } else {
+                *t = *src;
+                t->slot = malloc(sizeof *t->slot * t->cap);
+                MEM_CHECK (t->slot);
+                memcpy(t->slot, src->slot, sizeof *t->slot * t->cap);
+        }
+
+        return t;
+}
+
+
+/*******************************************************************************
+ * `snapshot_publish()` replaces the snapshot of a concurrent registry with a
+ * new one, and then waits until no lookup can still be reading the previous
+ * snapshot. Once the wait is over, the previous snapshot is freed along with
+ * any data that the write replaced or removed, which is passed through the
+ * third parameter. The caller must hold the writer lock.
+ */
+
+static void
+snapshot_publish(ag_cregistry *hnd, struct table *snap, void *old)
+{
+        struct table *prev = hnd->snap;
+
+        __atomic_store_n(&hnd->snap, snap, __ATOMIC_SEQ_CST);
+        __ag_epoch_sync__(hnd->ep);
+
+        if (old)
+                hnd->disp(old);
+
+        free(prev->slot);
+        free(prev);
+}
@@ -45,6 +45,12 @@ extern "C" {
  * be provided by the client code, along with a callback function that releases
  * the values on termination. The callback function is required to be of the
  * type `ag_registry_release_cbk`.
+ *
+ * Pushing an entry with a hash key that is already registered replaces the
+ * existing entry, disposing of its data, and `ag_registry_remove()` removes an
+ * entry along with its data. The registry grows as entries are pushed, but
+ * `ag_registry_reserve()` can be used to size it up front for a known number
+ * of entries.
  */
 
 typedef struct ag_registry      ag_registry;
@@ -54,6 +60,53 @@ extern ag_registry      *ag_registry_new(ag_registry_release_cbk *);
 extern void              ag_registry_release(ag_registry **);
 extern void             *ag_registry_get(const ag_registry *, ag_hash);
 extern void              ag_registry_push(ag_registry *, ag_hash, void *);
+extern void              ag_registry_remove(ag_registry *, ag_hash);
+extern void              ag_registry_reserve(ag_registry *, size_t);
+extern size_t            ag_registry_len(const ag_registry *);
+
+
+/*******************************************************************************
+ * The `ag_cregistry` type is a variant of `ag_registry` for registries that are
+ * read from several threads at once, and that are mostly read once populated.
+ * Lookups take no lock; they read an immutable snapshot of the registry that
+ * writers replace wholesale. Writers are serialised, and each write waits for
+ * the lookups still reading the previous snapshot before disposing of any
+ * replaced data.
+ *
+ * Since the data found by a lookup may be replaced as soon as the lookup
+ * returns, `ag_cregistry_get()` returns a copy of the data made through a
+ * callback of type `ag_registry_copy_cbk`, which the caller then owns. For
+ * reference counted objects, the copy callback simply bumps the count.
+ */
+
+typedef struct ag_cregistry     ag_cregistry;
+typedef void                    *(ag_registry_copy_cbk)(const void *);
+
+extern ag_cregistry     *ag_cregistry_new(ag_registry_copy_cbk *,
+                            ag_registry_release_cbk *);
+extern void              ag_cregistry_release(ag_cregistry **);
+extern void             *ag_cregistry_get(ag_cregistry *, ag_hash);
+extern void              ag_cregistry_push(ag_cregistry *, ag_hash, void *);
+extern void              ag_cregistry_remove(ag_cregistry *, ag_hash);
+extern size_t            ag_cregistry_len(const ag_cregistry *);
+
+
+/*
+ * The reader epochs through which `ag_cregistry` reclaims replaced snapshots
+ * are protected, and are shared with the other lock-free readers of the
+ * library, such as the HTTP router. A reader brackets its reads between
+ * __ag_epoch_enter__() and __ag_epoch_leave__(), and a writer that has
+ * published new data calls __ag_epoch_sync__() before reclaiming the data it
+ * replaced.
+ */
+
+struct ag_epoch;
+
+extern struct ag_epoch  *__ag_epoch_new__(void);
+extern void              __ag_epoch_release__(struct ag_epoch **);
+extern size_t           *__ag_epoch_enter__(struct ag_epoch *);
+extern void              __ag_epoch_leave__(size_t *);
+extern void              __ag_epoch_sync__(struct ag_epoch *);
 
 
 #ifdef __cplusplus
@@ -25,16 +25,15 @@
 
 #include <uuid/uuid.h>
 
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <sys/random.h>
 
-struct ag_uuid {
-        uuid_t  uuid;
-};
 
-
-/* Required for FreeBSD */
-#ifndef UUID_STR_LEN
-#       define UUID_STR_LEN 37
-#endif
+_Static_assert(sizeof (uuid_t) == sizeof ((ag_uuid *)0)->uuid,
+    "ag_uuid must hold a uuid_t");
 
 
 extern inline bool      ag_uuid_lt(const ag_uuid *, const ag_uuid *);
@@ -42,16 +41,163 @@ extern inline bool      ag_uuid_eq(const ag_uuid *, const ag_uuid *);
 extern inline bool      ag_uuid_gt(const ag_uuid *, const ag_uuid *);
 
 
+/*
+ * Each thread draws the random bits of its UUIDs from its own buffer of CSPRNG
+ * output, refilled by a single getrandom() call once every RAND_BFR_SZ / 16
+ * UUIDs. A thread also remembers the timestamp and counter of the last version
+ * 7 UUID it generated, so that its version 7 UUIDs keep increasing even when
+ * several are generated within the same millisecond.
+ *
+ * A forked child inherits the buffer of the thread that forked, and would
+ * generate the same UUIDs as its parent, so the buffer is emptied in the child
+ * by an atfork handler.
+ */
+
+#define RAND_BFR_SZ 4096
+
+static AG_THREADLOCAL struct {
+        unsigned char    bfr[RAND_BFR_SZ]; /* random bytes            */
+        size_t           pos;              /* next unused byte        */
+        uint64_t         ms;               /* last v7 timestamp       */
+        unsigned         seq;              /* last v7 counter         */
+} g_rand = {.pos = RAND_BFR_SZ};
+
+static pthread_once_t g_rand_once = PTHREAD_ONCE_INIT;
+
+
+static void
+rand_atfork(void)
+{
+        g_rand.pos = RAND_BFR_SZ;
+        g_rand.ms = 0;
+}
+
+
+static void
+rand_init(void)
+{
+        (void)pthread_atfork(NULL, NULL, rand_atfork);
+}
+
+
+/*
+ * Take the next 16 random bytes from the buffer of the calling thread, and
+ * refill it first if it has run out. getrandom() may return short for a buffer
+ * of this size if interrupted by a signal, so we loop until the buffer is full;
+ * should getrandom() be unavailable, libuuid fills in the remainder.
+ */
+static const unsigned char *
+rand_take(void)
+{
+        if (AG_UNLIKELY (g_rand.pos == RAND_BFR_SZ)) {
+                pthread_once(&g_rand_once, rand_init);
+
+                size_t n = 0;
+                ssize_t r;
+
+                while (n < RAND_BFR_SZ) {
+                        if (AG_LIKELY ((r = getrandom(g_rand.bfr + n,
+                            RAND_BFR_SZ - n, 0)) > 0))
+                                n += (size_t)r;
+                        else if (errno != EINTR)
+                                break;
+                }
+
+                for (n &= ~(size_t)15; n < RAND_BFR_SZ; n += 16)
+                        uuid_generate_random(g_rand.bfr + n);
+
+                g_rand.pos = 0;
+        }
+
+        const unsigned char *p = g_rand.bfr + g_rand.pos;
+        g_rand.pos += 16;
+
+        return p;
+}
+
+
+/*
+ * Fill in a version 4 UUID: 122 random bits with the version nibble set to 4
+ * and the variant bits set to 10.
+ */
+static inline void
+gen_v4(unsigned char *uuid)
+{
+        memcpy(uuid, rand_take(), 16);
+
+        uuid[6] = (uuid[6] & 0x0f) | 0x40;
+        uuid[8] = (uuid[8] & 0x3f) | 0x80;
+}
+
+
+/*
+ * Fill in a version 7 UUID: a 48-bit millisecond Unix timestamp, the version
+ * nibble, a 12-bit counter, the variant bits and 62 random bits. The counter
+ * starts from a random value below 2048 in each new millisecond, leaving room
+ * for at least 2048 UUIDs in that millisecond; if it does overflow, or if the
+ * clock steps backwards, the timestamp of the previous UUID is carried forward
+ * by a millisecond so that UUIDs from the same thread never decrease.
+ */
+static inline void
+gen_v7(unsigned char *uuid)
+{
+        const unsigned char *r = rand_take();
+        struct timespec ts;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t ms = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+        if (AG_LIKELY (ms > g_rand.ms))
+                g_rand.seq = ((r[0] << 8) | r[1]) & 0x7ff;
+        else if (AG_LIKELY (++g_rand.seq <= 0xfff))
+                ms = g_rand.ms;
+        else {
+                ms = g_rand.ms + 1;
+                g_rand.seq = 0;
+        }
+
+        g_rand.ms = ms;
+
+        for (register int i = 0; i < 6; i++)
+                uuid[i] = (unsigned char)(ms >> (40 - 8 * i));
+
+        uuid[6] = 0x70 | (g_rand.seq >> 8);
+        uuid[7] = g_rand.seq & 0xff;
+        memcpy(uuid + 8, r + 8, 8);
+        uuid[8] = (uuid[8] & 0x3f) | 0x80;
+}
+
+
 extern ag_uuid *
 ag_uuid_new(void)
+{
+        return ag_uuid_new_version(AG_UUID_V4);
+}
+
+
+extern ag_uuid *
+ag_uuid_new_version(enum ag_uuid_version ver)
 {
         ag_uuid *ctx = ag_memblock_new(sizeof *ctx);
-        uuid_generate_random(ctx->uuid);
+        ag_uuid_generate(ctx, ver);
 
         return (ctx);
 }
 
 
+extern void
+ag_uuid_generate(ag_uuid *ctx, enum ag_uuid_version ver)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT (ver == AG_UUID_V4 || ver == AG_UUID_V7);
+
+        if (ver == AG_UUID_V7)
+                gen_v7(ctx->uuid);
+        else
+                gen_v4(ctx->uuid);
+}
+
+
 extern ag_uuid *
 ag_uuid_new_empty(void)
 {
@@ -116,11 +262,16 @@ ag_uuid_cmp(const ag_uuid *ctx, const ag_uuid *cmp)
 }
 
 
+/*
+ * The hash of a UUID is taken over its 16 raw bytes, which fit the branch-free
+ * short input path of ag_hash_new_len(), rather than over its textual form.
+ */
 extern ag_hash
 ag_uuid_hash(const ag_uuid *ctx)
 {
-        AG_AUTO(ag_string) *s = ag_uuid_str(ctx);
-        return (ag_hash_new_str(s));
+        AG_ASSERT_PTR (ctx);
+
+        return (ag_hash_new_len(ctx->uuid, sizeof ctx->uuid));
 }
 
 
@@ -138,9 +289,33 @@ ag_uuid_str(const ag_uuid *ctx)
 {
         AG_ASSERT_PTR (ctx);
 
-        char bfr[UUID_STR_LEN];
-        uuid_unparse_upper(ctx->uuid, bfr);
+        char bfr[AG_UUID_STR_LEN];
+        ag_uuid_fmt(ctx, bfr);
 
         return (ag_string_new(bfr));
 }
 
+
+/*
+ * Format a UUID in its 8-4-4-4-12 upper case hexadecimal form, two digits per
+ * byte from a lookup table, with the hyphens placed after bytes 4, 6, 8 and 10.
+ */
+extern void
+ag_uuid_fmt(const ag_uuid *ctx, char *bfr)
+{
+        AG_ASSERT_PTR (ctx);
+        AG_ASSERT_PTR (bfr);
+
+        static const char hex[] = "0123456789ABCDEF";
+
+        for (register size_t i = 0; i < sizeof ctx->uuid; i++) {
+                if (i == 4 || i == 6 || i == 8 || i == 10)
+                        *bfr++ = '-';
+
+                *bfr++ = hex[ctx->uuid[i] >> 4];
+                *bfr++ = hex[ctx->uuid[i] & 0xf];
+        }
+
+        *bfr = '\0';
+}
+
@@ -34,15 +34,46 @@ extern "C" {
 #include "./string.h"
 
 
-typedef struct ag_uuid ag_uuid;
+/*
+ * The `ag_uuid` type holds the 16 raw bytes of a UUID. UUIDs handed out by the
+ * interface functions below are memory blocks, but the struct is declared here
+ * so that other types can also hold a UUID inline, as objects do with theirs;
+ * `ag_uuid_generate()` fills in such an inline UUID. `ag_uuid_fmt()` writes the
+ * upper case textual form of a UUID into a caller buffer of `AG_UUID_STR_LEN`
+ * bytes, including the null terminator, without allocating.
+ */
+
+typedef struct ag_uuid {
+        unsigned char   uuid[16];
+} ag_uuid;
+
+#define AG_UUID_STR_LEN 37
+
+
+/*
+ * UUIDs are generated either as random version 4 UUIDs, or as version 7 UUIDs
+ * that start with a millisecond Unix timestamp. Version 7 UUIDs sort in order
+ * of creation, and are successively increasing within a thread, which keeps
+ * B-tree indexes keyed on them from fragmenting. Both are generated from a
+ * per-thread buffer of CSPRNG output that is refilled in bulk, so that most
+ * UUIDs are generated without a system call. `ag_uuid_new()` generates version
+ * 4 UUIDs, and `ag_uuid_new_version()` lets the version be chosen per call.
+ */
+
+enum ag_uuid_version {
+        AG_UUID_V4 = 4,
+        AG_UUID_V7 = 7,
+};
 
 
 extern ag_uuid *ag_uuid_new(void);
+extern ag_uuid *ag_uuid_new_version(enum ag_uuid_version);
 extern ag_uuid *ag_uuid_new_empty(void);
 extern ag_uuid *ag_uuid_parse(const char *);
 ag_uuid *ag_uuid_copy(const ag_uuid *);
 extern ag_uuid *ag_uuid_clone(const ag_uuid *);
 extern void ag_uuid_release(ag_uuid **);
+extern void ag_uuid_generate(ag_uuid *, enum ag_uuid_version);
 
 
 extern enum ag_cmp ag_uuid_cmp(const ag_uuid *, const ag_uuid *);
@@ -66,6 +97,7 @@ inline bool ag_uuid_gt(const ag_uuid *ctx, const ag_uuid *cmp)
 extern bool ag_uuid_empty(const ag_uuid *);
 extern ag_hash ag_uuid_hash(const ag_uuid *);
 extern ag_string *ag_uuid_str(const ag_uuid *);
+extern void ag_uuid_fmt(const ag_uuid *, char *);
 
 
 #ifdef __cplusplus
@@ -83,10 +83,14 @@ static ag_alist *sample_empty(void);
 static ag_alist *sample_single(void);
 static ag_alist *sample_list(void);
 static ag_alist *sample_list_2(void);
+static ag_alist *sample_list_long(void);
 
 
 static bool     iterator(const ag_field *, void *, void *);
 static bool     iterator_mutable(ag_field **, void *, void *);
+static ag_value *transform_val(const ag_field *, void *);
+static bool      predicate_even(const ag_field *, void *);
+static bool      predicate_lookup(const ag_field *, void *);
 
 
 AG_METATEST_OBJECT_COPY(ag_alist, sample_empty());
@@ -427,6 +431,119 @@ AG_METATEST_ALIST_PARSE("foo=bar&bar=foo&key=val", "=", "&",
     "((foo:bar) (bar:foo) (key:val))");
 
 
+AG_METATEST_ALIST_PARSE_FORM("", "()");
+AG_METATEST_ALIST_PARSE_FORM("foo=bar", "((foo:bar))");
+AG_METATEST_ALIST_PARSE_FORM("foo=bar&bar=foo", "((foo:bar) (bar:foo))");
+AG_METATEST_ALIST_PARSE_FORM("foo&bar=&=foo", "((foo:) (bar:) (:foo))");
+AG_METATEST_ALIST_PARSE_FORM("&foo=bar&&", "((foo:bar))");
+AG_METATEST_ALIST_PARSE_FORM("a%26b=c%3Dd&e+f=g%2", "((a&b:c=d) (e f:g%2))");
+AG_METATEST_ALIST_PARSE_FORM("k=v=w", "((k:v=w))");
+AG_METATEST_ALIST_PARSE_FORM("k=a%00b&%00=v", "((k:a%00b) (%00:v))");
+AG_METATEST_ALIST_PARSE_FORM("k=%\xe9\xe9%e9", "((k:%\xe9\xe9\xe9))");
+
+
+AG_TEST_CASE("ag_alist_val(): sample_list_long() => indexed lookup")
+{
+        AG_AUTO(ag_alist) *a = sample_list_long();
+        register bool t = true;
+
+        for (register ag_int i = 1; i <= 100; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_alist_val(a, k);
+
+                t &= ag_alist_has_key(a, k) && ag_value_int(v) == i * 10;
+        }
+
+        AG_AUTO(ag_value) *k = ag_value_new_int(101);
+        AG_AUTO(ag_string) *ks = ag_string_new("1");
+        AG_AUTO(ag_value) *s = ag_value_new_string(ks);
+
+        AG_TEST (t && !ag_alist_has_key(a, k) && !ag_alist_has_key(a, s));
+}
+
+
+AG_TEST_CASE("ag_alist_has_key(): sample_list_long() => tracks push and set_at")
+{
+        AG_AUTO(ag_alist) *a = sample_list_long();
+        AG_AUTO(ag_value) *k = ag_value_new_int(200);
+        AG_AUTO(ag_value) *k2 = ag_value_new_int(300);
+        AG_AUTO(ag_value) *k3 = ag_value_new_int(50);
+        AG_AUTO(ag_field) *f = ag_field_new(k, k);
+        AG_AUTO(ag_field) *f2 = ag_field_new(k2, k2);
+
+        (void)ag_alist_has_key(a, k);
+        ag_alist_push(&a, f);
+        ag_alist_set_at(&a, f2, 50);
+
+        AG_TEST (ag_alist_has_key(a, k) && ag_alist_has_key(a, k2)
+            && !ag_alist_has_key(a, k3));
+}
+
+
+AG_TEST_CASE("ag_alist_val(): duplicate keys => first field wins")
+{
+        AG_AUTO(ag_alist) *a = sample_list_long();
+        AG_AUTO(ag_value) *k = ag_value_new_int(7);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-7);
+        AG_AUTO(ag_field) *f = ag_field_new(k, v);
+
+        ag_alist_push(&a, f);
+        AG_AUTO(ag_value) *v2 = ag_alist_val(a, k);
+
+        AG_TEST (ag_value_int(v2) == 70);
+}
+
+
+AG_TEST_CASE("ag_alist_val_set(): sample_list_long() => clone unaffected")
+{
+        AG_AUTO(ag_alist) *a = sample_list_long();
+        AG_AUTO(ag_value) *k = ag_value_new_int(64);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        (void)ag_alist_has_key(a, k);
+        AG_AUTO(ag_alist) *a2 = ag_alist_clone(a);
+        ag_alist_val_set(&a2, k, v);
+
+        AG_AUTO(ag_value) *v1 = ag_alist_val(a, k);
+        AG_AUTO(ag_value) *v2 = ag_alist_val(a2, k);
+
+        AG_TEST (ag_value_int(v1) == 640 && ag_value_int(v2) == -1);
+}
+
+
+AG_TEST_CASE("ag_alist_val(): keys with equal hashes => matching type wins")
+{
+        AG_AUTO(ag_alist) *a = ag_alist_new_empty();
+        AG_AUTO(ag_value) *k = ag_value_new_uint(1);
+        AG_AUTO(ag_value) *k2 = ag_value_new_int(1);
+        AG_AUTO(ag_value) *v = ag_value_new_int(10);
+        AG_AUTO(ag_value) *v2 = ag_value_new_int(20);
+        AG_AUTO(ag_field) *f = ag_field_new(k, v);
+        AG_AUTO(ag_field) *f2 = ag_field_new(k2, v2);
+
+        ag_alist_push(&a, f);
+        ag_alist_push(&a, f2);
+        AG_AUTO(ag_value) *v3 = ag_alist_val(a, k2);
+
+        AG_TEST (ag_value_hash(k) == ag_value_hash(k2)
+            && ag_value_int(v3) == 20);
+}
+
+
+AG_TEST_CASE("ag_alist_has_val(): sample_list() => tracks val_set")
+{
+        AG_AUTO(ag_alist) *a = sample_list();
+        AG_AUTO(ag_field) *f = ag_alist_get_at(a, 1);
+        AG_AUTO(ag_value) *k = ag_field_key(f);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_alist_val_set(&a, k, v);
+        AG_AUTO(ag_value) *v2 = ag_alist_val(a, k);
+
+        AG_TEST (ag_alist_has_val(a, v) && ag_value_int(v2) == -1);
+}
+
+
 AG_TEST_CASE("ag_alist_map(): sample_empty() => no effect")
 {
         AG_AUTO(ag_alist) *a = sample_empty();
@@ -471,6 +588,109 @@ AG_TEST_CASE("ag_alist_map_mutable(): sample_list() => sum")
 }
 
 
+AG_TEST_CASE("ag_alist_cursor_next(): sample_empty() => false")
+{
+        AG_AUTO(ag_alist) *a = sample_empty();
+        ag_alist_cursor c;
+
+        ag_alist_cursor_init(&c, a);
+        AG_TEST (!ag_alist_cursor_next(&c));
+}
+
+
+AG_TEST_CASE("ag_alist_cursor_get(): sample_list_long() => fields in order")
+{
+        AG_AUTO(ag_alist) *a = sample_list_long();
+        AG_AUTO(ag_alist) *a2 = ag_alist_copy(a);
+        register ag_int i = 0;
+        register bool t = true;
+        ag_alist_cursor c;
+
+        ag_alist_cursor_init(&c, a2);
+
+        while (ag_alist_cursor_next(&c)) {
+                const ag_field *f = ag_alist_cursor_get(&c);
+                t &= ag_value_int(ag_field_key_peek(f)) == ++i
+                    && ag_value_int(ag_field_val_peek(f)) == i * 10;
+        }
+
+        AG_TEST (t && i == 100 && ag_alist_refc(a) == 2);
+}
+
+
+AG_TEST_CASE("ag_alist_set_at(): copy spanning spine levels => original kept")
+{
+        AG_AUTO(ag_alist) *a = ag_alist_new_empty();
+        register bool t = true;
+
+        for (register ag_int i = 1; i <= 5000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_value_new_int(i * 10);
+                AG_AUTO(ag_field) *f = ag_field_new(k, v);
+
+                ag_alist_push(&a, f);
+        }
+
+        AG_AUTO(ag_alist) *a2 = ag_alist_copy(a);
+        AG_AUTO(ag_value) *k = ag_value_new_int(4321);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+        AG_AUTO(ag_field) *f = ag_field_new(k, v);
+
+        ag_alist_set_at(&a2, f, 4321);
+
+        for (register ag_int i = 1; i <= 5000; i++) {
+                AG_AUTO(ag_value) *k2 = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v2 = ag_alist_val(a, k2);
+                AG_AUTO(ag_value) *v3 = ag_alist_val(a2, k2);
+
+                t &= ag_value_int(v2) == i * 10
+                    && ag_value_int(v3) == (i == 4321 ? -1 : i * 10);
+        }
+
+        AG_TEST (t && ag_alist_len(a2) == 5000);
+}
+
+
+AG_TEST_CASE("ag_alist_pmap(): sample_list_long() => values in order")
+{
+        AG_AUTO(ag_alist) *a = sample_list_long();
+        AG_AUTO(ag_list) *l = ag_alist_pmap(a, transform_val, NULL, 1);
+        AG_AUTO(ag_list) *l2 = ag_alist_pmap(a, transform_val, NULL, 0);
+        register bool t = ag_list_len(l) == 100 && ag_list_eq(l, l2);
+
+        for (register size_t i = 1; i <= 100; i++) {
+                AG_AUTO(ag_value) *v = ag_list_get_at(l, i);
+                t &= ag_value_int(v) == (ag_int)i * 10;
+        }
+
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_alist_pfilter(): sample_list_long() => even keys in order")
+{
+        AG_AUTO(ag_alist) *a = sample_list_long();
+        AG_AUTO(ag_alist) *a2 = ag_alist_pfilter(a, predicate_even, NULL, 1);
+        AG_AUTO(ag_field) *f = ag_alist_get_at(a2, 1);
+        AG_AUTO(ag_field) *f2 = ag_alist_get_at(a2, 50);
+        AG_AUTO(ag_value) *k = ag_field_key(f);
+        AG_AUTO(ag_value) *k2 = ag_field_key(f2);
+
+        AG_TEST (ag_alist_len(a2) == 50 && ag_value_int(k) == 2
+            && ag_value_int(k2) == 100 && ag_alist_has_key(a2, k2));
+}
+
+
+AG_TEST_CASE("ag_alist_pfilter(): concurrent lookups => index built once")
+{
+        AG_AUTO(ag_alist) *a = sample_list_long();
+        AG_AUTO(ag_alist) *a2 = sample_list_long();
+        AG_AUTO(ag_alist) *a3 = ag_alist_pfilter(a, predicate_lookup, a2, 1);
+
+        AG_TEST (ag_alist_eq(a, a3));
+}
+
+
 /*
  * Define the test_suite_alist() function. We generate the test cases from the
  * above metatest definitions through a call to AG_TEST_SUITE_GENERATE().
@@ -520,6 +740,23 @@ sample_list_2(void)
 }
 
 
+static ag_alist *
+sample_list_long(void)
+{
+        ag_alist *a = ag_alist_new_empty();
+
+        for (register ag_int i = 1; i <= 100; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_value_new_int(i * 10);
+                AG_AUTO(ag_field) *f = ag_field_new(k, v);
+
+                ag_alist_push(&a, f);
+        }
+
+        return a;
+}
+
+
 static bool
 iterator(const ag_field *attr, void *in, void *out)
 {
@@ -546,3 +783,27 @@ iterator_mutable(ag_field **attr, void *in, void *out)
         return true;
 }
 
+
+static ag_value *
+transform_val(const ag_field *attr, void *in)
+{
+        (void)in;
+
+        return ag_field_val(attr);
+}
+
+
+static bool
+predicate_even(const ag_field *attr, void *in)
+{
+        (void)in;
+
+        return !(ag_value_int(ag_field_key_peek(attr)) % 2);
+}
+
+
+static bool
+predicate_lookup(const ag_field *attr, void *in)
+{
+        return ag_alist_has_key(in, ag_field_key_peek(attr));
+}
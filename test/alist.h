@@ -162,4 +162,13 @@
         }
 
 
+#define AG_METATEST_ALIST_PARSE_FORM(src, exp) \
+        AG_TEST_CASE("ag_alist_parse_form(): " src " => " exp) \
+        { \
+                AG_AUTO(ag_alist) *a = ag_alist_parse_form(src); \
+                AG_AUTO(ag_string) *s = ag_alist_str(a); \
+                AG_TEST (ag_string_eq(s, exp)); \
+        }
+
+
 #endif /* !__ARGENT_TEST_ALIST_H__ */
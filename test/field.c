@@ -69,6 +69,19 @@ AG_TEST_CASE("ag_field_parse() can parse a string representing a field")
 }
 
 
+AG_TEST_CASE("ag_field_key_peek() and ag_field_val_peek() borrow the field")
+{
+        AG_AUTO(ag_field) *f = ag_field_parse("foo=bar", "=");
+        const ag_value *k = ag_field_key_peek(f);
+        const ag_value *v = ag_field_val_peek(f);
+
+        AG_TEST (ag_string_eq(ag_value_string(k), "foo")
+            && ag_string_eq(ag_value_string(v), "bar")
+            && ag_string_refc(ag_value_string(k)) == 1
+            && ag_string_refc(ag_value_string(v)) == 1);
+}
+
+
 AG_TEST_CASE("ag_field_parse parses a field without a value")
 {
         AG_AUTO(ag_field) *f = ag_field_parse("foobar", "=");
@@ -274,6 +274,41 @@ AG_METATEST_HTTP_REQUEST_PARAM(REQUEST_GET1(), param_single());
 AG_METATEST_HTTP_REQUEST_PARAM(REQUEST_GET2(), param_array());
 
 
+/*
+ * Test ag_http_request_capture() with the captures of a route attached to a
+ * sample HTTP request object, and with a sample that has none. The value of a
+ * capture is expected to lie in the URL path of the request itself, and to be
+ * kept by a clone of the request.
+ */
+
+
+AG_TEST_CASE("ag_http_request_capture(): no captures => NULL")
+{
+        AG_AUTO(ag_http_request) *r = REQUEST_GET2();
+        size_t len = 0;
+
+        AG_TEST (!ag_http_request_capture(r, "id", &len) && !len);
+}
+
+
+AG_TEST_CASE("ag_http_request_capture(): capture => slice of the path")
+{
+        AG_AUTO(ag_http_request) *r = REQUEST_GET2();
+        AG_AUTO(ag_string) *k = ag_string_new("id");
+        struct ag_http_capture cap = {.key = k, .off = 1, .len = 2};
+
+        __ag_http_request_capture__(&r, &cap, 1);
+
+        AG_AUTO(ag_http_request) *cp = ag_http_request_clone(r);
+        AG_AUTO(ag_http_url) *u = ag_http_request_url(cp);
+        AG_AUTO(ag_string) *p = ag_http_url_path(u);
+        size_t len = 0;
+
+        AG_TEST (ag_http_request_capture(cp, "id", &len) == p + 1 && len == 2
+            && !ag_http_request_capture(cp, "name", &len));
+}
+
+
 
 /*
  * Define the test_suite_http_request() function. We generate the test cases
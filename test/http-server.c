@@ -0,0 +1,1126 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./test.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+
+/*
+ * Define the ID of the test suite for the HTTP server interface. We need this
+ * ID for the testing macros to correctly generate the boilerplate testing code.
+ */
+
+
+#define __AG_TEST_SUITE_ID__ 21
+
+
+/*
+ * Declare the helpers for the test cases, which run the server with one of its
+ * backends in a forked child and talk to it through a minimal FastCGI or HTTP
+ * client. server_start() forks a server with a given backend listening on a
+ * UNIX socket, in pre-fork mode with one worker process if asked to, and
+ * server_stop() stops it. server_worker() finds the worker process of a server
+ * in pre-fork mode. client_connect() connects to the server, req_put()
+ * and params_put() encode the records of a FastCGI request into a buffer, and
+ * client_recv() reads records until the given number of requests have ended,
+ * collecting the stdout stream of each request in the reply with the same
+ * index as the request ID. http_recv() reads until the given number of HTTP
+ * responses have been received in full. Each registered route is served by
+ * test_http_server_echo(), which responds with the path of the request
+ * followed by the number of its params, except for the /users/:id route,
+ * which is served by test_http_server_capture() with the captured id.
+ */
+
+
+#define REQ_MAX 4
+#define BFR_SZ  4096
+
+struct reply {
+        char     out[BFR_SZ];
+        size_t   len;
+        bool     done;
+};
+
+static pid_t     server_start(enum ag_http_server_backend, bool);
+static bool      server_stop(pid_t, int);
+static pid_t     server_worker(pid_t);
+static int       client_connect(void);
+static bool      client_recv(int, struct reply *, int);
+static size_t    req_put(unsigned char *, int, bool, const char *,
+                    const char *);
+static size_t    params_put(unsigned char *, int, const char *, size_t);
+static size_t    rec_put(unsigned char *, int, int, const void *, size_t);
+static bool      read_full(int, void *, size_t);
+static size_t    http_recv(int, char *, size_t, int);
+static bool      reply_has(const struct reply *, const char *);
+
+extern void      test_http_server_echo(const ag_http_request *);
+extern void      test_http_server_capture(const ag_http_request *);
+
+static char      g_sock[64];
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_LIBFCGI: request waiting for body => other"
+    " thread serves")
+{
+        unsigned char b[BFR_SZ];
+        struct reply r[REQ_MAX] = {{.len = 0}};
+        const unsigned char begin[8] = {0, 1};
+        pid_t pid = server_start(AG_HTTP_SERVER_LIBFCGI, false);
+        int fd = client_connect();
+        int fd2 = client_connect();
+        register bool t = fd >= 0 && fd2 >= 0;
+
+        if (t) {
+                size_t n = rec_put(b, 1, 1, begin, sizeof begin);
+                n += params_put(b + n, 1, "/post", 7);
+                n += rec_put(b + n, 5, 1, "a=1", 3);
+                t = write(fd, b, n) == (ssize_t)n;
+
+                n = req_put(b, 1, false, "/hello", NULL);
+                t = t && write(fd2, b, n) == (ssize_t)n
+                    && client_recv(fd2, r, 1)
+                    && reply_has(&r[1], "/hello:0");
+
+                memset(r, 0, sizeof r);
+                n = rec_put(b, 5, 1, "&b=2", 4);
+                n += rec_put(b + n, 5, 1, NULL, 0);
+                t = t && write(fd, b, n) == (ssize_t)n
+                    && client_recv(fd, r, 1)
+                    && reply_has(&r[1], "/post:2");
+        }
+
+        if (fd >= 0)
+                close(fd);
+
+        if (fd2 >= 0)
+                close(fd2);
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_LIBFCGI: pre-fork worker killed => restarted")
+{
+        unsigned char b[BFR_SZ];
+        struct timespec ts = {.tv_nsec = 10000000};
+        pid_t pid = server_start(AG_HTTP_SERVER_LIBFCGI, true);
+        pid_t w = -1, w2 = -1;
+        register bool t = true;
+
+        for (register int i = 0; t && i < 2; i++) {
+                struct reply r[REQ_MAX] = {{.len = 0}};
+                size_t n = req_put(b, 1, false, "/hello", NULL);
+                int fd = client_connect();
+
+                t = fd >= 0 && write(fd, b, n) == (ssize_t)n
+                    && client_recv(fd, r, 1) && reply_has(&r[1], "/hello:0");
+
+                if (fd >= 0)
+                        close(fd);
+
+                if (i || !t)
+                        continue;
+
+                t = (w = server_worker(pid)) > 0 && !kill(w, SIGKILL);
+
+                for (register int j = 0; t && j < 500; j++) {
+                        if ((w2 = server_worker(pid)) > 0 && w2 != w)
+                                break;
+
+                        nanosleep(&ts, NULL);
+                }
+
+                t = t && w2 > 0 && w2 != w;
+        }
+
+        AG_TEST (server_stop(pid, SIGTERM) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_FASTCGI: request => handler response")
+{
+        unsigned char b[BFR_SZ];
+        struct reply r[REQ_MAX] = {{.len = 0}};
+        pid_t pid = server_start(AG_HTTP_SERVER_FASTCGI, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                size_t n = req_put(b, 1, false, "/hello", NULL);
+                t = write(fd, b, n) == (ssize_t)n && client_recv(fd, r, 1)
+                    && reply_has(&r[1], "/hello:0")
+                    && strstr(r[1].out, "Status: 200")
+                    && read(fd, b, 1) == 0;
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_FASTCGI: unknown route => 404 response")
+{
+        unsigned char b[BFR_SZ];
+        struct reply r[REQ_MAX] = {{.len = 0}};
+        pid_t pid = server_start(AG_HTTP_SERVER_FASTCGI, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                size_t n = req_put(b, 1, false, "/missing", NULL);
+                t = write(fd, b, n) == (ssize_t)n && client_recv(fd, r, 1)
+                    && strstr(r[1].out, "Status: 404");
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_FASTCGI: FCGI_KEEP_CONN => connection reused")
+{
+        unsigned char b[BFR_SZ];
+        pid_t pid = server_start(AG_HTTP_SERVER_FASTCGI, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        for (register int i = 0; t && i < 3; i++) {
+                struct reply r[REQ_MAX] = {{.len = 0}};
+                size_t n = req_put(b, 1, true, "/hello", NULL);
+
+                t = write(fd, b, n) == (ssize_t)n && client_recv(fd, r, 1)
+                    && reply_has(&r[1], "/hello:0");
+        }
+
+        if (fd >= 0)
+                close(fd);
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_FASTCGI: interleaved requests => all answered")
+{
+        unsigned char b[BFR_SZ];
+        struct reply r[REQ_MAX] = {{.len = 0}};
+        pid_t pid = server_start(AG_HTTP_SERVER_FASTCGI, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                const unsigned char begin[8] = {0, 1, 1};
+                size_t n = 0;
+
+                n += rec_put(b + n, 1, 1, begin, sizeof begin);
+                n += rec_put(b + n, 1, 2, begin, sizeof begin);
+                n += rec_put(b + n, 1, 3, begin, sizeof begin);
+                n += params_put(b + n, 3, "/hello", 0);
+                n += params_put(b + n, 1, "/hello", 0);
+                n += params_put(b + n, 2, "/post", 7);
+                n += rec_put(b + n, 5, 2, "a=1&", 4);
+                n += rec_put(b + n, 5, 3, NULL, 0);
+                n += rec_put(b + n, 5, 2, "b=2", 3);
+                n += rec_put(b + n, 5, 2, NULL, 0);
+                n += rec_put(b + n, 5, 1, NULL, 0);
+
+                t = write(fd, b, n) == (ssize_t)n && client_recv(fd, r, 3)
+                    && reply_has(&r[1], "/hello:0")
+                    && reply_has(&r[2], "/post:2")
+                    && reply_has(&r[3], "/hello:0");
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_FASTCGI: FCGI_GET_VALUES => multiplexing on")
+{
+        unsigned char b[BFR_SZ], q[32], h[8];
+        pid_t pid = server_start(AG_HTTP_SERVER_FASTCGI, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                q[0] = 15;
+                q[1] = 0;
+                memcpy(q + 2, "FCGI_MPXS_CONNS", 15);
+
+                size_t n = rec_put(b, 9, 0, q, 17);
+                t = write(fd, b, n) == (ssize_t)n && read_full(fd, h, 8)
+                    && h[1] == 10 && read_full(fd, b, h[4] << 8 | h[5])
+                    && (h[4] << 8 | h[5]) == 18
+                    && !memcmp(b, "\x0f\x01" "FCGI_MPXS_CONNS1", 18);
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_FASTCGI: pre-fork SIGTERM => drained cleanly")
+{
+        unsigned char b[BFR_SZ];
+        struct reply r[REQ_MAX] = {{.len = 0}};
+        pid_t pid = server_start(AG_HTTP_SERVER_FASTCGI, true);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                size_t n = req_put(b, 1, true, "/hello", NULL);
+                t = write(fd, b, n) == (ssize_t)n && client_recv(fd, r, 1)
+                    && reply_has(&r[1], "/hello:0");
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGTERM) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: keep-alive => connection reused")
+{
+        char b[BFR_SZ];
+        const char *req = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        for (register int i = 0; t && i < 3; i++) {
+                size_t n = strlen(req);
+
+                t = write(fd, req, n) == (ssize_t)n
+                    && http_recv(fd, b, sizeof b, 1)
+                    && !strncmp(b, "HTTP/1.1 200 OK\r\n", 17)
+                    && strstr(b, "Content-Length: 8\r\n")
+                    && strstr(b, "\r\n\r\n/hello:0");
+        }
+
+        if (fd >= 0)
+                close(fd);
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: pipelined requests => answered in order")
+{
+        char b[BFR_SZ];
+        const char *req = "GET /hello?a=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /missing HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "POST /post HTTP/1.1\r\nHost: localhost\r\nContent-Type: "
+            "application/x-www-form-urlencoded\r\nContent-Length: 7\r\n"
+            "Connection: close\r\n\r\na=1&b=2";
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                size_t n = strlen(req);
+                char *r1, *r2, *r3;
+
+                t = write(fd, req, n) == (ssize_t)n
+                    && http_recv(fd, b, sizeof b, 3)
+                    && (r1 = strstr(b, "/hello:1"))
+                    && (r2 = strstr(r1, "HTTP/1.1 404 Not Found\r\n"))
+                    && (r3 = strstr(r2, "Connection: close\r\n"))
+                    && strstr(r3, "\r\n\r\n/post:2")
+                    && read(fd, b, 1) == 0;
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: request in pieces => parsed incrementally")
+{
+        char b[BFR_SZ];
+        const char *req = "POST /post HTTP/1.1\r\nHost: localhost:8080\r\n"
+            "Content-Type: application/x-www-form-urlencoded\r\n"
+            "Content-Length: 11\r\n\r\nx=1&y=2&z=3";
+        struct timespec ts = {.tv_nsec = 1000000};
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        for (register size_t i = 0; t && req[i]; i++) {
+                t = write(fd, req + i, 1) == 1;
+                nanosleep(&ts, NULL);
+        }
+
+        if (fd >= 0) {
+                t = t && http_recv(fd, b, sizeof b, 1)
+                    && strstr(b, "\r\n\r\n/post:3");
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: malformed request => 400 and close")
+{
+        char b[BFR_SZ];
+        const char *req = "GET /hello\r\n\r\n";
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                size_t n = strlen(req);
+
+                t = write(fd, req, n) == (ssize_t)n
+                    && http_recv(fd, b, sizeof b, 1)
+                    && !strncmp(b, "HTTP/1.1 400 Bad Request\r\n", 26)
+                    && read(fd, b, 1) == 0;
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: unknown content type => 415 and served on")
+{
+        char b[BFR_SZ];
+        const char *req = "POST /hello HTTP/1.1\r\nHost: localhost\r\n"
+            "Content-Type: image/png\r\nContent-Length: 1\r\n\r\nx";
+        const char *req2 = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                size_t n = strlen(req);
+
+                t = write(fd, req, n) == (ssize_t)n
+                    && http_recv(fd, b, sizeof b, 1)
+                    && !strncmp(b, "HTTP/1.1 415 Unsupported Media Type\r\n",
+                    37)
+                    && read(fd, b, 1) == 0;
+
+                close(fd);
+        }
+
+        if (t && (t = (fd = client_connect()) >= 0)) {
+                size_t n = strlen(req2);
+
+                t = write(fd, req2, n) == (ssize_t)n
+                    && http_recv(fd, b, sizeof b, 1)
+                    && !strncmp(b, "HTTP/1.1 200 OK\r\n", 17);
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: pre-fork SIGTERM => partial request"
+    " dropped")
+{
+        char b[BFR_SZ];
+        const char *req = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /hello HTTP/1.1\r\nHost: loc";
+        struct timeval tv = {.tv_sec = 5};
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, true);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                size_t n = strlen(req);
+
+                t = !setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv)
+                    && write(fd, req, n) == (ssize_t)n
+                    && http_recv(fd, b, sizeof b, 1)
+                    && !kill(pid, SIGTERM)
+                    && read(fd, b, 1) == 0;
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, t ? SIGTERM : SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: half-closed client => pending responses"
+    " sent")
+{
+        char b[BFR_SZ], q[BFR_SZ];
+        const char *req = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        struct timeval tv = {.tv_usec = 200000};
+        size_t n = strlen(req), k = sizeof q / n, sent = 0, recvd = 0, len;
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        for (register size_t i = 0; i < k; i++)
+                memcpy(q + i * n, req, n);
+
+        if (t) {
+                t = write(fd, req, n) == (ssize_t)n
+                    && (len = http_recv(fd, b, sizeof b, 1))
+                    && !setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv,
+                    sizeof tv);
+
+                for (register int i = 0; t && i < 400; i++) {
+                        ssize_t w = write(fd, q, k * n);
+
+                        if (w > 0)
+                                sent += w;
+
+                        if (w != (ssize_t)(k * n))
+                                break;
+                }
+
+                t = t && sent && !shutdown(fd, SHUT_WR);
+
+                for (ssize_t r; t && (r = read(fd, b, sizeof b)) > 0;)
+                        recvd += r;
+
+                t = t && recvd == sent / n * len;
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: unread pipelined responses => read stalled")
+{
+        char b[BFR_SZ], q[BFR_SZ];
+        const char *req = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        struct timeval tv = {.tv_usec = 200000};
+        size_t n = strlen(req), k = sizeof q / n, sent = 0, recvd = 0, len;
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        for (register size_t i = 0; i < k; i++)
+                memcpy(q + i * n, req, n);
+
+        if (t) {
+                t = write(fd, req, n) == (ssize_t)n
+                    && (len = http_recv(fd, b, sizeof b, 1))
+                    && !setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv,
+                    sizeof tv);
+
+                size_t max = t ? (16 << 20) / len * n : 0;
+                ssize_t w;
+
+                while (sent < max && (w = write(fd, q, k * n)) > 0)
+                        sent += w;
+
+                t = t && sent < max && !shutdown(fd, SHUT_WR);
+
+                for (ssize_t r; t && (r = read(fd, b, sizeof b)) > 0;)
+                        recvd += r;
+
+                t = t && recvd == sent / n * len;
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("AG_HTTP_SERVER_HTTP: route with capture => captured value")
+{
+        char b[BFR_SZ];
+        const char *req = "GET /users/42 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "DELETE /users/42 HTTP/1.1\r\nHost: localhost\r\n"
+            "Connection: close\r\n\r\n";
+        pid_t pid = server_start(AG_HTTP_SERVER_HTTP, false);
+        int fd = client_connect();
+        register bool t = fd >= 0;
+
+        if (t) {
+                size_t n = strlen(req);
+                char *r1;
+
+                t = write(fd, req, n) == (ssize_t)n
+                    && http_recv(fd, b, sizeof b, 2)
+                    && (r1 = strstr(b, "\r\n\r\nid=42"))
+                    && strstr(r1, "HTTP/1.1 405 Method Not Allowed\r\n");
+
+                close(fd);
+        }
+
+        AG_TEST (server_stop(pid, SIGKILL) && t);
+}
+
+
+AG_TEST_CASE("__ag_http_router_find__(): static route => exact match only")
+{
+        struct ag_http_router *r = __ag_http_router_new__();
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("test_http_server_echo");
+        struct ag_http_route rt;
+        register bool t;
+
+        __ag_http_router_add__(r, NULL, "/hello", p);
+        __ag_http_router_add__(r, NULL, "/help", p);
+        __ag_http_router_add__(r, NULL, "/", p);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/hello", &rt);
+        t = rt.hnd && !rt.ncap;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/", &rt);
+        t = t && rt.hnd;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/hel", &rt);
+        t = t && !rt.hnd && !rt.path;
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/hello/", &rt);
+        t = t && !rt.hnd && !rt.path;
+
+        __ag_http_router_release__(&r);
+        AG_TEST (t && !r);
+}
+
+
+AG_TEST_CASE("__ag_http_router_find__(): :param => captures a segment")
+{
+        struct ag_http_router *r = __ag_http_router_new__();
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("test_http_server_echo");
+        const char *path = "/users/42/posts/7";
+        struct ag_http_route rt;
+        register bool t;
+
+        __ag_http_router_add__(r, NULL, "/users/:id/posts/:post", p);
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, path, &rt);
+
+        t = rt.hnd && rt.ncap == 2
+            && !strcmp(rt.cap[0].key, "id") && rt.cap[0].off == 7
+            && rt.cap[0].len == 2 && !strcmp(rt.cap[1].key, "post")
+            && !strncmp(path + rt.cap[1].off, "7", rt.cap[1].len);
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/users//posts/7",
+            &rt);
+        t = t && !rt.hnd;
+
+        __ag_http_router_release__(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("__ag_http_router_find__(): static segment => preferred to param")
+{
+        struct ag_http_router *r = __ag_http_router_new__();
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("test_http_server_echo");
+        AG_AUTO(ag_plugin) *q = ag_plugin_new_local("test_http_server_capture");
+        struct ag_http_route rt;
+        register bool t;
+
+        __ag_http_router_add__(r, NULL, "/users/:id/posts", q);
+        __ag_http_router_add__(r, NULL, "/users/new", p);
+        __ag_http_router_add__(r, NULL, "/users/newest", p);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/users/new", &rt);
+        t = rt.hnd && ag_plugin_hnd(rt.hnd) == test_http_server_echo
+            && !rt.ncap;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/users/new/posts",
+            &rt);
+        t = t && rt.hnd && ag_plugin_hnd(rt.hnd) == test_http_server_capture
+            && rt.ncap == 1 && rt.cap[0].len == 3;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/users/ne", &rt);
+        t = t && !rt.hnd;
+
+        __ag_http_router_release__(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("__ag_http_router_find__(): *wildcard => captures the rest")
+{
+        struct ag_http_router *r = __ag_http_router_new__();
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("test_http_server_echo");
+        const char *path = "/static/css/site.css";
+        struct ag_http_route rt;
+        register bool t;
+
+        __ag_http_router_add__(r, NULL, "/static/*file", p);
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, path, &rt);
+
+        t = rt.hnd && rt.ncap == 1 && !strcmp(rt.cap[0].key, "file")
+            && !strcmp(path + rt.cap[0].off, "css/site.css")
+            && rt.cap[0].len == 12;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/static/", &rt);
+        t = t && rt.hnd && rt.ncap == 1 && !rt.cap[0].len;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_release__(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("__ag_http_router_find__(): method => own handler, else any")
+{
+        struct ag_http_router *r = __ag_http_router_new__();
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("test_http_server_echo");
+        AG_AUTO(ag_plugin) *q = ag_plugin_new_local("test_http_server_capture");
+        enum ag_http_method post = AG_HTTP_METHOD_POST;
+        struct ag_http_route rt;
+        register bool t;
+
+        __ag_http_router_add__(r, &post, "/items", q);
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/items", &rt);
+        t = !rt.hnd && rt.path;
+
+        __ag_http_router_add__(r, NULL, "/items", p);
+        __ag_http_router_find__(r, AG_HTTP_METHOD_GET, "/items", &rt);
+        t = t && rt.hnd && ag_plugin_hnd(rt.hnd) == test_http_server_echo;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_find__(r, AG_HTTP_METHOD_POST, "/items", &rt);
+        t = t && rt.hnd && ag_plugin_hnd(rt.hnd) == test_http_server_capture;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_add__(r, &post, "/items", p);
+        __ag_http_router_find__(r, AG_HTTP_METHOD_POST, "/items", &rt);
+        t = t && rt.hnd && ag_plugin_hnd(rt.hnd) == test_http_server_echo;
+        ag_plugin_release(&rt.hnd);
+
+        __ag_http_router_release__(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("__ag_http_router_add__(): replaced handler => released")
+{
+        struct ag_http_router *r = __ag_http_router_new__();
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("test_http_server_echo");
+        AG_AUTO(ag_plugin) *q = ag_plugin_new_local("test_http_server_capture");
+
+        __ag_http_router_add__(r, NULL, "/items", p);
+        __ag_http_router_add__(r, NULL, "/items/:id", p);
+
+        for (register int i = 0; i < 100; i++)
+                __ag_http_router_add__(r, NULL, "/items", i % 2 ? p : q);
+
+        register bool t = ag_plugin_refc(p) == 3 && ag_plugin_refc(q) == 1;
+
+        __ag_http_router_release__(&r);
+        AG_TEST (t && ag_plugin_refc(p) == 1);
+}
+
+
+static void *
+router_reader(void *ctx)
+{
+        struct ag_http_route rt;
+        register bool t = true;
+
+        for (register int i = 0; t && i < 20000; i++) {
+                __ag_http_router_find__(ctx, AG_HTTP_METHOD_GET, "/items/7",
+                    &rt);
+                t = rt.hnd && rt.ncap == 1;
+                ag_plugin_release(&rt.hnd);
+        }
+
+        return (void *)(uintptr_t)t;
+}
+
+
+AG_TEST_CASE("__ag_http_router_add__(): concurrent lookups => handler found")
+{
+        struct ag_http_router *r = __ag_http_router_new__();
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("test_http_server_echo");
+        AG_AUTO(ag_plugin) *q = ag_plugin_new_local("test_http_server_capture");
+        register bool t = true;
+        pthread_t thr[2];
+        void *res;
+
+        __ag_http_router_add__(r, NULL, "/items/:id", p);
+
+        for (register int i = 0; i < 2; i++)
+                pthread_create(&thr[i], NULL, router_reader, r);
+
+        for (register int i = 0; i < 1000; i++)
+                __ag_http_router_add__(r, NULL, "/items/:id", i % 2 ? p : q);
+
+        for (register int i = 0; i < 2; i++) {
+                pthread_join(thr[i], &res);
+                t = t && res;
+        }
+
+        __ag_http_router_release__(&r);
+        AG_TEST (t && ag_plugin_refc(p) == 1 && ag_plugin_refc(q) == 1);
+}
+
+
+extern ag_test_suite *
+test_suite_http_server(void)
+{
+        return AG_TEST_SUITE_GENERATE("ag_http_server interface");
+}
+
+
+extern void
+test_http_server_echo(const ag_http_request *req)
+{
+        AG_AUTO(ag_http_url) *u = ag_http_request_url(req);
+        AG_AUTO(ag_string) *p = ag_http_url_path(u);
+        AG_AUTO(ag_alist) *a = ag_http_request_param(req);
+        AG_AUTO(ag_string) *s = ag_string_new_fmt("%s:%zu", p,
+            ag_alist_len(a));
+        AG_AUTO(ag_http_response) *r = ag_http_response_new(
+            AG_HTTP_MIME_TEXT_PLAIN, AG_HTTP_STATUS_200_OK, s);
+
+        ag_http_server_respond(r);
+}
+
+
+extern void
+test_http_server_capture(const ag_http_request *req)
+{
+        size_t len = 0;
+        const char *id = ag_http_request_capture(req, "id", &len);
+        AG_AUTO(ag_string) *s = ag_string_new_fmt("id=%.*s", (int)len,
+            id ? id : "");
+        AG_AUTO(ag_http_response) *r = ag_http_response_new(
+            AG_HTTP_MIME_TEXT_PLAIN, AG_HTTP_STATUS_200_OK, s);
+
+        ag_http_server_respond(r);
+}
+
+
+/*
+ * Fork the server. The child never returns into the test harness; in pre-fork
+ * mode it exits successfully once its worker has been drained. The child skips
+ * the debug messages logged for every request, which would otherwise make the
+ * tests that send thousands of requests crawl.
+ */
+static pid_t
+server_start(enum ag_http_server_backend backend, bool prefork)
+{
+        snprintf(g_sock, sizeof g_sock, "/tmp/argent-test-%d.sock", getpid());
+        (void)unlink(g_sock);
+
+        pid_t pid = fork();
+
+        if (pid)
+                return pid;
+
+        setlogmask(LOG_UPTO(LOG_INFO));
+
+        struct ag_http_server_opt opt = {.threads = 2, .procs = prefork,
+            .listen = g_sock, .backend = backend};
+        ag_http_server_init(&opt);
+
+        AG_AUTO(ag_plugin) *p = ag_plugin_new_local("test_http_server_echo");
+        ag_http_server_register("/hello", p);
+        ag_http_server_register("/post", p);
+
+        AG_AUTO(ag_plugin) *c = ag_plugin_new_local(
+            "test_http_server_capture");
+        ag_http_server_register_method(AG_HTTP_METHOD_GET, "/users/:id", c);
+
+        ag_http_server_run();
+        ag_http_server_exit();
+        _exit(EXIT_SUCCESS);
+}
+
+
+static bool
+server_stop(pid_t pid, int sig)
+{
+        int status;
+
+        if (pid < 0 || kill(pid, sig) || waitpid(pid, &status, 0) != pid)
+                return false;
+
+        (void)unlink(g_sock);
+
+        return sig == SIGKILL || (WIFEXITED(status)
+            && WEXITSTATUS(status) == EXIT_SUCCESS);
+}
+
+
+/*
+ * Get the process ID of the worker of a server in pre-fork mode, or -1 if it
+ * has none at the moment.
+ */
+static pid_t
+server_worker(pid_t pid)
+{
+        char path[64];
+        int w = -1;
+
+        snprintf(path, sizeof path, "/proc/%d/task/%d/children", pid, pid);
+        FILE *f = fopen(path, "r");
+
+        if (f) {
+                if (fscanf(f, "%d", &w) != 1)
+                        w = -1;
+
+                fclose(f);
+        }
+
+        return w;
+}
+
+
+/*
+ * Connect to the server, retrying for up to two seconds while it starts up.
+ * Reads time out after five seconds so that a misbehaving server fails the
+ * test instead of hanging it.
+ */
+static int
+client_connect(void)
+{
+        struct sockaddr_un sa = {.sun_family = AF_UNIX};
+        struct timeval tv = {.tv_sec = 5};
+        struct timespec ts = {.tv_nsec = 10000000};
+
+        strcpy(sa.sun_path, g_sock);
+
+        for (register int i = 0; i < 200; i++) {
+                int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+                if (fd < 0)
+                        return -1;
+
+                if (!connect(fd, (struct sockaddr *)&sa, sizeof sa)) {
+                        (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv,
+                            sizeof tv);
+                        return fd;
+                }
+
+                close(fd);
+                nanosleep(&ts, NULL);
+        }
+
+        return -1;
+}
+
+
+static bool
+client_recv(int fd, struct reply *r, int n)
+{
+        unsigned char h[8], b[65536 + 256];
+
+        while (n) {
+                if (!read_full(fd, h, sizeof h))
+                        return false;
+
+                int id = h[2] << 8 | h[3];
+                size_t len = h[4] << 8 | h[5];
+
+                if (id >= REQ_MAX || !read_full(fd, b, len + h[6]))
+                        return false;
+
+                if (h[1] == 6 && r[id].len + len < BFR_SZ) {
+                        memcpy(r[id].out + r[id].len, b, len);
+                        r[id].len += len;
+                } else if (h[1] == 3 && !r[id].done) {
+                        r[id].done = true;
+                        n--;
+                }
+        }
+
+        return true;
+}
+
+
+/*
+ * Encode a request for a given URI, with FCGI_KEEP_CONN if asked to. A request
+ * with a body is a POST request with a form body.
+ */
+static size_t
+req_put(unsigned char *b, int id, bool keep, const char *uri,
+    const char *body)
+{
+        const unsigned char begin[8] = {0, 1, keep};
+        size_t blen = body ? strlen(body) : 0;
+        size_t n = 0;
+
+        n += rec_put(b + n, 1, id, begin, sizeof begin);
+        n += params_put(b + n, id, uri, blen);
+
+        if (blen)
+                n += rec_put(b + n, 5, id, body, blen);
+
+        n += rec_put(b + n, 5, id, NULL, 0);
+        return n;
+}
+
+
+/*
+ * Encode the params stream of a request, ended by an empty record. A non-zero
+ * content length makes it a POST request.
+ */
+static size_t
+params_put(unsigned char *b, int id, const char *uri, size_t clen)
+{
+        char len[16];
+        snprintf(len, sizeof len, "%zu", clen);
+
+        const char *kv[][2] = {
+                {"REQUEST_METHOD", clen ? "POST" : "GET"},
+                {"REQUEST_URI", uri},
+                {"CONTENT_TYPE", clen
+                    ? "application/x-www-form-urlencoded" : ""},
+                {"CONTENT_LENGTH", len},
+                {"SERVER_NAME", "localhost"},
+                {"SERVER_PORT", "8080"},
+                {"REMOTE_ADDR", "127.0.0.1"},
+                {"REMOTE_PORT", "54321"},
+                {"HTTP_USER_AGENT", "argent-test"},
+        };
+
+        unsigned char p[1024];
+        size_t n = 0;
+
+        for (register size_t i = 0; i < sizeof kv / sizeof *kv; i++) {
+                size_t kl = strlen(kv[i][0]), vl = strlen(kv[i][1]);
+
+                p[n++] = kl;
+                p[n++] = vl;
+                memcpy(p + n, kv[i][0], kl);
+                memcpy(p + n + kl, kv[i][1], vl);
+                n += kl + vl;
+        }
+
+        size_t m = rec_put(b, 4, id, p, n);
+        return m + rec_put(b + m, 4, id, NULL, 0);
+}
+
+
+static size_t
+rec_put(unsigned char *b, int type, int id, const void *data, size_t len)
+{
+        b[0] = 1;
+        b[1] = type;
+        b[2] = id >> 8;
+        b[3] = id & 0xff;
+        b[4] = len >> 8;
+        b[5] = len & 0xff;
+        b[6] = b[7] = 0;
+
+        if (len)
+                memcpy(b + 8, data, len);
+
+        return 8 + len;
+}
+
+
+static bool
+read_full(int fd, void *bfr, size_t len)
+{
+        char *p = bfr;
+
+        while (len) {
+                ssize_t n = read(fd, p, len);
+
+                if (n <= 0)
+                        return false;
+
+                p += n;
+                len -= n;
+        }
+
+        return true;
+}
+
+
+/*
+ * Read into a buffer until it holds a given number of complete HTTP responses,
+ * each of which has a Content-Length, and terminate it. Returns the number of
+ * bytes read, or 0 if the connection is closed or fails first.
+ */
+static size_t
+http_recv(int fd, char *bfr, size_t sz, int n)
+{
+        size_t len = 0;
+
+        for (;;) {
+                const char *p = bfr;
+                register int done = 0;
+                char *e;
+
+                bfr[len] = '\0';
+
+                while (done < n && (e = strstr(p, "\r\n\r\n"))) {
+                        const char *cl = strstr(p, "Content-Length: ");
+
+                        if (!cl || cl > e)
+                                break;
+
+                        size_t end = e + 4 - bfr + strtoul(cl + 16, NULL, 10);
+
+                        if (end > len)
+                                break;
+
+                        p = bfr + end;
+                        done++;
+                }
+
+                if (done == n)
+                        return len;
+
+                ssize_t r = read(fd, bfr + len, sz - len - 1);
+
+                if (r <= 0)
+                        return 0;
+
+                len += r;
+        }
+}
+
+
+static bool
+reply_has(const struct reply *r, const char *body)
+{
+        size_t n = strlen(body);
+
+        return r->done && r->len >= n
+            && !memcmp(r->out + r->len - n, body, n);
+}
@@ -269,6 +269,32 @@ AG_METATEST_HTTP_URL_PARSE("https://www.domain.com/foo", HTTPS_DOMAIN_FOO());
 AG_METATEST_HTTP_URL_PARSE("https://www.domain.com/foo/bar",
     HTTPS_DOMAIN_FOO_BAR());
 
+
+/*
+ * Check that ag_http_url_parse_env() takes the path from REQUEST_URI up to the
+ * query string or fragment, if any, and the whole URI otherwise.
+ */
+AG_TEST_CASE("ag_http_url_parse_env(): no query string => whole path")
+{
+        struct ag_http_env e = {.https = "", .server_name = "localhost",
+            .server_port = "8080", .request_uri = "/foo/bar"};
+        AG_AUTO(ag_http_url) *u = ag_http_url_parse_env(&e);
+        AG_AUTO(ag_string) *p = ag_http_url_path(u);
+
+        AG_TEST (ag_string_eq(p, "/foo/bar"));
+}
+
+
+AG_TEST_CASE("ag_http_url_parse_env(): query string => path before it")
+{
+        struct ag_http_env e = {.https = "", .server_name = "localhost",
+            .server_port = "8080", .request_uri = "/foo?bar=1#baz"};
+        AG_AUTO(ag_http_url) *u = ag_http_url_parse_env(&e);
+        AG_AUTO(ag_string) *p = ag_http_url_path(u);
+
+        AG_TEST (ag_string_eq(p, "/foo"));
+}
+
 /*
  * Define the test_suite_http_url() function. We generate the test cases from
  * the above metatest definitions through a call to AG_TEST_SUITE_GENERATE().
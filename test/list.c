@@ -43,6 +43,10 @@
 
 static ag_list *sample_int(void);
 static ag_list *sample_int_2(void);
+static ag_list *sample_int_long(void);
+static ag_list *sample_int_huge(void);
+static ag_list *sample_int_scrambled(void);
+static ag_list *sample_str_scrambled(void);
 
 
 /*
@@ -56,6 +60,33 @@ static bool     iterator(const ag_value *, void *, void *);
 static bool     iterator_mutable(ag_value **, void *, void *);
 
 
+/*
+ * Declare the prototypes for the callback functions that are used to test out
+ * the parallel functions of lists, along with iterator_push(), which builds the
+ * serial results to compare them against.
+ */
+
+
+static ag_value *transform_str(const ag_value *, void *);
+static ag_value *transform_copy(const ag_value *, void *);
+static bool      predicate_even(const ag_value *, void *);
+static ag_value *reducer_sum(const ag_value *, const ag_value *, void *);
+static bool      iterator_push(const ag_value *, void *, void *);
+
+
+/*
+ * Declare the prototypes for the comparators that are used to test out the
+ * sorting functions of lists, along with ordered(), which checks whether a
+ * list is in order according to a comparator.
+ */
+
+
+static enum ag_cmp       cmp_desc(const ag_value *, const ag_value *, void *);
+static enum ag_cmp       cmp_mod(const ag_value *, const ag_value *, void *);
+static bool              ordered(const ag_list *, ag_list_comparator *,
+                             void *);
+
+
 /*
  * Define the test cases for ag_list_new().
  */
@@ -224,6 +255,170 @@ AG_TEST_CASE("ag_list_set_at() sets the value at a given index")
 }
 
 
+/*
+ * Define the test cases for mutating shared lists. Shared lists are expected to
+ * be copied on write, so the other list is left unchanged. We use a list long
+ * enough to span several chunks so that both the first and later chunks are
+ * exercised.
+ */
+
+
+AG_TEST_CASE("ag_list_set_at() does not affect a clone of the list")
+{
+        AG_AUTO(ag_list) *l = sample_int_long();
+        AG_AUTO(ag_list) *l2 = ag_list_clone(l);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_list_set_at(&l2, v, 75);
+        AG_AUTO(ag_value) *v2 = ag_list_get_at(l, 75);
+        AG_AUTO(ag_value) *v3 = ag_list_get_at(l2, 75);
+
+        AG_TEST (ag_value_int(v2) == 75 && ag_value_int(v3) == -1);
+}
+
+
+AG_TEST_CASE("ag_list_set_at() does not affect a copy of the list")
+{
+        AG_AUTO(ag_list) *l = sample_int_long();
+        AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_list_set_at(&l2, v, 1);
+        AG_AUTO(ag_value) *v2 = ag_list_get_at(l, 1);
+        AG_AUTO(ag_value) *v3 = ag_list_get_at(l2, 1);
+
+        AG_TEST (ag_value_int(v2) == 1 && ag_value_int(v3) == -1);
+}
+
+
+AG_TEST_CASE("ag_list_push() does not affect a clone of the list")
+{
+        AG_AUTO(ag_list) *l = sample_int_long();
+        AG_AUTO(ag_list) *l2 = ag_list_clone(l);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_list_push(&l2, v);
+        ag_list_push(&l, v);
+        ag_list_push(&l, v);
+
+        AG_TEST (ag_list_len(l) == 102 && ag_list_len(l2) == 101);
+}
+
+
+AG_TEST_CASE("ag_list_get_at() gets the values of a list spanning chunks")
+{
+        AG_AUTO(ag_list) *l = sample_int_long();
+        register bool chk = true;
+
+        for (register size_t i = 1; i <= 100 && chk; i++) {
+                AG_AUTO(ag_value) *v = ag_list_get_at(l, i);
+                chk = (size_t)ag_value_int(v) == i;
+        }
+
+        AG_TEST (chk);
+}
+
+
+AG_TEST_CASE("ag_list_set_at() on a clone of a list spanning several spine"
+    " levels leaves the list untouched")
+{
+        AG_AUTO(ag_list) *l = ag_list_new();
+        register bool chk = true;
+
+        for (register int i = 1; i <= 40000; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i);
+                ag_list_push(&l, v);
+        }
+
+        AG_AUTO(ag_list) *l2 = ag_list_clone(l);
+
+        for (register size_t i = 1; i <= 40000; i += 997) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(-(int)i);
+                ag_list_set_at(&l2, v, i);
+        }
+
+        for (register size_t i = 1; i <= 40000 && chk; i++) {
+                AG_AUTO(ag_value) *v = ag_list_get_at(l, i);
+                AG_AUTO(ag_value) *v2 = ag_list_get_at(l2, i);
+
+                chk = (size_t)ag_value_int(v) == i
+                    && ag_value_int(v2) == ((i - 1) % 997 ? (int)i : -(int)i);
+        }
+
+        AG_TEST (chk);
+}
+
+
+/*
+ * Define the test cases for ag_list_new_array() and ag_list_reserve().
+ */
+
+
+AG_TEST_CASE("ag_list_new_array() creates a list from an array of values")
+{
+        ag_value *v[100];
+
+        for (register size_t i = 0; i < 100; i++)
+                v[i] = ag_value_new_int(i + 1);
+
+        AG_AUTO(ag_list) *l = ag_list_new_array((const ag_value **)v, 100);
+        AG_AUTO(ag_list) *l2 = sample_int_long();
+
+        AG_TEST (ag_list_len(l) == 100 && ag_list_eq(l, l2));
+}
+
+
+AG_TEST_CASE("ag_list_reserve() does not change the values of a list")
+{
+        AG_AUTO(ag_list) *l = sample_int_long();
+        AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+        AG_AUTO(ag_value) *v = ag_value_new_int(101);
+
+        ag_list_reserve(&l2, 1000);
+        ag_list_push(&l2, v);
+        AG_AUTO(ag_value) *v2 = ag_list_get_at(l2, 100);
+
+        AG_TEST (ag_list_len(l) == 100 && ag_list_len(l2) == 101
+            && ag_value_int(v2) == 100);
+}
+
+
+/*
+ * Define the test cases for frozen lists. A frozen list is shared without
+ * reference counting, and a mutation yields an unfrozen copy.
+ */
+
+
+AG_TEST_CASE("ag_list_freeze() makes copies of a list no-ops")
+{
+        ag_list *l = sample_int_long();
+        ag_list_freeze(l);
+
+        AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+        AG_AUTO(ag_value) *v = ag_list_get_at(l2, 50);
+
+        AG_TEST (l2 == l && ag_list_frozen(l2) && ag_value_int(v) == 50);
+}
+
+
+AG_TEST_CASE("ag_list_set_at() on a frozen list leaves the frozen list"
+    " unchanged")
+{
+        ag_list *l = sample_int_long();
+        ag_list_freeze(l);
+
+        AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+        ag_list_set_at(&l2, v, 50);
+
+        AG_AUTO(ag_value) *v2 = ag_list_get_at(l, 50);
+        AG_AUTO(ag_value) *v3 = ag_list_get_at(l2, 50);
+
+        AG_TEST (!ag_list_frozen(l2) && ag_value_int(v2) == 50
+            && ag_value_int(v3) == -1);
+}
+
+
 /*
  * Define the test cases for ag_list_map_mutable().
  */
@@ -253,6 +448,282 @@ AG_TEST_CASE("ag_list_map_mutable() iterates through a non-empty list")
 }
 
 
+/*
+ * Define the test cases for list cursors.
+ */
+
+
+AG_TEST_CASE("ag_list_cursor_next() returns false on an empty list")
+{
+        AG_AUTO(ag_list) *l = ag_list_new();
+        ag_list_cursor c;
+
+        ag_list_cursor_init(&c, l);
+        AG_TEST (!ag_list_cursor_next(&c) && !ag_list_cursor_next(&c));
+}
+
+
+AG_TEST_CASE("ag_list_cursor_get() visits every value of a list in order")
+{
+        AG_AUTO(ag_list) *l = sample_int_huge();
+        register ag_int i = 0;
+        register bool t = true;
+        ag_list_cursor c;
+
+        ag_list_cursor_init(&c, l);
+
+        while (ag_list_cursor_next(&c))
+                t &= ag_value_int(ag_list_cursor_get(&c)) == ++i;
+
+        AG_TEST (t && i == 10000 && !ag_list_cursor_next(&c));
+}
+
+
+AG_TEST_CASE("ag_list_cursor_next() leaves a shared list untouched")
+{
+        AG_AUTO(ag_list) *l = sample_int_long();
+        AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+        ag_list_cursor c, c2;
+        ag_int sum = 0, sum2 = 0;
+
+        ag_list_cursor_init(&c, l);
+        ag_list_cursor_init(&c2, l2);
+
+        while (ag_list_cursor_next(&c)) {
+                sum += ag_value_int(ag_list_cursor_get(&c));
+
+                if (ag_list_cursor_next(&c2))
+                        sum2 += ag_value_int(ag_list_cursor_get(&c2));
+                if (ag_list_cursor_next(&c2))
+                        sum2 += ag_value_int(ag_list_cursor_get(&c2));
+        }
+
+        AG_TEST (sum == 5050 && sum2 == 5050 && l == l2
+            && ag_list_refc(l) == 2);
+}
+
+
+/*
+ * Define the test cases for the parallel list functions. sample_int_huge() is
+ * long enough to be split across all threads of the shared pool, and each test
+ * is run with more than one grain size, including one that runs serially.
+ */
+
+
+AG_TEST_CASE("ag_list_pmap() returns an empty list for an empty list")
+{
+        AG_AUTO(ag_list) *l = ag_list_new();
+        AG_AUTO(ag_list) *l2 = ag_list_pmap(l, transform_str, NULL, 0);
+
+        AG_TEST (ag_list_empty(l2));
+}
+
+
+AG_TEST_CASE("ag_list_pmap() matches the serial transform of a list")
+{
+        AG_AUTO(ag_list) *l = sample_int_huge();
+        AG_AUTO(ag_list) *exp = ag_list_new();
+        register bool t = true;
+
+        ag_list_map(l, iterator_push, transform_str, &exp);
+
+        for (register size_t g = 0; g <= 10000; g = g * 10 + 1) {
+                AG_AUTO(ag_list) *l2 = ag_list_pmap(l, transform_str, NULL, g);
+
+                t &= ag_list_eq(l2, exp) && ag_list_hash(l2) == ag_list_hash(exp)
+                    && ag_list_sz(l2) == ag_list_sz(exp);
+        }
+
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_list_pmap() can copy values shared across threads")
+{
+        AG_AUTO(ag_string) *s = ag_string_new("shared");
+        AG_AUTO(ag_value) *v = ag_value_new_string(s);
+        AG_AUTO(ag_list) *l = ag_list_new();
+
+        for (register size_t i = 0; i < 10000; i++)
+                ag_list_push(&l, v);
+
+        AG_AUTO(ag_list) *l2 = ag_list_pmap(l, transform_copy, NULL, 1);
+        AG_AUTO(ag_list) *l3 = ag_list_pfilter(l, predicate_even, NULL, 1);
+        AG_AUTO(ag_value) *v2 = ag_list_get_at(l2, 10000);
+
+        AG_TEST (ag_list_eq(l, l2) && ag_value_eq(v, v2)
+            && ag_list_len(l3) == 10000);
+}
+
+
+AG_TEST_CASE("ag_list_pfilter() matches the serial filter of a list")
+{
+        AG_AUTO(ag_list) *l = sample_int_huge();
+        AG_AUTO(ag_list) *exp = ag_list_new();
+        register bool t = true;
+
+        ag_list_map(l, iterator_push, NULL, &exp);
+
+        for (register size_t g = 0; g <= 10000; g = g * 10 + 1) {
+                AG_AUTO(ag_list) *l2 = ag_list_pfilter(l, predicate_even, NULL,
+                    g);
+
+                t &= ag_list_eq(l2, exp);
+        }
+
+        AG_TEST (t && ag_list_len(exp) == 5000);
+}
+
+
+AG_TEST_CASE("ag_list_preduce() matches the serial reduction of a list")
+{
+        AG_AUTO(ag_list) *l = sample_int_huge();
+        AG_AUTO(ag_list) *l2 = ag_list_new();
+        AG_AUTO(ag_value) *init = ag_value_new_int(7);
+        register bool t = true;
+
+        for (register size_t g = 0; g <= 10000; g = g * 10 + 1) {
+                AG_AUTO(ag_value) *v = ag_list_preduce(l, reducer_sum, init,
+                    NULL, g);
+
+                t &= ag_value_int(v) == 50005007;
+        }
+
+        AG_AUTO(ag_value) *v2 = ag_list_preduce(l2, reducer_sum, init, NULL, 0);
+        AG_TEST (t && ag_value_int(v2) == 7);
+}
+
+
+AG_TEST_CASE("ag_list_sort() sorts a scrambled list of integers")
+{
+        AG_AUTO(ag_list) *l = sample_int_scrambled();
+        AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+        AG_AUTO(ag_list) *l3 = sample_int_huge();
+
+        ag_list_sort(&l2, NULL, NULL);
+
+        AG_TEST (ag_list_eq(l2, l3) && ag_list_sorted(l2)
+            && !ag_list_sorted(l) && !ordered(l, NULL, NULL));
+}
+
+
+AG_TEST_CASE("ag_list_sort() sorts a scrambled list of strings")
+{
+        AG_AUTO(ag_list) *l = sample_str_scrambled();
+        ag_list_sort(&l, NULL, NULL);
+
+        AG_TEST (ordered(l, NULL, NULL) && ag_list_sorted(l)
+            && ag_list_len(l) == 10000);
+}
+
+
+AG_TEST_CASE("ag_list_sort() sorts a list of floats with a comparator")
+{
+        AG_AUTO(ag_list) *l = ag_list_new();
+
+        for (register ag_int i = 0; i < 10000; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_float((i * 7919 % 10000)
+                    / 8.0);
+                ag_list_push(&l, v);
+        }
+
+        AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+        ag_list_sort(&l, NULL, NULL);
+        ag_list_sort(&l2, cmp_desc, NULL);
+
+        AG_TEST (ordered(l, NULL, NULL) && ordered(l2, cmp_desc, NULL)
+            && ag_list_sorted(l) && !ag_list_sorted(l2));
+}
+
+
+AG_TEST_CASE("ag_list_sort_stable() keeps equal values in order")
+{
+        AG_AUTO(ag_list) *l = sample_int_huge();
+        ag_int mod = 100;
+        register bool t = true;
+
+        ag_list_sort_stable(&l, cmp_mod, &mod);
+
+        for (register size_t i = 2; i <= 10000; i++) {
+                AG_AUTO(ag_value) *v = ag_list_get_at(l, i - 1);
+                AG_AUTO(ag_value) *v2 = ag_list_get_at(l, i);
+                ag_int m = ag_value_int(v) % mod, m2 = ag_value_int(v2) % mod;
+
+                t &= m < m2 || (m == m2 && ag_value_int(v) < ag_value_int(v2));
+        }
+
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_list_sort() does not affect a copy of the list")
+{
+        AG_AUTO(ag_list) *l = sample_str_scrambled();
+        AG_AUTO(ag_list) *l2 = ag_list_copy(l);
+        AG_AUTO(ag_value) *v = ag_list_get_at(l, 1);
+
+        ag_list_sort_stable(&l2, NULL, NULL);
+        AG_AUTO(ag_value) *v2 = ag_list_get_at(l, 1);
+
+        AG_TEST (ag_value_eq(v, v2) && !ordered(l, NULL, NULL)
+            && ordered(l2, NULL, NULL));
+}
+
+
+AG_TEST_CASE("ag_list_search() finds every value of a sorted list")
+{
+        AG_AUTO(ag_list) *l = sample_int_scrambled();
+        AG_AUTO(ag_value) *v = ag_value_new_int(0);
+        AG_AUTO(ag_value) *v2 = ag_value_new_int(10001);
+        register bool t = true;
+
+        ag_list_sort(&l, NULL, NULL);
+
+        for (register ag_int i = 1; i <= 10000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                t &= ag_list_search(l, k, NULL, NULL) == (size_t)i;
+        }
+
+        AG_TEST (t && !ag_list_search(l, v, NULL, NULL)
+            && !ag_list_search(l, v2, NULL, NULL));
+}
+
+
+AG_TEST_CASE("ag_list_search() finds the first of equal values")
+{
+        AG_AUTO(ag_list) *l = sample_int_huge();
+        AG_AUTO(ag_value) *k = ag_value_new_int(7);
+        ag_int mod = 10;
+
+        ag_list_sort_stable(&l, cmp_mod, &mod);
+        register size_t i = ag_list_search(l, k, cmp_mod, &mod);
+        AG_AUTO(ag_value) *v = ag_list_get_at(l, i);
+
+        AG_TEST (i == 7001 && ag_value_int(v) == 7);
+}
+
+
+AG_TEST_CASE("ag_list_sorted() tracks pushes and sets")
+{
+        AG_AUTO(ag_list) *l = sample_int_huge();
+        AG_AUTO(ag_list) *l2 = ag_list_new();
+        AG_AUTO(ag_value) *v = ag_value_new_int(5000);
+        AG_AUTO(ag_value) *v2 = ag_value_new_int(-1);
+        register bool t = ag_list_sorted(l) && ag_list_sorted(l2);
+
+        ag_list_set_at(&l, v, 5000);
+        t &= ag_list_sorted(l);
+
+        ag_list_set_at(&l, v2, 5000);
+        t &= !ag_list_sorted(l);
+
+        ag_list_push(&l2, v);
+        ag_list_push(&l2, v2);
+
+        AG_TEST (t && !ag_list_sorted(l2));
+}
+
+
 /*
  * Define the test_suite_list() testing interface function. This function is
  * responsible for creating a test suite from the test cases defined above.
@@ -315,6 +786,25 @@ static ag_list *sample_int_2(void)
 }
 
 
+/*
+ * Define the sample_int_long() helper function. This function generates a
+ * sample integer list with the values 1 through 100.
+ */
+
+
+static ag_list *sample_int_long(void)
+{
+        ag_list *l = ag_list_new();
+
+        for (register ag_int i = 1; i <= 100; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i);
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
 /*
  * Define the iterator() helper function. This function is the callback function
  * used to test out ag_list_map(). This function leads to summation of the
@@ -353,3 +843,165 @@ static bool iterator_mutable(ag_value **val, void *in, void *out)
         return true;
 }
 
+
+/*
+ * Define the sample_int_huge() helper function. This function generates a
+ * sample integer list with the values 1 through 10,000.
+ */
+
+
+static ag_list *sample_int_huge(void)
+{
+        ag_list *l = ag_list_new();
+
+        for (register ag_int i = 1; i <= 10000; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i);
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
+/*
+ * Define the sample_int_scrambled() and sample_str_scrambled() helper
+ * functions. These functions generate lists of the integers 1 through 10,000,
+ * and of strings made up from them, in a scrambled order.
+ */
+
+
+static ag_list *sample_int_scrambled(void)
+{
+        ag_list *l = ag_list_new();
+
+        for (register ag_int i = 0; i < 10000; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i * 7919 % 10000 + 1);
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
+static ag_list *sample_str_scrambled(void)
+{
+        ag_list *l = ag_list_new();
+
+        for (register ag_int i = 0; i < 10000; i++) {
+                AG_AUTO(ag_string) *s = ag_string_new_fmt("item/%ld",
+                    i * 7919 % 10000);
+                AG_AUTO(ag_value) *v = ag_value_new_string(s);
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
+/*
+ * Define the callback functions used to test the parallel list functions.
+ * transform_str() turns an integer into a string value, transform_copy()
+ * returns a copy of a value, predicate_even() keeps even integers and any
+ * value that isn't an integer, and reducer_sum() adds two integers.
+ */
+
+
+static ag_value *transform_str(const ag_value *val, void *in)
+{
+        (void)in;
+
+        AG_AUTO(ag_string) *s = ag_string_new_fmt("%ld", ag_value_int(val));
+        return ag_value_new_string(s);
+}
+
+
+static ag_value *transform_copy(const ag_value *val, void *in)
+{
+        (void)in;
+
+        return ag_value_copy(val);
+}
+
+
+static bool predicate_even(const ag_value *val, void *in)
+{
+        (void)in;
+
+        return !ag_value_type_int(val) || !(ag_value_int(val) % 2);
+}
+
+
+static ag_value *reducer_sum(const ag_value *lhs, const ag_value *rhs,
+    void *in)
+{
+        (void)in;
+
+        return ag_value_new_int(ag_value_int(lhs) + ag_value_int(rhs));
+}
+
+
+/*
+ * Define the iterator_push() helper function. This function builds the serial
+ * result of a parallel function by pushing values to the list passed through
+ * the output parameter; the values are transformed first if a transform is
+ * passed through the input parameter, and filtered through predicate_even()
+ * otherwise.
+ */
+
+
+static bool iterator_push(const ag_value *val, void *in, void *out)
+{
+        ag_list_transform *map = in;
+        ag_list **l = out;
+
+        if (map) {
+                AG_AUTO(ag_value) *v = map(val, NULL);
+                ag_list_push(l, v);
+        } else if (predicate_even(val, NULL))
+                ag_list_push(l, val);
+
+        return true;
+}
+
+
+/*
+ * Define the comparators used to test the sorting functions. cmp_desc() orders
+ * values in descending order, and cmp_mod() orders integers by their remainder
+ * modulo the integer passed through the input parameter. ordered() checks that
+ * no value of a list is less than the one before it.
+ */
+
+
+static enum ag_cmp cmp_desc(const ag_value *lhs, const ag_value *rhs, void *in)
+{
+        (void)in;
+
+        return ag_value_cmp(rhs, lhs);
+}
+
+
+static enum ag_cmp cmp_mod(const ag_value *lhs, const ag_value *rhs, void *in)
+{
+        ag_int mod = *(ag_int *)in;
+
+        return ag_int_cmp(ag_value_int(lhs) % mod, ag_value_int(rhs) % mod);
+}
+
+
+static bool ordered(const ag_list *list, ag_list_comparator *cmp, void *in)
+{
+        ag_list_cursor c;
+        const ag_value *v = NULL;
+
+        ag_list_cursor_init(&c, list);
+
+        while (ag_list_cursor_next(&c)) {
+                if (v && (cmp ? cmp(v, ag_list_cursor_get(&c), in)
+                    : ag_value_cmp(v, ag_list_cursor_get(&c))) == AG_CMP_GT)
+                        return false;
+
+                v = ag_list_cursor_get(&c);
+        }
+
+        return true;
+}
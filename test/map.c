@@ -0,0 +1,323 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./test.h"
+#include "./object.h"
+
+
+/*
+ * Define the ID of the test suite for the map interface. We need this ID for
+ * the testing macros to correctly generate the boilerplate testing code.
+ */
+
+
+#define __AG_TEST_SUITE_ID__ 15
+
+
+/*
+ * Declare the prototypes for generating sample maps. sample_empty() creates an
+ * empty map, sample_int() creates a map of 1,000 integers to ten times their
+ * value, and sample_int_2() creates the same map with one more entry.
+ */
+
+
+static ag_map   *sample_empty(void);
+static ag_map   *sample_int(void);
+static ag_map   *sample_int_2(void);
+
+
+/*
+ * Declare the prototype of the iterator function used to test ag_map_map().
+ */
+
+
+static bool     iterator(const ag_value *, const ag_value *, void *, void *);
+
+
+AG_METATEST_OBJECT_COPY(ag_map, sample_int());
+AG_METATEST_OBJECT_CLONE(ag_map, sample_int());
+AG_METATEST_OBJECT_RELEASE(ag_map, sample_int());
+AG_METATEST_OBJECT_CMP(ag_map, sample_int(), sample_int_2());
+AG_METATEST_OBJECT_EMPTY(ag_map, sample_empty());
+AG_METATEST_OBJECT_EMPTY_NOT(ag_map, sample_int());
+AG_METATEST_OBJECT_VALID(ag_map, sample_int());
+AG_METATEST_OBJECT_VALID_NOT(ag_map, sample_empty());
+AG_METATEST_OBJECT_TYPEID(ag_map, sample_int(), AG_TYPEID_MAP);
+AG_METATEST_OBJECT_LEN(ag_map, sample_empty(), 0);
+AG_METATEST_OBJECT_LEN(ag_map, sample_int(), 1000);
+
+
+AG_TEST_CASE("ag_map_get(): sample_int() => every value")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        register bool t = true;
+
+        for (register ag_int i = 0; i < 1000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_map_get(m, k);
+
+                t &= ag_map_has(m, k) && v && ag_value_int(v) == i * 10;
+        }
+
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_map_get(): missing key => NULL")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(1000);
+        AG_AUTO(ag_string) *s = ag_string_new("1");
+        AG_AUTO(ag_value) *k2 = ag_value_new_string(s);
+
+        AG_TEST (!ag_map_get(m, k) && !ag_map_has(m, k2));
+}
+
+
+AG_TEST_CASE("ag_map_set(): existing key => value replaced")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_map_set(&m, k, v);
+        AG_AUTO(ag_value) *v2 = ag_map_get(m, k);
+
+        AG_TEST (ag_map_len(m) == 1000 && ag_value_int(v2) == -1);
+}
+
+
+AG_TEST_CASE("ag_map_set(): copy of a map => original unaffected")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        AG_AUTO(ag_map) *m2 = ag_map_copy(m);
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+        AG_AUTO(ag_value) *k2 = ag_value_new_int(5000);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_map_set(&m2, k, v);
+        ag_map_set(&m2, k2, v);
+
+        AG_AUTO(ag_value) *v1 = ag_map_get(m, k);
+        AG_AUTO(ag_value) *v2 = ag_map_get(m2, k);
+
+        AG_TEST (ag_value_int(v1) == 420 && ag_value_int(v2) == -1
+            && !ag_map_has(m, k2) && ag_map_has(m2, k2)
+            && ag_map_len(m) == 1000 && ag_map_len(m2) == 1001);
+}
+
+
+AG_TEST_CASE("ag_map_set(): keys with colliding hashes => kept apart")
+{
+        AG_AUTO(ag_map) *m = ag_map_new();
+        AG_AUTO(ag_value) *k1 = ag_value_new_int(7);
+        AG_AUTO(ag_value) *k2 = ag_value_new_uint(7);
+        AG_AUTO(ag_value) *v1 = ag_value_new_int(1);
+        AG_AUTO(ag_value) *v2 = ag_value_new_int(2);
+
+        ag_map_set(&m, k1, v1);
+        ag_map_set(&m, k2, v2);
+
+        AG_AUTO(ag_value) *g1 = ag_map_get(m, k1);
+        AG_AUTO(ag_value) *g2 = ag_map_get(m, k2);
+        bool t = ag_map_len(m) == 2 && ag_value_int(g1) == 1
+            && ag_value_int(g2) == 2;
+
+        ag_map_remove(&m, k1);
+        AG_AUTO(ag_value) *g3 = ag_map_get(m, k2);
+
+        AG_TEST (t && ag_map_len(m) == 1 && !ag_map_has(m, k1)
+            && ag_value_int(g3) == 2);
+}
+
+
+AG_TEST_CASE("ag_map_remove(): sample_int() => only that key removed")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        register bool t = true;
+
+        for (register ag_int i = 0; i < 1000; i += 2) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                ag_map_remove(&m, k);
+        }
+
+        for (register ag_int i = 0; i < 1000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                t &= ag_map_has(m, k) == (i % 2);
+        }
+
+        AG_TEST (t && ag_map_len(m) == 500);
+}
+
+
+AG_TEST_CASE("ag_map_remove(): every key => empty map")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        AG_AUTO(ag_map) *m2 = sample_empty();
+
+        for (register ag_int i = 0; i < 1000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                ag_map_remove(&m, k);
+        }
+
+        AG_TEST (ag_map_empty(m) && ag_map_eq(m, m2) && !ag_map_hash(m));
+}
+
+
+AG_TEST_CASE("ag_map_remove(): copy of a map => original unaffected")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        AG_AUTO(ag_map) *m2 = ag_map_copy(m);
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+
+        ag_map_remove(&m2, k);
+
+        AG_TEST (ag_map_has(m, k) && !ag_map_has(m2, k)
+            && ag_map_len(m) == 1000 && ag_map_len(m2) == 999);
+}
+
+
+AG_TEST_CASE("ag_map_eq(): same entries in a different order => true")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        AG_AUTO(ag_map) *m2 = ag_map_new();
+
+        for (register ag_int i = 999; i >= 0; i--) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_value_new_int(i * 10);
+                ag_map_set(&m2, k, v);
+        }
+
+        AG_TEST (ag_map_eq(m, m2) && ag_map_hash(m) == ag_map_hash(m2));
+}
+
+
+AG_TEST_CASE("ag_map_map(): sample_int() => sum of values")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        ag_int sum = 0;
+
+        ag_map_map(m, iterator, NULL, &sum);
+        AG_TEST (sum == 4995000);
+}
+
+
+AG_TEST_CASE("ag_map_str(): string keys => entries in parentheses")
+{
+        AG_AUTO(ag_map) *m = ag_map_new();
+        AG_AUTO(ag_string) *ks = ag_string_new("foo");
+        AG_AUTO(ag_string) *vs = ag_string_new("bar");
+        AG_AUTO(ag_value) *k = ag_value_new_string(ks);
+        AG_AUTO(ag_value) *v = ag_value_new_string(vs);
+
+        ag_map_set(&m, k, v);
+        AG_AUTO(ag_string) *s = ag_map_str(m);
+
+        AG_TEST (ag_string_eq(s, "((foo:bar))"));
+}
+
+
+AG_TEST_CASE("ag_map_freeze(): frozen map => copies can still be modified")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_map_freeze(m);
+        ag_map *m2 = ag_map_copy(m);
+        ag_map_set(&m2, k, v);
+
+        AG_AUTO(ag_value) *v1 = ag_map_get(m, k);
+        AG_AUTO(ag_value) *v2 = ag_map_get(m2, k);
+        bool t = ag_value_int(v1) == 420 && ag_value_int(v2) == -1;
+
+        ag_map_release(&m2);
+        AG_TEST (t && ag_map_frozen(m) && ag_map_len(m) == 1000);
+}
+
+
+AG_TEST_CASE("ag_object_pack(): sample_int() => round trips")
+{
+        AG_AUTO(ag_map) *m = sample_int();
+        AG_AUTO(ag_value) *v = ag_value_new_object(m);
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_value_pack(v, pk);
+
+        struct ag_unpack rd;
+        ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+        AG_AUTO(ag_value) *v2 = ag_value_unpack(&rd);
+
+        AG_TEST (ag_unpack_done(&rd) && ag_map_eq(m, ag_value_object(v2)));
+}
+
+
+extern ag_test_suite *
+test_suite_map(void)
+{
+        return AG_TEST_SUITE_GENERATE("ag_map interface");
+}
+
+
+static ag_map *
+sample_empty(void)
+{
+        return ag_map_new();
+}
+
+
+static ag_map *
+sample_int(void)
+{
+        ag_map *m = ag_map_new();
+
+        for (register ag_int i = 0; i < 1000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_value_new_int(i * 10);
+                ag_map_set(&m, k, v);
+        }
+
+        return m;
+}
+
+
+static ag_map *
+sample_int_2(void)
+{
+        ag_map *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(1000);
+        AG_AUTO(ag_value) *v = ag_value_new_int(10000);
+
+        ag_map_set(&m, k, v);
+        return m;
+}
+
+
+static bool
+iterator(const ag_value *key, const ag_value *val, void *in, void *out)
+{
+        (void)key;
+        (void)in;
+        ag_int *sum = out;
+
+        *sum += ag_value_int(val);
+        return true;
+}
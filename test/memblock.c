@@ -23,6 +23,7 @@
 
 #include "./test.h"
 
+#include <pthread.h>
 #include <string.h>
 
 #define __AG_TEST_SUITE_ID__ 1
@@ -770,6 +771,120 @@ AG_TEST_CASE("ag_memblock_str() generates the string representation of a memory"
 }
 
 
+AG_TEST_CASE("ag_memblock_freeze() marks a memory block as frozen")
+{
+        int *i = ag_memblock_new(sizeof *i);
+        ag_memblock_freeze(i);
+
+        bool chk = ag_memblock_frozen(i);
+
+        AG_TEST (chk);
+}
+
+
+AG_TEST_CASE("ag_memblock_copy() does not change the reference count of a"
+    " frozen memory block")
+{
+        int *i = ag_memblock_new(sizeof *i);
+        ag_memblock_freeze(i);
+
+        int *j = ag_memblock_copy(i);
+        bool chk = j == i && ag_memblock_frozen(i);
+
+        AG_TEST (chk);
+}
+
+
+AG_TEST_CASE("ag_memblock_release() does not release a frozen memory block")
+{
+        int *i = ag_memblock_new(sizeof *i);
+        *i = 555;
+        ag_memblock_freeze(i);
+
+        int *j = i;
+        ag_memblock_release((ag_memblock **)&j);
+        bool chk = !j && *i == 555 && ag_memblock_frozen(i);
+
+        AG_TEST (chk);
+}
+
+
+AG_TEST_CASE("ag_memblock_release_last() keeps the last reference to a memory"
+    " block")
+{
+        int *i = ag_memblock_new(sizeof *i);
+        int *j = i;
+
+        bool chk = ag_memblock_release_last((ag_memblock **)&j) && j == i
+            && ag_memblock_refc(i) == 1;
+        ag_memblock_release((ag_memblock **)&j);
+
+        AG_TEST (chk && !j);
+}
+
+
+AG_TEST_CASE("ag_memblock_release_last() drops a shared reference to a memory"
+    " block")
+{
+        int *i = ag_memblock_new(sizeof *i);
+        int *j = ag_memblock_copy(i);
+
+        bool chk = !ag_memblock_release_last((ag_memblock **)&j) && !j
+            && ag_memblock_refc(i) == 1;
+        ag_memblock_release((ag_memblock **)&i);
+
+        AG_TEST (chk);
+}
+
+
+AG_TEST_CASE("ag_memblock_release_last() does not release a frozen memory"
+    " block")
+{
+        int *i = ag_memblock_new(sizeof *i);
+        ag_memblock_freeze(i);
+
+        int *j = i;
+        bool chk = !ag_memblock_release_last((ag_memblock **)&j) && !j
+            && ag_memblock_frozen(i);
+
+        AG_TEST (chk);
+}
+
+
+static void *
+release_last_race(void *ctx)
+{
+        ag_memblock *m = ctx;
+
+        return (void *)(uintptr_t)ag_memblock_release_last(&m);
+}
+
+
+AG_TEST_CASE("ag_memblock_release_last() reports the last reference to exactly"
+    " one of two threads releasing a memory block at once")
+{
+        bool chk = true;
+
+        for (register int n = 0; chk && n < 1000; n++) {
+                int *i = ag_memblock_new(sizeof *i);
+                int *j = ag_memblock_copy(i);
+                pthread_t thr[2];
+                void *res[2];
+
+                pthread_create(&thr[0], NULL, release_last_race, i);
+                pthread_create(&thr[1], NULL, release_last_race, j);
+                pthread_join(thr[0], &res[0]);
+                pthread_join(thr[1], &res[1]);
+
+                chk = (uintptr_t)res[0] + (uintptr_t)res[1] == 1
+                    && ag_memblock_refc(i) == 1;
+                ag_memblock_release((ag_memblock **)&i);
+        }
+
+        AG_TEST (chk);
+}
+
+
 extern ag_test_suite *test_suite_memblock(void)
 {
         return AG_TEST_SUITE_GENERATE("ag_memblock interface");
@@ -23,6 +23,8 @@
 #include "./test.h"
 #include "./object.h"
 
+#include <pthread.h>
+
 
 #define __AG_TEST_SUITE_ID__ 3
 
@@ -310,6 +312,22 @@ AG_TEST_CASE("ag_object_hash() executes its default callback if not overridden")
 }
 
 
+AG_TEST_CASE("ag_object_uuid_peek() gets the UUID returned by ag_object_uuid()")
+{
+        AG_AUTO(ag_object) *o = sample_base();
+        AG_AUTO(ag_uuid) *u = ag_object_uuid(o);
+        AG_AUTO(ag_string) *s = ag_uuid_str(u);
+        const ag_uuid *u2 = ag_object_uuid_peek(o);
+        char bfr[AG_UUID_STR_LEN];
+
+        ag_uuid_fmt(u2, bfr);
+        AG_AUTO(ag_uuid) *u3 = ag_uuid_parse(bfr);
+
+        AG_TEST (ag_uuid_eq(u, u2) && ag_uuid_eq(u, u3)
+            && ag_string_eq(s, bfr) && ag_uuid_hash(u) == ag_uuid_hash(u2));
+}
+
+
 AG_METATEST_OBJECT_STR_HAS(ag_object, sample_base(), "uuid");
 AG_METATEST_OBJECT_STR(ag_object, sample_derived(),
     "This is a sample derived object");
@@ -371,6 +389,98 @@ AG_TEST_CASE("ag_object_payload_mutable() reduces the refc of the original"
 }
 
 
+/*
+ * The racing threads below wait for each other before touching the shared
+ * object, so that the calls they race with overlap as often as possible.
+ */
+struct race {
+        ag_object       *obj;
+        unsigned        *ready;
+};
+
+
+static inline void
+race_start(unsigned *ready)
+{
+        __atomic_add_fetch(ready, 1, __ATOMIC_ACQ_REL);
+
+        while (__atomic_load_n(ready, __ATOMIC_ACQUIRE) < 2)
+                ;
+}
+
+
+static void *
+payload_mutable_race(void *ctx)
+{
+        struct race *r = ctx;
+
+        race_start(r->ready);
+
+        struct payload_derived *p = ag_object_payload_mutable(&r->obj);
+        bool chk = *p->x == 555 && *p->y == -666;
+
+        ag_object_release(&r->obj);
+        return (void *)(uintptr_t)chk;
+}
+
+
+static void *
+release_race(void *ctx)
+{
+        struct race *r = ctx;
+
+        race_start(r->ready);
+        ag_object_release(&r->obj);
+
+        return (void *)(uintptr_t)true;
+}
+
+
+AG_TEST_CASE("ag_object_payload_mutable() is safe while another thread releases"
+    " the shared object")
+{
+        bool chk = true;
+
+        for (register int n = 0; chk && n < 1000; n++) {
+                unsigned ready = 0;
+                ag_object *o = sample_derived();
+                struct race r[2] = {{.obj = o, .ready = &ready},
+                    {.obj = ag_object_copy(o), .ready = &ready}};
+                pthread_t thr[2];
+                void *res[2];
+
+                pthread_create(&thr[0], NULL, payload_mutable_race, &r[0]);
+                pthread_create(&thr[1], NULL, release_race, &r[1]);
+                pthread_join(thr[0], &res[0]);
+                pthread_join(thr[1], &res[1]);
+
+                chk = res[0] && res[1];
+        }
+
+        AG_TEST (chk);
+}
+
+
+AG_TEST_CASE("ag_object_registry_get() gets the v-table of a statically"
+    " registered object type")
+{
+        const struct ag_object_vtable *v;
+
+        AG_TEST ((v = ag_object_registry_get(AG_TYPEID_LIST)) && v->pack);
+}
+
+
+AG_TEST_CASE("AG_OBJECT_REGISTER() keeps the v-table of a statically"
+    " registered object type")
+{
+        const struct ag_object_vtable *v = ag_object_registry_get(
+            AG_TYPEID_ALIST);
+        AG_OBJECT_REGISTER(ag_alist);
+
+        AG_TEST (ag_object_registry_get(AG_TYPEID_ALIST) == v);
+}
+
+
 extern ag_test_suite *test_suite_object(void)
 {
         register_base();
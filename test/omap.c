@@ -0,0 +1,446 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./test.h"
+#include "./object.h"
+
+
+/*
+ * Define the ID of the test suite for the ordered map interface. We need this
+ * ID for the testing macros to correctly generate the boilerplate testing code.
+ */
+
+
+#define __AG_TEST_SUITE_ID__ 16
+
+
+/*
+ * Declare the prototypes for generating sample ordered maps. sample_empty()
+ * creates an empty ordered map, sample_int() creates an ordered map of 1,000
+ * integers to ten times their value, inserted in a scrambled order, and
+ * sample_int_2() creates the same ordered map with one more entry.
+ * sample_list() creates a list of fields holding the same entries as
+ * sample_int(), in ascending order of keys.
+ */
+
+
+static ag_omap  *sample_empty(void);
+static ag_omap  *sample_int(void);
+static ag_omap  *sample_int_2(void);
+static ag_list  *sample_list(ag_int);
+
+
+/*
+ * Declare the prototypes of the iterator functions used to test ag_omap_map()
+ * and ag_omap_range(). iterator() sums up the values it visits, and
+ * iterator_ordered() checks that the keys it visits are ascending, stopping
+ * once it has visited 10 keys.
+ */
+
+
+static bool     iterator(const ag_value *, const ag_value *, void *, void *);
+static bool     iterator_ordered(const ag_value *, const ag_value *, void *,
+                    void *);
+
+
+AG_METATEST_OBJECT_COPY(ag_omap, sample_int());
+AG_METATEST_OBJECT_CLONE(ag_omap, sample_int());
+AG_METATEST_OBJECT_RELEASE(ag_omap, sample_int());
+AG_METATEST_OBJECT_CMP(ag_omap, sample_int(), sample_int_2());
+AG_METATEST_OBJECT_EMPTY(ag_omap, sample_empty());
+AG_METATEST_OBJECT_EMPTY_NOT(ag_omap, sample_int());
+AG_METATEST_OBJECT_VALID(ag_omap, sample_int());
+AG_METATEST_OBJECT_VALID_NOT(ag_omap, sample_empty());
+AG_METATEST_OBJECT_TYPEID(ag_omap, sample_int(), AG_TYPEID_OMAP);
+AG_METATEST_OBJECT_LEN(ag_omap, sample_empty(), 0);
+AG_METATEST_OBJECT_LEN(ag_omap, sample_int(), 1000);
+AG_METATEST_OBJECT_JSON_HAS(ag_omap, sample_int(), "{\"0\":0,\"1\":10,");
+
+
+AG_TEST_CASE("ag_omap_get(): sample_int() => every value")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        register bool t = true;
+
+        for (register ag_int i = 0; i < 1000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_omap_get(m, k);
+
+                t &= ag_omap_has(m, k) && v && ag_value_int(v) == i * 10;
+        }
+
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_omap_get(): missing key => NULL")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(1000);
+        AG_AUTO(ag_value) *k2 = ag_value_new_uint(1);
+
+        AG_TEST (!ag_omap_get(m, k) && !ag_omap_has(m, k2));
+}
+
+
+AG_TEST_CASE("ag_omap_set(): existing key => value replaced")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_omap_set(&m, k, v);
+        AG_AUTO(ag_value) *v2 = ag_omap_get(m, k);
+
+        AG_TEST (ag_omap_len(m) == 1000 && ag_value_int(v2) == -1);
+}
+
+
+AG_TEST_CASE("ag_omap_set(): copy of an ordered map => original unaffected")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_omap) *m2 = ag_omap_copy(m);
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+        AG_AUTO(ag_value) *k2 = ag_value_new_int(5000);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_omap_set(&m2, k, v);
+        ag_omap_set(&m2, k2, v);
+
+        AG_AUTO(ag_value) *v1 = ag_omap_get(m, k);
+        AG_AUTO(ag_value) *v2 = ag_omap_get(m2, k);
+
+        AG_TEST (ag_value_int(v1) == 420 && ag_value_int(v2) == -1
+            && !ag_omap_has(m, k2) && ag_omap_has(m2, k2)
+            && ag_omap_len(m) == 1000 && ag_omap_len(m2) == 1001);
+}
+
+
+AG_TEST_CASE("ag_omap_remove(): sample_int() => only that key removed")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        register bool t = true;
+
+        for (register ag_int i = 0; i < 1000; i += 2) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                ag_omap_remove(&m, k);
+        }
+
+        for (register ag_int i = 0; i < 1000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_omap_get(m, k);
+
+                t &= (i % 2) ? v && ag_value_int(v) == i * 10 : !v;
+        }
+
+        AG_TEST (t && ag_omap_len(m) == 500);
+}
+
+
+AG_TEST_CASE("ag_omap_remove(): every key => empty ordered map")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_omap) *m2 = sample_empty();
+
+        for (register ag_int i = 0; i < 1000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int((i * 7919) % 1000);
+                ag_omap_remove(&m, k);
+        }
+
+        AG_TEST (ag_omap_empty(m) && ag_omap_eq(m, m2) && !ag_omap_hash(m)
+            && !ag_omap_sz(m));
+}
+
+
+AG_TEST_CASE("ag_omap_remove(): copy of an ordered map => original unaffected")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_omap) *m2 = ag_omap_copy(m);
+
+        for (register ag_int i = 0; i < 1000; i += 3) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                ag_omap_remove(&m2, k);
+        }
+
+        AG_AUTO(ag_omap) *m3 = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+
+        AG_TEST (ag_omap_eq(m, m3) && ag_omap_has(m, k) && !ag_omap_has(m2, k)
+            && ag_omap_len(m2) == 666);
+}
+
+
+AG_TEST_CASE("ag_omap_lower(): sample_int() with gaps => next key up")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+        AG_AUTO(ag_value) *k2 = ag_value_new_int(43);
+        AG_AUTO(ag_value) *k3 = ag_value_new_int(2000);
+
+        ag_omap_remove(&m, k);
+        AG_AUTO(ag_field) *f = ag_omap_lower(m, k);
+        AG_AUTO(ag_field) *f2 = ag_omap_lower(m, k2);
+        AG_AUTO(ag_value) *v = ag_field_key(f);
+        AG_AUTO(ag_value) *v2 = ag_field_val(f2);
+
+        AG_TEST (ag_value_int(v) == 43 && ag_value_int(v2) == 430
+            && !ag_omap_lower(m, k3));
+}
+
+
+AG_TEST_CASE("ag_omap_upper(): sample_int() => strictly greater key")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+        AG_AUTO(ag_value) *k2 = ag_value_new_int(-5);
+        AG_AUTO(ag_value) *k3 = ag_value_new_int(999);
+
+        AG_AUTO(ag_field) *f = ag_omap_upper(m, k);
+        AG_AUTO(ag_field) *f2 = ag_omap_upper(m, k2);
+        AG_AUTO(ag_value) *v = ag_field_key(f);
+        AG_AUTO(ag_value) *v2 = ag_field_key(f2);
+
+        AG_TEST (ag_value_int(v) == 43 && !ag_value_int(v2)
+            && !ag_omap_upper(m, k3));
+}
+
+
+AG_TEST_CASE("ag_omap_map(): sample_int() => values in ascending order")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        ag_int sum = 0;
+        ag_int last[2] = {-1, 0};
+
+        ag_omap_map(m, iterator, NULL, &sum);
+        ag_omap_map(m, iterator_ordered, NULL, last);
+
+        AG_TEST (sum == 4995000 && last[0] == 9 && last[1] == 10);
+}
+
+
+AG_TEST_CASE("ag_omap_range(): [100, 200) => only keys in range")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_value) *lo = ag_value_new_int(100);
+        AG_AUTO(ag_value) *hi = ag_value_new_int(200);
+        ag_int sum = 0, sum2 = 0, sum3 = 0;
+
+        ag_omap_range(m, lo, hi, iterator, NULL, &sum);
+        ag_omap_range(m, NULL, lo, iterator, NULL, &sum2);
+        ag_omap_range(m, hi, lo, iterator, NULL, &sum3);
+
+        AG_TEST (sum == 149500 && sum2 == 49500 && !sum3);
+}
+
+
+AG_TEST_CASE("ag_omap_range(): iterator returns false => stops early")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_value) *lo = ag_value_new_int(500);
+        ag_int last[2] = {499, 0};
+
+        ag_omap_range(m, lo, NULL, iterator_ordered, NULL, last);
+        AG_TEST (last[0] == 509 && last[1] == 10);
+}
+
+
+AG_TEST_CASE("ag_omap_new_list(): sorted fields => same as inserting them")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        register bool t = true;
+
+        for (register ag_int n = 0; n <= 1000; n += 37) {
+                AG_AUTO(ag_list) *l = sample_list(n);
+                AG_AUTO(ag_omap) *m2 = ag_omap_new_list(l);
+                AG_AUTO(ag_omap) *m3 = ag_omap_new();
+
+                for (register ag_int i = 0; i < n; i++) {
+                        AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                        AG_AUTO(ag_value) *v = ag_value_new_int(i * 10);
+                        ag_omap_set(&m3, k, v);
+                }
+
+                t &= ag_omap_eq(m2, m3) && ag_omap_hash(m2) == ag_omap_hash(m3)
+                    && ag_omap_sz(m2) == ag_omap_sz(m3);
+        }
+
+        AG_AUTO(ag_list) *l = sample_list(1000);
+        AG_AUTO(ag_omap) *m4 = ag_omap_new_list(l);
+
+        for (register ag_int i = 0; i < 1000; i += 2) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                ag_omap_remove(&m4, k);
+        }
+
+        AG_TEST (t && ag_omap_len(m4) == 500);
+}
+
+
+AG_TEST_CASE("ag_omap_str(): string keys => entries in ascending order")
+{
+        AG_AUTO(ag_omap) *m = ag_omap_new();
+        AG_AUTO(ag_string) *ks = ag_string_new("foo");
+        AG_AUTO(ag_string) *ks2 = ag_string_new("bar");
+        AG_AUTO(ag_value) *k = ag_value_new_string(ks);
+        AG_AUTO(ag_value) *k2 = ag_value_new_string(ks2);
+        AG_AUTO(ag_value) *v = ag_value_new_int(1);
+
+        ag_omap_set(&m, k, v);
+        ag_omap_set(&m, k2, v);
+        AG_AUTO(ag_string) *s = ag_omap_str(m);
+
+        AG_TEST (ag_string_eq(s, "((bar:1) (foo:1))"));
+}
+
+
+AG_TEST_CASE("ag_omap_json(): string values => escaped JSON object")
+{
+        AG_AUTO(ag_omap) *m = ag_omap_new();
+        AG_AUTO(ag_string) *ks = ag_string_new("a\"b");
+        AG_AUTO(ag_string) *vs = ag_string_new("c\\d");
+        AG_AUTO(ag_value) *k = ag_value_new_string(ks);
+        AG_AUTO(ag_value) *v = ag_value_new_string(vs);
+
+        ag_omap_set(&m, k, v);
+        AG_AUTO(ag_string) *j = ag_omap_json(m);
+
+        AG_TEST (ag_string_eq(j, "{\"a\\\"b\":\"c\\\\d\"}"));
+}
+
+
+AG_TEST_CASE("ag_omap_freeze(): frozen map => copies can still be modified")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(42);
+        AG_AUTO(ag_value) *v = ag_value_new_int(-1);
+
+        ag_omap_freeze(m);
+        ag_omap *m2 = ag_omap_copy(m);
+        ag_omap_set(&m2, k, v);
+        ag_omap_remove(&m2, k);
+
+        bool t = ag_omap_has(m, k) && !ag_omap_has(m2, k);
+
+        ag_omap_release(&m2);
+        AG_TEST (t && ag_omap_frozen(m) && ag_omap_len(m) == 1000);
+}
+
+
+AG_TEST_CASE("ag_object_pack(): sample_int() => round trips")
+{
+        AG_AUTO(ag_omap) *m = sample_int();
+        AG_AUTO(ag_value) *v = ag_value_new_object(m);
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_value_pack(v, pk);
+
+        struct ag_unpack rd;
+        ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+        AG_AUTO(ag_value) *v2 = ag_value_unpack(&rd);
+
+        AG_TEST (ag_unpack_done(&rd) && ag_omap_eq(m, ag_value_object(v2)));
+}
+
+
+extern ag_test_suite *
+test_suite_omap(void)
+{
+        return AG_TEST_SUITE_GENERATE("ag_omap interface");
+}
+
+
+static ag_omap *
+sample_empty(void)
+{
+        return ag_omap_new();
+}
+
+
+static ag_omap *
+sample_int(void)
+{
+        ag_omap *m = ag_omap_new();
+
+        for (register ag_int i = 0; i < 1000; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int((i * 7) % 1000);
+                AG_AUTO(ag_value) *v = ag_value_new_int(((i * 7) % 1000) * 10);
+                ag_omap_set(&m, k, v);
+        }
+
+        return m;
+}
+
+
+static ag_omap *
+sample_int_2(void)
+{
+        ag_omap *m = sample_int();
+        AG_AUTO(ag_value) *k = ag_value_new_int(1000);
+        AG_AUTO(ag_value) *v = ag_value_new_int(10000);
+
+        ag_omap_set(&m, k, v);
+        return m;
+}
+
+
+static ag_list *
+sample_list(ag_int len)
+{
+        ag_list *l = ag_list_new();
+
+        for (register ag_int i = 0; i < len; i++) {
+                AG_AUTO(ag_value) *k = ag_value_new_int(i);
+                AG_AUTO(ag_value) *v = ag_value_new_int(i * 10);
+                AG_AUTO(ag_field) *f = ag_field_new(k, v);
+                AG_AUTO(ag_value) *e = ag_value_new_object(f);
+
+                ag_list_push(&l, e);
+        }
+
+        return l;
+}
+
+
+static bool
+iterator(const ag_value *key, const ag_value *val, void *in, void *out)
+{
+        (void)key;
+        (void)in;
+        ag_int *sum = out;
+
+        *sum += ag_value_int(val);
+        return true;
+}
+
+
+static bool
+iterator_ordered(const ag_value *key, const ag_value *val, void *in, void *out)
+{
+        (void)val;
+        (void)in;
+        ag_int *last = out;
+
+        if (ag_value_int(key) != last[0] + 1)
+                return false;
+
+        last[0] = ag_value_int(key);
+        return ++last[1] < 10;
+}
@@ -0,0 +1,283 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+
+#include "./test.h"
+
+#include <string.h>
+
+
+/*
+ * Define the ID of the test suite for the binary encoding interface. We need
+ * this ID for the testing macros to correctly generate the boilerplate testing
+ * code.
+ */
+
+
+#define __AG_TEST_SUITE_ID__ 14
+
+
+/*
+ * Declare the prototypes for the helper functions. roundtrip() packs a value
+ * and unpacks it again, checking that the entire buffer has been consumed, and
+ * sample_list() and sample_alist() create sample containers of mixed values.
+ */
+
+
+static ag_value *roundtrip(const ag_value *);
+static ag_list  *sample_list(void);
+static ag_alist *sample_alist(void);
+
+
+AG_TEST_CASE("ag_value_pack() round trips small and large signed integers")
+{
+        const ag_int ints[] = {0, 1, -1, 127, -32, -33, 128, -128, 32767,
+            -32768, 65536, -2147483647, (ag_int)1 << 40, AG_INT_MAX >> 3,
+            -(AG_INT_MAX >> 3)};
+        bool ok = true;
+
+        for (size_t i = 0; i < sizeof ints / sizeof *ints; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(ints[i]);
+                AG_AUTO(ag_value) *v2 = roundtrip(v);
+
+                ok &= ag_value_type_int(v2) && ag_value_int(v2) == ints[i];
+        }
+
+        AG_TEST (ok);
+}
+
+
+AG_TEST_CASE("ag_value_pack() round trips unsigned integers as unsigned")
+{
+        const ag_uint uints[] = {0, 1, 255, 256, 65535, 65536, 4294967296,
+            AG_UINT_MAX >> 1};
+        bool ok = true;
+
+        for (size_t i = 0; i < sizeof uints / sizeof *uints; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_uint(uints[i]);
+                AG_AUTO(ag_value) *v2 = roundtrip(v);
+
+                ok &= ag_value_type_uint(v2) && ag_value_uint(v2) == uints[i];
+        }
+
+        AG_TEST (ok);
+}
+
+
+AG_TEST_CASE("ag_value_pack() round trips floating point values exactly")
+{
+        AG_AUTO(ag_value) *v = ag_value_new_float(-3.141592653589793);
+        AG_AUTO(ag_value) *v2 = roundtrip(v);
+
+        AG_TEST (ag_value_type_float(v2)
+            && ag_value_float(v2) == -3.141592653589793);
+}
+
+
+AG_TEST_CASE("ag_value_pack() round trips short and long strings")
+{
+        AG_AUTO(ag_string) *s = ag_string_new("Hello, world!");
+        AG_AUTO(ag_value) *v = ag_value_new_string(s);
+        AG_AUTO(ag_value) *v2 = roundtrip(v);
+
+        char bfr[70000];
+        memset(bfr, 'x', sizeof bfr - 1);
+        bfr[sizeof bfr - 1] = '\0';
+
+        AG_AUTO(ag_string) *s3 = ag_string_new(bfr);
+        AG_AUTO(ag_value) *v3 = ag_value_new_string(s3);
+        AG_AUTO(ag_value) *v4 = roundtrip(v3);
+
+        AG_TEST (ag_value_eq(v, v2) && ag_value_eq(v3, v4));
+}
+
+
+AG_TEST_CASE("ag_unpack_str() returns a slice of the input buffer")
+{
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_pack_string(pk, "zero-copy");
+
+        struct ag_unpack rd;
+        size_t len;
+        ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+        const char *s = ag_unpack_str(&rd, &len);
+
+        AG_TEST (s == ag_pack_bfr(pk) + 1 && len == 9
+            && !strncmp(s, "zero-copy", len) && ag_unpack_done(&rd));
+}
+
+
+AG_TEST_CASE("ag_pack_int() uses the smallest encoding for small integers")
+{
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_pack_int(pk, 5);
+        ag_pack_int(pk, -5);
+        ag_pack_int(pk, 1000);
+
+        AG_TEST (ag_pack_len(pk) == 1 + 1 + 3);
+}
+
+
+AG_TEST_CASE("ag_object_pack() uses a compact envelope for small objects")
+{
+        AG_AUTO(ag_list) *l = ag_list_new();
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_object_pack(l, pk);
+
+        AG_TEST (ag_pack_len(pk) == 4);
+}
+
+
+AG_TEST_CASE("ag_object_pack() round trips a list of mixed values")
+{
+        AG_AUTO(ag_list) *l = sample_list();
+        AG_AUTO(ag_value) *v = ag_value_new_object(l);
+        AG_AUTO(ag_value) *v2 = roundtrip(v);
+        const ag_object *o = ag_value_object(v2);
+
+        AG_TEST (ag_object_typeid(o) == AG_TYPEID_LIST && ag_list_eq(l, o)
+            && ag_list_len(o) == ag_list_len(l));
+}
+
+
+AG_TEST_CASE("ag_object_pack() round trips nested lists")
+{
+        AG_AUTO(ag_list) *l = sample_list();
+        AG_AUTO(ag_value) *v = ag_value_new_object(l);
+        AG_AUTO(ag_list) *l2 = sample_list();
+        ag_list_push(&l2, v);
+
+        AG_AUTO(ag_value) *v2 = ag_value_new_object(l2);
+        AG_AUTO(ag_value) *v3 = roundtrip(v2);
+        AG_AUTO(ag_value) *v4 = ag_list_get_at(ag_value_object(v3), 5);
+
+        AG_TEST (ag_list_eq(l2, ag_value_object(v3))
+            && ag_list_eq(l, ag_value_object(v4)));
+}
+
+
+AG_TEST_CASE("ag_object_pack() round trips an association list")
+{
+        AG_AUTO(ag_alist) *a = sample_alist();
+        AG_AUTO(ag_value) *v = ag_value_new_object(a);
+        AG_AUTO(ag_value) *v2 = roundtrip(v);
+        const ag_object *o = ag_value_object(v2);
+
+        AG_AUTO(ag_string) *s = ag_string_new("answer");
+        AG_AUTO(ag_value) *k = ag_value_new_string(s);
+        AG_AUTO(ag_value) *val = ag_alist_val(o, k);
+
+        AG_TEST (ag_object_typeid(o) == AG_TYPEID_ALIST && ag_alist_eq(a, o)
+            && ag_value_type_float(val));
+}
+
+
+AG_TEST_CASE("ag_object_pack() round trips an HTTP URL")
+{
+        AG_AUTO(ag_http_url) *u = ag_http_url_new(true, "example.com", 8080,
+            "/foo/bar");
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_object_pack(u, pk);
+
+        struct ag_unpack rd;
+        ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+        AG_AUTO(ag_http_url) *u2 = ag_object_unpack(&rd);
+
+        AG_TEST (ag_http_url_eq(u, u2) && ag_unpack_done(&rd));
+}
+
+
+AG_TEST_CASE("ag_unpack_skip() skips over nested items")
+{
+        AG_AUTO(ag_alist) *a = sample_alist();
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_object_pack(a, pk);
+        ag_pack_int(pk, -77);
+
+        struct ag_unpack rd;
+        ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+        ag_unpack_skip(&rd);
+
+        AG_TEST (ag_unpack_int(&rd) == -77 && ag_unpack_done(&rd));
+}
+
+
+extern ag_test_suite *
+test_suite_pack(void)
+{
+        return AG_TEST_SUITE_GENERATE("ag_pack interface");
+}
+
+
+static ag_value *
+roundtrip(const ag_value *val)
+{
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_value_pack(val, pk);
+
+        struct ag_unpack rd;
+        ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+        ag_value *v = ag_value_unpack(&rd);
+
+        AG_ASSERT (ag_unpack_done(&rd));
+        return v;
+}
+
+
+static ag_list *
+sample_list(void)
+{
+        AG_AUTO(ag_value) *v1 = ag_value_new_int(-123);
+        AG_AUTO(ag_value) *v2 = ag_value_new_uint(456);
+        AG_AUTO(ag_value) *v3 = ag_value_new_float(7.89);
+        AG_AUTO(ag_string) *s = ag_string_new("foo bar");
+        AG_AUTO(ag_value) *v4 = ag_value_new_string(s);
+
+        ag_list *l = ag_list_new();
+        ag_list_push(&l, v1);
+        ag_list_push(&l, v2);
+        ag_list_push(&l, v3);
+        ag_list_push(&l, v4);
+
+        return l;
+}
+
+
+static ag_alist *
+sample_alist(void)
+{
+        AG_AUTO(ag_string) *s = ag_string_new("key");
+        AG_AUTO(ag_value) *k1 = ag_value_new_string(s);
+        AG_AUTO(ag_value) *v1 = ag_value_new_int(-1);
+        AG_AUTO(ag_field) *f1 = ag_field_new(k1, v1);
+
+        AG_AUTO(ag_string) *s2 = ag_string_new("answer");
+        AG_AUTO(ag_value) *k2 = ag_value_new_string(s2);
+        AG_AUTO(ag_value) *v2 = ag_value_new_float(0.5);
+        AG_AUTO(ag_field) *f2 = ag_field_new(k2, v2);
+
+        AG_AUTO(ag_alist) *a = ag_alist_new(f1);
+        ag_alist_push(&a, f2);
+
+        return ag_alist_copy(a);
+}
+
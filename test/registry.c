@@ -0,0 +1,384 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./test.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+
+/*
+ * Define the ID of the test suite for the registry interface. We need this ID
+ * for the testing macros to correctly generate the boilerplate testing code.
+ */
+
+
+#define __AG_TEST_SUITE_ID__ 19
+
+
+/*
+ * Declare the prototypes for the helper functions used by the test cases.
+ * sample_new() creates a registry holding heap allocated copies of the
+ * integers 1 through a given count, keyed by their hashes, and entry_new()
+ * allocates a copy of an integer. entry_dispose() is the release callback of
+ * the sample registries, and counts the number of entries it has disposed.
+ */
+
+
+static ag_registry      *sample_new(size_t);
+static size_t           *entry_new(size_t);
+static void              entry_dispose(void *);
+static size_t            g_disposed = 0;
+
+
+/*
+ * Declare the helpers for the concurrent registry test cases. The entries of a
+ * concurrent registry are reference counted, with shared_copy() taking a new
+ * reference and shared_dispose() dropping one. shared_reader() is the body of
+ * the threads that look up entries while another thread replaces them.
+ */
+
+
+struct shared {
+        size_t  refc;
+        size_t  val;
+};
+
+static struct shared    *shared_new(size_t);
+static void             *shared_copy(const void *);
+static void              shared_dispose(void *);
+static void             *shared_reader(void *);
+static size_t            g_shared = 0;
+
+
+AG_TEST_CASE("ag_registry_get(): empty registry => NULL")
+{
+        ag_registry *r = sample_new(0);
+        register bool t = !ag_registry_get(r, ag_hash_new(1))
+            && !ag_registry_len(r);
+
+        ag_registry_release(&r);
+        AG_TEST (t && !r);
+}
+
+
+AG_TEST_CASE("ag_registry_get(): 5000 entries => all entries found")
+{
+        ag_registry *r = sample_new(5000);
+        register bool t = ag_registry_len(r) == 5000;
+
+        for (register size_t i = 1; t && i <= 5000; i++) {
+                size_t *e = ag_registry_get(r, ag_hash_new(i));
+                t &= e && *e == i;
+        }
+
+        t &= !ag_registry_get(r, ag_hash_new(5001));
+
+        ag_registry_release(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_registry_get(): string keys => all entries found")
+{
+        ag_registry *r = ag_registry_new(entry_dispose);
+        char key[32];
+        register bool t = true;
+
+        for (register size_t i = 1; i <= 1000; i++) {
+                snprintf(key, sizeof key, "/api/v1/route/%zu", i);
+                ag_registry_push(r, ag_hash_new_str(key), entry_new(i));
+        }
+
+        for (register size_t i = 1; t && i <= 1000; i++) {
+                snprintf(key, sizeof key, "/api/v1/route/%zu", i);
+                size_t *e = ag_registry_get(r, ag_hash_new_str(key));
+                t &= e && *e == i;
+        }
+
+        ag_registry_release(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_registry_push(): existing key => entry replaced")
+{
+        ag_registry *r = sample_new(100);
+        size_t d = g_disposed;
+
+        ag_registry_push(r, ag_hash_new(50), entry_new(500));
+        size_t *e = ag_registry_get(r, ag_hash_new(50));
+        register bool t = *e == 500 && ag_registry_len(r) == 100
+            && g_disposed == d + 1;
+
+        ag_registry_release(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_registry_remove(): existing keys => entries removed")
+{
+        ag_registry *r = sample_new(3000);
+        size_t d = g_disposed;
+        register bool t = true;
+
+        for (register size_t i = 1; i <= 3000; i += 2)
+                ag_registry_remove(r, ag_hash_new(i));
+
+        t &= ag_registry_len(r) == 1500 && g_disposed == d + 1500;
+
+        for (register size_t i = 1; t && i <= 3000; i++) {
+                size_t *e = ag_registry_get(r, ag_hash_new(i));
+                t &= i % 2 ? !e : e && *e == i;
+        }
+
+        ag_registry_release(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_registry_remove(): missing key => no change")
+{
+        ag_registry *r = sample_new(10);
+        size_t d = g_disposed;
+
+        ag_registry_remove(r, ag_hash_new(11));
+        register bool t = ag_registry_len(r) == 10 && g_disposed == d;
+
+        ag_registry_release(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_registry_reserve(): entries kept across reserve")
+{
+        ag_registry *r = sample_new(100);
+        register bool t = true;
+
+        ag_registry_reserve(r, 10000);
+
+        for (register size_t i = 101; i <= 10000; i++)
+                ag_registry_push(r, ag_hash_new(i), entry_new(i));
+
+        for (register size_t i = 1; t && i <= 10000; i++) {
+                size_t *e = ag_registry_get(r, ag_hash_new(i));
+                t &= e && *e == i;
+        }
+
+        t &= ag_registry_len(r) == 10000;
+
+        ag_registry_release(&r);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_registry_release(): all entries disposed")
+{
+        ag_registry *r = sample_new(777);
+        size_t d = g_disposed;
+
+        ag_registry_release(&r);
+        AG_TEST (g_disposed == d + 777);
+}
+
+
+AG_TEST_CASE("ag_cregistry_get(): pushed entries => copies found")
+{
+        ag_cregistry *r = ag_cregistry_new(shared_copy, shared_dispose);
+        register bool t = true;
+
+        for (register size_t i = 1; i <= 1000; i++)
+                ag_cregistry_push(r, ag_hash_new(i), shared_new(i));
+
+        for (register size_t i = 1; t && i <= 1000; i++) {
+                struct shared *e = ag_cregistry_get(r, ag_hash_new(i));
+                t &= e && e->val == i && e->refc == 2;
+                shared_dispose(e);
+        }
+
+        t &= ag_cregistry_len(r) == 1000
+            && !ag_cregistry_get(r, ag_hash_new(1001));
+
+        ag_cregistry_release(&r);
+        AG_TEST (t && !r && !g_shared);
+}
+
+
+AG_TEST_CASE("ag_cregistry_push(): existing key => entry replaced")
+{
+        ag_cregistry *r = ag_cregistry_new(shared_copy, shared_dispose);
+
+        ag_cregistry_push(r, ag_hash_new(1), shared_new(1));
+        struct shared *e = ag_cregistry_get(r, ag_hash_new(1));
+
+        ag_cregistry_push(r, ag_hash_new(1), shared_new(2));
+        struct shared *e2 = ag_cregistry_get(r, ag_hash_new(1));
+
+        register bool t = e->val == 1 && e->refc == 1 && e2->val == 2
+            && ag_cregistry_len(r) == 1;
+
+        shared_dispose(e);
+        shared_dispose(e2);
+        ag_cregistry_release(&r);
+        AG_TEST (t && !g_shared);
+}
+
+
+AG_TEST_CASE("ag_cregistry_remove(): existing key => entry removed")
+{
+        ag_cregistry *r = ag_cregistry_new(shared_copy, shared_dispose);
+
+        ag_cregistry_push(r, ag_hash_new(1), shared_new(1));
+        ag_cregistry_push(r, ag_hash_new(2), shared_new(2));
+        ag_cregistry_remove(r, ag_hash_new(1));
+        ag_cregistry_remove(r, ag_hash_new(3));
+
+        struct shared *e = ag_cregistry_get(r, ag_hash_new(2));
+        register bool t = !ag_cregistry_get(r, ag_hash_new(1))
+            && e && e->val == 2 && ag_cregistry_len(r) == 1;
+
+        shared_dispose(e);
+        ag_cregistry_release(&r);
+        AG_TEST (t && !g_shared);
+}
+
+
+AG_TEST_CASE("ag_cregistry_get(): concurrent writes => consistent reads")
+{
+        ag_cregistry *r = ag_cregistry_new(shared_copy, shared_dispose);
+        pthread_t thr[4];
+
+        for (register size_t i = 1; i <= 64; i++)
+                ag_cregistry_push(r, ag_hash_new(i), shared_new(i));
+
+        for (register size_t i = 0; i < 4; i++)
+                pthread_create(&thr[i], NULL, shared_reader, r);
+
+        for (register size_t i = 0; i < 2000; i++) {
+                ag_cregistry_push(r, ag_hash_new(i % 64 + 1),
+                    shared_new(i % 64 + 1));
+                ag_cregistry_push(r, ag_hash_new(1000 + i), shared_new(0));
+                ag_cregistry_remove(r, ag_hash_new(1000 + i));
+        }
+
+        register bool t = true;
+        for (register size_t i = 0; i < 4; i++) {
+                void *res;
+                pthread_join(thr[i], &res);
+                t &= res == r;
+        }
+
+        ag_cregistry_release(&r);
+        AG_TEST (t && !g_shared);
+}
+
+
+extern ag_test_suite *
+test_suite_registry(void)
+{
+        return AG_TEST_SUITE_GENERATE("ag_registry interface");
+}
+
+
+static ag_registry *
+sample_new(size_t len)
+{
+        ag_registry *r = ag_registry_new(entry_dispose);
+
+        for (register size_t i = 1; i <= len; i++)
+                ag_registry_push(r, ag_hash_new(i), entry_new(i));
+
+        return r;
+}
+
+
+static size_t *
+entry_new(size_t val)
+{
+        size_t *e = malloc(sizeof *e);
+        *e = val;
+
+        return e;
+}
+
+
+static void
+entry_dispose(void *data)
+{
+        free(data);
+        g_disposed++;
+}
+
+
+static struct shared *
+shared_new(size_t val)
+{
+        struct shared *e = malloc(sizeof *e);
+        e->refc = 1;
+        e->val = val;
+
+        __atomic_add_fetch(&g_shared, 1, __ATOMIC_RELAXED);
+        return e;
+}
+
+
+static void *
+shared_copy(const void *data)
+{
+        struct shared *e = (struct shared *)data;
+        __atomic_add_fetch(&e->refc, 1, __ATOMIC_RELAXED);
+
+        return e;
+}
+
+
+static void
+shared_dispose(void *data)
+{
+        struct shared *e = data;
+
+        if (!__atomic_sub_fetch(&e->refc, 1, __ATOMIC_ACQ_REL)) {
+                free(e);
+                __atomic_sub_fetch(&g_shared, 1, __ATOMIC_RELAXED);
+        }
+}
+
+
+static void *
+shared_reader(void *ctx)
+{
+        ag_cregistry *r = ctx;
+
+        for (register size_t i = 0; i < 20000; i++) {
+                register size_t k = i % 64 + 1;
+                struct shared *e = ag_cregistry_get(r, ag_hash_new(k));
+
+                if (!e || e->val != k) {
+                        r = NULL;
+                        break;
+                }
+
+                shared_dispose(e);
+        }
+
+        return r;
+}
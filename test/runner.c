@@ -48,6 +48,14 @@ int main(int argc, char **argv)
         ag_test_suite *req = test_suite_http_request();
         ag_test_suite *resp = test_suite_http_response();
         ag_test_suite *plug = test_suite_plugin();
+        ag_test_suite *pack = test_suite_pack();
+        ag_test_suite *map = test_suite_map();
+        ag_test_suite *omap = test_suite_omap();
+        ag_test_suite *vec = test_suite_vec();
+        ag_test_suite *seq = test_suite_seq();
+        ag_test_suite *registry = test_suite_registry();
+        ag_test_suite *uuid = test_suite_uuid();
+        ag_test_suite *srv = test_suite_http_server();
 
         ag_test_harness_push(th, log);
         ag_test_harness_push(th, mblock);
@@ -63,6 +71,14 @@ int main(int argc, char **argv)
         ag_test_harness_push(th, req);
         ag_test_harness_push(th, resp);
         ag_test_harness_push(th, plug);
+        ag_test_harness_push(th, pack);
+        ag_test_harness_push(th, map);
+        ag_test_harness_push(th, omap);
+        ag_test_harness_push(th, vec);
+        ag_test_harness_push(th, seq);
+        ag_test_harness_push(th, registry);
+        ag_test_harness_push(th, uuid);
+        ag_test_harness_push(th, srv);
 
         ag_test_suite_release(&log);
         ag_test_suite_release(&mblock);
@@ -78,6 +94,14 @@ int main(int argc, char **argv)
         ag_test_suite_release(&req);
         ag_test_suite_release(&resp);
         ag_test_suite_release(&plug);
+        ag_test_suite_release(&pack);
+        ag_test_suite_release(&map);
+        ag_test_suite_release(&omap);
+        ag_test_suite_release(&vec);
+        ag_test_suite_release(&seq);
+        ag_test_suite_release(&registry);
+        ag_test_suite_release(&uuid);
+        ag_test_suite_release(&srv);
 
         ag_test_harness_exec(th);
         ag_test_harness_log(th, stdout);
@@ -0,0 +1,262 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./test.h"
+
+
+/*
+ * Define the ID of the test suite for the sequence interface. We need this ID
+ * for the testing macros to correctly generate the boilerplate testing code.
+ */
+
+
+#define __AG_TEST_SUITE_ID__ 18
+
+
+/*
+ * Declare the prototypes for generating sample lists. sample_int() creates a
+ * list of the integers 1 through 10,000, and sample_str() creates a list of
+ * three strings.
+ */
+
+
+static ag_list  *sample_int(void);
+static ag_list  *sample_str(void);
+
+
+/*
+ * Declare the prototypes for the callback functions used by the test cases.
+ * transform_tenfold() multiplies an integer by ten, and predicate_even() keeps
+ * even integers. generator_count() generates the integers from 1 onwards
+ * without end, counting its calls through its context, and generator_dispose()
+ * marks its context as disposed by negating it.
+ */
+
+
+static ag_value *transform_tenfold(const ag_value *, void *);
+static bool      predicate_even(const ag_value *, void *);
+static ag_value *generator_count(void *);
+static void      generator_dispose(void *);
+
+
+AG_TEST_CASE("ag_seq_collect(): ag_seq_from_list() => same list")
+{
+        AG_AUTO(ag_list) *l = sample_int();
+        AG_AUTO(ag_seq) *s = ag_seq_from_list(l);
+        AG_AUTO(ag_list) *l2 = ag_seq_collect(s);
+
+        AG_TEST (ag_list_eq(l, l2) && !ag_seq_next(s));
+}
+
+
+AG_TEST_CASE("ag_seq_collect(): empty list => empty list")
+{
+        AG_AUTO(ag_list) *l = ag_list_new();
+        AG_AUTO(ag_seq) *s = ag_seq_from_list(l);
+        AG_AUTO(ag_list) *l2 = ag_seq_collect(s);
+
+        AG_TEST (ag_list_empty(l2));
+}
+
+
+AG_TEST_CASE("ag_seq_next(): ag_seq_from_list() => values in order")
+{
+        AG_AUTO(ag_list) *l = sample_int();
+        AG_AUTO(ag_seq) *s = ag_seq_from_list(l);
+        register ag_int i = 0;
+        const ag_value *v;
+        register bool t = true;
+
+        ag_list_release(&l);
+
+        while ((v = ag_seq_next(s)))
+                t &= ag_value_int(v) == ++i;
+
+        AG_TEST (t && i == 10000);
+}
+
+
+AG_TEST_CASE("ag_seq_filter(): filter, map and take => fused pipeline")
+{
+        AG_AUTO(ag_list) *l = sample_int();
+        AG_AUTO(ag_seq) *s = ag_seq_take(ag_seq_map(ag_seq_filter(
+            ag_seq_from_list(l), predicate_even, NULL), transform_tenfold,
+            NULL), 5);
+        AG_AUTO(ag_list) *l2 = ag_seq_collect(s);
+        register bool t = ag_list_len(l2) == 5;
+
+        for (register size_t i = 1; t && i <= 5; i++) {
+                AG_AUTO(ag_value) *v = ag_list_get_at(l2, i);
+                t &= ag_value_int(v) == (ag_int)i * 20;
+        }
+
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_seq_take(): endless generator => stops pulling")
+{
+        ag_int n = 0;
+        AG_AUTO(ag_seq) *s = ag_seq_take(ag_seq_new(generator_count, &n,
+            NULL), 3);
+        AG_AUTO(ag_list) *l = ag_seq_collect(s);
+
+        AG_TEST (ag_list_len(l) == 3 && n == 3 && !ag_seq_next(s));
+}
+
+
+AG_TEST_CASE("ag_seq_skip(): sample_int() => remaining values")
+{
+        AG_AUTO(ag_list) *l = sample_int();
+        AG_AUTO(ag_seq) *s = ag_seq_skip(ag_seq_from_list(l), 9990);
+        AG_AUTO(ag_list) *l2 = ag_seq_collect(s);
+        AG_AUTO(ag_value) *v = ag_list_get_at(l2, 1);
+
+        AG_AUTO(ag_seq) *s2 = ag_seq_skip(ag_seq_from_list(l), 20000);
+        AG_AUTO(ag_list) *l3 = ag_seq_collect(s2);
+
+        AG_TEST (ag_list_len(l2) == 10 && ag_value_int(v) == 9991
+            && ag_list_empty(l3));
+}
+
+
+AG_TEST_CASE("ag_seq_zip(): sequences of unequal length => shorter length")
+{
+        AG_AUTO(ag_list) *l = sample_int();
+        AG_AUTO(ag_list) *l2 = sample_str();
+        AG_AUTO(ag_seq) *s = ag_seq_zip(ag_seq_from_list(l),
+            ag_seq_from_list(l2));
+        AG_AUTO(ag_list) *l3 = ag_seq_collect(s);
+        AG_AUTO(ag_value) *v = ag_list_get_at(l3, 3);
+        const ag_field *f = ag_value_object(v);
+
+        AG_TEST (ag_list_len(l3) == 3
+            && ag_value_int(ag_field_key_peek(f)) == 3
+            && ag_string_eq(ag_value_string(ag_field_val_peek(f)), "fig"));
+}
+
+
+AG_TEST_CASE("ag_seq_from_lines(): file => lines without terminators")
+{
+        FILE *file = tmpfile();
+        fputs("alpha\nbeta\r\n\ngamma", file);
+        rewind(file);
+
+        AG_AUTO(ag_seq) *s = ag_seq_from_lines(file);
+        AG_AUTO(ag_list) *l = ag_seq_collect(s);
+        AG_AUTO(ag_value) *v = ag_list_get_at(l, 2);
+        AG_AUTO(ag_value) *v2 = ag_list_get_at(l, 3);
+        AG_AUTO(ag_value) *v3 = ag_list_get_at(l, 4);
+
+        fclose(file);
+
+        AG_TEST (ag_list_len(l) == 4
+            && ag_string_eq(ag_value_string(v), "beta")
+            && ag_string_eq(ag_value_string(v2), "")
+            && ag_string_eq(ag_value_string(v3), "gamma"));
+}
+
+
+AG_TEST_CASE("ag_seq_release(): generator => context disposed")
+{
+        ag_int n = 0;
+        ag_seq *s = ag_seq_map(ag_seq_new(generator_count, &n,
+            generator_dispose), transform_tenfold, NULL);
+        const ag_value *v = ag_seq_next(s);
+        register bool t = ag_value_int(v) == 10;
+
+        ag_seq_release(&s);
+        AG_TEST (t && !s && n == -1);
+}
+
+
+extern ag_test_suite *
+test_suite_seq(void)
+{
+        return AG_TEST_SUITE_GENERATE("ag_seq interface");
+}
+
+
+static ag_list *
+sample_int(void)
+{
+        ag_list *l = ag_list_new();
+
+        for (register ag_int i = 1; i <= 10000; i++) {
+                AG_AUTO(ag_value) *v = ag_value_new_int(i);
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
+static ag_list *
+sample_str(void)
+{
+        const char *s[] = {"pear", "apple", "fig"};
+        ag_list *l = ag_list_new();
+
+        for (register size_t i = 0; i < 3; i++) {
+                AG_AUTO(ag_string) *e = ag_string_new(s[i]);
+                AG_AUTO(ag_value) *v = ag_value_new_string(e);
+                ag_list_push(&l, v);
+        }
+
+        return l;
+}
+
+
+static ag_value *
+transform_tenfold(const ag_value *val, void *in)
+{
+        (void)in;
+
+        return ag_value_new_int(ag_value_int(val) * 10);
+}
+
+
+static bool
+predicate_even(const ag_value *val, void *in)
+{
+        (void)in;
+
+        return !(ag_value_int(val) % 2);
+}
+
+
+static ag_value *
+generator_count(void *ctx)
+{
+        ag_int *n = ctx;
+
+        return ag_value_new_int(++*n);
+}
+
+
+static void
+generator_dispose(void *ctx)
+{
+        ag_int *n = ctx;
+
+        *n = -*n;
+}
@@ -92,6 +92,32 @@ AG_TEST_CASE("ag_string_new_fmt() can create a formatted Unicode string")
 }
 
 
+/*
+ * Define the test cases for ag_string_new_json().
+ */
+
+
+AG_TEST_CASE("ag_string_new_json() quotes an empty string")
+{
+        AG_AUTO(ag_string) *s = ag_string_new_json("");
+        AG_TEST (ag_string_eq(s, "\"\""));
+}
+
+
+AG_TEST_CASE("ag_string_new_json() escapes quotes, backslashes and controls")
+{
+        AG_AUTO(ag_string) *s = ag_string_new_json("a\"b\\c\td");
+        AG_TEST (ag_string_eq(s, "\"a\\\"b\\\\c\\u0009d\""));
+}
+
+
+AG_TEST_CASE("ag_string_new_json() keeps a Unicode string as is")
+{
+        AG_AUTO(ag_string) *s = ag_string_new_json("नमस्ते");
+        AG_TEST (ag_string_eq(s, "\"नमस्ते\""));
+}
+
+
 /*
  * Define the test cases for ag_string_copy().
  */
@@ -41,6 +41,14 @@ extern ag_test_suite    *test_suite_http_client(void);
 extern ag_test_suite    *test_suite_http_request(void);
 extern ag_test_suite    *test_suite_http_response(void);
 extern ag_test_suite    *test_suite_plugin(void);
+extern ag_test_suite    *test_suite_pack(void);
+extern ag_test_suite    *test_suite_map(void);
+extern ag_test_suite    *test_suite_omap(void);
+extern ag_test_suite    *test_suite_vec(void);
+extern ag_test_suite    *test_suite_seq(void);
+extern ag_test_suite    *test_suite_registry(void);
+extern ag_test_suite    *test_suite_uuid(void);
+extern ag_test_suite    *test_suite_http_server(void);
 
 
 #endif /* !__ARGENT_TEST_TEST_H__ */
@@ -0,0 +1,169 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+
+/*
+ * Define the ID of the test suite for the UUID interface. We need this ID for
+ * the testing macros to correctly generate the boilerplate testing code.
+ */
+
+
+#define __AG_TEST_SUITE_ID__ 20
+
+
+/*
+ * Declare the prototypes for the helper functions used by the test cases.
+ * sample_count is the number of UUIDs generated by the bulk test cases, which
+ * is large enough for the per-thread random buffer to be refilled a few times.
+ * uuid_memcmp() is a qsort() callback ordering UUIDs by their bytes.
+ */
+
+
+#define SAMPLE_COUNT 10000
+
+static int uuid_memcmp(const void *, const void *);
+
+
+AG_TEST_CASE("ag_uuid_new(): version 4 and RFC 4122 variant bits set")
+{
+        register bool t = true;
+
+        for (register size_t i = 0; t && i < SAMPLE_COUNT; i++) {
+                AG_AUTO(ag_uuid) *u = ag_uuid_new();
+                t &= (u->uuid[6] >> 4) == 4 && (u->uuid[8] >> 6) == 2;
+        }
+
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_uuid_generate(): AG_UUID_V4 => distinct UUIDs")
+{
+        ag_uuid *u = malloc(SAMPLE_COUNT * sizeof *u);
+        register bool t = true;
+
+        for (register size_t i = 0; i < SAMPLE_COUNT; i++)
+                ag_uuid_generate(&u[i], AG_UUID_V4);
+
+        qsort(u, SAMPLE_COUNT, sizeof *u, uuid_memcmp);
+
+        for (register size_t i = 1; t && i < SAMPLE_COUNT; i++)
+                t &= memcmp(&u[i - 1], &u[i], sizeof *u) != 0;
+
+        free(u);
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_uuid_new_version(): AG_UUID_V7 => current timestamp")
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t now = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+        AG_AUTO(ag_uuid) *u = ag_uuid_new_version(AG_UUID_V7);
+        uint64_t ms = 0;
+
+        for (register int i = 0; i < 6; i++)
+                ms = (ms << 8) | u->uuid[i];
+
+        AG_TEST ((u->uuid[6] >> 4) == 7 && (u->uuid[8] >> 6) == 2
+            && ms >= now && ms < now + 1000);
+}
+
+
+AG_TEST_CASE("ag_uuid_generate(): AG_UUID_V7 => strictly increasing")
+{
+        ag_uuid prev, cur;
+        register bool t = true;
+
+        ag_uuid_generate(&prev, AG_UUID_V7);
+
+        for (register size_t i = 0; t && i < SAMPLE_COUNT; i++) {
+                ag_uuid_generate(&cur, AG_UUID_V7);
+                t &= ag_uuid_lt(&prev, &cur);
+                prev = cur;
+        }
+
+        AG_TEST (t);
+}
+
+
+AG_TEST_CASE("ag_uuid_fmt(): ag_uuid_parse() => same UUID")
+{
+        AG_AUTO(ag_uuid) *u = ag_uuid_parse(
+            "0189B2A4-7C3E-7F01-8A2B-3C4D5E6F7081");
+        char bfr[AG_UUID_STR_LEN];
+
+        ag_uuid_fmt(u, bfr);
+        AG_TEST (!strcmp(bfr, "0189B2A4-7C3E-7F01-8A2B-3C4D5E6F7081"));
+}
+
+
+AG_TEST_CASE("ag_uuid_new(): forked child => different UUIDs from parent")
+{
+        int fd[2];
+        ag_uuid pu, cu;
+        register bool t = !pipe(fd);
+
+        ag_uuid_generate(&pu, AG_UUID_V4);
+
+        if (t) {
+                pid_t pid = fork();
+
+                if (!pid) {
+                        ag_uuid_generate(&cu, AG_UUID_V4);
+                        _exit(write(fd[1], &cu, sizeof cu) != sizeof cu);
+                }
+
+                ag_uuid_generate(&pu, AG_UUID_V4);
+                t = read(fd[0], &cu, sizeof cu) == sizeof cu;
+
+                waitpid(pid, NULL, 0);
+                close(fd[0]);
+                close(fd[1]);
+        }
+
+        AG_TEST (t && !ag_uuid_eq(&pu, &cu));
+}
+
+
+extern ag_test_suite *
+test_suite_uuid(void)
+{
+        return AG_TEST_SUITE_GENERATE("ag_uuid interface");
+}
+
+
+static int
+uuid_memcmp(const void *lhs, const void *rhs)
+{
+        return memcmp(lhs, rhs, sizeof (ag_uuid));
+}
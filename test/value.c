@@ -560,6 +560,26 @@ AG_TEST_CASE("ag_value_len() returns the length of the string for a string "
 }
 
 
+AG_TEST_CASE("ag_value_json() renders a string value as a JSON string")
+{
+        AG_AUTO(ag_string) *s = ag_string_new("say \"hi\"\n");
+        AG_AUTO(ag_value) *v = ag_value_new_string(s);
+        AG_AUTO(ag_string) *j = ag_value_json(v);
+
+        AG_TEST (ag_string_eq(j, "\"say \\\"hi\\\"\\u000a\""));
+}
+
+
+AG_TEST_CASE("ag_value_json() renders a numeric value as a JSON number")
+{
+        AG_AUTO(ag_value) *v = sample_value_float();
+        AG_AUTO(ag_string) *j = ag_value_json(v);
+        AG_AUTO(ag_string) *s = ag_value_str(v);
+
+        AG_TEST (ag_string_eq(j, s));
+}
+
+
 AG_TEST_CASE("ag_value_len() returns the length of the object for an object "
     "value")
 {
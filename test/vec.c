@@ -0,0 +1,317 @@
+/*******************************************************************************
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * Argent---infrastructure for building web services
+ * Copyright (C) 2020 Abhishek Chakravarti
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can contact Abhishek Chakravarti at <abhishek@taranjali.org>.
+ ******************************************************************************/
+
+#include "./test.h"
+#include "./object.h"
+
+
+/*
+ * Define the ID of the test suite for the typed vector interface. We need this
+ * ID for the testing macros to correctly generate the boilerplate testing code.
+ */
+
+
+#define __AG_TEST_SUITE_ID__ 17
+
+
+/*
+ * Declare the prototypes for generating sample vectors. sample_empty() creates
+ * an empty integer vector, sample_int() creates an integer vector of the 1,000
+ * integers from 0 to 999 in a scrambled order, and sample_int_2() creates the
+ * same vector with one more element. sample_float() creates a vector of 1,001
+ * floating point numbers, and sample_str() creates a vector of three strings.
+ */
+
+
+static ag_vec_int       *sample_empty(void);
+static ag_vec_int       *sample_int(void);
+static ag_vec_int       *sample_int_2(void);
+static ag_vec_float     *sample_float(void);
+static ag_vec_str       *sample_str(void);
+
+
+AG_METATEST_OBJECT_COPY(ag_vec_int, sample_int());
+AG_METATEST_OBJECT_CLONE(ag_vec_int, sample_int());
+AG_METATEST_OBJECT_RELEASE(ag_vec_int, sample_int());
+AG_METATEST_OBJECT_CMP(ag_vec_int, sample_int(), sample_int_2());
+AG_METATEST_OBJECT_EMPTY(ag_vec_int, sample_empty());
+AG_METATEST_OBJECT_EMPTY_NOT(ag_vec_int, sample_int());
+AG_METATEST_OBJECT_VALID(ag_vec_int, sample_int());
+AG_METATEST_OBJECT_VALID_NOT(ag_vec_int, sample_empty());
+AG_METATEST_OBJECT_TYPEID(ag_vec_int, sample_int(), AG_TYPEID_VEC_INT);
+AG_METATEST_OBJECT_LEN(ag_vec_int, sample_empty(), 0);
+AG_METATEST_OBJECT_LEN(ag_vec_int, sample_int(), 1000);
+AG_METATEST_OBJECT_COPY(ag_vec_str, sample_str());
+AG_METATEST_OBJECT_CLONE(ag_vec_str, sample_str());
+AG_METATEST_OBJECT_RELEASE(ag_vec_str, sample_str());
+AG_METATEST_OBJECT_TYPEID(ag_vec_str, sample_str(), AG_TYPEID_VEC_STR);
+AG_METATEST_OBJECT_JSON_HAS(ag_vec_str, sample_str(), "[\"pear\",\"");
+
+
+AG_TEST_CASE("ag_vec_int_push(): sample_empty() => elements in order")
+{
+        AG_AUTO(ag_vec_int) *v = sample_empty();
+        register bool t = true;
+
+        for (register ag_int i = 0; i < 100; i++)
+                ag_vec_int_push(&v, -i);
+
+        for (register size_t i = 1; i <= 100; i++)
+                t &= ag_vec_int_get_at(v, i) == -(ag_int)(i - 1);
+
+        AG_TEST (t && ag_vec_int_len(v) == 100);
+}
+
+
+AG_TEST_CASE("ag_vec_int_set_at(): copy of a vector => original unaffected")
+{
+        AG_AUTO(ag_vec_int) *v = sample_int();
+        AG_AUTO(ag_vec_int) *v2 = ag_vec_int_copy(v);
+        ag_int old = ag_vec_int_get_at(v, 42);
+
+        ag_vec_int_set_at(&v2, -1, 42);
+        ag_vec_int_push(&v2, -2);
+
+        AG_TEST (ag_vec_int_get_at(v, 42) == old
+            && ag_vec_int_get_at(v2, 42) == -1 && ag_vec_int_len(v) == 1000
+            && ag_vec_int_len(v2) == 1001);
+}
+
+
+AG_TEST_CASE("ag_vec_int_sort(): sample_int() => ascending order")
+{
+        AG_AUTO(ag_vec_int) *v = sample_int();
+        AG_AUTO(ag_vec_int) *v2 = ag_vec_int_copy(v);
+        ag_vec_int_sort(&v2);
+
+        const ag_int *d = ag_vec_int_data(v2);
+        register bool t = true;
+
+        for (register ag_int i = 0; i < 1000; i++)
+                t &= d[i] == i;
+
+        AG_TEST (t && ag_vec_int_data(v)[1] == 617);
+}
+
+
+AG_TEST_CASE("ag_vec_int_sort(): many duplicates => ascending order")
+{
+        AG_AUTO(ag_vec_int) *v = sample_empty();
+        register bool t = true;
+
+        for (register ag_int i = 0; i < 5000; i++)
+                ag_vec_int_push(&v, (i * 7919) % 13);
+
+        ag_vec_int_sort(&v);
+        const ag_int *d = ag_vec_int_data(v);
+
+        for (register size_t i = 1; i < 5000; i++)
+                t &= d[i - 1] <= d[i];
+
+        AG_TEST (t && ag_vec_int_len(v) == 5000);
+}
+
+
+AG_TEST_CASE("ag_vec_str_sort(): sample_str() => ascending order")
+{
+        AG_AUTO(ag_vec_str) *v = sample_str();
+        ag_vec_str_sort(&v);
+
+        ag_string *const *d = ag_vec_str_data(v);
+
+        AG_TEST (ag_string_eq(d[0], "apple") && ag_string_eq(d[1], "fig")
+            && ag_string_eq(d[2], "pear"));
+}
+
+
+AG_TEST_CASE("ag_vec_int_sum(): sample_int() => 499500")
+{
+        AG_AUTO(ag_vec_int) *v = sample_int();
+        AG_AUTO(ag_vec_int) *v2 = sample_empty();
+
+        AG_TEST (ag_vec_int_sum(v) == 499500 && !ag_vec_int_sum(v2));
+}
+
+
+AG_TEST_CASE("ag_vec_int_min(): sample_int() => 0 and 999")
+{
+        AG_AUTO(ag_vec_int) *v = sample_int();
+        AG_TEST (!ag_vec_int_min(v) && ag_vec_int_max(v) == 999);
+}
+
+
+AG_TEST_CASE("ag_vec_float_sum(): sample_float() => sum, min and max")
+{
+        AG_AUTO(ag_vec_float) *v = sample_float();
+
+        AG_TEST (ag_vec_float_sum(v) == 249749.5
+            && ag_vec_float_min(v) == -0.5 && ag_vec_float_max(v) == 499.5);
+}
+
+
+AG_TEST_CASE("ag_vec_int_list(): sample_int() => round trips")
+{
+        AG_AUTO(ag_vec_int) *v = sample_int();
+        AG_AUTO(ag_list) *l = ag_vec_int_list(v);
+        AG_AUTO(ag_vec_int) *v2 = ag_vec_int_new_list(l);
+        AG_AUTO(ag_value) *e = ag_list_get_at(l, 10);
+
+        AG_TEST (ag_list_len(l) == 1000 && ag_vec_int_eq(v, v2)
+            && ag_value_int(e) == ag_vec_int_get_at(v, 10));
+}
+
+
+AG_TEST_CASE("ag_vec_str_list(): sample_str() => round trips")
+{
+        AG_AUTO(ag_vec_str) *v = sample_str();
+        AG_AUTO(ag_list) *l = ag_vec_str_list(v);
+        AG_AUTO(ag_vec_str) *v2 = ag_vec_str_new_list(l);
+
+        AG_TEST (ag_list_len(l) == 3 && ag_vec_str_eq(v, v2));
+}
+
+
+AG_TEST_CASE("ag_vec_str_set_at(): own element => set without being freed")
+{
+        AG_AUTO(ag_vec_str) *v = sample_str();
+
+        ag_vec_str_set_at(&v, ag_vec_str_data(v)[0], 1);
+        ag_vec_str_set_at(&v, ag_vec_str_data(v)[1], 3);
+
+        AG_AUTO(ag_string) *s1 = ag_vec_str_get_at(v, 1);
+        AG_AUTO(ag_string) *s3 = ag_vec_str_get_at(v, 3);
+
+        AG_TEST (ag_string_eq(s1, "pear") && ag_string_eq(s3, "apple"));
+}
+
+
+AG_TEST_CASE("ag_vec_str_freeze(): frozen vector => copies can still be set")
+{
+        AG_AUTO(ag_vec_str) *v = sample_str();
+        AG_AUTO(ag_string) *s = ag_string_new("kiwi");
+
+        ag_vec_str_freeze(v);
+        ag_vec_str *v2 = ag_vec_str_copy(v);
+        ag_vec_str_set_at(&v2, s, 1);
+
+        AG_AUTO(ag_string) *s1 = ag_vec_str_get_at(v, 1);
+        AG_AUTO(ag_string) *s2 = ag_vec_str_get_at(v2, 1);
+        bool t = ag_string_eq(s1, "pear") && ag_string_eq(s2, "kiwi");
+
+        ag_vec_str_release(&v2);
+        AG_TEST (t && ag_vec_str_frozen(v));
+}
+
+
+AG_TEST_CASE("ag_object_pack(): sample_int() => round trips")
+{
+        AG_AUTO(ag_vec_int) *v = sample_int();
+        AG_AUTO(ag_value) *o = ag_value_new_object(v);
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_value_pack(o, pk);
+
+        struct ag_unpack rd;
+        ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+        AG_AUTO(ag_value) *o2 = ag_value_unpack(&rd);
+
+        AG_TEST (ag_unpack_done(&rd)
+            && ag_vec_int_eq(v, ag_value_object(o2)));
+}
+
+
+AG_TEST_CASE("ag_object_pack(): sample_str() => round trips")
+{
+        AG_AUTO(ag_vec_str) *v = sample_str();
+        AG_AUTO(ag_value) *o = ag_value_new_object(v);
+        AG_AUTO(ag_pack) *pk = ag_pack_new();
+        ag_value_pack(o, pk);
+
+        struct ag_unpack rd;
+        ag_unpack_init(&rd, ag_pack_bfr(pk), ag_pack_len(pk));
+        AG_AUTO(ag_value) *o2 = ag_value_unpack(&rd);
+
+        AG_TEST (ag_unpack_done(&rd)
+            && ag_vec_str_eq(v, ag_value_object(o2)));
+}
+
+
+extern ag_test_suite *
+test_suite_vec(void)
+{
+        return AG_TEST_SUITE_GENERATE("ag_vec interface");
+}
+
+
+static ag_vec_int *
+sample_empty(void)
+{
+        return ag_vec_int_new();
+}
+
+
+static ag_vec_int *
+sample_int(void)
+{
+        ag_vec_int *v = ag_vec_int_new();
+
+        for (register ag_int i = 0; i < 1000; i++)
+                ag_vec_int_push(&v, (i * 617) % 1000);
+
+        return v;
+}
+
+
+static ag_vec_int *
+sample_int_2(void)
+{
+        ag_vec_int *v = sample_int();
+        ag_vec_int_push(&v, 1000);
+
+        return v;
+}
+
+
+static ag_vec_float *
+sample_float(void)
+{
+        ag_vec_float *v = ag_vec_float_new();
+
+        for (register ag_int i = -1; i < 1000; i++)
+                ag_vec_float_push(&v, i * 0.5);
+
+        return v;
+}
+
+
+static ag_vec_str *
+sample_str(void)
+{
+        const char *s[] = {"pear", "apple", "fig"};
+        ag_vec_str *v = ag_vec_str_new();
+
+        for (register size_t i = 0; i < 3; i++) {
+                AG_AUTO(ag_string) *e = ag_string_new(s[i]);
+                ag_vec_str_push(&v, e);
+        }
+
+        return v;
+}